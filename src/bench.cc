@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
@@ -6,9 +7,11 @@
 #include <time.h>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <boost/program_options.hpp>
 #include "zlog/options.h"
 #include "zlog/log.h"
+#include "zlog/record.h"
 #include "randbytes.h"
 
 namespace po = boost::program_options;
@@ -61,17 +64,123 @@ static void stats_entry()
   }
 }
 
+static void producer_entry(zlog::Log *log, zlog::RecordPacker *packer,
+    size_t entry_size, size_t batch, std::atomic<bool> *stop)
+{
+  // the generator isn't thread-safe, so each producer gets its own
+  zlog::util::rand_data_gen dgen(
+      std::max<size_t>(1ULL << 20, entry_size * 4), entry_size);
+  dgen.generate();
+
+  while (!shutdown && !*stop && packer) {
+    int ret = packer->appendAsync(std::string(dgen.sample(), entry_size),
+        [](int ret, zlog::RecordAddress addr) {
+      if (ret && ret != -ESHUTDOWN) {
+        std::cerr << "packed appendAsync cb failed: " << strerror(-ret) << std::endl;
+        assert(0);
+        return;
+      }
+      op_count++;
+    });
+    if (ret) {
+      std::cerr << "packed appendAsync failed: " << strerror(-ret) << std::endl;
+      assert(0);
+      break;
+    }
+  }
+
+  while (!shutdown && !*stop && !packer && batch > 1) {
+    std::vector<std::string> entries;
+    entries.reserve(batch);
+    for (size_t i = 0; i < batch; i++) {
+      entries.emplace_back(dgen.sample(), entry_size);
+    }
+    int ret = log->appendBatchAsync(std::move(entries),
+        [batch](int ret, std::vector<uint64_t>& positions) {
+      if (ret && ret != -ESHUTDOWN) {
+        std::cerr << "appendBatchAsync cb failed: " << strerror(-ret) << std::endl;
+        assert(0);
+        return;
+      }
+      op_count += batch;
+    });
+    if (ret) {
+      std::cerr << "appendBatchAsync failed: " << strerror(-ret) << std::endl;
+      assert(0);
+      break;
+    }
+  }
+
+  while (!shutdown && !*stop && !packer && batch <= 1) {
+    const auto entry_data = std::string(dgen.sample(), entry_size);
+    int ret = log->appendAsync(entry_data, [](int ret, uint64_t pos) {
+      if (ret && ret != -ESHUTDOWN) {
+        std::cerr << "appendAsync cb failed: " << strerror(-ret) << std::endl;
+        assert(0);
+        return;
+      }
+      op_count++;
+    });
+    if (ret) {
+      std::cerr << "appendAsync failed: " << strerror(-ret) << std::endl;
+      assert(0);
+      break;
+    }
+  }
+}
+
+// run a fixed number of producer threads against a log for the given number
+// of seconds and return the average append throughput.
+static double run_producers(zlog::Log *log, zlog::RecordPacker *packer,
+    int producers, int runtime, size_t entry_size, size_t batch)
+{
+  std::atomic<bool> stop(false);
+
+  const auto start_ops_count = op_count.load();
+  const auto start_us = getus();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producers; i++) {
+    threads.emplace_back(producer_entry, log, packer, entry_size, batch,
+        &stop);
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait_for(lk, std::chrono::seconds(runtime),
+        [&] { return shutdown.load(); });
+  }
+
+  stop = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const auto elapsed_us = getus() - start_us;
+  const auto ops = op_count.load() - start_ops_count;
+
+  return (double)(ops * 1000000ULL) / (double)elapsed_us;
+}
+
 int main(int argc, char **argv)
 {
   std::string log_name;
   uint32_t width;
   uint32_t slots;
   size_t entry_size;
+  size_t batch;
   int qdepth;
   int runtime;
   std::string backend_name;
   std::vector<std::string> backend_options;
   int finisher_threads;
+  int min_finisher_threads;
+  int max_finisher_threads;
+  int producers;
+  bool producer_sweep;
+  uint32_t pack_records;
+  uint32_t pack_delay_us;
+  bool ordered_callbacks;
 
   {
     namespace po = boost::program_options;
@@ -86,8 +195,16 @@ int main(int argc, char **argv)
       ("slots", po::value<uint32_t>(&slots)->default_value(10), "object slots")
       ("size", po::value<size_t>(&entry_size)->default_value(1024), "entry size")
       ("qdepth", po::value<int>(&qdepth)->default_value(1), "queue depth")
+      ("batch", po::value<size_t>(&batch)->default_value(1), "entries per append (uses AppendBatch when > 1)")
       ("runtime", po::value<int>(&runtime)->default_value(0), "runtime")
       ("finisher_threads", po::value<int>(&finisher_threads)->default_value(0), "finisher threads")
+      ("min-finisher-threads", po::value<int>(&min_finisher_threads)->default_value(1), "adaptive finisher pool min threads")
+      ("max-finisher-threads", po::value<int>(&max_finisher_threads)->default_value(0), "adaptive finisher pool max threads (0 = fixed pool)")
+      ("producers", po::value<int>(&producers)->default_value(1), "producer threads")
+      ("producer-sweep", po::bool_switch(&producer_sweep), "scale producers from 1 to --producers (runtime per step)")
+      ("pack-records", po::value<uint32_t>(&pack_records)->default_value(0), "pack up to this many entries into each log position (0 = off)")
+      ("pack-delay-us", po::value<uint32_t>(&pack_delay_us)->default_value(1000), "max time to wait for a pack to fill")
+      ("ordered-callbacks", po::bool_switch(&ordered_callbacks), "deliver append callbacks in position order")
       ;
 
     po::variables_map vm;
@@ -126,6 +243,9 @@ int main(int argc, char **argv)
   if (finisher_threads > 0) {
     options.finisher_threads = finisher_threads;
   }
+  options.min_finisher_threads = min_finisher_threads;
+  options.max_finisher_threads = max_finisher_threads;
+  options.ordered_append_callbacks = ordered_callbacks;
 
   zlog::Log *log;
   int ret = zlog::Log::Open(options, log_name, &log);
@@ -134,32 +254,73 @@ int main(int argc, char **argv)
     return -1;
   }
 
+  zlog::RecordPacker *packer = nullptr;
+  if (pack_records > 0) {
+    zlog::RecordPackerOptions popts;
+    popts.max_records = pack_records;
+    popts.max_delay_us = pack_delay_us;
+    ret = zlog::RecordPacker::Create(log, popts, &packer);
+    if (ret) {
+      std::cerr << "record packer create failed: " << strerror(-ret) << std::endl;
+      delete log;
+      return -1;
+    }
+  }
+
   runtime = std::max(runtime, 0);
+  producers = std::max(producers, 1);
   signal(SIGINT, sig_handler);
+
+  op_count = 0;
+
+  if (producer_sweep) {
+    if (runtime == 0) {
+      std::cerr << "producer sweep requires a runtime" << std::endl;
+      delete packer;
+      delete log;
+      return -1;
+    }
+
+    // each step doubles the number of producers, ending with exactly the
+    // number requested.
+    std::vector<int> steps;
+    for (int n = 1; n < producers; n *= 2) {
+      steps.push_back(n);
+    }
+    steps.push_back(producers);
+
+    for (auto n : steps) {
+      if (shutdown) {
+        break;
+      }
+      const auto iops = run_producers(log, packer, n, runtime, entry_size,
+          batch);
+      std::cout << "producers " << n << " iops " << iops << std::endl;
+    }
+
+    delete packer;
+
+    log->PrintStats();
+
+    delete log;
+
+    return 0;
+  }
+
   signal(SIGALRM, sig_handler);
   alarm(runtime);
 
   std::thread stats_thread(stats_entry);
 
-  zlog::util::rand_data_gen dgen(1ULL << 22, entry_size);
-  dgen.generate();
+  std::vector<std::thread> threads;
+  std::atomic<bool> stop(false);
+  for (int i = 0; i < producers; i++) {
+    threads.emplace_back(producer_entry, log, packer, entry_size, batch,
+        &stop);
+  }
 
-  op_count = 0;
-  while (!shutdown) {
-    const auto entry_data = std::string(dgen.sample(), entry_size);
-    int ret = log->appendAsync(entry_data, [&](int ret, uint64_t pos) {
-      if (ret && ret != -ESHUTDOWN) {
-        std::cerr << "appendAsync cb failed: " << strerror(-ret) << std::endl;
-        assert(0);
-        return;
-      }
-      op_count++;
-    });
-    if (ret) {
-      std::cerr << "appendAsync failed: " << strerror(-ret) << std::endl;
-      assert(0);
-      break;
-    }
+  for (auto& thread : threads) {
+    thread.join();
   }
 
   shutdown = true;
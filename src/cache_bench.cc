@@ -0,0 +1,158 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "zlog/options.h"
+#include "zlog/cache.h"
+
+namespace po = boost::program_options;
+
+// measures the scaling of the entry cache hit path. the cache is filled with
+// entries, and then each thread reads random positions for a fixed time. the
+// throughput is reported for each number of threads and each shard setting,
+// along with the speedup relative to a single thread.
+
+struct result {
+  uint64_t ops;
+  double secs;
+};
+
+static result run(zlog::Cache& cache, const std::string& entry,
+    uint64_t entries, int threads, int put_pct, double secs)
+{
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> ops(threads, 0);
+  std::vector<std::thread> workers;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::mt19937_64 gen(t);
+      std::uniform_int_distribution<uint64_t> pos_dist(0, entries - 1);
+      std::uniform_int_distribution<int> pct_dist(0, 99);
+      std::string data;
+      uint64_t count = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 64; i++) {
+          uint64_t pos = pos_dist(gen);
+          if (put_pct && pct_dist(gen) < put_pct) {
+            cache.remove(&pos);
+            cache.put(pos, entry);
+          } else {
+            cache.get(&pos, &data);
+          }
+        }
+        count += 64;
+      }
+      ops[t] = count;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::duration<double>(secs));
+  stop = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  result r{0, elapsed.count()};
+  for (const auto count : ops) {
+    r.ops += count;
+  }
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  size_t entry_size;
+  uint64_t entries;
+  std::vector<int> threads;
+  std::vector<int> shard_bits;
+  std::string policy;
+  int put_pct;
+  double secs;
+
+  po::options_description opts("Benchmark options");
+  opts.add_options()
+    ("help", "show help message")
+    ("size", po::value<size_t>(&entry_size)->default_value(1024), "entry size")
+    ("entries", po::value<uint64_t>(&entries)->default_value(100000), "cached entries")
+    ("threads", po::value<std::vector<int>>(&threads)->multitoken(), "thread counts (default 1 2 4 8 16 32)")
+    ("shard-bits", po::value<std::vector<int>>(&shard_bits)->multitoken(), "shard bits, -1 for the default (default -1 0)")
+    ("policy", po::value<std::string>(&policy)->default_value("lru"), "eviction policy (lru, arc)")
+    ("put-pct", po::value<int>(&put_pct)->default_value(0), "percent of operations that replace an entry")
+    ("secs", po::value<double>(&secs)->default_value(2.0), "seconds per measurement")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, opts), vm);
+
+  if (vm.count("help")) {
+    std::cout << opts << std::endl;
+    return 1;
+  }
+
+  po::notify(vm);
+
+  if (threads.empty()) {
+    threads = {1, 2, 4, 8, 16, 32};
+  }
+  if (shard_bits.empty()) {
+    shard_bits = {-1, 0};
+  }
+  if (entries == 0) {
+    std::cerr << "entries must be greater than zero" << std::endl;
+    return 1;
+  }
+
+  zlog::Options options;
+  if (policy == "lru") {
+    options.eviction = zlog::Eviction::Eviction_Policy::LRU;
+  } else if (policy == "arc") {
+    options.eviction = zlog::Eviction::Eviction_Policy::ARC;
+  } else {
+    std::cerr << "unknown policy: " << policy << std::endl;
+    return 1;
+  }
+
+  // room for every entry, with slack for an uneven spread across the shards
+  options.cache_size = 2 * entries *
+    (entry_size + zlog::Cache::kEntryOverhead);
+
+  const std::string entry(entry_size, 'x');
+
+  std::cout << "hardware threads " << std::thread::hardware_concurrency()
+    << std::endl;
+
+  for (const auto bits : shard_bits) {
+    options.cache_shard_bits = bits;
+    zlog::Cache cache(options);
+
+    for (uint64_t pos = 0; pos < entries; pos++) {
+      cache.put(pos, entry);
+    }
+
+    double base = 0;
+    for (const auto count : threads) {
+      const auto r = run(cache, entry, entries, count, put_pct, secs);
+      const double ops_per_sec = r.ops / r.secs;
+      if (base == 0) {
+        base = ops_per_sec;
+      }
+      std::cout << "shards " << cache.num_shards()
+        << " threads " << count
+        << " ops_per_sec " << (uint64_t)ops_per_sec
+        << " scaling " << (ops_per_sec / base)
+        << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,329 @@
+// Compare pipelines of dependent log operations written against the
+// synchronous, callback, and coroutine interfaces. Each pipeline appends an
+// entry, reads it back at the returned position, and repeats. Pipelines run
+// concurrently: one thread per pipeline for the synchronous interface, and
+// no dedicated threads for the callback and coroutine interfaces.
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <boost/program_options.hpp>
+#include "zlog/options.h"
+#include "zlog/log.h"
+#include "zlog/coro.h"
+
+#ifndef ZLOG_HAVE_COROUTINES
+#error "zlog_coro_bench requires compiler support for coroutines"
+#endif
+
+namespace po = boost::program_options;
+
+static inline uint64_t getus()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (((uint64_t)ts.tv_sec) * 1000000ULL) + ts.tv_nsec / 1000;
+}
+
+// counts down completed pipelines
+class Countdown {
+ public:
+  explicit Countdown(int count) :
+    count_(count)
+  {}
+
+  void done() {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (--count_ == 0) {
+      cond_.notify_all();
+    }
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lk(lock_);
+    cond_.wait(lk, [&] { return count_ == 0; });
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable cond_;
+  int count_;
+};
+
+// resumes coroutines on a fixed set of application threads
+class ThreadPoolExecutor : public zlog::Executor {
+ public:
+  explicit ThreadPoolExecutor(int threads) :
+    stop_(false)
+  {
+    for (int i = 0; i < threads; i++) {
+      threads_.emplace_back(&ThreadPoolExecutor::entry, this);
+    }
+  }
+
+  ~ThreadPoolExecutor() {
+    {
+      std::lock_guard<std::mutex> lk(lock_);
+      stop_ = true;
+      cond_.notify_all();
+    }
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Execute(std::function<void()> fn) override {
+    std::lock_guard<std::mutex> lk(lock_);
+    fns_.emplace_back(std::move(fn));
+    cond_.notify_one();
+  }
+
+ private:
+  void entry() {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (true) {
+      cond_.wait(lk, [&] { return stop_ || !fns_.empty(); });
+      if (fns_.empty()) {
+        break;
+      }
+      auto fn = std::move(fns_.front());
+      fns_.pop_front();
+      lk.unlock();
+      fn();
+      lk.lock();
+    }
+  }
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::deque<std::function<void()>> fns_;
+  bool stop_;
+  std::vector<std::thread> threads_;
+};
+
+static void check(int ret)
+{
+  if (ret) {
+    std::cerr << "pipeline failed: " << strerror(-ret) << std::endl;
+    exit(1);
+  }
+}
+
+static void check(int ret, const std::string& entry, const std::string& data)
+{
+  check(ret);
+  if (entry != data) {
+    std::cerr << "pipeline failed: unexpected entry" << std::endl;
+    exit(1);
+  }
+}
+
+static void run_sync(zlog::Log *log, int pipelines, int ops,
+    const std::string& data)
+{
+  std::vector<std::thread> threads;
+  for (int i = 0; i < pipelines; i++) {
+    threads.emplace_back([=] {
+      for (int j = 0; j < ops; j++) {
+        uint64_t pos;
+        int ret = log->Append(data, &pos);
+        std::string entry;
+        if (!ret) {
+          ret = log->Read(pos, &entry);
+        }
+        check(ret, entry, data);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+struct CallbackPipeline {
+  zlog::Log *log;
+  const std::string *data;
+  int remaining;
+  Countdown *countdown;
+
+  void step() {
+    if (remaining-- == 0) {
+      countdown->done();
+      return;
+    }
+
+    int ret = log->appendAsync(*data, [this](int ret, uint64_t pos) {
+      check(ret);
+      ret = log->readAsync(pos, [this](int ret, std::string& entry) {
+        check(ret, entry, *data);
+        step();
+      });
+      check(ret);
+    });
+    check(ret);
+  }
+};
+
+static void run_callback(zlog::Log *log, int pipelines, int ops,
+    const std::string& data)
+{
+  Countdown countdown(pipelines);
+  std::vector<CallbackPipeline> states(pipelines);
+  for (auto& state : states) {
+    state.log = log;
+    state.data = &data;
+    state.remaining = ops;
+    state.countdown = &countdown;
+    state.step();
+  }
+  countdown.wait();
+}
+
+// a coroutine that starts eagerly and frees itself when it finishes
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+static DetachedTask coro_pipeline(zlog::CoroLog *clog, int ops,
+    const std::string *data, Countdown *countdown)
+{
+  for (int i = 0; i < ops; i++) {
+    auto res = co_await clog->Append(*data);
+    check(res.ret);
+    auto entry = co_await clog->Read(res.position);
+    check(entry.ret, entry.data, *data);
+  }
+  countdown->done();
+}
+
+static void run_coro(zlog::Log *log, int pipelines, int ops,
+    const std::string& data, zlog::Executor *executor)
+{
+  zlog::CoroLog clog(log, executor);
+  Countdown countdown(pipelines);
+  for (int i = 0; i < pipelines; i++) {
+    coro_pipeline(&clog, ops, &data, &countdown);
+  }
+  countdown.wait();
+}
+
+int main(int argc, char **argv)
+{
+  std::string log_name;
+  std::string backend_name;
+  std::vector<std::string> backend_options;
+  std::vector<std::string> modes;
+  int pipelines;
+  int ops;
+  size_t entry_size;
+  int finisher_threads;
+  int executor_threads;
+
+  {
+    po::options_description opts("Benchmark options");
+    opts.add_options()
+      ("help", "show help message")
+      ("backend-name", po::value<std::string>(&backend_name)->required(), "backend name")
+      ("backend-opt", po::value<std::vector<std::string>>(&backend_options)->multitoken(), "backend options")
+      ("name", po::value<std::string>(&log_name)->default_value("bench"), "log name")
+      ("mode", po::value<std::vector<std::string>>(&modes)->multitoken(), "sync, callback, coro (default: all)")
+      ("pipelines", po::value<int>(&pipelines)->default_value(16), "concurrent pipelines")
+      ("ops", po::value<int>(&ops)->default_value(1000), "append+read steps per pipeline")
+      ("size", po::value<size_t>(&entry_size)->default_value(1024), "entry size")
+      ("finisher_threads", po::value<int>(&finisher_threads)->default_value(0), "finisher threads")
+      ("executor-threads", po::value<int>(&executor_threads)->default_value(0), "resume coroutines on this many application threads (0: resume on zlog threads)")
+      ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opts), vm);
+
+    if (vm.count("help")) {
+      std::cout << opts << std::endl;
+      return 1;
+    }
+
+    po::notify(vm);
+  }
+
+  if (modes.empty()) {
+    modes = {"sync", "callback", "coro"};
+  }
+
+  zlog::Options options;
+  for (auto option : backend_options) {
+    auto pos = option.find(":");
+    if (pos == std::string::npos) {
+      std::cout << "invalid option " << option << std::endl;
+      exit(1);
+    }
+    auto key = option.substr(0, pos);
+    auto val = option.substr(pos+1, option.size()-key.size()-1);
+    options.backend_options[key] = val;
+  }
+
+  pipelines = std::max(pipelines, 1);
+
+  options.backend_name = backend_name;
+  options.create_if_missing = true;
+  options.error_if_exists = true;
+  // a pipeline submits its next op from the completion of its previous op,
+  // which holds its slot until the completion returns.
+  options.max_inflight_ops = std::max<uint32_t>(options.max_inflight_ops,
+      2 * pipelines);
+  if (finisher_threads > 0) {
+    options.finisher_threads = finisher_threads;
+  }
+
+  zlog::Log *log;
+  int ret = zlog::Log::Open(options, log_name, &log);
+  if (ret) {
+    std::cerr << "log::open failed: " << strerror(-ret) << std::endl;
+    return -1;
+  }
+
+  std::unique_ptr<ThreadPoolExecutor> executor;
+  if (executor_threads > 0) {
+    executor.reset(new ThreadPoolExecutor(executor_threads));
+  }
+
+  const std::string data(entry_size, 'x');
+
+  for (const auto& mode : modes) {
+    const auto start_us = getus();
+    if (mode == "sync") {
+      run_sync(log, pipelines, ops, data);
+    } else if (mode == "callback") {
+      run_callback(log, pipelines, ops, data);
+    } else if (mode == "coro") {
+      run_coro(log, pipelines, ops, data, executor.get());
+    } else {
+      std::cerr << "invalid mode " << mode << std::endl;
+      return -1;
+    }
+    const auto elapsed_us = getus() - start_us;
+    const auto total = 2ULL * pipelines * ops;
+    std::cout << mode << " pipelines " << pipelines
+      << " ops " << total
+      << " elapsed_us " << elapsed_us
+      << " ops/s " << (double)(total * 1000000ULL) / (double)elapsed_us
+      << std::endl;
+  }
+
+  executor.reset();
+  delete log;
+
+  return 0;
+}
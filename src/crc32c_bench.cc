@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <boost/program_options.hpp>
+#include "zlog/options.h"
+#include "zlog/log.h"
+#include "util/crc32c.h"
+
+namespace po = boost::program_options;
+
+// measures the cost of entry checksums. the throughput of the hardware and
+// portable crc32c implementations is reported for a range of entry sizes,
+// followed by the cost of checksumming an entry relative to the time it takes
+// to append it to a log.
+
+static inline uint64_t getns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (((uint64_t)ts.tv_sec) * 1000000000ULL) + ts.tv_nsec;
+}
+
+static std::string make_entry(size_t size, unsigned seed)
+{
+  std::string s(size, 0);
+  uint32_t x = seed * 2654435761U + 1;
+  for (auto& c : s) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c = static_cast<char>(x);
+  }
+  return s;
+}
+
+// the result of each run is accumulated so the checksums aren't optimized
+// away
+static uint32_t sink;
+
+// nanoseconds per entry to checksum each of the entries, one at a time
+static double time_sequential(const std::vector<std::string>& entries,
+    bool portable, size_t bytes)
+{
+  const size_t rounds = std::max<size_t>(1, bytes /
+      (entries.size() * entries[0].size() + 1));
+  const auto start = getns();
+  for (size_t r = 0; r < rounds; r++) {
+    for (const auto& entry : entries) {
+      sink += portable ?
+        zlog::crc32c::ExtendPortable(0, entry.data(), entry.size()) :
+        zlog::crc32c::Value(entry.data(), entry.size());
+    }
+  }
+  return (double)(getns() - start) / (rounds * entries.size());
+}
+
+// nanoseconds per entry to checksum the entries as a batch
+static double time_batch(const std::vector<std::string>& entries,
+    size_t bytes)
+{
+  const std::vector<zlog::Slice> slices(entries.begin(), entries.end());
+  std::vector<uint32_t> crcs(entries.size());
+  const size_t rounds = std::max<size_t>(1, bytes /
+      (entries.size() * entries[0].size() + 1));
+  const auto start = getns();
+  for (size_t r = 0; r < rounds; r++) {
+    zlog::crc32c::ValueBatch(slices.data(), slices.size(), crcs.data());
+    sink += crcs[0];
+  }
+  return (double)(getns() - start) / (rounds * entries.size());
+}
+
+static double gbps(size_t size, double ns)
+{
+  return ns > 0 ? size / ns : 0.0;
+}
+
+// nanoseconds per append of count entries of the given size
+static double time_appends(zlog::Log *log, size_t size, int count)
+{
+  const auto entry = make_entry(size, 0);
+  const auto start = getns();
+  for (int i = 0; i < count; i++) {
+    int ret = log->Append(entry, nullptr);
+    if (ret) {
+      std::cerr << "append failed: " << strerror(-ret) << std::endl;
+      exit(1);
+    }
+  }
+  return (double)(getns() - start) / count;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<size_t> sizes;
+  size_t batch;
+  size_t bytes;
+  std::string backend_name;
+  size_t append_size;
+  int appends;
+
+  po::options_description opts("Benchmark options");
+  opts.add_options()
+    ("help", "show help message")
+    ("size", po::value<std::vector<size_t>>(&sizes)->multitoken(), "entry sizes (default 64 256 1024 4096 65536)")
+    ("batch", po::value<size_t>(&batch)->default_value(64), "entries per batch")
+    ("bytes", po::value<size_t>(&bytes)->default_value(256 << 20), "bytes checksummed per measurement")
+    ("backend-name", po::value<std::string>(&backend_name)->default_value("ram"), "backend for the append comparison (empty to skip)")
+    ("append-size", po::value<size_t>(&append_size)->default_value(1024), "entry size for the append comparison")
+    ("appends", po::value<int>(&appends)->default_value(20000), "appends per measurement")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, opts), vm);
+
+  if (vm.count("help")) {
+    std::cout << opts << std::endl;
+    return 1;
+  }
+
+  po::notify(vm);
+
+  if (sizes.empty()) {
+    sizes = {64, 256, 1024, 4096, 65536};
+  }
+  batch = std::max<size_t>(batch, 1);
+
+  std::cout << "hardware crc32c: "
+    << (zlog::crc32c::IsFastCrc32Supported() ? "yes" : "no") << std::endl;
+
+  for (const auto size : sizes) {
+    std::vector<std::string> entries;
+    for (size_t i = 0; i < batch; i++) {
+      entries.push_back(make_entry(size, i));
+    }
+
+    const auto portable = time_sequential(entries, true, bytes);
+    const auto sequential = time_sequential(entries, false, bytes);
+    const auto batched = time_batch(entries, bytes);
+
+    std::cout << "size " << size
+      << " portable_gbps " << gbps(size, portable)
+      << " gbps " << gbps(size, sequential)
+      << " batch_gbps " << gbps(size, batched)
+      << " ns_per_entry " << sequential
+      << " batch_ns_per_entry " << batched
+      << std::endl;
+  }
+
+  if (backend_name.empty()) {
+    return 0;
+  }
+
+  // the checksum cost is measured directly rather than as the difference
+  // between appends with and without checksums, which is lost in the noise.
+  std::vector<std::string> entries(1, make_entry(append_size, 0));
+  const auto checksum_ns = time_sequential(entries, false, bytes);
+
+  for (const bool checksums : {false, true}) {
+    zlog::Options options;
+    options.backend_name = backend_name;
+    options.create_if_missing = true;
+    options.error_if_exists = true;
+    options.entry_checksums = checksums;
+
+    zlog::Log *log;
+    const auto name = std::string("crc32c_bench.") +
+      (checksums ? "on" : "off");
+    int ret = zlog::Log::Open(options, name, &log);
+    if (ret) {
+      std::cerr << "log::open failed: " << strerror(-ret) << std::endl;
+      return 1;
+    }
+
+    // warm up: create the sequencer and the initial stripe
+    time_appends(log, append_size, std::min(appends, 1000));
+    const auto append_ns = time_appends(log, append_size, appends);
+
+    std::cout << "append size " << append_size
+      << " checksums " << (checksums ? "on" : "off")
+      << " append_ns " << append_ns;
+    if (checksums) {
+      std::cout << " checksum_ns " << checksum_ns
+        << " checksum_pct " << (100.0 * checksum_ns / append_ns);
+    }
+    std::cout << std::endl;
+
+    delete log;
+  }
+
+  return sink == 0x12345678 ? 2 : 0;
+}
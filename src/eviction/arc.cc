@@ -1,43 +1,22 @@
 #include"zlog/eviction/arc.h"
 #include<algorithm>
-#include<iostream>
-#include"zlog/cache.h"
 
 namespace zlog{
 
 ARC::~ARC(){}
 
 int ARC::cache_get_hit(uint64_t* pos){
-  
-  // std::cout << "read: " << *pos << std::endl;
-  
   if(t1_hash_map.find(*pos) != t1_hash_map.end()){
-    // std::cout << "hit t1 " << std::endl;
     auto it = t1_hash_map[*pos];
     t2_eviction_list.splice(t2_eviction_list.begin(), t1_eviction_list, it);
     t2_hash_map[*pos] = it;
     t1_hash_map.erase(*pos);
   }else if(t2_hash_map.find(*pos) != t2_hash_map.end()){
-    // std::cout << "hit t2 " << std::endl;
     auto it = t2_hash_map[*pos];
     t2_eviction_list.splice(t2_eviction_list.begin(), t2_eviction_list, it);
   }else{
     return -1;
   }
-
-
-  // std::cout << "t1 hash: " << t1_hash_map.size() << std::endl;
-  // std::cout << "t1 list: " << t1_eviction_list.size() << std::endl;
-  // std::cout << "t2 hash: " << t2_hash_map.size() << std::endl;
-  // std::cout << "t2 list: " << t2_eviction_list.size() << std::endl;
-  // std::cout << "b1 hash: " << b1_hash_map.size() << std::endl;
-  // std::cout << "b1 list: " << b1_eviction_list.size() << std::endl;
-  // std::cout << "b2 hash: " << b2_hash_map.size() << std::endl;
-  // std::cout << "b2 list: " << b2_eviction_list.size() << std::endl;
-  
-  // std::cout << "------------------------------------------------" << std::endl;
-  // hit_count++;
-  // std::cout << hit_count << std::endl;
   return 0;
 }
 
@@ -46,72 +25,69 @@ int ARC::cache_get_miss(uint64_t pos){
 }
 
 int ARC::cache_put_miss(uint64_t pos){
+  // a hit in a ghost list adapts the target size of t1: towards recency for
+  // b1, and towards frequency for b2.
   if(b1_hash_map.find(pos) != b1_hash_map.end()){
-    // std::cout << "hit b1 " << std::endl;
-      
     auto it = b1_hash_map[pos];
-    
-    arc_p = std::min(arc_p + get_delta_1(), (double)arc_c);
-    replace(pos);
+    arc_p = std::min(arc_p + get_delta_1(), (double)resident() + 1);
     t2_eviction_list.splice(t2_eviction_list.begin(), b1_eviction_list, it);
     t2_hash_map[pos] = it;
     b1_hash_map.erase(pos);
-
   }else if(b2_hash_map.find(pos) != b2_hash_map.end()){
-    // std::cout << "hit b2 " << std::endl;
-    
     auto it = b2_hash_map[pos];
     arc_p = std::max(arc_p - get_delta_2(), 0.0);
-    replace(pos);
     t2_eviction_list.splice(t2_eviction_list.begin(), b2_eviction_list, it);
     t2_hash_map[pos] = it;
     b2_hash_map.erase(pos);
   }else{
-    // std::cout << "cache miss " << std::endl;
-    if(t1_hash_map.size() + b1_hash_map.size() >= arc_c){
-      if(t1_hash_map.size() < arc_c){
-        auto r = b1_eviction_list.back();
-        b1_hash_map.erase(r);
-        b1_eviction_list.pop_back();
-        replace(pos);
-      }else{
-        auto r = t1_eviction_list.back();
-        t1_hash_map.erase(r);
-        t1_eviction_list.pop_back();
-        cache_ref->cache_map.erase(r);
-      }
-    }else{
-      if(t1_hash_map.size() + b1_hash_map.size() + t2_hash_map.size() + b2_hash_map.size() >= arc_c){
-        if(t1_hash_map.size() + b1_hash_map.size() + t2_hash_map.size() + b2_hash_map.size() >= 2 * arc_c){
-          auto r = b2_eviction_list.back();
-          b2_hash_map.erase(r);
-          b2_eviction_list.pop_back();
-        }
-        replace(pos);
-      }
-    }
     t1_eviction_list.push_front(pos);
     t1_hash_map[pos] = t1_eviction_list.begin();
   }
 
+  trim_ghosts();
+  return 0;
+}
 
-  //  std::cout << "put: " << pos << std::endl;
+int ARC::cache_remove(uint64_t pos){
+  // a removed position won't be cached again, so it is dropped from the
+  // ghost lists too.
+  int ret = -1;
+  std::pair<std::unordered_map<uint64_t, std::list<uint64_t>::iterator>*,
+    std::list<uint64_t>*> lists[] = {
+    {&t1_hash_map, &t1_eviction_list},
+    {&t2_hash_map, &t2_eviction_list},
+    {&b1_hash_map, &b1_eviction_list},
+    {&b2_hash_map, &b2_eviction_list},
+  };
+  for(auto& l : lists){
+    auto it = l.first->find(pos);
+    if(it != l.first->end()){
+      l.second->erase(it->second);
+      l.first->erase(it);
+      ret = 0;
+    }
+  }
 
-  // std::cout << "t1 hash: " << t1_hash_map.size() << std::endl;
-  // std::cout << "t1 list: " << t1_eviction_list.size() << std::endl;
-  // std::cout << "t2 hash: " << t2_hash_map.size() << std::endl;
-  // std::cout << "t2 list: " << t2_eviction_list.size() << std::endl;
-  // std::cout << "b1 hash: " << b1_hash_map.size() << std::endl;
-  // std::cout << "b1 list: " << b1_eviction_list.size() << std::endl;
-  // std::cout << "b2 hash: " << b2_hash_map.size() << std::endl;
-  // std::cout << "b2 list: " << b2_eviction_list.size() << std::endl;
-  
-  // std::cout << "------------------------------------------------" << std::endl;
-  return 0;
+  return ret;
 }
 
 uint64_t ARC::get_evicted(){
-  return -1;
+  if(!t1_eviction_list.empty() &&
+      (t1_hash_map.size() > arc_p || t2_eviction_list.empty())){
+    auto r = t1_eviction_list.back();
+    t1_hash_map.erase(r);
+    t1_eviction_list.pop_back();
+    b1_eviction_list.push_front(r);
+    b1_hash_map[r] = b1_eviction_list.begin();
+    return r;
+  }
+
+  auto r = t2_eviction_list.back();
+  t2_hash_map.erase(r);
+  t2_eviction_list.pop_back();
+  b2_eviction_list.push_front(r);
+  b2_hash_map[r] = b2_eviction_list.begin();
+  return r;
 }
 
 double ARC::get_delta_1(){
@@ -130,29 +106,23 @@ double ARC::get_delta_2(){
   }
 }
 
-int ARC::replace(uint64_t pos){
-  if(t1_hash_map.size() > 0 && (t1_hash_map.size() > arc_p || 
-  (b2_hash_map.find(pos) != b2_hash_map.end() && t1_hash_map.size() <= arc_p)
-  )){
-    auto r = t1_eviction_list.back();
-    t1_hash_map.erase(r);
-    t1_eviction_list.pop_back();
-    
-    cache_ref->cache_map.erase(r);
-
-    b1_eviction_list.push_front(r);
-    b1_hash_map[r] = b1_eviction_list.begin();
-  }else{
-    auto r = t2_eviction_list.back();
-    t2_hash_map.erase(r);
-    t2_eviction_list.pop_back();
-    
-    cache_ref->cache_map.erase(r);
+size_t ARC::resident() const{
+  return t1_hash_map.size() + t2_hash_map.size();
+}
 
-    b2_eviction_list.push_front(r);
-    b2_hash_map[r] = b2_eviction_list.begin();
+// keep |t1| + |b1| <= c and |t1| + |t2| + |b1| + |b2| <= 2c
+void ARC::trim_ghosts(){
+  const size_t c = resident();
+  while(!b1_eviction_list.empty() &&
+      t1_hash_map.size() + b1_hash_map.size() > c){
+    b1_hash_map.erase(b1_eviction_list.back());
+    b1_eviction_list.pop_back();
+  }
+  while(!b2_eviction_list.empty() &&
+      c + b1_hash_map.size() + b2_hash_map.size() > 2 * c){
+    b2_hash_map.erase(b2_eviction_list.back());
+    b2_eviction_list.pop_back();
   }
-  return 0;
 }
 
-}
\ No newline at end of file
+}
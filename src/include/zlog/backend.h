@@ -1,10 +1,12 @@
 #pragma once
+#include <cerrno>
 #include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
+#include "slice.h"
 
 namespace zlog {
 
@@ -172,6 +174,24 @@ class Backend {
   virtual int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data_out) = 0;
 
+  /**
+   * Read multiple positions of one object.
+   *
+   * Position positions[i] is read into data_out[i], and results[i] is set to
+   * the result, which has the same meaning as the return value of Read.
+   *
+   * The default implementation calls Read for each position. Backends that
+   * can read the positions with a single request or transaction should
+   * override it.
+   */
+  virtual void ReadBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, size_t count, std::string *data_out,
+      int *results) {
+    for (size_t i = 0; i < count; i++) {
+      results[i] = Read(oid, epoch, positions[i], &data_out[i]);
+    }
+  }
+
   /**
    * Write a log position.
    *
@@ -189,6 +209,51 @@ class Backend {
   virtual int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) = 0;
 
+  /**
+   * Write a log position from a list of buffers.
+   *
+   * The entry is the concatenation of the count slices in data. The slices
+   * are only accessed for the duration of the call. Semantics and return
+   * values are otherwise the same as Write.
+   *
+   * The default implementation concatenates the slices and calls Write.
+   * Backends that can copy the slices directly into their own storage should
+   * override it.
+   */
+  virtual int WriteV(const std::string& oid, const Slice *data, size_t count,
+      uint64_t epoch, uint64_t position) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+      size += data[i].size;
+    }
+    std::string flat;
+    flat.reserve(size);
+    for (size_t i = 0; i < count; i++) {
+      flat.append(data[i].data, data[i].size);
+    }
+    return Write(oid, flat, epoch, position);
+  }
+
+  /**
+   * Write multiple positions of one object.
+   *
+   * The entry data[i] is written at positions[i], and results[i] is set to
+   * the result, which has the same meaning as the return value of Write. The
+   * entries are independent: an error for one entry (e.g. -EROFS) doesn't
+   * prevent the others from being written. Entries are applied in order.
+   *
+   * The default implementation calls WriteV for each entry. Backends that
+   * can apply the entries with a single request or transaction should
+   * override it.
+   */
+  virtual void WriteBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, const Slice *data, size_t count,
+      int *results) {
+    for (size_t i = 0; i < count; i++) {
+      results[i] = WriteV(oid, &data[i], 1, epoch, positions[i]);
+    }
+  }
+
   /**
    * Fill a log position.
    *
@@ -270,6 +335,89 @@ class Backend {
    * -ENOENT object doesn't exist / needs init
    */
   virtual int Stat(const std::string& oid, size_t *size) = 0;
+
+ public:
+  /**
+   * Asynchronous variants of the log entry interfaces.
+   *
+   * Each has the same semantics and return values as its synchronous
+   * counterpart, with the result delivered to the callback. The callback is
+   * invoked exactly once, either before the call returns or later from any
+   * thread. The oid is only valid for the duration of the call, but data
+   * buffers (including data_out) remain valid until the callback is invoked.
+   *
+   * The default implementations run the synchronous interface on the calling
+   * thread and then invoke the callback. Backends that can keep many requests
+   * in flight without blocking a thread per request (e.g. a file store built
+   * on io_uring) should override them.
+   */
+  virtual void ReadAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::string *data_out,
+      std::function<void(int)> cb) {
+    cb(Read(oid, epoch, position, data_out));
+  }
+
+  // the positions, data_out, and results arrays remain valid until the
+  // callback is invoked. results are set before it is invoked.
+  virtual void ReadBatchAsync(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, size_t count, std::string *data_out,
+      int *results, std::function<void()> cb) {
+    ReadBatch(oid, epoch, positions, count, data_out, results);
+    cb();
+  }
+
+  virtual void WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position, std::function<void(int)> cb) {
+    cb(Write(oid, data, epoch, position));
+  }
+
+  virtual void WriteVAsync(const std::string& oid, const Slice *data,
+      size_t count, uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) {
+    cb(WriteV(oid, data, count, epoch, position));
+  }
+
+  virtual void FillAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::function<void(int)> cb) {
+    cb(Fill(oid, epoch, position));
+  }
+
+  virtual void TrimAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, bool trim_limit, bool trim_full,
+      std::function<void(int)> cb) {
+    cb(Trim(oid, epoch, position, trim_limit, trim_full));
+  }
+
+ public:
+  /**
+   * Watch for changes made to log entries by any client of the backend.
+   *
+   * After an entry in an object whose name begins with @prefix is written,
+   * filled or trimmed, @cb is invoked with a range of positions [first, last]
+   * that includes the changed positions. A range may also include positions
+   * that didn't change. The callback may be invoked from any thread, must not
+   * block, and must not call into the backend. Unwatch waits for callbacks
+   * that are running to return.
+   *
+   * Watches are optional. Without them, clients waiting for entries written by
+   * other clients have to poll.
+   *
+   * @param prefix  object name prefix
+   * @param cb      change callback
+   * @param cookie  identifies the watch for Unwatch
+   *
+   * @return 0 or non-zero
+   * -EOPNOTSUPP the backend doesn't support watches
+   */
+  virtual int Watch(const std::string& prefix,
+      std::function<void(uint64_t first, uint64_t last)> cb,
+      uint64_t *cookie) {
+    return -EOPNOTSUPP;
+  }
+
+  virtual int Unwatch(uint64_t cookie) {
+    return -EOPNOTSUPP;
+  }
 };
 
 }
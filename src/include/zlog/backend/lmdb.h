@@ -1,5 +1,10 @@
 #pragma once
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <sstream>
 #include <iostream>
@@ -21,6 +26,15 @@ class LMDBBackend : public Backend {
 
   void Init(const std::string& path);
 
+  /*
+   * Route Write, Fill, and Trim (sync and async) through a dedicated writer
+   * thread. The writer drains up to max_batch pending requests, applies them
+   * in a single transaction, and commits once. When max_delay_us is non-zero
+   * the writer waits up to that long for a batch to fill before committing.
+   * Must be called after Init and before the backend is used.
+   */
+  void EnableGroupCommit(size_t max_batch, uint64_t max_delay_us);
+
   int Initialize(const std::map<std::string, std::string>& opts) override;
 
   void Close();
@@ -49,9 +63,20 @@ class LMDBBackend : public Backend {
   int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data) override;
 
+  void ReadBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, size_t count, std::string *data_out,
+      int *results) override;
+
   int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) override;
 
+  int WriteV(const std::string& oid, const Slice *data, size_t count,
+      uint64_t epoch, uint64_t position) override;
+
+  void WriteBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, const Slice *data, size_t count,
+      int *results) override;
+
   int Fill(const std::string& oid, uint64_t epoch,
       uint64_t position) override;
 
@@ -66,6 +91,21 @@ class LMDBBackend : public Backend {
 
   int Stat(const std::string& oid, size_t *size) override;
 
+  void WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) override;
+
+  void WriteVAsync(const std::string& oid, const Slice *data,
+      size_t count, uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) override;
+
+  void FillAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, std::function<void(int)> cb) override;
+
+  void TrimAsync(const std::string& oid, uint64_t epoch,
+      uint64_t position, bool trim_limit, bool trim_full,
+      std::function<void(int)> cb) override;
+
  private:
   std::map<std::string, std::string> options;
   MDB_env *env;
@@ -179,6 +219,25 @@ class LMDBBackend : public Backend {
       return Put(key, v, exclusive);
     }
 
+    // reserve space for a value of the given size and return a pointer to it
+    // in *data. the caller fills in the value before the transaction ends.
+    int Reserve(const std::string& key, size_t size, void **data,
+        bool exclusive) {
+      MDB_val k;
+      k.mv_size = key.size();
+      k.mv_data = (void*)key.data();
+      MDB_val v;
+      v.mv_size = size;
+      v.mv_data = nullptr;
+      int flags = MDB_RESERVE | (exclusive ? MDB_NOOVERWRITE : 0);
+      int ret = mdb_put(txn, be->db_obj, &k, &v, flags);
+      assert(ret == 0 || ret == MDB_KEYEXIST);
+      if (ret == MDB_KEYEXIST)
+        return -EEXIST;
+      *data = v.mv_data;
+      return 0;
+    }
+
     int Delete(const std::string& key) {
       MDB_val k;
       k.mv_size = key.size();
@@ -220,8 +279,54 @@ class LMDBBackend : public Backend {
   int CheckEpoch(Transaction& txn, uint64_t epoch, const std::string& oid,
       bool eq = false);
 
+  // apply an operation to an open write transaction. on error the
+  // transaction is left unmodified, so the caller may either abort it or
+  // continue to use it for other operations.
+  int ApplyWrite(Transaction& txn, const std::string& oid,
+      const Slice *data, size_t count, uint64_t epoch, uint64_t position);
+  int ApplyFill(Transaction& txn, const std::string& oid,
+      uint64_t epoch, uint64_t position);
+  int ApplyTrim(Transaction& txn, const std::string& oid,
+      uint64_t epoch, uint64_t position, bool trim_limit, bool trim_full);
+
  private:
   bool need_close = false;
+
+  // group commit
+  struct CommitRequest {
+    enum Type {
+      WRITE,
+      FILL,
+      TRIM
+    };
+
+    Type type;
+    std::string oid;
+    uint64_t epoch;
+    uint64_t position;
+    // write payload. when data is null the payload is the single slice.
+    const Slice *data;
+    size_t count;
+    Slice single;
+    bool trim_limit;
+    bool trim_full;
+    std::function<void(int)> cb;
+  };
+
+  void SubmitCommit(CommitRequest&& req);
+  int SubmitCommitWait(CommitRequest&& req);
+  int ApplyCommit(Transaction& txn, const CommitRequest& req);
+  void CommitEntry();
+  void StopGroupCommit();
+
+  bool group_commit = false;
+  size_t commit_max_batch = 64;
+  uint64_t commit_max_delay_us = 0;
+  bool commit_stop = false;
+  std::mutex commit_lock;
+  std::condition_variable commit_cond;
+  std::deque<CommitRequest> commit_queue;
+  std::thread commit_thread;
 };
 
 }
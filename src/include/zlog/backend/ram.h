@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <vector>
 #include <sstream>
 #include <iostream>
@@ -17,7 +20,9 @@ class RAMBackend : public Backend {
  public:
   RAMBackend() :
     blackhole_(false),
-    options_{{"scheme", "ram"}}
+    options_{{"scheme", "ram"}},
+    num_watches_(0),
+    next_watch_cookie_(0)
   {}
 
   ~RAMBackend();
@@ -48,9 +53,20 @@ class RAMBackend : public Backend {
   int Read(const std::string& oid, uint64_t epoch,
       uint64_t position, std::string *data) override;
 
+  void ReadBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, size_t count, std::string *data_out,
+      int *results) override;
+
   int Write(const std::string& oid, const std::string& data,
       uint64_t epoch, uint64_t position) override;
 
+  int WriteV(const std::string& oid, const Slice *data, size_t count,
+      uint64_t epoch, uint64_t position) override;
+
+  void WriteBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, const Slice *data, size_t count,
+      int *results) override;
+
   int Fill(const std::string& oid, uint64_t epoch,
       uint64_t position) override;
 
@@ -65,6 +81,12 @@ class RAMBackend : public Backend {
 
   int Stat(const std::string& oid, size_t *size) override;
 
+  int Watch(const std::string& prefix,
+      std::function<void(uint64_t, uint64_t)> cb,
+      uint64_t *cookie) override;
+
+  int Unwatch(uint64_t cookie) override;
+
  private:
   struct LinkObject {
     std::string hoid;
@@ -96,6 +118,42 @@ class RAMBackend : public Backend {
   int CheckEpoch(uint64_t epoch, const std::string& oid,
       bool eq, LogObject*& lobj);
 
+  // read a position of an object that has passed the epoch check
+  static int ReadEntry(const LogObject& lobj, uint64_t position,
+      std::string *data);
+
+  // records a change made under the backend lock. watchers are notified when
+  // the notification is destroyed, after the lock has been released.
+  class Notification {
+   public:
+    Notification(RAMBackend *backend, const std::string& oid) :
+      backend_(backend),
+      oid_(oid),
+      changed_(false)
+    {}
+
+    ~Notification() {
+      if (changed_) {
+        backend_->Notify(oid_, first_, last_);
+      }
+    }
+
+    void add(uint64_t first, uint64_t last) {
+      first_ = changed_ ? std::min(first_, first) : first;
+      last_ = changed_ ? std::max(last_, last) : last;
+      changed_ = true;
+    }
+
+   private:
+    RAMBackend * const backend_;
+    const std::string& oid_;
+    bool changed_;
+    uint64_t first_;
+    uint64_t last_;
+  };
+
+  void Notify(const std::string& oid, uint64_t first, uint64_t last);
+
   bool startsWith(std::string s, std::string prefix) {
     return s.size() >= prefix.size() && std::equal(prefix.cbegin(), prefix.cend(), s.cbegin());
   }
@@ -106,6 +164,14 @@ class RAMBackend : public Backend {
   std::map<std::string, std::string> options_;
   std::unordered_map<std::string,
     boost::variant<LinkObject, ProjectionObject, LogObject>> objects_;
+
+  // watches have their own lock, which writes only take when there are
+  // watches.
+  std::mutex watch_lock_;
+  std::atomic<size_t> num_watches_;
+  uint64_t next_watch_cookie_;
+  std::map<uint64_t, std::pair<std::string,
+    std::function<void(uint64_t, uint64_t)>>> watches_;
 };
 
 }
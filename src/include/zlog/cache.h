@@ -1,48 +1,96 @@
 #pragma once
-#include<string>
-#include<sstream>
-#include<iostream>
-#include<unordered_map>
-#include<mutex>
-#include"zlog/eviction/lru.h"
-#include"zlog/eviction/arc.h"
-#include"zlog/options.h"
-#include"zlog/mempool/mempool.h"
-#include"../../monitoring/statistics.h"
-
-namespace zlog{
-class Cache{
-  public:
-    Cache(const zlog::Options& ops) : options(ops){
-      current_cache_use = 0;
-
-      switch(options.eviction){
-        case zlog::Eviction::Eviction_Policy::LRU:
-          eviction = new LRU(options.cache_size, this);
-        break;
-        case zlog::Eviction::Eviction_Policy::ARC:
-          eviction = new ARC(options.cache_size, this);
-        break;
-        default:
-          eviction = new LRU(options.cache_size, this);
-          std::cout << "Eviction policy not implemented. Using default: LRU" << std::endl;   
-        break;
-      }
-    }
-    ~Cache();
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "zlog/eviction.h"
+#include "zlog/options.h"
+#include "zlog/mempool/mempool.h"
+
+namespace zlog {
+
+/**
+ * A cache of log entries keyed by position.
+ *
+ * The cache is split into shards by a hash of the position, and each shard
+ * has its own lock and eviction policy, so threads reading different
+ * positions rarely contend. Capacity is accounted in bytes: each entry is
+ * charged its size plus kEntryOverhead, and each shard holds an equal part of
+ * Options::cache_size. Entries are allocated from the zlog_mempool cache
+ * pool.
+ *
+ * Entries are immutable and shared, so a hit holds the shard lock only to
+ * find the entry and update the eviction policy. The entry is copied out
+ * after the lock is released.
+ */
+class Cache {
+ public:
+  // per-entry bookkeeping charged in addition to the entry's data
+  static const size_t kEntryOverhead = 64;
+
+  explicit Cache(const zlog::Options& options);
+  ~Cache();
+
+  Cache(const Cache&) = delete;
+  Cache& operator=(const Cache&) = delete;
+
+  // put and get return 0 if the entry was cached / found, and non-zero
+  // otherwise. an entry larger than a shard isn't cached. removed positions
+  // (e.g. trimmed ones) are dropped from the eviction policy as well.
+  int put(uint64_t pos, const std::string& data);
+  int get(uint64_t* pos, std::string* data);
+  int remove(uint64_t* pos);
+  void remove_below(uint64_t pos);
+
+  // bytes charged for the cached entries, and the number of entries
+  size_t usage() const;
+  size_t size() const;
 
-    int put(uint64_t pos, const std::string& data);
-    int get(uint64_t* pos, std::string* data);
-    int remove(uint64_t* pos);
+  size_t capacity() const {
+    return capacity_;
+  }
 
-    std::unordered_map<uint64_t, zlog_mempool::cache::string> cache_map; //FIX
+  size_t num_shards() const {
+    return shards_.size();
+  }
 
+  uint64_t evictions() const {
+    return evictions_;
+  }
 
-  private:
-    zlog::Eviction* eviction;
-    const zlog::Options& options;
-    int64_t current_cache_use;
-    std::mutex mut;
+ private:
+  typedef std::shared_ptr<const zlog_mempool::cache::string> Entry;
 
+  struct Shard {
+    mutable std::mutex lock;
+    zlog_mempool::cache::unordered_map<uint64_t, Entry> entries;
+    std::unique_ptr<Eviction> eviction;
+    size_t usage = 0;
+  };
+
+  static size_t charge(const Entry& entry) {
+    return entry->size() + kEntryOverhead;
+  }
+
+  Shard& shard(uint64_t pos) {
+    if (shard_bits_ == 0) {
+      return *shards_[0];
+    }
+    // fibonacci hashing spreads consecutive positions across the shards
+    return *shards_[(pos * 0x9e3779b97f4a7c15ULL) >> (64 - shard_bits_)];
+  }
+
+  // drop an entry from a locked shard. the entry is returned so that it can
+  // be freed after the lock is released.
+  Entry erase(Shard& shard, uint64_t pos);
+
+  const zlog::Options& options;
+  const size_t capacity_;
+  int shard_bits_;
+  size_t shard_capacity_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> evictions_;
 };
+
 }
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "slice.h"
+
+namespace zlog {
+
+/**
+ * Compresses log entries.
+ *
+ * When a codec is set in Options, each entry is compressed before it is
+ * written to the backend, and is stored behind a small header that records
+ * the id of the codec. Reads use the header to select the codec that
+ * decompresses the entry, so a log may be read with a different codec than
+ * it was written with, as long as the writing codec is built-in or is the
+ * one configured for the read.
+ *
+ * Codec ids 0 through 127 are reserved for the built-in codecs. A codec must
+ * be thread-safe.
+ */
+class Codec {
+ public:
+  virtual ~Codec() {}
+
+  virtual uint8_t Id() const = 0;
+  virtual const char *Name() const = 0;
+
+  /**
+   * Append the compressed form of input to output. Return false if the input
+   * could not be compressed, in which case the entry is stored uncompressed
+   * and the contents of output are ignored.
+   */
+  virtual bool Compress(const Slice& input, std::string *output) = 0;
+
+  /**
+   * Decompress input into the size bytes at output. The size is the size of
+   * the input that was compressed.
+   *
+   * @return 0 or non-zero
+   * -EINVAL input is corrupt
+   */
+  virtual int Decompress(const Slice& input, char *output, size_t size) = 0;
+
+  /**
+   * Return the largest size that input_size bytes of compressed input can
+   * decompress to. A stored entry that claims to be larger is corrupt, and is
+   * rejected before memory is allocated for it. The default is a fixed cap of
+   * kMaxDecompressedSize.
+   */
+  virtual uint64_t MaxDecompressedSize(size_t input_size) const {
+    return kMaxDecompressedSize;
+  }
+
+ public:
+  static const uint64_t kMaxDecompressedSize = 1ULL << 30;
+
+  // entries are stored behind a header, without compression
+  static const uint8_t kNoOp = 0;
+  // fast LZ77-style compression, without external dependencies
+  static const uint8_t kLZ = 1;
+
+  /**
+   * Return a built-in codec by id, or by name ("none" or "lz"). Returns
+   * nullptr when there is no such codec.
+   */
+  static std::shared_ptr<Codec> Builtin(uint8_t id);
+  static std::shared_ptr<Codec> Builtin(const std::string& name);
+};
+
+}
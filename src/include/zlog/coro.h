@@ -0,0 +1,289 @@
+#pragma once
+
+// C++20 coroutine adapters for zlog::Log. This header is a no-op unless it is
+// compiled with coroutine support (e.g. -std=c++20), in which case
+// ZLOG_HAVE_COROUTINES is defined. The library itself does not need to be
+// built with coroutine support.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define ZLOG_HAVE_COROUTINES 1
+#endif
+#endif
+
+#ifdef ZLOG_HAVE_COROUTINES
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "log.h"
+
+namespace zlog {
+
+/**
+ * Runs the continuation of a coroutine awaiting a log operation.
+ *
+ * Without an executor, a coroutine is resumed directly on the thread that
+ * completes the operation, typically a zlog finisher thread. An application
+ * may instead resume its coroutines on its own threads, avoiding a second hop
+ * from a zlog thread into its thread pool.
+ */
+class Executor {
+ public:
+  virtual ~Executor() {}
+
+  // run fn. must not run fn before returning unless that is safe for the
+  // caller, e.g. when fn only resumes a suspended coroutine.
+  virtual void Execute(std::function<void()> fn) = 0;
+};
+
+struct PositionResult {
+  int ret;
+  uint64_t position;
+};
+
+struct ReadResult {
+  int ret;
+  std::string data;
+};
+
+namespace coro {
+
+class AwaiterBase {
+ public:
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+ protected:
+  AwaiterBase(Log *log, Executor *executor) :
+    log_(log),
+    executor_(executor),
+    done_(false)
+  {}
+
+  // called by the operation's callback. an operation may complete before its
+  // submission returns (e.g. a read answered from the cache), in which case
+  // await_suspend sees that the callback ran and the coroutine continues
+  // without suspending. resuming it from the callback instead would nest the
+  // coroutine in its own await_suspend and grow the stack with every such
+  // completion.
+  //
+  // the awaiter lives in the coroutine frame, which may be destroyed once the
+  // coroutine is resumed. nothing is accessed after resuming, or after done_
+  // is set when await_suspend may still be running.
+  void complete() {
+    if (!done_.exchange(true)) {
+      return;
+    }
+    auto handle = handle_;
+    if (executor_) {
+      executor_->Execute([handle] { handle.resume(); });
+    } else {
+      handle.resume();
+    }
+  }
+
+  // called by await_suspend once the operation has been submitted. returns
+  // true if the coroutine should suspend, and false if the operation has
+  // already completed.
+  bool suspend() {
+    return !done_.exchange(true);
+  }
+
+  Log *log_;
+  Executor *executor_;
+  std::coroutine_handle<> handle_;
+  // set by whichever of await_suspend and the callback finishes first
+  std::atomic<bool> done_;
+};
+
+class AppendAwaiter : public AwaiterBase {
+ public:
+  AppendAwaiter(Log *log, Executor *executor, std::string&& data) :
+    AwaiterBase(log, executor),
+    data_(std::move(data)),
+    result_{0, 0}
+  {}
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    const int ret = log_->appendAsync(std::move(data_),
+        [this](int ret, uint64_t position) {
+      result_.ret = ret;
+      result_.position = position;
+      complete();
+    });
+    if (ret) {
+      result_.ret = ret;
+      return false;
+    }
+    return suspend();
+  }
+
+  PositionResult await_resume() {
+    return result_;
+  }
+
+ private:
+  std::string data_;
+  PositionResult result_;
+};
+
+class ReadAwaiter : public AwaiterBase {
+ public:
+  ReadAwaiter(Log *log, Executor *executor, uint64_t position) :
+    AwaiterBase(log, executor),
+    position_(position),
+    result_{0, std::string()}
+  {}
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    const int ret = log_->readAsync(position_,
+        [this](int ret, std::string& data) {
+      result_.ret = ret;
+      if (!ret) {
+        result_.data.swap(data);
+      }
+      complete();
+    });
+    if (ret) {
+      result_.ret = ret;
+      return false;
+    }
+    return suspend();
+  }
+
+  ReadResult await_resume() {
+    return std::move(result_);
+  }
+
+ private:
+  const uint64_t position_;
+  ReadResult result_;
+};
+
+class TailAwaiter : public AwaiterBase {
+ public:
+  TailAwaiter(Log *log, Executor *executor) :
+    AwaiterBase(log, executor),
+    result_{0, 0}
+  {}
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    const int ret = log_->tailAsync([this](int ret, uint64_t position) {
+      result_.ret = ret;
+      result_.position = position;
+      complete();
+    });
+    if (ret) {
+      result_.ret = ret;
+      return false;
+    }
+    return suspend();
+  }
+
+  PositionResult await_resume() {
+    return result_;
+  }
+
+ private:
+  PositionResult result_;
+};
+
+// fill, trim, and trimTo, which only produce a return code
+class StatusAwaiter : public AwaiterBase {
+ public:
+  typedef int (Log::*submit_fn)(uint64_t, std::function<void(int)>);
+
+  StatusAwaiter(Log *log, Executor *executor, submit_fn submit,
+      uint64_t position) :
+    AwaiterBase(log, executor),
+    submit_(submit),
+    position_(position),
+    ret_(0)
+  {}
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    const int ret = (log_->*submit_)(position_, [this](int ret) {
+      ret_ = ret;
+      complete();
+    });
+    if (ret) {
+      ret_ = ret;
+      return false;
+    }
+    return suspend();
+  }
+
+  int await_resume() {
+    return ret_;
+  }
+
+ private:
+  const submit_fn submit_;
+  const uint64_t position_;
+  int ret_;
+};
+
+}
+
+/**
+ * Awaitable interface to a log.
+ *
+ *   zlog::CoroLog clog(log, &executor);
+ *   auto res = co_await clog.Append(data);
+ *   if (!res.ret) {
+ *     auto entry = co_await clog.Read(res.position);
+ *   }
+ *
+ * Each call starts the operation when awaited, using the log's asynchronous
+ * interface, and the awaiting coroutine is resumed through the executor (if
+ * any) when it completes. Results use the same return codes as the
+ * synchronous interface. The log must outlive the awaiters.
+ */
+class CoroLog {
+ public:
+  explicit CoroLog(Log *log, Executor *executor = nullptr) :
+    log_(log),
+    executor_(executor)
+  {}
+
+  coro::TailAwaiter CheckTail() {
+    return coro::TailAwaiter(log_, executor_);
+  }
+
+  coro::AppendAwaiter Append(std::string data) {
+    return coro::AppendAwaiter(log_, executor_, std::move(data));
+  }
+
+  coro::ReadAwaiter Read(uint64_t position) {
+    return coro::ReadAwaiter(log_, executor_, position);
+  }
+
+  coro::StatusAwaiter Fill(uint64_t position) {
+    return coro::StatusAwaiter(log_, executor_, &Log::fillAsync, position);
+  }
+
+  coro::StatusAwaiter Trim(uint64_t position) {
+    return coro::StatusAwaiter(log_, executor_, &Log::trimAsync, position);
+  }
+
+  coro::StatusAwaiter TrimTo(uint64_t position) {
+    return coro::StatusAwaiter(log_, executor_, &Log::trimToAsync, position);
+  }
+
+  Log *log() const {
+    return log_;
+  }
+
+ private:
+  Log *log_;
+  Executor *executor_;
+};
+
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include "log.h"
+
+namespace zlog {
+
+struct LogCursorOptions {
+  // iterate from the end of the range towards its start
+  bool reverse = false;
+
+  // the cursor keeps reads outstanding for up to readahead positions beyond
+  // the consumer. the window starts at min_readahead and doubles, up to
+  // max_readahead, each time the consumer catches up with the reads and has
+  // to wait for them.
+  uint32_t min_readahead = 16;
+  uint32_t max_readahead = 4096;
+
+  // a position that hasn't been written is returned with -ENOENT. when
+  // wait_for_holes is set the cursor instead waits for the position to be
+  // written or filled, returning -ENOENT only once it is still unwritten
+  // after hole_timeout_ms. a timeout of zero waits without a limit.
+  bool wait_for_holes = false;
+  uint32_t hole_timeout_ms = 1000;
+};
+
+/**
+ * Iterates over a range of log positions, reading ahead of the consumer.
+ *
+ * Entries are read in chunks with Log::readRangeAsync, so each chunk is read
+ * with one backend request per object, and several chunks are outstanding
+ * while the consumer works through the entries that have already arrived.
+ * Replaying a log this way is bounded by the backend rather than by the
+ * latency of reading one position at a time.
+ *
+ * A cursor is used by one thread at a time, and the log must outlive it.
+ */
+class LogCursor {
+ public:
+  LogCursor() {}
+  virtual ~LogCursor();
+
+  /**
+   * Return the next position. The result of reading the position is
+   * returned in entry->ret, as for Log::ReadRange.
+   *
+   * @return 0 or non-zero
+   * -ERANGE every position in the range has been returned
+   * other errors are from reading the entries, and the read is retried by
+   * the next call.
+   */
+  virtual int Next(LogEntry *entry) = 0;
+
+ public:
+  /**
+   * Create a cursor over the positions [start, end). The range may extend
+   * past the tail of the log, e.g. to read up to a tail observed earlier.
+   *
+   * @return 0 or non-zero
+   * -EINVAL end is less than start, or the readahead options are invalid
+   */
+  static int Create(Log *log, uint64_t start, uint64_t end,
+      const LogCursorOptions& options, LogCursor **cursor);
+
+ private:
+  LogCursor(const LogCursor&);
+  void operator=(const LogCursor&);
+};
+
+}
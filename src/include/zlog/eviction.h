@@ -14,9 +14,15 @@ class Eviction{
 
     virtual ~Eviction(){};
 
+    // a policy tracks the positions held by one cache shard, and is called
+    // with the shard locked. it never removes entries from the cache itself:
+    // when the shard needs space it asks for a victim with get_evicted, which
+    // is only called while at least one position is resident, and which stops
+    // tracking the victim as resident.
     virtual int cache_get_hit(uint64_t* pos) = 0;
     virtual int cache_get_miss(uint64_t pos) = 0;
     virtual int cache_put_miss(uint64_t pos) = 0;
+    virtual int cache_remove(uint64_t pos) = 0;
     virtual uint64_t get_evicted() = 0;
   };
 }
\ No newline at end of file
@@ -4,11 +4,119 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 #include "options.h"
+#include "slice.h"
 
 namespace zlog {
 
 class Backend;
+class CompletionQueue;
+
+/**
+ * A request submitted to a log through Log::Submit.
+ *
+ * The cookie is opaque to the log and is returned unmodified in the matching
+ * LogCompletion.
+ */
+struct LogRequest {
+  enum Type {
+    APPEND,
+    READ,
+    FILL,
+    TRIM
+  };
+
+  Type type;
+  uint64_t cookie;
+  // target position for read, fill, and trim
+  uint64_t position;
+  // entry data for append. moved into the log when submitted.
+  std::string data;
+
+  static LogRequest Append(uint64_t cookie, std::string data) {
+    return LogRequest{APPEND, cookie, 0, std::move(data)};
+  }
+
+  static LogRequest Read(uint64_t cookie, uint64_t position) {
+    return LogRequest{READ, cookie, position, std::string()};
+  }
+
+  static LogRequest Fill(uint64_t cookie, uint64_t position) {
+    return LogRequest{FILL, cookie, position, std::string()};
+  }
+
+  static LogRequest Trim(uint64_t cookie, uint64_t position) {
+    return LogRequest{TRIM, cookie, position, std::string()};
+  }
+};
+
+/**
+ * The result of a LogRequest, reaped from a CompletionQueue.
+ */
+struct LogCompletion {
+  LogRequest::Type type;
+  uint64_t cookie;
+  // same return codes as the corresponding synchronous interface
+  int ret;
+  // the assigned position for append, otherwise the requested position
+  uint64_t position;
+  // entry data for a successful read
+  std::string data;
+};
+
+/**
+ * A queue of completed log requests owned by the caller.
+ *
+ * Completions are produced by log threads and consumed by the owner, either by
+ * polling with Reap or by blocking in Wait. No callbacks are run on behalf of
+ * the caller. A completion queue may be shared by multiple logs, and must
+ * outlive every request submitted against it.
+ */
+class CompletionQueue {
+ public:
+  CompletionQueue() {}
+  virtual ~CompletionQueue();
+
+  /**
+   * Move up to max completions into out without blocking. Returns the number
+   * of completions appended to out.
+   */
+  virtual size_t Reap(std::vector<LogCompletion> *out, size_t max) = 0;
+
+  /**
+   * Block until at least min completions are available, then move up to max
+   * completions into out. The wait is bounded by the number of pending
+   * requests, and a negative timeout waits forever. Returns the number of
+   * completions appended to out, which may be less than min on timeout.
+   */
+  virtual size_t Wait(std::vector<LogCompletion> *out, size_t min,
+      size_t max, int timeout_ms = -1) = 0;
+
+  /**
+   * Number of submitted requests that have not been reaped.
+   */
+  virtual size_t Pending() const = 0;
+
+ public:
+  static CompletionQueue *Create();
+
+ private:
+  CompletionQueue(const CompletionQueue&);
+  void operator=(const CompletionQueue&);
+};
+
+/**
+ * The result of reading one position with Log::ReadRange.
+ */
+struct LogEntry {
+  uint64_t position;
+  // 0 when data holds the entry, otherwise the error Read would return for
+  // the position: -ENODATA if it has been filled or trimmed (invalidated),
+  // or -ENOENT if it hasn't been written.
+  int ret;
+  std::string data;
+};
 
 class Log {
  public:
@@ -29,12 +137,82 @@ class Log {
       std::function<void(int, uint64_t)> cb) = 0;
 
   /**
+   * Append variants that avoid copying the entry. An rvalue string is moved
+   * into the log, and a (data, size) buffer is copied exactly once without an
+   * intermediate string. The buffer only needs to remain valid until the call
+   * returns.
+   */
+  virtual int Append(std::string&& data, uint64_t *pposition) = 0;
+  virtual int appendAsync(std::string&& data,
+      std::function<void(int, uint64_t)> cb) = 0;
+  virtual int Append(const char *data, size_t size, uint64_t *pposition) = 0;
+  virtual int appendAsync(const char *data, size_t size,
+      std::function<void(int, uint64_t)> cb) = 0;
+
+  /**
+   * Append an entry formed by concatenating a list of buffers, such as a
+   * record header and a payload, without first copying them into a single
+   * string. The buffers remain owned by the caller. For Append they must
+   * remain valid until the call returns, and for appendAsync until the
+   * callback has been invoked. Backends that support it copy the buffers
+   * directly into storage.
+   */
+  virtual int Append(const std::vector<Slice>& data, uint64_t *pposition) = 0;
+  virtual int appendAsync(const std::vector<Slice>& data,
+      std::function<void(int, uint64_t)> cb) = 0;
+
+  /**
+   * Append a batch of entries. Entries are moved into the log, and positions
+   * is filled in with the position of each entry. Positions for the batch
+   * are reserved with a single sequencer request and are assigned in entry
+   * order from one contiguous range. An entry that must be retried (e.g.
+   * after the log is reconfigured) is assigned a new position on its own, so
+   * in that case positions are neither contiguous nor ordered. Writes are
+   * grouped by the object they map to, and the groups are written in
+   * parallel.
    *
+   * The vector passed to the appendBatchAsync callback may be swapped or
+   * moved out of by the callback.
+   *
+   * @return 0 or the first error from the batch. on error, some entries in the
+   * batch may have been appended.
+   */
+  virtual int AppendBatch(std::vector<std::string>&& entries,
+      std::vector<uint64_t> *positions) = 0;
+  virtual int appendBatchAsync(std::vector<std::string>&& entries,
+      std::function<void(int, std::vector<uint64_t>&)> cb) = 0;
+
+  /**
+   * The string passed to the readAsync callback holds the buffer filled in by
+   * the backend. The callback may take ownership of it by swapping or moving
+   * out of it.
+   *
+   * A read that is answered without a backend request (e.g. from the entry
+   * cache, or for a position known to be filled or trimmed) invokes the
+   * callback synchronously on the calling thread, before readAsync returns.
    */
   virtual int Read(uint64_t position, std::string *data) = 0;
   virtual int readAsync(uint64_t position,
       std::function<void(int, std::string&)> cb) = 0;
 
+  /**
+   * Read the positions [start, end). entries is filled in with one entry per
+   * position, in position order, each with its own result. Positions are
+   * grouped by the object they map to, and each object is read with a single
+   * backend request. Objects are read in parallel.
+   *
+   * The vector passed to the readRangeAsync callback may be swapped or moved
+   * out of by the callback.
+   *
+   * @return 0 or non-zero. the result of each position is returned in its
+   * entry, so 0 doesn't mean that every position was read.
+   * -EINVAL end is less than start
+   */
+  virtual int ReadRange(uint64_t start, uint64_t end,
+      std::vector<LogEntry> *entries) = 0;
+  virtual int readRangeAsync(uint64_t start, uint64_t end,
+      std::function<void(int, std::vector<LogEntry>&)> cb) = 0;
+
   /**
    *
    */
@@ -53,6 +231,58 @@ class Log {
   virtual int trimTo(uint64_t position) = 0;
   virtual int trimToAsync(uint64_t position, std::function<void(int)> cb) = 0;
 
+  /**
+   * Submit a batch of requests. The result of each request is delivered to
+   * the completion queue, tagged with the request cookie. Request data is
+   * moved out of the batch. As with readAsync, reads that are answered
+   * without a backend request are completed on the calling thread, so their
+   * completions may be reaped as soon as Submit returns.
+   *
+   * @return 0 or non-zero
+   * -EINVAL invalid request type or null completion queue. no requests from
+   *  the batch are submitted in this case.
+   */
+  virtual int Submit(CompletionQueue *cq,
+      std::vector<LogRequest>& requests) = 0;
+
+  /**
+   * Wait until the position has been written, filled or trimmed, after which
+   * Read doesn't return -ENOENT for it. Waiters are woken as soon as an
+   * append, fill or trim through this log completes. Changes made by other
+   * clients are noticed through the backend's watch interface or, for
+   * backends without watches, by checking the position at intervals that
+   * grow to 10ms.
+   *
+   * @return 0 or non-zero
+   * -ETIMEDOUT the position wasn't written within timeout_ms. a negative
+   *  timeout waits forever.
+   */
+  virtual int WaitForPosition(uint64_t position, int timeout_ms = -1) = 0;
+
+  /**
+   * Deliver the entries of the log to cb in position order, starting at
+   * position, as they are written. Positions are waited on in the same way
+   * as WaitForPosition. Each entry has ret set to 0 and holds the entry data,
+   * or has ret set to -ENODATA if the position was filled or trimmed, and the
+   * callback may move the data out of it. Delivery waits at a position that
+   * hasn't been written, so a hole left by a failed client must be filled for
+   * delivery to continue.
+   *
+   * The callbacks of all of a log's subscriptions are invoked one at a time
+   * from a single thread owned by the log, so a callback that blocks holds
+   * up the other subscriptions. Unsubscribe waits for a running callback to
+   * return, and can't be called from the subscription's own callback.
+   * Subscriptions end when the log is destroyed.
+   *
+   * @return 0 or non-zero
+   * -EINVAL cb is empty or subscription is null (Subscribe)
+   * -ENOENT unknown subscription (Unsubscribe)
+   * -EDEADLK called from the subscription's callback (Unsubscribe)
+   */
+  virtual int Subscribe(uint64_t position,
+      std::function<void(LogEntry&)> cb, uint64_t *subscription) = 0;
+  virtual int Unsubscribe(uint64_t subscription) = 0;
+
  public:
   virtual int StripeWidth() = 0;
 
@@ -11,6 +11,7 @@ namespace zlog {
 
 class Statistics;
 class Backend;
+class Codec;
 
 struct Options {
   // The storage backend. When set, this option will take priority over other
@@ -38,8 +39,86 @@ struct Options {
   uint32_t stripe_width = 10;
   uint32_t stripe_slots = 5;
 
+  // number of threads that seal and read the log's objects in parallel when
+  // a log instance proposes itself as the sequencer. takeover seals every
+  // object in the log, so on a log with many stripes its time is dominated
+  // by these requests.
+  uint32_t sequencer_takeover_threads = 16;
+
   uint32_t max_inflight_ops = 1024;
 
+  // run synchronous operations (e.g. Append, Read) on the calling thread
+  // instead of handing them to a finisher thread, provided that the number of
+  // in-flight operations is below max_inflight_ops. this avoids two context
+  // switches per call. when the limit is reached the operation is queued.
+  bool inline_sync_ops = false;
+
+  // combine concurrent appends to the same object into a single backend
+  // request (Backend::WriteBatch). an append that finds a write to its object
+  // in progress is queued, and queued appends are written together when that
+  // write completes. a combined request holds at most coalesce_max_entries
+  // entries and coalesce_max_bytes bytes of entry data. when
+  // coalesce_window_us is non-zero, a write waits up to that long for more
+  // appends to combine with before it is issued.
+  bool coalesce_writes = false;
+  uint32_t coalesce_max_entries = 64;
+  uint32_t coalesce_max_bytes = 1 << 20;
+  uint32_t coalesce_window_us = 0;
+
+  // compress entries with a codec (see zlog/codec.h) before they are written,
+  // and decompress them when they are read. entries written with a codec are
+  // stored behind a header that identifies the codec. the codec is recorded
+  // in the log's view when the log is created, and opening the log fails
+  // with -EINVAL unless it is opened with a codec that can read its entries
+  // (any codec, e.g. Codec::Builtin("none"), when the recorded codec is
+  // built-in, and the same codec otherwise). a log created without a codec
+  // must be opened without one.
+  std::shared_ptr<Codec> codec = nullptr;
+
+  // append a crc32c checksum to each entry when it is written, and verify it
+  // when the entry is read. the checksum covers the entry as stored, after
+  // compression. as with codec, the setting is recorded when the log is
+  // created, and opening the log with a different setting fails with
+  // -EINVAL.
+  bool entry_checksums = false;
+
+  // what a read does when an entry doesn't match its checksum: fail with
+  // -EIO, log the mismatch and return the entry anyway, or read the entry
+  // again up to checksum_refetch_attempts times before failing with -EIO.
+  enum ChecksumPolicy {
+    CHECKSUM_FAIL,
+    CHECKSUM_LOG,
+    CHECKSUM_REFETCH
+  };
+  ChecksumPolicy checksum_policy = CHECKSUM_FAIL;
+  int checksum_refetch_attempts = 3;
+
+  // deliver appendAsync callbacks in position order. a completed append's
+  // callback is held until the callbacks of all appends from this log at
+  // lower positions have been delivered, while the appends themselves still
+  // run in parallel. an append holds its place in max_inflight_ops until its
+  // callback is delivered, which bounds the number of callbacks held.
+  // synchronous appends and AppendBatch aren't ordered, so an Append may
+  // return before the callbacks of appends at lower positions, and a
+  // callback may itself make a synchronous append.
+  bool ordered_append_callbacks = false;
+
+  // when greater than zero, a log instance that is the sequencer hands out
+  // append positions from ranges of sequencer_lease_size positions leased by
+  // each core, instead of updating the shared tail once per append. appends
+  // from different cores then don't contend on the tail, but positions are
+  // no longer assigned in the order that appends are made, and a reader
+  // following the tail may wait at a position that a lease holds until it's
+  // used or the lease expires. leased positions that are unused when the sequencer changes or the
+  // log is closed are filled. leasing doesn't apply to ordered appends,
+  // AppendBatch, or positions handed out by a zlog-seqr server.
+  uint32_t sequencer_lease_size = 0;
+
+  // the rest of a lease that isn't used for sequencer_lease_idle_ms (up to
+  // twice that long) is filled, so that a core that stops appending doesn't
+  // hold back readers following the tail. zero disables expiry.
+  int sequencer_lease_idle_ms = 50;
+
   int min_refresh_timeout_ms = 125;
   int max_refresh_timeout_ms = 5000;
 
@@ -48,6 +127,26 @@ struct Options {
   // number of I/O threads
   int finisher_threads = 10;
 
+  // adaptive finisher pool. when max_finisher_threads is greater than zero
+  // the pool starts with finisher_threads threads, and every
+  // finisher_adapt_interval_ms it is resized within [min_finisher_threads,
+  // max_finisher_threads] based on how long ops wait to be started and how
+  // long they hold a thread. when statistics is set, the pool size is
+  // reported in the FINISHER_THREADS ticker and resize decisions are counted
+  // in FINISHER_POOL_GROWS and FINISHER_POOL_SHRINKS.
+  int min_finisher_threads = 1;
+  int max_finisher_threads = 0;
+  int finisher_adapt_interval_ms = 100;
+
+  // when both foreground ops (append, read, tail) and background ops (trim,
+  // fill, trimTo) are waiting for a finisher thread, they are started in the
+  // ratio foreground_weight:background_weight. ops in one class are never
+  // held back when the other class has nothing waiting, except that at most
+  // the background share of the finisher threads (and at least one) runs
+  // background ops at once. a weight of zero is treated as one.
+  uint32_t foreground_weight = 8;
+  uint32_t background_weight = 1;
+
   // maximum views to read at once when updating current view
   // advanced
   int max_refresh_views_read = 20;
@@ -56,8 +155,19 @@ struct Options {
   std::vector<std::string> http;
   
   //cache options
+  //
+  // the cache holds up to cache_size bytes of entries. zero disables the
+  // cache. entries are cached when they are appended or read, and a read of
+  // a cached entry completes on the calling thread without a backend request.
+  // entries trimmed by another log instance may still be returned from the
+  // cache until they are evicted.
   zlog::Eviction::Eviction_Policy eviction = zlog::Eviction::Eviction_Policy::LRU;
-  size_t cache_size = 1024 * 1024 * 1;
+  size_t cache_size = 0;
+
+  // the cache is split into 2^cache_shard_bits shards, each with its own lock
+  // and eviction policy. by default there are up to 64 shards of at least
+  // 512KB each.
+  int cache_shard_bits = -1;
 };
 
 }
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "log.h"
+#include "slice.h"
+
+namespace zlog {
+
+/**
+ * The address of a record packed into a log entry: the log position of the
+ * entry, and the index of the record within it.
+ */
+struct RecordAddress {
+  uint64_t position;
+  uint32_t index;
+};
+
+struct RecordPackerOptions {
+  // a pack is appended once it holds max_records records or max_bytes bytes
+  // of record data, whichever comes first. a record larger than max_bytes is
+  // appended in a pack of its own.
+  uint32_t max_records = 256;
+  uint32_t max_bytes = 64 << 10;
+
+  // an open pack is appended at most max_delay_us after its first record was
+  // added, even if it isn't full. zero appends a pack as soon as the packer's
+  // flush thread runs, so records are only combined while it is busy.
+  uint32_t max_delay_us = 1000;
+};
+
+/**
+ * Packs many small records into each log entry.
+ *
+ * The per-entry costs of an append (a sequencer request, object mapping, a
+ * backend write, and per-entry storage metadata) dominate when records are
+ * small. A packer buffers records for a bounded time or size and appends
+ * them as one framed log entry. Each record is identified by the position of
+ * that entry and its index in the pack. Packed entries are decoded with
+ * UnpackRecords or ReadRecords.
+ *
+ * Records appended by a packer complete in batches, and the order of records
+ * in a pack is the order in which they were added. A packer may be used from
+ * multiple threads, and the log must outlive it.
+ */
+class RecordPacker {
+ public:
+  RecordPacker() {}
+  virtual ~RecordPacker();
+
+  /**
+   * Add a record to the open pack. Append blocks until the pack containing
+   * the record has been appended, which may take up to max_delay_us. The
+   * record is moved into the packer, or copied when passed as a slice.
+   *
+   * @return 0 or non-zero, as for Log::Append.
+   */
+  virtual int Append(std::string&& record, RecordAddress *paddr) = 0;
+  virtual int Append(const Slice& record, RecordAddress *paddr) = 0;
+  virtual int appendAsync(std::string&& record,
+      std::function<void(int, RecordAddress)> cb) = 0;
+
+  /**
+   * Append the open pack, if any, and wait for all packs to complete.
+   */
+  virtual void Flush() = 0;
+
+ public:
+  static int Create(Log *log, const RecordPackerOptions& options,
+      RecordPacker **packer);
+
+ private:
+  RecordPacker(const RecordPacker&);
+  void operator=(const RecordPacker&);
+};
+
+/**
+ * Decode a packed log entry. The slices returned in records point into entry
+ * and are only valid as long as it is.
+ *
+ * @return 0 or non-zero
+ * -EINVAL entry is not a packed entry
+ */
+int UnpackRecords(const Slice& entry, std::vector<Slice> *records);
+
+/**
+ * Read a packed log entry into buffer and decode it. The slices returned in
+ * records point into buffer.
+ *
+ * @return 0 or non-zero, as for Log::Read and UnpackRecords.
+ */
+int ReadRecords(Log *log, uint64_t position, std::string *buffer,
+    std::vector<Slice> *records);
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace zlog {
+
+/**
+ * A reference to a contiguous buffer owned by someone else.
+ *
+ * Slices describe the pieces of a log entry passed to a scatter/gather append,
+ * such as a record header and a payload kept in separate buffers. A slice does
+ * not copy or own the referenced memory; see the interfaces accepting slices
+ * for how long the memory must remain valid.
+ */
+struct Slice {
+  Slice() :
+    data(""),
+    size(0)
+  {}
+
+  Slice(const char *data, size_t size) :
+    data(data),
+    size(size)
+  {}
+
+  Slice(const std::string& s) :
+    data(s.data()),
+    size(s.size())
+  {}
+
+  Slice(const char *s) :
+    data(s),
+    size(strlen(s))
+  {}
+
+  const char *data;
+  size_t size;
+};
+
+}
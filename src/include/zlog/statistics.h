@@ -12,20 +12,76 @@ enum Tickers : uint32_t {
   CACHE_REQS,
   CACHE_MISSES,
 
+  // size of the adaptive finisher pool, and the number of times it changed
+  FINISHER_THREADS,
+  FINISHER_POOL_GROWS,
+  FINISHER_POOL_SHRINKS,
+
+  // entry compression. the ratio is COMPRESS_BYTES_IN / COMPRESS_BYTES_OUT.
+  // entries that don't compress are counted in COMPRESS_SKIPPED, and are not
+  // included in the byte counts.
+  COMPRESS_BYTES_IN,
+  COMPRESS_BYTES_OUT,
+  COMPRESS_SKIPPED,
+  DECOMPRESS_BYTES_IN,
+  DECOMPRESS_BYTES_OUT,
+
+  // entries read that didn't match their checksum, and reads repeated
+  // because of a mismatch
+  CHECKSUM_FAILURES,
+  CHECKSUM_REFETCHES,
+
+  // appends waiting in the reorder window when append callbacks are ordered
+  APPEND_REORDER_WINDOW,
+
+  // positions read that were answered from the index of filled and trimmed
+  // positions, without a backend request
+  INVALID_RANGE_HITS,
+
   TICKER_ENUM_MAX
 };
 
 const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
 
   {CACHE_REQS, "zlog_cache_reqs"},
-  {CACHE_MISSES, "zlog_cache_misses"}
+  {CACHE_MISSES, "zlog_cache_misses"},
+  {FINISHER_THREADS, "zlog_finisher_threads"},
+  {FINISHER_POOL_GROWS, "zlog_finisher_pool_grows"},
+  {FINISHER_POOL_SHRINKS, "zlog_finisher_pool_shrinks"},
+  {COMPRESS_BYTES_IN, "zlog_compress_bytes_in"},
+  {COMPRESS_BYTES_OUT, "zlog_compress_bytes_out"},
+  {COMPRESS_SKIPPED, "zlog_compress_skipped"},
+  {DECOMPRESS_BYTES_IN, "zlog_decompress_bytes_in"},
+  {DECOMPRESS_BYTES_OUT, "zlog_decompress_bytes_out"},
+  {CHECKSUM_FAILURES, "zlog_checksum_failures"},
+  {CHECKSUM_REFETCHES, "zlog_checksum_refetches"},
+  {APPEND_REORDER_WINDOW, "zlog_append_reorder_window"},
+  {INVALID_RANGE_HITS, "zlog_invalid_range_hits"}
 };
 
 enum Histograms : uint32_t {
+  // time ops spend queued before a finisher thread starts them
+  FOREGROUND_QUEUE_WAIT_MICROS,
+  BACKGROUND_QUEUE_WAIT_MICROS,
+
+  // cpu time per entry spent in the codec. only measured when stats_level_ is
+  // above kExceptDetailedTimers.
+  COMPRESSION_TIMES_NANOS,
+  DECOMPRESSION_TIMES_NANOS,
+
+  // time a completed append's callback waits for appends at lower positions
+  // when append callbacks are ordered
+  APPEND_REORDER_DELAY_MICROS,
+
   HISTOGRAM_ENUM_MAX,  // TODO(ldemailly): enforce HistogramsNameMap match
 };
 
 const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
+  {FOREGROUND_QUEUE_WAIT_MICROS, "zlog_foreground_queue_wait_micros"},
+  {BACKGROUND_QUEUE_WAIT_MICROS, "zlog_background_queue_wait_micros"},
+  {COMPRESSION_TIMES_NANOS, "zlog_compression_times_nanos"},
+  {DECOMPRESSION_TIMES_NANOS, "zlog_decompression_times_nanos"},
+  {APPEND_REORDER_DELAY_MICROS, "zlog_append_reorder_delay_micros"}
 };
 
 struct HistogramData {
@@ -1,53 +1,186 @@
-#include<iostream>
-#include<string>
-#include<unordered_map>
-#include<tuple>
-#include<iterator>
-#include"include/zlog/eviction.h"
-#include"include/zlog/cache.h"
-
-namespace zlog{
-
-Cache::~Cache(){}
-
-int Cache::put(uint64_t pos, const std::string& data){
-  int ret = 0;
-  mut.lock();
-  if(options.cache_size > 0 && data.size() < options.cache_size && cache_map.find(pos) == cache_map.end()){ 
-    eviction->cache_put_miss(pos);
-    zlog_mempool::cache::string pool_data(data.data(), data.size());
-    cache_map[pos] = zlog_mempool::cache::string(pool_data);
-  }else{
-    ret = -1;
-  }
-  mut.unlock();
-  return ret;
-}
-
-int Cache::get(uint64_t* pos, std::string* data){
-  #ifdef WITH_STATS
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <string>
+#include "include/zlog/eviction.h"
+#include "include/zlog/eviction/arc.h"
+#include "include/zlog/eviction/lru.h"
+#include "include/zlog/cache.h"
+#include "monitoring/statistics.h"
+
+namespace zlog {
+
+// each shard holds at least this much, unless the number of shards is set
+static const size_t kMinShardCapacity = 512 << 10;
+static const int kMaxShardBits = 6;
+// limit on an explicitly configured number of shards
+static const int kShardBitsLimit = 16;
+
+static int default_shard_bits(const size_t capacity)
+{
+  int bits = 0;
+  while (bits < kMaxShardBits &&
+      (capacity >> (bits + 1)) >= kMinShardCapacity) {
+    bits++;
+  }
+  return bits;
+}
+
+Cache::Cache(const zlog::Options& ops) :
+  options(ops),
+  capacity_(ops.cache_size),
+  shard_bits_(ops.cache_shard_bits >= 0 ?
+      std::min(ops.cache_shard_bits, kShardBitsLimit) : default_shard_bits(ops.cache_size)),
+  shard_capacity_(capacity_ >> shard_bits_),
+  evictions_(0)
+{
+  bool warned = false;
+  for (int i = 0; i < (1 << shard_bits_); i++) {
+    std::unique_ptr<Shard> shard(new Shard);
+    switch (options.eviction) {
+      case zlog::Eviction::Eviction_Policy::LRU:
+        shard->eviction.reset(new LRU());
+        break;
+      case zlog::Eviction::Eviction_Policy::ARC:
+        shard->eviction.reset(new ARC());
+        break;
+      default:
+        shard->eviction.reset(new LRU());
+        if (!warned) {
+          std::cout << "Eviction policy not implemented. Using default: LRU" << std::endl;
+          warned = true;
+        }
+        break;
+    }
+    shards_.emplace_back(std::move(shard));
+  }
+}
+
+Cache::~Cache() {}
+
+int Cache::put(uint64_t pos, const std::string& data)
+{
+  if (data.size() + kEntryOverhead > shard_capacity_) {
+    return -1;
+  }
+
+  // the entry is copied before the shard is locked
+  auto entry = std::allocate_shared<zlog_mempool::cache::string>(
+      zlog_mempool::cache::pool_allocator<zlog_mempool::cache::string>(),
+      data.data(), data.size());
+  const auto entry_charge = charge(entry);
+
+  // evicted entries are freed after the shard is unlocked
+  std::vector<Entry> evicted;
+
+  auto& s = shard(pos);
+  std::lock_guard<std::mutex> lk(s.lock);
+
+  if (s.entries.find(pos) != s.entries.end()) {
+    return -1;
+  }
+
+  while (s.usage + entry_charge > shard_capacity_) {
+    assert(!s.entries.empty());
+    const auto victim = s.eviction->get_evicted();
+    auto it = s.entries.find(victim);
+    assert(it != s.entries.end());
+    s.usage -= charge(it->second);
+    evicted.emplace_back(std::move(it->second));
+    s.entries.erase(it);
+  }
+  evictions_ += evicted.size();
+
+  s.entries.emplace(pos, std::move(entry));
+  s.usage += entry_charge;
+  s.eviction->cache_put_miss(pos);
+
+  return 0;
+}
+
+int Cache::get(uint64_t* pos, std::string* data)
+{
   RecordTick(options.statistics, CACHE_REQS);
-  #endif
-  auto map_it = cache_map.find(*pos);
-  int ret = 0;       
-  mut.lock(); 
-  if(map_it != cache_map.end()){
-    data->assign((map_it->second).data(), (map_it->second).size());
-    eviction->cache_get_hit(pos);
-  }else{
-    #ifdef WITH_STATS
+
+  Entry entry;
+  {
+    auto& s = shard(*pos);
+    std::lock_guard<std::mutex> lk(s.lock);
+    auto it = s.entries.find(*pos);
+    if (it != s.entries.end()) {
+      entry = it->second;
+      s.eviction->cache_get_hit(pos);
+    }
+  }
+
+  if (!entry) {
     RecordTick(options.statistics, CACHE_MISSES);
-    #endif
-    ret = 1;
+    return 1;
   }
-  mut.unlock();
-  return ret;
+
+  data->assign(entry->data(), entry->size());
+  return 0;
 }
 
-int Cache::remove(uint64_t* pos){
-  if(cache_map.erase(*pos) > 0){
-    return 0;    
+Cache::Entry Cache::erase(Shard& s, const uint64_t pos)
+{
+  auto it = s.entries.find(pos);
+  if (it == s.entries.end()) {
+    return nullptr;
   }
-  return 1;
+  auto entry = std::move(it->second);
+  s.entries.erase(it);
+  s.usage -= charge(entry);
+  s.eviction->cache_remove(pos);
+  return entry;
 }
+
+int Cache::remove(uint64_t* pos)
+{
+  Entry entry;
+  {
+    auto& s = shard(*pos);
+    std::lock_guard<std::mutex> lk(s.lock);
+    entry = erase(s, *pos);
+  }
+  return entry ? 0 : 1;
+}
+
+void Cache::remove_below(uint64_t pos)
+{
+  for (auto& s : shards_) {
+    std::vector<Entry> removed;
+    std::lock_guard<std::mutex> lk(s->lock);
+    std::vector<uint64_t> positions;
+    for (const auto& entry : s->entries) {
+      if (entry.first < pos) {
+        positions.push_back(entry.first);
+      }
+    }
+    for (const auto position : positions) {
+      removed.emplace_back(erase(*s, position));
+    }
+  }
+}
+
+size_t Cache::usage() const
+{
+  size_t usage = 0;
+  for (const auto& s : shards_) {
+    std::lock_guard<std::mutex> lk(s->lock);
+    usage += s->usage;
+  }
+  return usage;
+}
+
+size_t Cache::size() const
+{
+  size_t size = 0;
+  for (const auto& s : shards_) {
+    std::lock_guard<std::mutex> lk(s->lock);
+    size += s->entries.size();
+  }
+  return size;
+}
+
 }
@@ -0,0 +1,190 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/zlog/cache.h"
+
+static std::string entry(uint64_t pos, size_t size = 100)
+{
+  auto s = std::to_string(pos);
+  s.resize(size, 'x');
+  return s;
+}
+
+static const size_t kCharge = 100 + zlog::Cache::kEntryOverhead;
+
+TEST(CacheTest, ByteCapacity) {
+  zlog::Options options;
+  options.cache_size = 4 * kCharge;
+  zlog::Cache cache(options);
+  ASSERT_EQ(cache.num_shards(), 1u);
+
+  for (uint64_t pos = 0; pos < 4; pos++) {
+    ASSERT_EQ(cache.put(pos, entry(pos)), 0);
+  }
+  ASSERT_EQ(cache.size(), 4u);
+  ASSERT_EQ(cache.usage(), 4 * kCharge);
+  ASSERT_EQ(cache.evictions(), 0u);
+
+  // the least recently used entry makes room for a new one
+  std::string data;
+  uint64_t pos = 0;
+  ASSERT_EQ(cache.get(&pos, &data), 0);
+  ASSERT_EQ(data, entry(0));
+  ASSERT_EQ(cache.put(4, entry(4)), 0);
+  ASSERT_EQ(cache.size(), 4u);
+  ASSERT_EQ(cache.evictions(), 1u);
+  pos = 1;
+  ASSERT_NE(cache.get(&pos, &data), 0);
+  pos = 0;
+  ASSERT_EQ(cache.get(&pos, &data), 0);
+
+  // a large entry evicts several small ones
+  ASSERT_EQ(cache.put(5, entry(5, 250)), 0);
+  ASSERT_LE(cache.usage(), cache.capacity());
+  ASSERT_EQ(cache.size(), 3u);
+
+  // entries larger than the cache aren't cached, and entries are immutable
+  ASSERT_NE(cache.put(6, entry(6, 4 * kCharge)), 0);
+  ASSERT_NE(cache.put(5, entry(7)), 0);
+  pos = 5;
+  ASSERT_EQ(cache.get(&pos, &data), 0);
+  ASSERT_EQ(data, entry(5, 250));
+}
+
+TEST(CacheTest, Remove) {
+  zlog::Options options;
+  options.cache_size = 1 << 20;
+  options.cache_shard_bits = 2;
+  zlog::Cache cache(options);
+  ASSERT_EQ(cache.num_shards(), 4u);
+
+  for (uint64_t pos = 0; pos < 100; pos++) {
+    ASSERT_EQ(cache.put(pos, entry(pos)), 0);
+  }
+  ASSERT_EQ(cache.usage(), 100 * kCharge);
+
+  uint64_t pos = 50;
+  ASSERT_EQ(cache.remove(&pos), 0);
+  ASSERT_NE(cache.remove(&pos), 0);
+  cache.remove_below(20);
+  ASSERT_EQ(cache.size(), 79u);
+  ASSERT_EQ(cache.usage(), 79 * kCharge);
+
+  std::string data;
+  for (pos = 0; pos < 100; pos++) {
+    uint64_t p = pos;
+    const bool cached = pos >= 20 && pos != 50;
+    ASSERT_EQ(cache.get(&p, &data) == 0, cached);
+  }
+
+  // removed positions can be cached again
+  ASSERT_EQ(cache.put(10, entry(10)), 0);
+}
+
+TEST(CacheTest, Shards) {
+  zlog::Options options;
+  options.cache_size = 1 << 20;
+  ASSERT_EQ(zlog::Cache(options).num_shards(), 2u);
+  options.cache_size = 1 << 30;
+  ASSERT_EQ(zlog::Cache(options).num_shards(), 64u);
+  options.cache_size = 1 << 10;
+  ASSERT_EQ(zlog::Cache(options).num_shards(), 1u);
+  options.cache_shard_bits = 3;
+  ASSERT_EQ(zlog::Cache(options).num_shards(), 8u);
+
+  // consecutive positions are spread across the shards, which each hold an
+  // equal part of the capacity
+  options.cache_size = 64 * kCharge;
+  zlog::Cache cache(options);
+  for (uint64_t pos = 0; pos < 48; pos++) {
+    ASSERT_EQ(cache.put(pos, entry(pos)), 0);
+  }
+  ASSERT_EQ(cache.size(), 48u);
+  ASSERT_EQ(cache.evictions(), 0u);
+}
+
+// entries that are hit again survive a scan under ARC, but not under LRU
+TEST(CacheTest, ScanResistance) {
+  for (const auto policy : {zlog::Eviction::Eviction_Policy::LRU,
+      zlog::Eviction::Eviction_Policy::ARC}) {
+    zlog::Options options;
+    options.cache_size = 4 * kCharge;
+    options.eviction = policy;
+    zlog::Cache cache(options);
+
+    std::string data;
+    for (uint64_t pos = 0; pos < 4; pos++) {
+      ASSERT_EQ(cache.put(pos, entry(pos)), 0);
+      uint64_t p = pos;
+      ASSERT_EQ(cache.get(&p, &data), 0);
+    }
+
+    for (uint64_t pos = 100; pos < 104; pos++) {
+      ASSERT_EQ(cache.put(pos, entry(pos)), 0);
+    }
+    ASSERT_EQ(cache.size(), 4u);
+
+    size_t hot = 0;
+    for (uint64_t pos = 0; pos < 4; pos++) {
+      uint64_t p = pos;
+      if (cache.get(&p, &data) == 0) {
+        hot++;
+      }
+    }
+
+    if (policy == zlog::Eviction::Eviction_Policy::LRU) {
+      ASSERT_EQ(hot, 0u);
+    } else {
+      ASSERT_EQ(hot, 3u);
+    }
+  }
+}
+
+TEST(CacheTest, MempoolCharge) {
+  // entries and the index are allocated from the cache pool
+  const auto before = zlog_mempool::cache::allocated_bytes();
+  {
+    zlog::Options options;
+    options.cache_size = 1 << 20;
+    zlog::Cache cache(options);
+    for (uint64_t pos = 0; pos < 10; pos++) {
+      ASSERT_EQ(cache.put(pos, entry(pos, 1000)), 0);
+    }
+    ASSERT_GE(zlog_mempool::cache::allocated_bytes(), before + 10 * 1000);
+  }
+  ASSERT_EQ(zlog_mempool::cache::allocated_bytes(), before);
+}
+
+TEST(CacheTest, Concurrent) {
+  for (const auto policy : {zlog::Eviction::Eviction_Policy::LRU,
+      zlog::Eviction::Eviction_Policy::ARC}) {
+    zlog::Options options;
+    options.cache_size = 200 * kCharge;
+    options.cache_shard_bits = 2;
+    options.eviction = policy;
+    zlog::Cache cache(options);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&, t] {
+        std::string data;
+        for (uint64_t i = 0; i < 5000; i++) {
+          uint64_t pos = (i * 7 + t * 13) % 500;
+          if (i % 4 == 0) {
+            cache.put(pos, entry(pos));
+          } else if (i % 100 == 3) {
+            cache.remove(&pos);
+          } else if (cache.get(&pos, &data) == 0) {
+            ASSERT_EQ(data, entry(pos));
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    ASSERT_LE(cache.usage(), cache.capacity());
+    ASSERT_EQ(cache.usage(), cache.size() * kCharge);
+  }
+}
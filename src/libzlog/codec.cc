@@ -0,0 +1,208 @@
+#include "include/zlog/codec.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace zlog {
+
+const uint8_t Codec::kNoOp;
+const uint8_t Codec::kLZ;
+const uint64_t Codec::kMaxDecompressedSize;
+
+// the noop codec never compresses. entries written with it are stored behind
+// a header that marks them as uncompressed.
+class NoOpCodec : public Codec {
+ public:
+  uint8_t Id() const override {
+    return kNoOp;
+  }
+
+  const char *Name() const override {
+    return "none";
+  }
+
+  bool Compress(const Slice& input, std::string *output) override {
+    return false;
+  }
+
+  int Decompress(const Slice& input, char *output, size_t size) override {
+    if (input.size != size) {
+      return -EINVAL;
+    }
+    std::memcpy(output, input.data, size);
+    return 0;
+  }
+
+  uint64_t MaxDecompressedSize(size_t input_size) const override {
+    return input_size;
+  }
+};
+
+// a byte-oriented LZ77 codec. the compressed form is a sequence of tagged
+// runs. a tag with the high bit clear is followed by (tag + 1) literal bytes.
+// a tag with the high bit set is a match of ((tag & 0x7f) + 4) bytes,
+// followed by a two byte little-endian offset back into the output. matches
+// are found with a single-entry hash table of 4-byte sequences, so
+// compression is fast but makes no attempt at finding the best match.
+static const size_t kMinMatch = 4;
+static const size_t kMaxMatch = kMinMatch + 0x7f;
+static const size_t kMaxLiterals = 0x80;
+static const size_t kMaxOffset = 0xffff;
+static const int kHashBits = 12;
+
+class LZCodec : public Codec {
+ public:
+  uint8_t Id() const override {
+    return kLZ;
+  }
+
+  const char *Name() const override {
+    return "lz";
+  }
+
+  bool Compress(const Slice& input, std::string *output) override;
+  int Decompress(const Slice& input, char *output, size_t size) override;
+
+  // every 3 bytes of input expand to at most one maximum length match
+  uint64_t MaxDecompressedSize(size_t input_size) const override {
+    return (uint64_t(input_size) / 3 + 1) * kMaxMatch;
+  }
+
+ private:
+  static inline uint32_t hash(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return (v * 2654435761U) >> (32 - kHashBits);
+  }
+
+  static void put_literals(std::string *output, const char *data,
+      size_t size) {
+    while (size > 0) {
+      const size_t n = std::min(size, kMaxLiterals);
+      output->push_back(static_cast<char>(n - 1));
+      output->append(data, n);
+      data += n;
+      size -= n;
+    }
+  }
+};
+
+bool LZCodec::Compress(const Slice& input, std::string *output)
+{
+  const char *src = input.data;
+  const size_t size = input.size;
+  const size_t start = output->size();
+
+  if (size < 2 * kMinMatch) {
+    return false;
+  }
+
+  output->reserve(start + size);
+
+  // positions are stored plus one so that zero means empty
+  uint32_t table[1 << kHashBits];
+  std::memset(table, 0, sizeof(table));
+
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + kMinMatch <= size) {
+    const auto h = hash(src + pos);
+    const size_t cand = table[h];
+    table[h] = pos + 1;
+
+    if (cand == 0 || pos - (cand - 1) > kMaxOffset ||
+        std::memcmp(src + cand - 1, src + pos, kMinMatch) != 0) {
+      pos++;
+      continue;
+    }
+
+    const size_t match = cand - 1;
+    size_t len = kMinMatch;
+    while (pos + len < size && len < kMaxMatch &&
+        src[match + len] == src[pos + len]) {
+      len++;
+    }
+
+    put_literals(output, src + anchor, pos - anchor);
+
+    const size_t offset = pos - match;
+    output->push_back(static_cast<char>(0x80 | (len - kMinMatch)));
+    output->push_back(static_cast<char>(offset & 0xff));
+    output->push_back(static_cast<char>(offset >> 8));
+
+    pos += len;
+    anchor = pos;
+
+    if (output->size() - start >= size) {
+      return false;
+    }
+  }
+
+  put_literals(output, src + anchor, size - anchor);
+
+  return output->size() - start < size;
+}
+
+int LZCodec::Decompress(const Slice& input, char *output, size_t size)
+{
+  const auto src = reinterpret_cast<const unsigned char*>(input.data);
+  size_t ip = 0;
+  size_t op = 0;
+
+  while (ip < input.size) {
+    const auto tag = src[ip++];
+    if (!(tag & 0x80)) {
+      const size_t len = tag + 1;
+      if (ip + len > input.size || op + len > size) {
+        return -EINVAL;
+      }
+      std::memcpy(output + op, src + ip, len);
+      ip += len;
+      op += len;
+    } else {
+      const size_t len = (tag & 0x7f) + kMinMatch;
+      if (ip + 2 > input.size) {
+        return -EINVAL;
+      }
+      const size_t offset = src[ip] | (size_t(src[ip + 1]) << 8);
+      ip += 2;
+      if (offset == 0 || offset > op || op + len > size) {
+        return -EINVAL;
+      }
+      // the source and destination may overlap
+      for (size_t i = 0; i < len; i++) {
+        output[op + i] = output[op - offset + i];
+      }
+      op += len;
+    }
+  }
+
+  return op == size ? 0 : -EINVAL;
+}
+
+std::shared_ptr<Codec> Codec::Builtin(const uint8_t id)
+{
+  static const auto noop = std::make_shared<NoOpCodec>();
+  static const auto lz = std::make_shared<LZCodec>();
+
+  switch (id) {
+    case kNoOp:
+      return noop;
+    case kLZ:
+      return lz;
+    default:
+      return nullptr;
+  }
+}
+
+std::shared_ptr<Codec> Codec::Builtin(const std::string& name)
+{
+  if (name == "none") {
+    return Builtin(kNoOp);
+  } else if (name == "lz") {
+    return Builtin(kLZ);
+  }
+  return nullptr;
+}
+
+}
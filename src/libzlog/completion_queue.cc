@@ -0,0 +1,90 @@
+#include "completion_queue.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace zlog {
+
+CompletionQueue::~CompletionQueue() {}
+
+CompletionQueue *CompletionQueue::Create()
+{
+  return new CompletionQueueImpl();
+}
+
+CompletionQueueImpl::~CompletionQueueImpl()
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  assert(pending_ == 0);
+}
+
+void CompletionQueueImpl::add_pending(const size_t count)
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  pending_ += count;
+}
+
+void CompletionQueueImpl::complete(LogRequest::Type type, uint64_t cookie,
+    int ret, uint64_t position, std::string *data)
+{
+  LogCompletion c;
+  c.type = type;
+  c.cookie = cookie;
+  c.ret = ret;
+  c.position = position;
+  if (data) {
+    c.data.swap(*data);
+  }
+
+  std::lock_guard<std::mutex> lk(lock_);
+  completions_.emplace_back(std::move(c));
+  cond_.notify_all();
+}
+
+size_t CompletionQueueImpl::reap_locked(std::vector<LogCompletion> *out,
+    const size_t max)
+{
+  size_t count = 0;
+  while (count < max && !completions_.empty()) {
+    out->emplace_back(std::move(completions_.front()));
+    completions_.pop_front();
+    count++;
+  }
+  assert(pending_ >= count);
+  pending_ -= count;
+  return count;
+}
+
+size_t CompletionQueueImpl::Reap(std::vector<LogCompletion> *out,
+    const size_t max)
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  return reap_locked(out, max);
+}
+
+size_t CompletionQueueImpl::Wait(std::vector<LogCompletion> *out,
+    const size_t min, const size_t max, const int timeout_ms)
+{
+  std::unique_lock<std::mutex> lk(lock_);
+
+  // never wait for more completions than there are outstanding requests
+  const auto ready = [&] {
+    return completions_.size() >= std::min(min, pending_);
+  };
+
+  if (timeout_ms < 0) {
+    cond_.wait(lk, ready);
+  } else {
+    cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms), ready);
+  }
+
+  return reap_locked(out, max);
+}
+
+size_t CompletionQueueImpl::Pending() const
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  return pending_;
+}
+
+}
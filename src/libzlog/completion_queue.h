@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "include/zlog/log.h"
+
+namespace zlog {
+
+class CompletionQueueImpl : public CompletionQueue {
+ public:
+  CompletionQueueImpl() :
+    pending_(0)
+  {}
+
+  ~CompletionQueueImpl();
+
+  size_t Reap(std::vector<LogCompletion> *out, size_t max) override;
+
+  size_t Wait(std::vector<LogCompletion> *out, size_t min,
+      size_t max, int timeout_ms) override;
+
+  size_t Pending() const override;
+
+ public:
+  // account for requests that will later be completed. called before the
+  // requests are queued so that Pending() never under counts.
+  void add_pending(size_t count);
+
+  // deliver a completion. called from log finisher threads, or from the
+  // submitting thread for reads answered without a backend request.
+  void complete(LogRequest::Type type, uint64_t cookie, int ret,
+      uint64_t position, std::string *data);
+
+ private:
+  size_t reap_locked(std::vector<LogCompletion> *out, size_t max);
+
+  mutable std::mutex lock_;
+  std::condition_variable cond_;
+  std::deque<LogCompletion> completions_;
+  size_t pending_;
+};
+
+}
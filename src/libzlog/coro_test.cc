@@ -0,0 +1,235 @@
+// built as c++20 when the compiler supports it, and empty otherwise
+#include "zlog/coro.h"
+
+#ifdef ZLOG_HAVE_COROUTINES
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "libzlog/log_impl.h"
+#include "test_libzlog.h"
+
+// a coroutine that starts when it's called, and signals when it returns
+struct Task {
+  struct State {
+    std::mutex lock;
+    std::condition_variable cond;
+    bool done = false;
+
+    void wait() {
+      std::unique_lock<std::mutex> lk(lock);
+      cond.wait(lk, [this] { return done; });
+    }
+  };
+
+  struct promise_type {
+    State *state = nullptr;
+
+    Task get_return_object() {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept {
+      std::lock_guard<std::mutex> lk(state->lock);
+      state->done = true;
+      state->cond.notify_one();
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  void run(State *state) {
+    handle.promise().state = state;
+    handle.resume();
+  }
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+// resumes coroutines on a single thread
+class ThreadExecutor : public zlog::Executor {
+ public:
+  ThreadExecutor() :
+    stop_(false),
+    thread_(&ThreadExecutor::entry, this)
+  {}
+
+  ~ThreadExecutor() {
+    {
+      std::lock_guard<std::mutex> lk(lock_);
+      stop_ = true;
+      cond_.notify_one();
+    }
+    thread_.join();
+  }
+
+  void Execute(std::function<void()> fn) override {
+    std::lock_guard<std::mutex> lk(lock_);
+    queue_.push_back(std::move(fn));
+    cond_.notify_one();
+  }
+
+  std::thread::id id() const {
+    return thread_.get_id();
+  }
+
+ private:
+  void entry() {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (true) {
+      cond_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      auto fn = std::move(queue_.front());
+      queue_.pop_front();
+      lk.unlock();
+      fn();
+      lk.lock();
+    }
+  }
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::deque<std::function<void()>> queue_;
+  bool stop_;
+  std::thread thread_;
+};
+
+static Task append_read(zlog::CoroLog& clog, int count, int *verified,
+    ThreadExecutor *executor)
+{
+  for (int i = 0; i < count; i++) {
+    const auto data = "entry-" + std::to_string(i);
+    auto appended = co_await clog.Append(data);
+    EXPECT_EQ(appended.ret, 0);
+    if (executor) {
+      EXPECT_EQ(std::this_thread::get_id(), executor->id());
+    }
+
+    auto read = co_await clog.Read(appended.position);
+    EXPECT_EQ(read.ret, 0);
+    EXPECT_EQ(read.data, data);
+
+    auto tail = co_await clog.CheckTail();
+    EXPECT_EQ(tail.ret, 0);
+    EXPECT_GT(tail.position, appended.position);
+
+    if (!appended.ret && !read.ret && read.data == data) {
+      (*verified)++;
+    }
+  }
+}
+
+TEST_P(ZLogTest, CoroAppendRead) {
+  DoSetUp();
+
+  zlog::CoroLog clog(log);
+  Task::State state;
+  int verified = 0;
+  append_read(clog, 100, &verified, nullptr).run(&state);
+  state.wait();
+  ASSERT_EQ(verified, 100);
+}
+
+TEST_P(ZLogTest, CoroExecutor) {
+  DoSetUp();
+
+  ThreadExecutor executor;
+  zlog::CoroLog clog(log, &executor);
+  Task::State state;
+  int verified = 0;
+  append_read(clog, 100, &verified, &executor).run(&state);
+  state.wait();
+  ASSERT_EQ(verified, 100);
+}
+
+static Task fill_trim(zlog::CoroLog& clog, uint64_t position, int *results)
+{
+  results[0] = co_await clog.Fill(position);
+  results[1] = (co_await clog.Read(position)).ret;
+  results[2] = co_await clog.Trim(position + 1);
+  results[3] = (co_await clog.Read(position + 1)).ret;
+  results[4] = co_await clog.TrimTo(position + 1);
+}
+
+TEST_P(ZLogTest, CoroFillTrim) {
+  DoSetUp();
+
+  zlog::CoroLog clog(log);
+  Task::State state;
+  int results[5];
+  fill_trim(clog, 10, results).run(&state);
+  state.wait();
+  ASSERT_EQ(results[0], 0);
+  ASSERT_EQ(results[1], -ENODATA);
+  ASSERT_EQ(results[2], 0);
+  ASSERT_EQ(results[3], -ENODATA);
+  ASSERT_EQ(results[4], 0);
+}
+
+// reads answered from the cache or the index of invalid positions complete
+// before readAsync returns. the coroutine continues without suspending
+// instead of being resumed from the callback, which would nest it a little
+// deeper in the stack with every read.
+static Task read_loop(zlog::CoroLog& clog, uint64_t first, uint64_t count,
+    int expected, uint64_t *matched)
+{
+  for (uint64_t i = 0; i < count; i++) {
+    auto res = co_await clog.Read(first + (i % 1000));
+    if (res.ret == expected) {
+      (*matched)++;
+    }
+  }
+}
+
+TEST_P(ZLogTest, CoroReadCached) {
+  DoSetUp();
+
+  if (!lowlevel()) {
+    // the cached log needs the same backend instance
+    return;
+  }
+
+  zlog::Options options2 = options;
+  options2.create_if_missing = false;
+  options2.error_if_exists = false;
+  options2.statistics = nullptr;
+  options2.cache_size = 1 << 20;
+
+  zlog::Log *clog_log;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &clog_log), 0);
+  std::unique_ptr<zlog::Log> clog_log_ptr(clog_log);
+
+  for (int i = 0; i < 1000; i++) {
+    uint64_t pos;
+    ASSERT_EQ(clog_log->Append("a", &pos), 0);
+  }
+
+  zlog::CoroLog clog(clog_log);
+  Task::State state;
+  uint64_t matched = 0;
+  read_loop(clog, 0, 200000, 0, &matched).run(&state);
+  state.wait();
+  ASSERT_EQ(matched, 200000u);
+}
+
+TEST_P(ZLogTest, CoroReadTrimmed) {
+  DoSetUp();
+
+  // the reads cycle through the trimmed prefix
+  ASSERT_EQ(log->trimTo(999), 0);
+
+  zlog::CoroLog clog(log);
+  Task::State state;
+  uint64_t matched = 0;
+  read_loop(clog, 0, 200000, -ENODATA, &matched).run(&state);
+  state.wait();
+  ASSERT_EQ(matched, 200000u);
+
+  // all answered from the index of invalid positions
+  ASSERT_GE(((zlog::LogImpl*)log)->invalid_range_hits, 200000u);
+}
+
+#endif
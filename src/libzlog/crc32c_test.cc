@@ -0,0 +1,78 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "util/crc32c.h"
+
+static std::string random_string(size_t size, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::string s(size, 0);
+  for (auto& c : s) {
+    c = static_cast<char>(gen());
+  }
+  return s;
+}
+
+// test vectors from rfc 3720 section b.4
+TEST(Crc32cTest, StandardResults) {
+  char buf[32];
+
+  memset(buf, 0, sizeof(buf));
+  ASSERT_EQ(0x8a9136aaU, zlog::crc32c::Value(buf, sizeof(buf)));
+  ASSERT_EQ(0x8a9136aaU, zlog::crc32c::ExtendPortable(0, buf, sizeof(buf)));
+
+  memset(buf, 0xff, sizeof(buf));
+  ASSERT_EQ(0x62a8ab43U, zlog::crc32c::Value(buf, sizeof(buf)));
+  ASSERT_EQ(0x62a8ab43U, zlog::crc32c::ExtendPortable(0, buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; i++) {
+    buf[i] = i;
+  }
+  ASSERT_EQ(0x46dd794eU, zlog::crc32c::Value(buf, sizeof(buf)));
+  ASSERT_EQ(0x46dd794eU, zlog::crc32c::ExtendPortable(0, buf, sizeof(buf)));
+
+  const std::string s = "123456789";
+  ASSERT_EQ(0xe3069283U, zlog::crc32c::Value(s.data(), s.size()));
+  ASSERT_EQ(0xe3069283U, zlog::crc32c::ExtendPortable(0, s.data(), s.size()));
+
+  ASSERT_EQ(0U, zlog::crc32c::Value(s.data(), 0));
+}
+
+TEST(Crc32cTest, HardwareMatchesPortable) {
+  const auto data = random_string(4096, 1);
+  for (size_t off = 0; off < 9; off++) {
+    for (size_t size = 0; off + size <= data.size(); size += 37) {
+      ASSERT_EQ(zlog::crc32c::Value(data.data() + off, size),
+          zlog::crc32c::ExtendPortable(0, data.data() + off, size));
+    }
+  }
+}
+
+TEST(Crc32cTest, Extend) {
+  const auto data = random_string(1000, 2);
+  const auto expected = zlog::crc32c::Value(data.data(), data.size());
+  for (size_t split = 0; split <= data.size(); split += 13) {
+    const auto crc = zlog::crc32c::Value(data.data(), split);
+    ASSERT_EQ(expected, zlog::crc32c::Extend(crc, data.data() + split,
+          data.size() - split));
+    ASSERT_EQ(expected, zlog::crc32c::ExtendPortable(crc, data.data() + split,
+          data.size() - split));
+  }
+}
+
+TEST(Crc32cTest, ValueBatch) {
+  // buffers of different sizes, so that the interleaved streams end at
+  // different offsets, and a count that isn't a multiple of the batch width.
+  std::vector<std::string> buffers;
+  for (unsigned i = 0; i < 23; i++) {
+    buffers.push_back(random_string(i * 29 % 300, i));
+  }
+
+  std::vector<zlog::Slice> slices(buffers.begin(), buffers.end());
+  std::vector<uint32_t> crcs(slices.size());
+  zlog::crc32c::ValueBatch(slices.data(), slices.size(), crcs.data());
+
+  for (size_t i = 0; i < buffers.size(); i++) {
+    ASSERT_EQ(crcs[i], zlog::crc32c::Value(buffers[i].data(),
+          buffers[i].size()));
+  }
+}
@@ -0,0 +1,199 @@
+#include "entry_codec.h"
+#include <cassert>
+#include <cerrno>
+#include <time.h>
+#include "monitoring/statistics.h"
+
+namespace zlog {
+
+static inline uint64_t thread_cpu_nanos()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (((uint64_t)ts.tv_sec) * 1000000000ULL) + ts.tv_nsec;
+}
+
+static inline void put_varint64(std::string *dst, uint64_t value)
+{
+  while (value >= 0x80) {
+    dst->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  dst->push_back(static_cast<char>(value));
+}
+
+// returns the number of bytes consumed, or zero if the input is truncated or
+// the value doesn't fit.
+static inline size_t get_varint64(const char *src, size_t size,
+    uint64_t *value)
+{
+  uint64_t result = 0;
+  for (size_t i = 0; i < size && i < 10; i++) {
+    const uint64_t byte = static_cast<unsigned char>(src[i]);
+    result |= (byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+EntryCodec::EntryCodec(std::shared_ptr<Codec> codec,
+    Statistics *statistics) :
+  codec_(codec),
+  statistics_(statistics),
+  compress_bytes_in_(0),
+  compress_bytes_out_(0),
+  compress_skipped_(0),
+  decompress_bytes_in_(0),
+  decompress_bytes_out_(0),
+  compress_cpu_nanos_(0),
+  decompress_cpu_nanos_(0)
+{
+  assert(codec_);
+}
+
+bool EntryCodec::timed() const
+{
+  return statistics_ &&
+    statistics_->stats_level_ > kExceptDetailedTimers;
+}
+
+void EntryCodec::Encode(const Slice *data, const size_t count,
+    std::string *output)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++) {
+    size += data[i].size;
+  }
+
+  // the codec compresses a single buffer
+  std::string flat;
+  Slice input;
+  if (count == 1) {
+    input = data[0];
+  } else {
+    flat.reserve(size);
+    for (size_t i = 0; i < count; i++) {
+      flat.append(data[i].data, data[i].size);
+    }
+    input = Slice(flat);
+  }
+
+  if (codec_->Id() != Codec::kNoOp) {
+    const auto start_ns = timed() ? thread_cpu_nanos() : 0;
+
+    output->clear();
+    output->push_back(static_cast<char>(codec_->Id()));
+    put_varint64(output, size);
+    const auto header_size = output->size();
+    const bool compressed = codec_->Compress(input, output);
+
+    if (start_ns) {
+      const auto elapsed_ns = thread_cpu_nanos() - start_ns;
+      compress_cpu_nanos_ += elapsed_ns;
+      MeasureTime(statistics_, COMPRESSION_TIMES_NANOS, elapsed_ns);
+    }
+
+    if (compressed) {
+      const auto out = output->size() - header_size;
+      compress_bytes_in_ += size;
+      compress_bytes_out_ += out;
+      RecordTick(statistics_, COMPRESS_BYTES_IN, size);
+      RecordTick(statistics_, COMPRESS_BYTES_OUT, out);
+      return;
+    }
+
+    compress_skipped_++;
+    RecordTick(statistics_, COMPRESS_SKIPPED);
+  }
+
+  output->clear();
+  output->reserve(size + 1);
+  output->push_back(static_cast<char>(Codec::kNoOp));
+  output->append(input.data, input.size);
+}
+
+int EntryCodec::Decode(std::string *entry)
+{
+  if (entry->empty()) {
+    return -EINVAL;
+  }
+
+  const auto id = static_cast<uint8_t>((*entry)[0]);
+  if (id == Codec::kNoOp) {
+    entry->erase(0, 1);
+    return 0;
+  }
+
+  Codec *codec = nullptr;
+  std::shared_ptr<Codec> builtin;
+  if (id == codec_->Id()) {
+    codec = codec_.get();
+  } else {
+    builtin = Codec::Builtin(id);
+    codec = builtin.get();
+  }
+
+  if (!codec) {
+    return -EINVAL;
+  }
+
+  uint64_t size;
+  const auto varint_size = get_varint64(entry->data() + 1,
+      entry->size() - 1, &size);
+  if (varint_size == 0) {
+    return -EINVAL;
+  }
+
+  const auto header_size = 1 + varint_size;
+  const Slice input(entry->data() + header_size,
+      entry->size() - header_size);
+
+  // the size comes from the stored entry, which may be corrupt or may not be
+  // an encoded entry at all
+  if (size > codec->MaxDecompressedSize(input.size)) {
+    return -EINVAL;
+  }
+
+  const auto start_ns = timed() ? thread_cpu_nanos() : 0;
+
+  std::string output;
+  output.resize(size);
+  int ret = codec->Decompress(input, &output[0], size);
+
+  if (start_ns) {
+    const auto elapsed_ns = thread_cpu_nanos() - start_ns;
+    decompress_cpu_nanos_ += elapsed_ns;
+    MeasureTime(statistics_, DECOMPRESSION_TIMES_NANOS, elapsed_ns);
+  }
+
+  if (ret) {
+    return ret;
+  }
+
+  decompress_bytes_in_ += input.size;
+  decompress_bytes_out_ += size;
+  RecordTick(statistics_, DECOMPRESS_BYTES_IN, input.size);
+  RecordTick(statistics_, DECOMPRESS_BYTES_OUT, size);
+
+  entry->swap(output);
+
+  return 0;
+}
+
+EntryCodec::Stats EntryCodec::stats() const
+{
+  Stats stats;
+  stats.compress_bytes_in = compress_bytes_in_;
+  stats.compress_bytes_out = compress_bytes_out_;
+  stats.compress_skipped = compress_skipped_;
+  stats.decompress_bytes_in = decompress_bytes_in_;
+  stats.decompress_bytes_out = decompress_bytes_out_;
+  stats.compress_cpu_nanos = compress_cpu_nanos_;
+  stats.decompress_cpu_nanos = decompress_cpu_nanos_;
+  return stats;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include "include/zlog/codec.h"
+#include "include/zlog/statistics.h"
+
+namespace zlog {
+
+// encodes log entries with a codec, and decodes entries written with any
+// codec that is built-in or is the configured codec.
+//
+// an encoded entry starts with the id of the codec. for codecs other than the
+// noop codec the id is followed by the uncompressed size as a varint, and then
+// the compressed data. entries that don't compress are stored with the noop
+// codec id followed by the entry.
+class EntryCodec {
+ public:
+  EntryCodec(std::shared_ptr<Codec> codec, Statistics *statistics);
+
+  EntryCodec(const EntryCodec&) = delete;
+  EntryCodec& operator=(const EntryCodec&) = delete;
+
+  const Codec& codec() const {
+    return *codec_;
+  }
+
+  // encode the concatenation of the count slices in data into output
+  void Encode(const Slice *data, size_t count, std::string *output);
+
+  // decode an entry in place
+  int Decode(std::string *entry);
+
+  struct Stats {
+    uint64_t compress_bytes_in;
+    uint64_t compress_bytes_out;
+    uint64_t compress_skipped;
+    uint64_t decompress_bytes_in;
+    uint64_t decompress_bytes_out;
+    uint64_t compress_cpu_nanos;
+    uint64_t decompress_cpu_nanos;
+  };
+
+  Stats stats() const;
+
+ private:
+  // cpu time is only measured when statistics with detailed timers are set
+  bool timed() const;
+
+  const std::shared_ptr<Codec> codec_;
+  Statistics * const statistics_;
+
+  std::atomic<uint64_t> compress_bytes_in_;
+  std::atomic<uint64_t> compress_bytes_out_;
+  std::atomic<uint64_t> compress_skipped_;
+  std::atomic<uint64_t> decompress_bytes_in_;
+  std::atomic<uint64_t> decompress_bytes_out_;
+  std::atomic<uint64_t> compress_cpu_nanos_;
+  std::atomic<uint64_t> decompress_cpu_nanos_;
+};
+
+}
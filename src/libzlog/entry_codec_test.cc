@@ -0,0 +1,178 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "libzlog/entry_codec.h"
+
+static std::string random_string(size_t size, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::string s(size, 0);
+  for (auto& c : s) {
+    c = static_cast<char>(gen());
+  }
+  return s;
+}
+
+static std::string json_string(size_t count)
+{
+  std::string s;
+  for (size_t i = 0; i < count; i++) {
+    s += "{\"id\": " + std::to_string(i) + ", \"name\": \"entry\", "
+      "\"tags\": [\"a\", \"b\"], \"value\": " + std::to_string(i * 7) + "}\n";
+  }
+  return s;
+}
+
+static std::string roundtrip(zlog::EntryCodec& codec, const std::string& data)
+{
+  const zlog::Slice slice(data);
+  std::string entry;
+  codec.Encode(&slice, 1, &entry);
+  EXPECT_EQ(codec.Decode(&entry), 0);
+  return entry;
+}
+
+TEST(EntryCodecTest, Builtin) {
+  ASSERT_EQ(zlog::Codec::Builtin("none")->Id(), zlog::Codec::kNoOp);
+  ASSERT_EQ(zlog::Codec::Builtin("lz")->Id(), zlog::Codec::kLZ);
+  ASSERT_EQ(zlog::Codec::Builtin(zlog::Codec::kLZ)->Name(), std::string("lz"));
+  ASSERT_EQ(zlog::Codec::Builtin("zip"), nullptr);
+  ASSERT_EQ(zlog::Codec::Builtin(100), nullptr);
+}
+
+TEST(EntryCodecTest, RoundTrip) {
+  zlog::EntryCodec codec(zlog::Codec::Builtin("lz"), nullptr);
+
+  const std::vector<std::string> inputs = {
+    "",
+    "a",
+    "abcabcabcabc",
+    std::string(100000, 'x'),
+    json_string(1),
+    json_string(2000),
+    random_string(4096, 1),
+    // matches more than the maximum offset apart
+    random_string(70000, 2) + random_string(70000, 2),
+  };
+
+  for (const auto& input : inputs) {
+    ASSERT_EQ(roundtrip(codec, input), input);
+  }
+
+  // entries from several buffers are encoded as one
+  const std::string a = json_string(10), b = json_string(20);
+  const zlog::Slice slices[] = {a, b};
+  std::string entry;
+  codec.Encode(slices, 2, &entry);
+  ASSERT_LT(entry.size(), a.size() + b.size());
+  ASSERT_EQ(codec.Decode(&entry), 0);
+  ASSERT_EQ(entry, a + b);
+}
+
+TEST(EntryCodecTest, Stats) {
+  auto statistics = zlog::CreateCacheStatistics();
+  statistics->stats_level_ = zlog::kAll;
+  zlog::EntryCodec codec(zlog::Codec::Builtin("lz"), statistics.get());
+
+  const auto json = json_string(100);
+  const zlog::Slice slice(json);
+  std::string entry;
+  codec.Encode(&slice, 1, &entry);
+  ASSERT_LT(entry.size(), json.size() / 2);
+
+  // incompressible entries are stored with a one byte header
+  const auto noise = random_string(1000, 3);
+  std::string entry2;
+  const zlog::Slice slice2(noise);
+  codec.Encode(&slice2, 1, &entry2);
+  ASSERT_EQ(entry2.size(), noise.size() + 1);
+  ASSERT_EQ(entry2[0], zlog::Codec::kNoOp);
+
+  ASSERT_EQ(codec.Decode(&entry), 0);
+  ASSERT_EQ(codec.Decode(&entry2), 0);
+
+  const auto stats = codec.stats();
+  ASSERT_EQ(stats.compress_bytes_in, json.size());
+  ASSERT_LT(stats.compress_bytes_out, json.size() / 2);
+  ASSERT_EQ(stats.compress_skipped, 1u);
+  ASSERT_EQ(stats.decompress_bytes_out, json.size());
+  ASSERT_EQ(stats.decompress_bytes_in, stats.compress_bytes_out);
+
+  ASSERT_EQ(statistics->getTickerCount(zlog::COMPRESS_BYTES_IN),
+      stats.compress_bytes_in);
+  ASSERT_EQ(statistics->getTickerCount(zlog::COMPRESS_BYTES_OUT),
+      stats.compress_bytes_out);
+  ASSERT_EQ(statistics->getTickerCount(zlog::COMPRESS_SKIPPED), 1u);
+  ASSERT_EQ(statistics->getTickerCount(zlog::DECOMPRESS_BYTES_OUT),
+      json.size());
+
+  zlog::HistogramData data;
+  statistics->histogramData(zlog::COMPRESSION_TIMES_NANOS, &data);
+  ASSERT_GT(data.average, 0.0);
+}
+
+TEST(EntryCodecTest, NoOp) {
+  zlog::EntryCodec codec(zlog::Codec::Builtin("none"), nullptr);
+
+  const auto json = json_string(10);
+  const zlog::Slice slice(json);
+  std::string entry;
+  codec.Encode(&slice, 1, &entry);
+  ASSERT_EQ(entry.size(), json.size() + 1);
+  ASSERT_EQ(codec.Decode(&entry), 0);
+  ASSERT_EQ(entry, json);
+
+  // entries written with a built-in codec are readable with any codec
+  zlog::EntryCodec lz(zlog::Codec::Builtin("lz"), nullptr);
+  lz.Encode(&slice, 1, &entry);
+  ASSERT_EQ(entry[0], zlog::Codec::kLZ);
+  ASSERT_EQ(codec.Decode(&entry), 0);
+  ASSERT_EQ(entry, json);
+}
+
+TEST(EntryCodecTest, Corrupt) {
+  zlog::EntryCodec codec(zlog::Codec::Builtin("lz"), nullptr);
+
+  std::string entry;
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+
+  // unknown codec
+  entry = std::string(1, char(100)) + "abc";
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+
+  // truncated header
+  entry = std::string(1, char(zlog::Codec::kLZ));
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+
+  const auto json = json_string(100);
+  const zlog::Slice slice(json);
+  std::string good;
+  codec.Encode(&slice, 1, &good);
+
+  // truncated data
+  entry = good.substr(0, good.size() - 1);
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+
+  // trailing data
+  entry = good + "x";
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+
+  // sizes that the input can't decompress to are rejected before the output
+  // is allocated
+  entry = std::string(1, char(zlog::Codec::kLZ));
+  for (int i = 0; i < 8; i++) {
+    entry.push_back(char(0xff));
+  }
+  entry.push_back(char(0x7f));
+  entry += "abc";
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+
+  // a size that is larger than the input can expand to, but small enough to
+  // allocate
+  entry = good;
+  entry.resize(1);
+  entry.push_back(char(0x80));
+  entry.push_back(char(0x80));
+  entry.push_back(char(0x01));
+  entry += "abc";
+  ASSERT_EQ(codec.Decode(&entry), -EINVAL);
+}
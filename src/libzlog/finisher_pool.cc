@@ -0,0 +1,45 @@
+#include "finisher_pool.h"
+#include <algorithm>
+#include <cassert>
+
+namespace zlog {
+
+// queue wait below this is dominated by thread wakeup latency, which more
+// threads won't reduce.
+static const uint64_t min_grow_wait_us = 100;
+
+int adapt_finisher_threads(const FinisherSample& sample, const int threads,
+    const int min_threads, const int max_threads)
+{
+  assert(min_threads > 0);
+  assert(min_threads <= max_threads);
+
+  const auto grow = std::min(max_threads, threads + std::max(1, threads / 2));
+  const auto shrink = std::max(min_threads, threads - 1);
+  const auto capacity_us = sample.interval_us * std::max(threads, 1);
+
+  int target = threads;
+
+  if (sample.ops == 0) {
+    if (sample.depth > 0) {
+      target = grow;
+    } else {
+      target = shrink;
+    }
+  } else {
+    const auto avg_wait_us = sample.wait_us / sample.ops;
+    const auto avg_busy_us = sample.busy_us / sample.ops;
+
+    if (avg_wait_us > avg_busy_us &&
+        avg_wait_us >= min_grow_wait_us &&
+        sample.busy_us * 2 >= capacity_us) {
+      target = grow;
+    } else if (sample.busy_us * 4 < capacity_us && sample.depth == 0) {
+      target = shrink;
+    }
+  }
+
+  return std::min(max_threads, std::max(min_threads, target));
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace zlog {
+
+/**
+ * Activity of a log's finisher threads over one sampling interval. The
+ * adaptive finisher pool is resized from these samples.
+ *
+ * Busy time is the time that finisher threads are held while starting ops.
+ * With a synchronous backend this is the backend service time. Ops waiting on
+ * an asynchronous backend don't hold a thread and don't count as busy.
+ */
+struct FinisherSample {
+  // length of the interval
+  uint64_t interval_us;
+  // ops dequeued by finishers in the interval
+  uint64_t ops;
+  // total time those ops spent waiting in the queue
+  uint64_t wait_us;
+  // total time finishers were held by ops in the interval
+  uint64_t busy_us;
+  // ops waiting in the queue at the end of the interval
+  size_t depth;
+};
+
+/**
+ * Choose the number of finisher threads for the next interval.
+ *
+ * The pool grows when ops wait in the queue longer than it takes to service
+ * them while the threads are mostly busy, or when ops are waiting and none
+ * were started (e.g. every thread is held by a long trimTo). Growth is
+ * multiplicative so that a pool started small reaches its working size in a
+ * few intervals. The pool shrinks by one thread when the threads are mostly
+ * idle and the queue is empty. The result is within [min_threads,
+ * max_threads].
+ */
+int adapt_finisher_threads(const FinisherSample& sample, int threads,
+    int min_threads, int max_threads);
+
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "libzlog/finisher_pool.h"
+
+static zlog::FinisherSample sample(uint64_t ops, uint64_t wait_us,
+    uint64_t busy_us, size_t depth)
+{
+  zlog::FinisherSample s;
+  s.interval_us = 100000;
+  s.ops = ops;
+  s.wait_us = wait_us;
+  s.busy_us = busy_us;
+  s.depth = depth;
+  return s;
+}
+
+TEST(FinisherPoolTest, Idle) {
+  // an idle pool shrinks one thread at a time down to the minimum
+  ASSERT_EQ(zlog::adapt_finisher_threads(sample(0, 0, 0, 0), 4, 1, 8), 3);
+  ASSERT_EQ(zlog::adapt_finisher_threads(sample(0, 0, 0, 0), 2, 2, 8), 2);
+}
+
+TEST(FinisherPoolTest, Stalled) {
+  // ops are waiting but none were started: every thread is held
+  ASSERT_EQ(zlog::adapt_finisher_threads(sample(0, 0, 0, 10), 4, 1, 8), 6);
+  ASSERT_EQ(zlog::adapt_finisher_threads(sample(0, 0, 0, 10), 1, 1, 8), 2);
+  ASSERT_EQ(zlog::adapt_finisher_threads(sample(0, 0, 0, 10), 8, 1, 8), 8);
+}
+
+TEST(FinisherPoolTest, Saturated) {
+  // 2 threads fully busy servicing 1ms ops, and ops queue for 5ms
+  ASSERT_EQ(zlog::adapt_finisher_threads(
+        sample(200, 200 * 5000, 200000, 50), 2, 1, 16), 3);
+  ASSERT_EQ(zlog::adapt_finisher_threads(
+        sample(200, 200 * 5000, 200000, 50), 16, 1, 16), 16);
+}
+
+TEST(FinisherPoolTest, ShortWait) {
+  // busy threads, but ops are started about as fast as they're queued
+  ASSERT_EQ(zlog::adapt_finisher_threads(
+        sample(200, 200 * 50, 200000, 0), 2, 1, 16), 2);
+  // waits longer than service time, but short in absolute terms
+  ASSERT_EQ(zlog::adapt_finisher_threads(
+        sample(100000, 100000 * 20, 150000, 0), 2, 1, 16), 2);
+}
+
+TEST(FinisherPoolTest, Underutilized) {
+  // 8 threads are busy for less than a quarter of the interval
+  ASSERT_EQ(zlog::adapt_finisher_threads(
+        sample(1000, 1000 * 10, 100000, 0), 8, 1, 16), 7);
+  // unless ops are queued
+  ASSERT_EQ(zlog::adapt_finisher_threads(
+        sample(1000, 1000 * 10, 100000, 5), 8, 1, 16), 8);
+}
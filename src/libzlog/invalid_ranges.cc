@@ -0,0 +1,112 @@
+#include "invalid_ranges.h"
+#include <algorithm>
+#include <iterator>
+
+namespace zlog {
+
+void InvalidRanges::advance(uint64_t position)
+{
+  auto it = ranges_.begin();
+  while (it != ranges_.end() && it->first <= position) {
+    position = std::max(position, it->second);
+    it = ranges_.erase(it);
+  }
+  num_ranges_ = ranges_.size();
+  min_valid_.store(position, std::memory_order_release);
+}
+
+void InvalidRanges::add_below(const uint64_t position)
+{
+  if (position <= min_valid_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(lock_);
+  if (position > min_valid_) {
+    advance(position);
+  }
+}
+
+void InvalidRanges::add(const uint64_t position)
+{
+  if (position < min_valid_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(lock_);
+
+  if (position == min_valid_) {
+    advance(position + 1);
+    return;
+  }
+
+  if (position < min_valid_) {
+    return;
+  }
+
+  auto next = ranges_.upper_bound(position);
+  if (next != ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (position < prev->second) {
+      return;
+    }
+    if (position == prev->second) {
+      prev->second = position + 1;
+      if (next != ranges_.end() && next->first == prev->second) {
+        prev->second = next->second;
+        ranges_.erase(next);
+        num_ranges_ = ranges_.size();
+      }
+      return;
+    }
+  }
+
+  if (next != ranges_.end() && next->first == position + 1) {
+    const auto end = next->second;
+    ranges_.erase(next);
+    ranges_.emplace(position, end);
+    return;
+  }
+
+  if (ranges_.size() >= max_ranges_) {
+    return;
+  }
+
+  ranges_.emplace(position, position + 1);
+  num_ranges_ = ranges_.size();
+}
+
+bool InvalidRanges::find(const uint64_t position) const
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  auto it = ranges_.upper_bound(position);
+  if (it == ranges_.begin()) {
+    return false;
+  }
+  return position < std::prev(it)->second;
+}
+
+void InvalidRanges::ranges(const uint64_t start, const uint64_t end,
+    std::vector<std::pair<uint64_t, uint64_t>> *out) const
+{
+  std::lock_guard<std::mutex> lk(lock_);
+
+  const uint64_t min_valid = min_valid_;
+  if (start < min_valid && start < end) {
+    out->emplace_back(start, std::min(end, min_valid));
+  }
+
+  auto it = ranges_.upper_bound(start);
+  if (it != ranges_.begin()) {
+    it = std::prev(it);
+  }
+  for (; it != ranges_.end() && it->first < end; it++) {
+    const auto first = std::max(start, it->first);
+    const auto last = std::min(end, it->second);
+    if (first < last) {
+      out->emplace_back(first, last);
+    }
+  }
+}
+
+}
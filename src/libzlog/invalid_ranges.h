@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace zlog {
+
+// an index of log positions that are known to be invalid: positions below the
+// log's min_valid_position, and positions that have been filled or trimmed.
+//
+// a position never becomes valid again once it has been invalidated, so the
+// index can be incomplete but is never stale, even when other clients change
+// the log. reads of positions in the index are answered with -ENODATA
+// without a backend request.
+class InvalidRanges {
+ public:
+  // once the index holds max_ranges ranges, single positions that don't
+  // extend an existing range aren't added.
+  explicit InvalidRanges(size_t max_ranges = 1 << 16) :
+    min_valid_(0),
+    num_ranges_(0),
+    max_ranges_(max_ranges)
+  {}
+
+  InvalidRanges(const InvalidRanges&) = delete;
+  InvalidRanges& operator=(const InvalidRanges&) = delete;
+
+  // positions below position are invalid
+  void add_below(uint64_t position);
+
+  // the position is invalid
+  void add(uint64_t position);
+
+  bool contains(uint64_t position) const {
+    if (position < min_valid_.load(std::memory_order_acquire)) {
+      return true;
+    }
+    if (num_ranges_.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    return find(position);
+  }
+
+  // append the invalid ranges [first, last) within [start, end), in order
+  void ranges(uint64_t start, uint64_t end,
+      std::vector<std::pair<uint64_t, uint64_t>> *out) const;
+
+  // positions below min_valid are invalid, and size is the number of other
+  // ranges
+  uint64_t min_valid() const {
+    return min_valid_;
+  }
+
+  size_t size() const {
+    return num_ranges_;
+  }
+
+ private:
+  bool find(uint64_t position) const;
+
+  // raise min_valid_, absorbing ranges that it reaches. the lock is held.
+  void advance(uint64_t position);
+
+  std::atomic<uint64_t> min_valid_;
+
+  // disjoint ranges { first: end } above min_valid_. ranges are merged with
+  // neighbours they touch.
+  mutable std::mutex lock_;
+  std::map<uint64_t, uint64_t> ranges_;
+  std::atomic<size_t> num_ranges_;
+  const size_t max_ranges_;
+};
+
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "libzlog/invalid_ranges.h"
+
+typedef std::vector<std::pair<uint64_t, uint64_t>> Ranges;
+
+static Ranges ranges(const zlog::InvalidRanges& index, uint64_t start,
+    uint64_t end)
+{
+  Ranges out;
+  index.ranges(start, end, &out);
+  return out;
+}
+
+TEST(InvalidRangesTest, Empty) {
+  zlog::InvalidRanges index;
+  ASSERT_FALSE(index.contains(0));
+  ASSERT_FALSE(index.contains(100));
+  ASSERT_EQ(index.min_valid(), 0u);
+  ASSERT_EQ(index.size(), 0u);
+  ASSERT_TRUE(ranges(index, 0, 100).empty());
+}
+
+TEST(InvalidRangesTest, Merge) {
+  zlog::InvalidRanges index;
+
+  index.add(10);
+  index.add(12);
+  ASSERT_EQ(index.size(), 2u);
+  ASSERT_TRUE(index.contains(10));
+  ASSERT_FALSE(index.contains(11));
+  ASSERT_TRUE(index.contains(12));
+
+  // filling the gap merges the neighbours
+  index.add(11);
+  ASSERT_EQ(index.size(), 1u);
+  ASSERT_EQ(ranges(index, 0, 100), (Ranges{{10, 13}}));
+
+  // extended on either side, and adding a contained position is a no-op
+  index.add(9);
+  index.add(13);
+  index.add(11);
+  ASSERT_EQ(index.size(), 1u);
+  ASSERT_EQ(ranges(index, 0, 100), (Ranges{{9, 14}}));
+
+  index.add(20);
+  ASSERT_EQ(ranges(index, 0, 100), (Ranges{{9, 14}, {20, 21}}));
+  ASSERT_EQ(ranges(index, 10, 20), (Ranges{{10, 14}}));
+  ASSERT_EQ(ranges(index, 14, 20), Ranges());
+}
+
+TEST(InvalidRangesTest, Below) {
+  zlog::InvalidRanges index;
+
+  index.add(5);
+  index.add(7);
+  index.add(20);
+  index.add_below(6);
+  ASSERT_EQ(index.min_valid(), 6u);
+  ASSERT_EQ(index.size(), 2u);
+  for (uint64_t p = 0; p < 6; p++) {
+    ASSERT_TRUE(index.contains(p));
+  }
+  ASSERT_FALSE(index.contains(6));
+
+  // the range starting at min_valid is absorbed
+  index.add(6);
+  ASSERT_EQ(index.min_valid(), 8u);
+  ASSERT_EQ(index.size(), 1u);
+
+  // min_valid never moves back
+  index.add_below(3);
+  ASSERT_EQ(index.min_valid(), 8u);
+
+  index.add_below(30);
+  ASSERT_EQ(index.min_valid(), 30u);
+  ASSERT_EQ(index.size(), 0u);
+  ASSERT_EQ(ranges(index, 25, 35), (Ranges{{25, 30}}));
+  ASSERT_EQ(ranges(index, 30, 35), Ranges());
+}
+
+TEST(InvalidRangesTest, MaxRanges) {
+  zlog::InvalidRanges index(2);
+
+  index.add(10);
+  index.add(20);
+  index.add(30);
+  ASSERT_EQ(index.size(), 2u);
+  ASSERT_FALSE(index.contains(30));
+
+  // positions that extend a range are still added
+  index.add(11);
+  index.add(19);
+  ASSERT_EQ(ranges(index, 0, 100), (Ranges{{10, 12}, {19, 21}}));
+}
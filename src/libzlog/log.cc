@@ -90,8 +90,14 @@ int create_or_open(const Options& options, const std::string& name,
          << boost::asio::ip::host_name() << "."
          << unique_id;
 
+  std::unique_ptr<WriteCoalescer> coalescer;
+  if (options.coalesce_writes) {
+    coalescer.reset(new WriteCoalescer(backend, options.coalesce_max_entries,
+          options.coalesce_max_bytes, options.coalesce_window_us));
+  }
+
   log_backend_out = std::make_shared<LogBackend>(backend, hoid, prefix,
-      token.str());
+      token.str(), std::move(coalescer));
 
   return 0;
 }
@@ -116,6 +122,12 @@ int Log::Open(const Options& options,
     return -EIO;
   }
 
+  // entries are stored in the format chosen when the log was created
+  ret = view_reader->view()->check_entry_format(options);
+  if (ret) {
+    return ret;
+  }
+
   auto striper = std::unique_ptr<Striper>(new Striper(log_backend,
         std::move(view_reader), options));
 
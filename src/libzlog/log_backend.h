@@ -2,6 +2,7 @@
 #include <iostream>
 #include <sstream>
 #include "include/zlog/backend.h"
+#include "write_coalescer.h"
 
 namespace zlog {
 
@@ -11,11 +12,13 @@ class LogBackend final {
   LogBackend(std::shared_ptr<Backend> backend,
       const std::string& hoid,
       const std::string& prefix,
-      const std::string& token) :
+      const std::string& token,
+      std::unique_ptr<WriteCoalescer> coalescer = nullptr) :
     backend_(backend),
     hoid_(hoid),
     prefix_(prefix),
-    token_(token)
+    token_(token),
+    coalescer_(std::move(coalescer))
   {
     assert(backend);
     assert(!hoid_.empty());
@@ -40,6 +43,12 @@ class LogBackend final {
     return token_;
   }
 
+  // combines concurrent asynchronous writes to the same object. null if
+  // write coalescing isn't enabled.
+  const WriteCoalescer *coalescer() const {
+    return coalescer_.get();
+  }
+
  public:
   int ReadViews(uint64_t epoch, uint32_t max_views,
       std::map<uint64_t, std::string> *views_out) const {
@@ -52,56 +61,110 @@ class LogBackend final {
 
   int Read(const std::string& oid, uint64_t epoch, uint64_t position,
       std::string *data_out) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Read(prefixed_oid.str(), epoch, position, data_out);
+    return backend_->Read(prefixed_oid(oid), epoch, position, data_out);
   }
 
   int Write(const std::string& oid, const std::string& data, uint64_t epoch,
       uint64_t position) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Write(prefixed_oid.str(), data, epoch, position);
+    return backend_->Write(prefixed_oid(oid), data, epoch, position);
+  }
+
+  int WriteV(const std::string& oid, const Slice *data, size_t count,
+      uint64_t epoch, uint64_t position) const {
+    return backend_->WriteV(prefixed_oid(oid), data, count, epoch, position);
   }
 
   int Fill(const std::string& oid, uint64_t epoch, uint64_t position) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Fill(prefixed_oid.str(), epoch, position);
+    return backend_->Fill(prefixed_oid(oid), epoch, position);
   }
 
   int Trim(const std::string& oid, uint64_t epoch, uint64_t position,
       bool trim_limit = false, bool trim_full = false) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Trim(prefixed_oid.str(), epoch, position, trim_limit,
+    return backend_->Trim(prefixed_oid(oid), epoch, position, trim_limit,
         trim_full);
   }
 
+  void ReadAsync(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::string *data_out, std::function<void(int)> cb) const {
+    backend_->ReadAsync(prefixed_oid(oid), epoch, position, data_out,
+        std::move(cb));
+  }
+
+  void ReadBatchAsync(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, size_t count, std::string *data_out,
+      int *results, std::function<void()> cb) const {
+    backend_->ReadBatchAsync(prefixed_oid(oid), epoch, positions, count,
+        data_out, results, std::move(cb));
+  }
+
+  void WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position, std::function<void(int)> cb) const {
+    if (coalescer_) {
+      coalescer_->Write(prefixed_oid(oid), data, epoch, position,
+          std::move(cb));
+      return;
+    }
+    backend_->WriteAsync(prefixed_oid(oid), data, epoch, position,
+        std::move(cb));
+  }
+
+  void WriteVAsync(const std::string& oid, const Slice *data, size_t count,
+      uint64_t epoch, uint64_t position, std::function<void(int)> cb) const {
+    backend_->WriteVAsync(prefixed_oid(oid), data, count, epoch, position,
+        std::move(cb));
+  }
+
+  void FillAsync(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) const {
+    backend_->FillAsync(prefixed_oid(oid), epoch, position, std::move(cb));
+  }
+
+  void TrimAsync(const std::string& oid, uint64_t epoch, uint64_t position,
+      bool trim_limit, bool trim_full, std::function<void(int)> cb) const {
+    backend_->TrimAsync(prefixed_oid(oid), epoch, position, trim_limit,
+        trim_full, std::move(cb));
+  }
+
   int Seal(const std::string& oid, uint64_t epoch) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Seal(prefixed_oid.str(), epoch);
+    return backend_->Seal(prefixed_oid(oid), epoch);
   }
 
   int MaxPos(const std::string& oid, uint64_t epoch, uint64_t *pos_out,
       bool *empty_out) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->MaxPos(prefixed_oid.str(), epoch, pos_out, empty_out);
+    return backend_->MaxPos(prefixed_oid(oid), epoch, pos_out, empty_out);
   }
 
   int Stat(const std::string& oid, size_t *size) const {
-    std::stringstream prefixed_oid;
-    prefixed_oid << prefix_ << "." << oid;
-    return backend_->Stat(prefixed_oid.str(), size);
+    return backend_->Stat(prefixed_oid(oid), size);
+  }
+
+  // watch for changes to the entries of this log
+  int Watch(std::function<void(uint64_t, uint64_t)> cb,
+      uint64_t *cookie) const {
+    return backend_->Watch(prefix_ + ".", std::move(cb), cookie);
+  }
+
+  int Unwatch(uint64_t cookie) const {
+    return backend_->Unwatch(cookie);
   }
 
  private:
+  // built with a single allocation, rather than through a stringstream, since
+  // this runs for every i/o operation.
+  std::string prefixed_oid(const std::string& oid) const {
+    std::string prefixed;
+    prefixed.reserve(prefix_.size() + 1 + oid.size());
+    prefixed.append(prefix_);
+    prefixed.push_back('.');
+    prefixed.append(oid);
+    return prefixed;
+  }
+
   const std::shared_ptr<Backend> backend_;
   const std::string hoid_;
   const std::string prefix_;
   const std::string token_;
+  std::unique_ptr<WriteCoalescer> coalescer_;
 };
 
 }
@@ -0,0 +1,203 @@
+#include "log_cursor.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+namespace zlog {
+
+LogCursor::~LogCursor() {}
+
+int LogCursor::Create(Log *log, const uint64_t start, const uint64_t end,
+    const LogCursorOptions& options, LogCursor **cursor)
+{
+  if (!log || end < start || options.min_readahead == 0 ||
+      options.max_readahead < options.min_readahead) {
+    return -EINVAL;
+  }
+
+  *cursor = new LogCursorImpl(log, start, end, options);
+
+  return 0;
+}
+
+LogCursorImpl::LogCursorImpl(Log *log, const uint64_t start,
+    const uint64_t end, const LogCursorOptions& options) :
+  log_(log),
+  start_(start),
+  end_(end),
+  options_(options),
+  inflight_(0),
+  next_(options.reverse ? end : start),
+  issued_(next_),
+  readahead_(options.min_readahead),
+  stalls_(0),
+  reads_(0),
+  hole_waits_(0)
+{}
+
+LogCursorImpl::~LogCursorImpl()
+{
+  // the read callbacks reference the chunks
+  std::unique_lock<std::mutex> lk(lock_);
+  cond_.wait(lk, [&] { return inflight_ == 0; });
+}
+
+int LogCursorImpl::Next(LogEntry *entry)
+{
+  std::vector<Chunk*> reads;
+  std::unique_lock<std::mutex> lk(lock_);
+
+  if (next_ == (options_.reverse ? start_ : end_)) {
+    return -ERANGE;
+  }
+
+  fill(&reads);
+  assert(!chunks_.empty());
+  auto chunk = chunks_.front().get();
+
+  // the consumer has caught up with the reads, so more of them are needed
+  // to keep it busy.
+  if (!chunk->done) {
+    stalls_++;
+    readahead_ = std::min<uint64_t>(readahead_ * 2, options_.max_readahead);
+    fill(&reads);
+    lk.unlock();
+    read(reads);
+    reads.clear();
+    lk.lock();
+    cond_.wait(lk, [&] { return chunk->done; });
+  }
+
+  // the chunk stays at the front of the cursor and is read again
+  if (chunk->ret) {
+    const int ret = chunk->ret;
+    chunk->done = false;
+    chunk->ret = 0;
+    inflight_++;
+    reads.push_back(chunk);
+    lk.unlock();
+    read(reads);
+    return ret;
+  }
+
+  assert(chunk->entries.size() == chunk->end - chunk->start);
+  const auto index = options_.reverse ?
+    chunk->entries.size() - 1 - chunk->consumed : chunk->consumed;
+  *entry = std::move(chunk->entries[index]);
+  chunk->consumed++;
+  if (options_.reverse) {
+    next_--;
+  } else {
+    next_++;
+  }
+  if (chunk->consumed == chunk->entries.size()) {
+    chunks_.pop_front();
+  }
+
+  fill(&reads);
+  lk.unlock();
+  read(reads);
+
+  if (entry->ret == -ENOENT && options_.wait_for_holes) {
+    wait_for_hole(entry);
+  }
+
+  return 0;
+}
+
+void LogCursorImpl::fill(std::vector<Chunk*> *reads)
+{
+  // two chunks fill the window, so one can be read while the consumer works
+  // through the other.
+  const uint64_t chunk_size = std::max<uint64_t>(1, readahead_ / 2);
+
+  while (true) {
+    const uint64_t buffered = options_.reverse ?
+      next_ - issued_ : issued_ - next_;
+    const uint64_t available = options_.reverse ?
+      issued_ - start_ : end_ - issued_;
+    const uint64_t count = std::min(chunk_size, available);
+
+    // wait for room for a whole chunk, rather than reading small ones
+    if (count == 0 || (buffered > 0 && buffered + count > readahead_)) {
+      break;
+    }
+
+    std::unique_ptr<Chunk> chunk(new Chunk);
+    if (options_.reverse) {
+      chunk->start = issued_ - count;
+      chunk->end = issued_;
+      issued_ -= count;
+    } else {
+      chunk->start = issued_;
+      chunk->end = issued_ + count;
+      issued_ += count;
+    }
+
+    inflight_++;
+    reads_++;
+    reads->push_back(chunk.get());
+    chunks_.push_back(std::move(chunk));
+  }
+}
+
+void LogCursorImpl::read(const std::vector<Chunk*>& reads)
+{
+  // reads are issued without holding the lock. starting a read may wait for
+  // outstanding log operations to complete, including earlier reads whose
+  // callbacks need the lock.
+  for (auto chunk : reads) {
+    auto complete = [this, chunk](int ret, std::vector<LogEntry>& entries) {
+      std::lock_guard<std::mutex> lk(lock_);
+      chunk->ret = ret;
+      if (!ret) {
+        chunk->entries.swap(entries);
+      }
+      chunk->done = true;
+      inflight_--;
+      cond_.notify_all();
+    };
+
+    int ret = log_->readRangeAsync(chunk->start, chunk->end, complete);
+    if (ret) {
+      std::vector<LogEntry> entries;
+      complete(ret, entries);
+    }
+  }
+}
+
+void LogCursorImpl::wait_for_hole(LogEntry *entry)
+{
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    hole_waits_++;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::milliseconds(options_.hole_timeout_ms);
+  auto delay = std::chrono::microseconds(100);
+
+  while (options_.hole_timeout_ms == 0 ||
+      std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(delay);
+    entry->ret = log_->Read(entry->position, &entry->data);
+    if (entry->ret != -ENOENT) {
+      return;
+    }
+    delay = std::min(delay * 2, decltype(delay)(10000));
+  }
+}
+
+LogCursorImpl::Stats LogCursorImpl::stats() const
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  Stats stats;
+  stats.readahead = readahead_;
+  stats.stalls = stalls_;
+  stats.reads = reads_;
+  stats.hole_waits = hole_waits_;
+  return stats;
+}
+
+}
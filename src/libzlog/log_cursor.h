@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "include/zlog/cursor.h"
+
+namespace zlog {
+
+class LogCursorImpl : public LogCursor {
+ public:
+  LogCursorImpl(Log *log, uint64_t start, uint64_t end,
+      const LogCursorOptions& options);
+
+  ~LogCursorImpl();
+
+  int Next(LogEntry *entry) override;
+
+  struct Stats {
+    // the readahead window now, and the number of times the consumer had to
+    // wait for a read
+    uint64_t readahead;
+    uint64_t stalls;
+    // range reads issued, and holes that were waited on
+    uint64_t reads;
+    uint64_t hole_waits;
+  };
+
+  Stats stats() const;
+
+ private:
+  // a range of positions read with one range read. entries are consumed from
+  // the front, or from the back when the cursor is reversed.
+  struct Chunk {
+    uint64_t start;
+    uint64_t end;
+    bool done = false;
+    int ret = 0;
+    std::vector<LogEntry> entries;
+    size_t consumed = 0;
+  };
+
+  // add chunks until the readahead window is full. the chunks are returned
+  // to be read once the lock has been released.
+  void fill(std::vector<Chunk*> *reads);
+  void read(const std::vector<Chunk*>& reads);
+
+  void wait_for_hole(LogEntry *entry);
+
+  Log * const log_;
+  const uint64_t start_;
+  const uint64_t end_;
+  const LogCursorOptions options_;
+
+  mutable std::mutex lock_;
+  std::condition_variable cond_;
+  std::deque<std::unique_ptr<Chunk>> chunks_;
+  size_t inflight_;
+
+  // next_ is the next position to return, and issued_ is the end of the
+  // positions that have been requested. reversed, both are exclusive upper
+  // bounds that move towards start_.
+  uint64_t next_;
+  uint64_t issued_;
+
+  uint64_t readahead_;
+  uint64_t stalls_;
+  uint64_t reads_;
+  uint64_t hole_waits_;
+};
+
+}
@@ -1,11 +1,14 @@
 #include "log_impl.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <boost/asio/ip/host_name.hpp>
 #include <dlfcn.h>
@@ -13,59 +16,260 @@
 
 #include "include/zlog/log.h"
 #include "include/zlog/backend.h"
-#include "include/zlog/cache.h"
 
+#include "finisher_pool.h"
+#include "monitoring/statistics.h"
 #include "striper.h"
+#include "util/cast_util.h"
+#include "util/crc32c.h"
 
 namespace zlog {
 
+static inline uint64_t now_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// size of the largest op type allocated from the op pool
+static size_t max_op_size()
+{
+  return std::max({
+      sizeof(TailOp),
+      sizeof(ReadOp),
+      sizeof(AppendOp),
+      sizeof(GatherAppendOp),
+      sizeof(FillOp),
+      sizeof(TrimOp),
+      sizeof(TrimToOp),
+      sizeof(AppendBatchOp),
+      sizeof(BatchGroupOp),
+      sizeof(ReadRangeOp),
+      sizeof(ReadGroupOp),
+      sizeof(CQAppendOp),
+      sizeof(CQReadOp),
+      sizeof(CQFillOp),
+      sizeof(CQTrimOp),
+  });
+}
+
 LogImpl::LogImpl(std::shared_ptr<LogBackend> backend,
     const std::string& name,
     std::unique_ptr<Striper> striper,
     const Options& opts) :
-  shutdown(false),
+  num_finishers_(0),
+  adaptive_finishers_(opts.max_finisher_threads > 0),
+  min_finishers_(0),
+  max_finishers_(0),
+  finisher_adapt_stop_(false),
+  finisher_busy_us_(0),
+  finisher_grows_(0),
+  finisher_shrinks_(0),
+  last_queue_ops_(0),
+  last_queue_wait_us_(0),
+  last_busy_us_(0),
+  op_pool_(max_op_size(), opts.max_inflight_ops),
+  op_queue_(std::max(opts.finisher_threads, 1), opts.foreground_weight,
+      opts.background_weight, opts.statistics),
   backend(backend),
   name(name),
   striper(std::move(striper)),
   num_inflight_ops_(0),
-  options(opts)
+  num_queue_op_waiters_(0),
+  drained_(false),
+  options(opts),
+  entry_codec(opts.codec ?
+      new EntryCodec(opts.codec, opts.statistics) : nullptr),
+  append_window(opts.ordered_append_callbacks ?
+      new ReorderWindow(opts.statistics, [this] { finish_op(); }) : nullptr),
+  cache(opts.cache_size > 0 ? new Cache(options) : nullptr),
+  lease_fill_stop_(false),
+  watch_started_(false),
+  backend_watch_(false),
+  watch_cookie_(0),
+  next_subscription_(0),
+  subscriptions_stop_(false),
+  running_subscription_(nullptr),
+  subscription_wake_(false)
 {
   assert(!this->name.empty());
   assert(this->striper);
 
-  for (int i = 0; i < options.finisher_threads; i++) {
-    finishers_.push_back(std::thread(&LogImpl::finisher_entry_, this));
-  }
-
   append_propose_sequencer = 0;
   append_expand_view = 0;
   append_seal = 0;
   append_stale_view = 0;
   append_read_only = 0;
+  read_checksum_failures = 0;
+  read_checksum_refetches = 0;
+  invalid_range_hits = 0;
+  lease_fills = 0;
+
+  int num_threads = options.finisher_threads;
+  if (adaptive_finishers_) {
+    max_finishers_ = options.max_finisher_threads;
+    min_finishers_ = std::min(std::max(options.min_finisher_threads, 1),
+        max_finishers_);
+    num_threads = std::min(std::max(num_threads, min_finishers_),
+        max_finishers_);
+  }
+
+  const int num_slots = adaptive_finishers_ ? max_finishers_ : num_threads;
+  for (int i = 0; i < num_slots; i++) {
+    finishers_.emplace_back(new Finisher());
+  }
+  set_background_limit(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    start_finisher(i);
+  }
+  num_finishers_ = num_threads;
+
+  if (adaptive_finishers_) {
+    SetTickerCount(options.statistics, FINISHER_THREADS, num_threads);
+    finisher_adapt_thread_ = std::thread(&LogImpl::finisher_adapt_entry_, this);
+  }
+
+  if (options.sequencer_lease_size > 0) {
+    lease_fill_thread_ = std::thread(&LogImpl::lease_fill_entry_, this);
+    this->striper->set_retired_leases_handler(
+        [this](std::vector<std::pair<uint64_t, uint64_t>>& ranges) {
+          fill_leases(ranges);
+        });
+  }
 }
 
 LogImpl::~LogImpl()
-{ 
+{
+  // subscriptions read through the log, so they are stopped first
   {
-    std::lock_guard<std::mutex> l(lock);
-    shutdown = true;
+    std::lock_guard<std::mutex> lk(subscriptions_lock_);
+    subscriptions_stop_ = true;
+  }
+  if (subscription_thread_.joinable()) {
+    wake_subscriptions_();
+    subscription_thread_.join();
+  }
+  subscriptions_.clear();
+
+  // positions still held by the sequencer's leases are filled while the
+  // finishers are running
+  if (lease_fill_thread_.joinable()) {
+    std::vector<std::pair<uint64_t, uint64_t>> unused;
+    const auto view = striper->view();
+    if (view && view->seq) {
+      view->seq->drain_leases(&unused);
+    }
+    fill_leases(unused);
+    {
+      std::lock_guard<std::mutex> lk(lease_fill_lock_);
+      lease_fill_stop_ = true;
+      lease_fill_cond_.notify_one();
+    }
+    lease_fill_thread_.join();
+  }
+
+  if (finisher_adapt_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(finisher_adapt_lock_);
+      finisher_adapt_stop_ = true;
+      finisher_adapt_cond_.notify_one();
+    }
+    finisher_adapt_thread_.join();
   }
-  
-  finishers_cond_.notify_all();
+
+  // retired finishers may still be finishing their last op
+  op_queue_.shutdown();
   for (auto& finisher : finishers_) {
-    finisher.join();
+    if (finisher->thread.joinable()) {
+      finisher->thread.join();
+    }
+  }
+
+  // ops started by the finishers may still be waiting on asynchronous backend
+  // requests. there is nothing to do but wait for them to complete. the op
+  // that brings the count to zero after the draining bit is set signals us.
+  {
+    std::unique_lock<std::mutex> lk(drain_lock_);
+    if (num_inflight_ops_.fetch_or(kDrainingOps) != 0) {
+      drain_cond_.wait(lk, [this] { return drained_; });
+    }
+  }
+
+  if (backend_watch_) {
+    backend->Unwatch(watch_cookie_);
   }
 
   striper->shutdown();
 }
 
+void LogImpl::fill_leases(
+    std::vector<std::pair<uint64_t, uint64_t>>& ranges)
+{
+  std::lock_guard<std::mutex> lk(lease_fill_lock_);
+  if (lease_fill_stop_) {
+    return;
+  }
+  lease_fill_queue_.insert(lease_fill_queue_.end(),
+      ranges.begin(), ranges.end());
+  lease_fill_cond_.notify_one();
+}
+
+void LogImpl::lease_fill_entry_()
+{
+  const auto idle = std::chrono::milliseconds(options.sequencer_lease_idle_ms);
+  const auto wake = [this] {
+    return lease_fill_stop_ || !lease_fill_queue_.empty();
+  };
+
+  std::unique_lock<std::mutex> lk(lease_fill_lock_);
+  while (true) {
+    // while there is nothing to fill, the leases of this instance's sequencer
+    // are checked once per idle period, and those unused since the previous
+    // check are filled.
+    if (idle.count() <= 0) {
+      lease_fill_cond_.wait(lk, wake);
+    } else if (!lease_fill_cond_.wait_for(lk, idle, wake)) {
+      lk.unlock();
+      std::vector<std::pair<uint64_t, uint64_t>> unused;
+      const auto view = striper->view();
+      if (view && view->seq) {
+        view->seq->expire_leases(&unused);
+      }
+      lk.lock();
+      lease_fill_queue_.insert(lease_fill_queue_.end(),
+          unused.begin(), unused.end());
+      continue;
+    }
+
+    // the queue is emptied before the thread exits
+    if (lease_fill_queue_.empty()) {
+      return;
+    }
+
+    const auto range = lease_fill_queue_.front();
+    lease_fill_queue_.pop_front();
+    lk.unlock();
+
+    for (auto position = range.first; position < range.second; position++) {
+      // -EROFS means the position was written, which is fine
+      Fill(position);
+      lease_fills++;
+    }
+
+    lk.lock();
+  }
+}
+
 int TailOp::run()
 {
   while (true) {
     const auto view = log_->striper->view();
     if (view->seq) {
-      position_ = view->seq->check_tail(increment_);
-      return 0;
+      int ret = view->seq->check_tail(increment_, &position_);
+      if (ret && log_->retry_sequencer(*view, ret)) {
+        continue;
+      }
+      return ret;
     } else {
       int ret = log_->striper->propose_sequencer();
       if (ret) {
@@ -78,13 +282,28 @@ int TailOp::run()
 
 int LogImpl::tailAsync(bool increment, std::function<void(int, uint64_t)> cb)
 {
-  auto op = std::unique_ptr<LogOp>(new TailOp(this, increment, cb));
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) TailOp(this, increment, std::move(cb)));
   queue_op(std::move(op));
   return 0;
 }
 
 int LogImpl::CheckTail(uint64_t *position_out)
 {
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    uint64_t position;
+    TailOp op(this, false, [&](int r, uint64_t p) {
+      ret = r;
+      position = p;
+    });
+    run_inline(op);
+    if (!ret) {
+      *position_out = position;
+    }
+    return ret;
+  }
+
   struct {
     int ret;
     bool done = false;
@@ -120,179 +339,443 @@ int LogImpl::CheckTail(uint64_t *position_out)
   return ctx.ret;
 }
 
-int ReadOp::run()
+void PositionOp::execute()
 {
   while (true) {
-    const auto view = log_->striper->view();
-    const auto oid = log_->striper->map(view, position_);
-    if (!oid) {
-      int ret = log_->striper->try_expand_view(position_);
-      if (ret) {
-        return ret;
+    if (!view_) {
+      auto view = log_->striper->view();
+      const auto oid = log_->striper->map(view, position_);
+      if (!oid) {
+        int ret = log_->striper->try_expand_view(position_);
+        if (ret) {
+          complete(ret);
+          return;
+        }
+        continue;
       }
-      continue;
+      log_->invalid_ranges.add_below(
+          view->object_map().min_valid_position());
+      view_ = std::move(view);
+      oid_ = *oid;
     }
 
-    int ret = log_->backend->Read(*oid, view->epoch(), position_, &data_);
+    int ret;
+    io_begin();
+    issue(oid_, view_->epoch(), [this](int ret) { io_complete(ret); });
+    if (!io_end(&ret)) {
+      return;
+    }
 
-    if (ret == -ESPIPE) {
-      log_->striper->update_current_view(view->epoch());
-      continue;
+    if (handle(ret)) {
+      return;
     }
+  }
+}
 
-    if (ret == -ERANGE) {
-      return -ENOENT;
-    }
-
-    // the position is mapped, but the target object doesn't exist / hasn't been
-    // initialized. in this case we _could_ choose to not initialize it and
-    // report that the position hasn't been written. initializing here means we
-    // can avoid explaining how the behavior is correct, and unifies handling
-    // with the other operations which will make future restructing of the async
-    // handling easier. in the end, this is unlikely to be an optimization that
-    // matters at all since newly created stripes are initialized in the
-    // background (future work).
-    if (ret == -ENOENT) {
-      int ret = log_->backend->Seal(*oid, view->epoch());
-      if (ret && ret != -ESPIPE) {
-        return ret;
-      }
-      continue;
+void PositionOp::io_resume(int ret)
+{
+  if (!handle(ret)) {
+    execute();
+  }
+}
+
+bool PositionOp::handle(int ret)
+{
+  if (ret == -ESPIPE) {
+    log_->striper->update_current_view(view_->epoch());
+    view_.reset();
+    return false;
+  }
+
+  // the position is mapped, but the target object doesn't exist / hasn't been
+  // initialized. in this case we _could_ choose to not initialize it and
+  // report that the position hasn't been written. initializing here means we
+  // can avoid explaining how the behavior is correct, and unifies handling
+  // with the other operations which will make future restructing of the async
+  // handling easier. in the end, this is unlikely to be an optimization that
+  // matters at all since newly created stripes are initialized in the
+  // background (future work).
+  if (ret == -ENOENT) {
+    int ret = log_->backend->Seal(oid_, view_->epoch());
+    if (ret && ret != -ESPIPE) {
+      complete(ret);
+      return true;
     }
+    view_.reset();
+    return false;
+  }
 
-    return ret;
+  if (retry(ret)) {
+    return false;
+  }
+
+  complete(result(ret));
+  return true;
+}
+
+void ReadOp::issue(const std::string& oid, const uint64_t epoch,
+    std::function<void(int)> cb)
+{
+  log_->backend->ReadAsync(oid, epoch, position_, &data_, std::move(cb));
+}
+
+int ReadOp::result(int ret)
+{
+  if (ret == -ERANGE) {
+    return -ENOENT;
+  }
+  if (ret == -ENODATA) {
+    log_->invalid_ranges.add(position_);
   }
+  if (!ret && log_->encode_entries()) {
+    ret = log_->decode_entry(&data_, verified_);
+  }
+  if (!ret && log_->cache) {
+    log_->cache->put(position_, data_);
+  }
+  return ret;
+}
+
+bool ReadOp::retry(const int ret)
+{
+  if (ret || !log_->options.entry_checksums ||
+      log_->options.checksum_policy != Options::CHECKSUM_REFETCH) {
+    return false;
+  }
+
+  if (log_->verify_entry(data_)) {
+    verified_ = true;
+    return false;
+  }
+
+  // decode_entry handles the mismatch once the attempts are exhausted
+  if (refetches_ >= log_->options.checksum_refetch_attempts) {
+    return false;
+  }
+
+  refetches_++;
+  log_->read_checksum_refetches++;
+  RecordTick(log_->options.statistics, CHECKSUM_REFETCHES);
+  data_.clear();
+
+  return true;
+}
+
+bool LogImpl::local_read(uint64_t position, std::string *data, int *ret)
+{
+  if (invalid_ranges.contains(position)) {
+    invalid_range_hits++;
+    RecordTick(options.statistics, INVALID_RANGE_HITS);
+    *ret = -ENODATA;
+    return true;
+  }
+
+  if (cache && cache->get(&position, data) == 0) {
+    *ret = 0;
+    return true;
+  }
+
+  return false;
 }
 
 int LogImpl::Read(const uint64_t position, std::string *data_out)
 {
+  int ret;
+  if (local_read(position, data_out, &ret)) {
+    return ret;
+  }
+
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    ReadOp op(this, position, [&](int r, std::string& data) {
+      ret = r;
+      if (!ret) {
+        data_out->swap(data);
+      }
+    });
+    run_inline(op);
+    return ret;
+  }
+
   struct {
     int ret;
     bool done = false;
-    std::string data;
+    std::string *data_out;
     std::mutex lock;
     std::condition_variable cond;
   } ctx;
 
-  int ret = readAsync(position, [&](int ret, std::string& data) {
+  ctx.data_out = data_out;
+
+  // the caller is blocked until the op completes, so the buffer filled in by
+  // the backend is swapped directly into the caller's string. the op is
+  // queued directly since the cache has already been checked.
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) ReadOp(this, position, [&ctx](int ret, std::string& data) {
     {
       std::lock_guard<std::mutex> lk(ctx.lock);
       ctx.ret = ret;
       ctx.done = true;
       if (!ctx.ret) {
-        ctx.data.assign(std::move(data));
+        ctx.data_out->swap(data);
       }
       ctx.cond.notify_one();
     }
-  });
-
-  if (ret) {
-    return ret;
-  }
+  }));
+  queue_op(std::move(op));
 
   std::unique_lock<std::mutex> lk(ctx.lock);
   ctx.cond.wait(lk, [&] { return ctx.done; });
 
-  if (!ctx.ret) {
-    data_out->assign(std::move(ctx.data));
-  }
-
   return ctx.ret;
 }
 
 int LogImpl::readAsync(uint64_t position,
     std::function<void(int, std::string&)> cb)
 {
-  auto op = std::unique_ptr<LogOp>(new ReadOp(this, position, cb));
+  // a read answered without the backend is delivered on the calling thread
+  std::string data;
+  int ret;
+  if (local_read(position, &data, &ret)) {
+    if (cb) {
+      cb(ret, data);
+    }
+    return 0;
+  }
+
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) ReadOp(this, position, std::move(cb)));
   queue_op(std::move(op));
   return 0;
 }
 
-int AppendOp::run()
+void AppendOp::execute()
 {
+  if (log_->encode_entries() && !encoded_) {
+    encode();
+    encoded_ = true;
+  }
+
   while (true) {
-    const auto view = log_->striper->view();
+    if (!view_) {
+      auto view = log_->striper->view();
+
+      if (view->seq) {
+        // avoid obtaining a new append position when the view has been
+        // updated (e.g. because the mapping was extended), but the sequencer
+        // did not change. this is generally a minor optimization. but for
+        // completeness, it also handles the edge case in which stripes are
+        // configured to hold exactly one log entry. in this case a loop will
+        // be created by which the new position doesn't map, the map is
+        // extended, and then a new unmapped position is obtained.
+        if (!position_epoch_ || (*position_epoch_ != view->seq->epoch())) {
+          int ret;
+          if (ordered_) {
+            const auto& seq = view->seq;
+            ret = log_->append_window->try_assign(&ticket_, windowed_,
+                [&seq](uint64_t *position) {
+                  return seq->check_tail(true, position);
+                }, &position_);
+            windowed_ = windowed_ || !ret;
+          } else {
+            ret = view->seq->next(&position_);
+          }
+          if (ret) {
+            if (log_->retry_sequencer(*view, ret)) {
+              continue;
+            }
+            complete(ret);
+            return;
+          }
+          position_epoch_ = view->seq->epoch();
+        }
+        assert(position_epoch_);
+        assert(*position_epoch_ > 0);
+        assert(*position_epoch_ == view->seq->epoch());
+      } else {
+        log_->append_propose_sequencer++;
+        int ret = log_->striper->propose_sequencer();
+        if (ret) {
+          complete(ret);
+          return;
+        }
+        continue;
+      }
 
-    if (view->seq) {
-      // avoid obtaining a new append position when the view has been updated
-      // (e.g. because the mapping was extended), but the sequencer did not
-      // change. this is generally a minor optimization. but for completeness,
-      // it also handles the edge case in which stripes are configured to hold
-      // exactly one log entry. in this case a loop will be created by which the
-      // new position doesn't map, the map is extended, and then a new unmapped
-      // position is obtained.
-      if (!position_epoch_ || (*position_epoch_ != view->seq->epoch())) {
-        position_ = view->seq->check_tail(true);
-        position_epoch_ = view->seq->epoch();
-      }
-      assert(position_epoch_);
-      assert(*position_epoch_ > 0);
-      assert(*position_epoch_ == view->seq->epoch());
-    } else {
-      log_->append_propose_sequencer++;
-      int ret = log_->striper->propose_sequencer();
-      if (ret) {
-        return ret;
+      const auto oid = log_->striper->map(view, position_);
+      if (!oid) {
+        log_->append_expand_view++;
+        int ret = log_->striper->try_expand_view(position_);
+        if (ret) {
+          complete(ret);
+          return;
+        }
+        continue;
       }
-      continue;
+
+      view_ = std::move(view);
+      oid_ = *oid;
     }
 
-    const auto oid = log_->striper->map(view, position_);
-    if (!oid) {
-      log_->append_expand_view++;
-      int ret = log_->striper->try_expand_view(position_);
-      if (ret) {
-        return ret;
-      }
-      continue;
+    int ret;
+    io_begin();
+    write(oid_, view_->epoch(), [this](int ret) { io_complete(ret); });
+    if (!io_end(&ret)) {
+      return;
     }
 
-    while (true) {
-      int ret = log_->backend->Write(*oid, data_, view->epoch(), position_);
-      if (!ret) {
-        return ret;
-      } else if (ret == -ENOENT) {
-        log_->append_seal++;
-        // this can happen if a new stripe has been created but not initialized,
-        // either because we are racing with initialization, or due to a fault in
-        // the process performing the initialization.
-        int ret = log_->backend->Seal(*oid, view->epoch());
-        if (!ret) {
-          // try the append again. the view and the position are still
-          // consistent, and there is no reason to think they are out-of-date.
-          continue;
-        } else if (ret != -ESPIPE) {
-          return ret;
-        }
-        assert(ret == -ESPIPE);
-        // unlike other backend interfaces, seal will return -ESPIPE if the
-        // epoch is less than _or equal_ to the stored epoch. if the write
-        // returned -ENOENT at epoch 100 because it was racing with
-        // initialization (also at epoch 100), then seal at epoch 100 will
-        // return -ESPIPE. the point is that when -ESPIPE is returned from seal
-        // we shouldn't refresh the striper and wait on a newer epoch. if there
-        // actually is a newer view, then that will be caught by the write
-        // interface. XXX: this would be a fantastic scenario to test for in a
-        // model, by incorrectly refreshing here causing a deadlock, or perhaps
-        // changing the epoch <= test in the backend.
-        break;
-      } else if (ret == -ESPIPE) {
-        log_->append_stale_view++;
-        log_->striper->update_current_view(view->epoch());
-        break;
-      } else if (ret == -EROFS) {
-        log_->append_read_only++;
-        position_epoch_.reset(); // make sure to get a new position
-        break;
-      } else {
-        return ret;
-      }
+    if (handle(ret)) {
+      return;
+    }
+  }
+}
+
+void AppendOp::callback(const int ret)
+{
+  if (windowed_) {
+    log_->complete_ordered_append(ticket_, ret, std::move(cb_));
+    return;
+  }
+
+  if (cb_) {
+    cb_(ret, position_);
+  }
+}
+
+void AppendOp::io_resume(int ret)
+{
+  if (!handle(ret)) {
+    execute();
+  }
+}
+
+bool AppendOp::handle(int ret)
+{
+  if (!ret) {
+    if (log_->cache) {
+      cache_entry();
     }
+    log_->position_watcher.notify(position_);
+    complete(ret);
+    return true;
+  } else if (ret == -ENOENT) {
+    log_->append_seal++;
+    // this can happen if a new stripe has been created but not initialized,
+    // either because we are racing with initialization, or due to a fault in
+    // the process performing the initialization.
+    int ret = log_->backend->Seal(oid_, view_->epoch());
+    if (!ret) {
+      // try the append again. the view and the position are still
+      // consistent, and there is no reason to think they are out-of-date.
+      return false;
+    } else if (ret != -ESPIPE) {
+      complete(ret);
+      return true;
+    }
+    assert(ret == -ESPIPE);
+    // unlike other backend interfaces, seal will return -ESPIPE if the
+    // epoch is less than _or equal_ to the stored epoch. if the write
+    // returned -ENOENT at epoch 100 because it was racing with
+    // initialization (also at epoch 100), then seal at epoch 100 will
+    // return -ESPIPE. the point is that when -ESPIPE is returned from seal
+    // we shouldn't refresh the striper and wait on a newer epoch. if there
+    // actually is a newer view, then that will be caught by the write
+    // interface. XXX: this would be a fantastic scenario to test for in a
+    // model, by incorrectly refreshing here causing a deadlock, or perhaps
+    // changing the epoch <= test in the backend.
+    view_.reset();
+    return false;
+  } else if (ret == -ESPIPE) {
+    log_->append_stale_view++;
+    log_->striper->update_current_view(view_->epoch());
+    view_.reset();
+    return false;
+  } else if (ret == -EROFS) {
+    log_->append_read_only++;
+    position_epoch_.reset(); // make sure to get a new position
+    view_.reset();
+    return false;
+  } else {
+    complete(ret);
+    return true;
+  }
+}
+
+void AppendOp::write(const std::string& oid, const uint64_t epoch,
+    std::function<void(int)> cb)
+{
+  log_->backend->WriteAsync(oid, data_, epoch, position_, std::move(cb));
+}
+
+void AppendOp::encode()
+{
+  if (log_->cache) {
+    raw_ = data_;
+  }
+  log_->encode_entry(&data_);
+}
+
+void AppendOp::cache_entry()
+{
+  // an entry that was encoded before the op was created isn't cached
+  if (!log_->encode_entries()) {
+    log_->cache->put(position_, data_);
+  } else if (raw_) {
+    log_->cache->put(position_, *raw_);
+  }
+}
+
+void GatherAppendOp::write(const std::string& oid, const uint64_t epoch,
+    std::function<void(int)> cb)
+{
+  if (log_->encode_entries()) {
+    AppendOp::write(oid, epoch, std::move(cb));
+    return;
   }
+  log_->backend->WriteVAsync(oid, slices_.data(), slices_.size(), epoch,
+      position_, std::move(cb));
+}
+
+void GatherAppendOp::encode()
+{
+  log_->encode_entry(slices_.data(), slices_.size(), &data_);
+}
+
+void GatherAppendOp::cache_entry()
+{
+  std::string entry;
+  for (const auto& slice : slices_) {
+    entry.append(slice.data, slice.size);
+  }
+  log_->cache->put(position_, entry);
 }
 
 int LogImpl::Append(const std::string& data, uint64_t *pposition)
 {
+  return Append(std::string(data), pposition);
+}
+
+int LogImpl::Append(const char *data, size_t size, uint64_t *pposition)
+{
+  return Append(std::string(data, size), pposition);
+}
+
+int LogImpl::Append(std::string&& data, uint64_t *pposition)
+{
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    uint64_t position;
+    AppendOp op(this, std::move(data), [&](int r, uint64_t p) {
+      ret = r;
+      position = p;
+    });
+    run_inline(op);
+    if (!ret && pposition) {
+      *pposition = position;
+    }
+    return ret;
+  }
+
   struct {
     int ret;
     bool done = false;
@@ -301,7 +784,12 @@ int LogImpl::Append(const std::string& data, uint64_t *pposition)
     std::condition_variable cond;
   } ctx;
 
-  int ret = appendAsync(data, [&](int ret, uint64_t position) {
+  // a single captured pointer keeps the callback within std::function's
+  // inline storage, so no allocation is needed to construct it. synchronous
+  // appends don't go through the append window, so that an ordered callback
+  // can make one without waiting on its own delivery.
+  auto op = new (op_pool_) AppendOp(this, std::move(data),
+      [&ctx](int ret, uint64_t position) {
     {
       std::lock_guard<std::mutex> lk(ctx.lock);
       ctx.ret = ret;
@@ -312,10 +800,7 @@ int LogImpl::Append(const std::string& data, uint64_t *pposition)
       ctx.cond.notify_one();
     }
   });
-
-  if (ret) {
-    return ret;
-  }
+  queue_op(std::unique_ptr<LogOp>(op));
 
   std::unique_lock<std::mutex> lk(ctx.lock);
   ctx.cond.wait(lk, [&] { return ctx.done; });
@@ -327,253 +812,517 @@ int LogImpl::Append(const std::string& data, uint64_t *pposition)
   return ctx.ret;
 }
 
-int LogImpl::appendAsync(const std::string& data,
-    std::function<void(int, uint64_t)> cb)
-{
-  auto op = std::unique_ptr<LogOp>(new AppendOp(this, data, cb));
-  queue_op(std::move(op));
-  return 0;
-}
-
-int FillOp::run()
+int LogImpl::Append(const std::vector<Slice>& data, uint64_t *pposition)
 {
-  while (true) {
-    const auto view = log_->striper->view();
-    const auto oid = log_->striper->map(view, position_);
-    if (!oid) {
-      int ret = log_->striper->try_expand_view(position_);
-      if (ret) {
-        return ret;
-      }
-      continue;
-    }
-
-    int ret = log_->backend->Fill(*oid, view->epoch(), position_);
-
-    if (ret == -ESPIPE) {
-      log_->striper->update_current_view(view->epoch());
-      continue;
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    uint64_t position;
+    GatherAppendOp op(this, data, [&](int r, uint64_t p) {
+      ret = r;
+      position = p;
+    });
+    run_inline(op);
+    if (!ret && pposition) {
+      *pposition = position;
     }
+    return ret;
+  }
 
-    if (ret == -ENOENT) {
-      int ret = log_->backend->Seal(*oid, view->epoch());
-      if (ret && ret != -ESPIPE) {
-        return ret;
-      }
-      continue;
-    }
-
-    return ret;
-  }
-}
-
-int LogImpl::Fill(const uint64_t position)
-{
   struct {
     int ret;
     bool done = false;
+    uint64_t position;
     std::mutex lock;
     std::condition_variable cond;
   } ctx;
 
-  int ret = fillAsync(position, [&](int ret) {
+  // not ordered, as for Append above
+  auto op = new (op_pool_) GatherAppendOp(this, data,
+      [&ctx](int ret, uint64_t position) {
     {
       std::lock_guard<std::mutex> lk(ctx.lock);
       ctx.ret = ret;
       ctx.done = true;
+      if (!ctx.ret) {
+        ctx.position = position;
+      }
       ctx.cond.notify_one();
     }
   });
-
-  if (ret) {
-    return ret;
-  }
+  queue_op(std::unique_ptr<LogOp>(op));
 
   std::unique_lock<std::mutex> lk(ctx.lock);
   ctx.cond.wait(lk, [&] { return ctx.done; });
 
+  if (!ctx.ret && pposition) {
+    *pposition = ctx.position;
+  }
+
   return ctx.ret;
 }
 
-int LogImpl::fillAsync(uint64_t position, std::function<void(int)> cb)
+int LogImpl::appendAsync(const std::string& data,
+    std::function<void(int, uint64_t)> cb)
 {
-  auto op = std::unique_ptr<LogOp>(new FillOp(this, position, cb));
-  queue_op(std::move(op));
+  return appendAsync(std::string(data), std::move(cb));
+}
+
+int LogImpl::appendAsync(const char *data, size_t size,
+    std::function<void(int, uint64_t)> cb)
+{
+  return appendAsync(std::string(data, size), std::move(cb));
+}
+
+int LogImpl::appendAsync(std::string&& data,
+    std::function<void(int, uint64_t)> cb)
+{
+  auto op = new (op_pool_) AppendOp(this, std::move(data), std::move(cb));
+  if (append_window) {
+    op->set_ordered();
+  }
+  queue_op(std::unique_ptr<LogOp>(op));
+  return 0;
+}
+
+int LogImpl::appendAsync(const std::vector<Slice>& data,
+    std::function<void(int, uint64_t)> cb)
+{
+  auto op = new (op_pool_) GatherAppendOp(this, data, std::move(cb));
+  if (append_window) {
+    op->set_ordered();
+  }
+  queue_op(std::unique_ptr<LogOp>(op));
   return 0;
 }
 
-int TrimOp::run()
+void AppendBatchOp::execute()
 {
+  const auto count = entries_.size();
+  if (count == 0) {
+    complete(0);
+    return;
+  }
+
+  if (log_->encode_entries()) {
+    if (log_->cache) {
+      raw_entries_ = entries_;
+    }
+    log_->encode_entries(entries_);
+  }
+
+  std::vector<std::string> oids(count);
+
   while (true) {
-    const auto view = log_->striper->view();
-    const auto oid = log_->striper->map(view, position_);
-    if (!oid) {
-      int ret = log_->striper->try_expand_view(position_);
+    auto view = log_->striper->view();
+
+    if (!view->seq) {
+      log_->append_propose_sequencer++;
+      int ret = log_->striper->propose_sequencer();
       if (ret) {
-        return ret;
+        complete(ret);
+        return;
       }
       continue;
     }
 
-    int ret = log_->backend->Trim(*oid, view->epoch(), position_,
-        false, false);
+    // reserve positions for the whole batch with one sequencer request. as
+    // with AppendOp, the positions are kept across view changes that don't
+    // change the sequencer.
+    if (!position_epoch_ || (*position_epoch_ != view->seq->epoch())) {
+      uint64_t first;
+      int ret = view->seq->reserve(count, &first);
+      if (ret) {
+        if (log_->retry_sequencer(*view, ret)) {
+          continue;
+        }
+        complete(ret);
+        return;
+      }
+      positions_.resize(count);
+      for (size_t i = 0; i < count; i++) {
+        positions_[i] = first + i;
+      }
+      position_epoch_ = view->seq->epoch();
+    }
 
-    if (ret == -ESPIPE) {
-      log_->striper->update_current_view(view->epoch());
-      continue;
+    bool mapped = true;
+    for (size_t i = 0; i < count; i++) {
+      const auto oid = log_->striper->map(view, positions_[i]);
+      if (!oid) {
+        mapped = false;
+        break;
+      }
+      oids[i] = std::move(*oid);
     }
 
-    if (ret == -ENOENT) {
-      int ret = log_->backend->Seal(*oid, view->epoch());
-      if (ret && ret != -ESPIPE) {
-        return ret;
+    if (!mapped) {
+      // positions are increasing, so expanding the view to the last one maps
+      // the entire batch.
+      log_->append_expand_view++;
+      int ret = log_->striper->try_expand_view(positions_.back());
+      if (ret) {
+        complete(ret);
+        return;
       }
       continue;
     }
 
-    return ret;
+    std::unordered_map<std::string, std::vector<size_t>> groups;
+    for (size_t i = 0; i < count; i++) {
+      groups[oids[i]].push_back(i);
+    }
+
+    // the last group to complete also completes the batch, which may destroy
+    // this op. nothing here may be accessed after the last group is queued.
+    pending_groups_ = groups.size();
+    const auto epoch = view->epoch();
+    for (auto& group : groups) {
+      auto op = std::unique_ptr<LogOp>(
+          new (log_->op_pool_) BatchGroupOp(log_, this, epoch,
+            group.first, std::move(group.second)));
+      log_->queue_child_op(std::move(op));
+    }
+
+    return;
   }
 }
 
-int LogImpl::Trim(const uint64_t position)
+void AppendBatchOp::set_result(const int ret)
 {
-  struct {
-    int ret;
-    bool done = false;
-    std::mutex lock;
-    std::condition_variable cond;
-  } ctx;
+  if (ret) {
+    int expected = 0;
+    ret_.compare_exchange_strong(expected, ret);
+  }
+}
 
-  int ret = trimAsync(position, [&](int ret) {
-    {
-      std::lock_guard<std::mutex> lk(ctx.lock);
-      ctx.ret = ret;
-      ctx.done = true;
-      ctx.cond.notify_one();
-    }
-  });
+void AppendBatchOp::cache_entry(const size_t index, const uint64_t position)
+{
+  if (!log_->cache) {
+    return;
+  }
+  log_->cache->put(position, raw_entries_.empty() ?
+      entries_[index] : raw_entries_[index]);
+}
 
-  if (ret) {
-    return ret;
+void AppendBatchOp::group_done()
+{
+  if (pending_groups_.fetch_sub(1) == 1) {
+    complete(ret_.load());
   }
+}
 
-  std::unique_lock<std::mutex> lk(ctx.lock);
-  ctx.cond.wait(lk, [&] { return ctx.done; });
+void BatchGroupOp::execute()
+{
+  results_.assign(entries_.size(), 0);
+  pending_ = entries_.size() + 1;
+
+  for (size_t i = 0; i < entries_.size(); i++) {
+    const auto index = entries_[i];
+    log_->backend->WriteAsync(oid_, batch_->entries_[index], epoch_,
+        batch_->positions_[index], [this, i](int ret) {
+          results_[i] = ret;
+          if (put_pending()) {
+            writes_done();
+          }
+        });
+  }
 
-  return ctx.ret;
+  if (put_pending()) {
+    writes_done();
+  }
 }
 
-int LogImpl::trimAsync(uint64_t position, std::function<void(int)> cb)
+void BatchGroupOp::writes_done()
 {
-  auto op = std::unique_ptr<LogOp>(new TrimOp(this, position, cb));
-  queue_op(std::move(op));
-  return 0;
+  std::vector<size_t> retry;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (results_[i]) {
+      retry.push_back(i);
+    } else {
+      const auto index = entries_[i];
+      batch_->cache_entry(index, batch_->positions_[index]);
+      log_->position_watcher.notify(batch_->positions_[index]);
+    }
+  }
+
+  if (retry.empty()) {
+    complete(0);
+    return;
+  }
+
+  // handling the errors returned by a write, such as an uninitialized object
+  // or a stale view, is left to AppendOp. each failed entry is retried with
+  // its own op, which keeps the reserved position unless it has to be
+  // replaced (e.g. the stripe was sealed).
+  pending_ = retry.size() + 1;
+
+  for (auto i : retry) {
+    const auto index = entries_[i];
+    auto op = new AppendOp(log_, std::move(batch_->entries_[index]),
+        [this, index](int ret, uint64_t position) {
+          if (ret) {
+            batch_->set_result(ret);
+          } else {
+            batch_->positions_[index] = position;
+            // the op caches the entry itself unless it has been encoded
+            if (log_->encode_entries()) {
+              batch_->cache_entry(index, position);
+            }
+          }
+        });
+
+    op->set_encoded();
+    if (results_[i] != -EROFS) {
+      op->assign_position(batch_->positions_[index],
+          *batch_->position_epoch_);
+    }
+
+    op->start([](LogOp *op, int ret, void *arg) {
+      auto group = static_cast<BatchGroupOp*>(arg);
+      op->callback(ret);
+      delete op;
+      if (group->put_pending()) {
+        group->complete(0);
+      }
+    }, this);
+  }
+
+  if (put_pending()) {
+    complete(0);
+  }
 }
 
-int TrimToOp::run()
+void ReadRangeOp::execute()
 {
+  const auto count = end_ - start_;
+  entries_.resize(count);
+  for (uint64_t i = 0; i < count; i++) {
+    entries_[i].position = start_ + i;
+    entries_[i].ret = 0;
+  }
+
+  if (count == 0) {
+    complete(0);
+    return;
+  }
+
   while (true) {
     const auto view = log_->striper->view();
-    // note that we are invalidating the range [0, position_], inclusive. this
-    // results in a _valid_ range of [_position+1, ...) which is why we _advance
-    // the valid position_ to position_ + 1.
-    if (position_ >= view->object_map().min_valid_position()) {
-      int ret = log_->striper->advance_min_valid_position(position_ + 1);
-      if (ret) {
-        return ret;
+
+    // positions known to be invalid are answered without reading them, and
+    // don't need to be mapped.
+    log_->invalid_ranges.add_below(view->object_map().min_valid_position());
+    std::vector<std::pair<uint64_t, uint64_t>> invalid;
+    log_->invalid_ranges.ranges(start_, end_, &invalid);
+    for (const auto& range : invalid) {
+      for (auto p = range.first; p < range.second; p++) {
+        entries_[p - start_].ret = -ENODATA;
       }
-      continue;
     }
+    auto next_invalid = invalid.cbegin();
+
+    // within a stripe, position p maps to object (p % width) of the stripe,
+    // so the stripe is mapped once and its positions are grouped without
+    // mapping each one.
+    std::vector<std::pair<std::string, std::vector<size_t>>> groups;
+    bool mapped = true;
+    uint64_t position = start_;
+    while (position < end_) {
+      while (next_invalid != invalid.cend() &&
+          next_invalid->second <= position) {
+        next_invalid++;
+      }
+      if (next_invalid != invalid.cend() && position >= next_invalid->first) {
+        position = next_invalid->second;
+        continue;
+      }
 
-    uint64_t stripe_id = 0;
-    bool done = false;
-    bool restart = false;
-
-    // drives the iterator over the map_to range
-    while (true) {
-      // get all objects that map positions in the trim range
-      // TODO: would be good to skip objects already processed
-      const auto objects = log_->striper->map_to(view, position_, stripe_id, done);
-      if (done) {
+      const auto stripe = view->object_map().map_stripe(position);
+      if (!stripe) {
+        mapped = false;
         break;
       }
 
-      if (!objects) {
-        // expand view may also attempt to initialize new stripes. this is
-        // correct, but inefficient. however, trimming/space reclaiming right now
-        // has a lot of ineffiencies and this can be address in a later revision
-        // that will address the problem of trimming/space reclaiming/object
-        // deletion/view trimming more completely.
-        int ret = log_->striper->try_expand_view(position_);
-        if (ret) {
-          return ret;
+      // group j holds the positions that map to the same object as the j-th
+      // position of the range in this stripe
+      const auto last = std::min(end_ - 1, stripe->max_position());
+      const auto width = stripe->width();
+      const auto first = position;
+      const auto first_group = groups.size();
+      for (uint64_t p = first; p <= last && p < first + width; p++) {
+        groups.emplace_back(stripe->oids()[p % width], std::vector<size_t>());
+        groups.back().second.reserve((last - p) / width + 1);
+      }
+      for (; position <= last; position++) {
+        if (entries_[position - start_].ret == -ENODATA) {
+          continue;
         }
-        restart = true;
-        break;
+        groups[first_group + (position - first) % width].second.push_back(
+            position - start_);
       }
+    }
 
-      for (auto obj : *objects) {
-        const auto oid = obj.first;
-        const auto trim_full = obj.second;
+    if (!mapped) {
+      // as with reads of single positions, the view is expanded to map the
+      // range. positions are increasing, so mapping the last one maps them
+      // all.
+      int ret = log_->striper->try_expand_view(end_ - 1);
+      if (ret) {
+        complete(ret);
+        return;
+      }
+      continue;
+    }
 
-        // handles setting up range trim and omap/bytestream space reclaim etc..
-        int ret = log_->backend->Trim(oid, view->epoch(), position_,
-            true, trim_full);
+    size_t hits = 0;
+    for (const auto& range : invalid) {
+      hits += range.second - range.first;
+    }
+    if (hits) {
+      log_->invalid_range_hits += hits;
+      RecordTick(log_->options.statistics, INVALID_RANGE_HITS, hits);
+    }
 
-        if (ret == -ESPIPE) {
-          log_->striper->update_current_view(view->epoch());
-          // restart after view update. wildly inefficient :(
-          restart = true;
-          break;
-        }
+    groups.erase(std::remove_if(groups.begin(), groups.end(),
+          [](const std::pair<std::string, std::vector<size_t>>& group) {
+            return group.second.empty();
+          }), groups.end());
+    if (groups.empty()) {
+      complete(0);
+      return;
+    }
 
-        if (ret == -ENOENT) {
-          int ret = log_->backend->Seal(oid, view->epoch());
-          if (ret && ret != -ESPIPE) {
-            return ret;
-          }
+    // the last group to complete also completes the range, which may destroy
+    // this op. nothing here may be accessed after the last group is queued.
+    pending_groups_ = groups.size();
+    const auto epoch = view->epoch();
+    for (auto& group : groups) {
+      auto op = std::unique_ptr<LogOp>(
+          new (log_->op_pool_) ReadGroupOp(log_, this, epoch,
+            std::move(group.first), std::move(group.second)));
+      log_->queue_child_op(std::move(op));
+    }
 
-          // part of trimming here means we may create objects that are
-          // immediately trimmed (holes, past eol). i suspect that there are an
-          // optimization here, but for now when we create a new object we'll
-          // restart the trim process and treat it like any other object. this is
-          // clearly, wildly, inefficient.
-          restart = true;
-          break;
-        }
+    return;
+  }
+}
 
-        if (ret != 0) {
-          return ret;
-        }
+void ReadRangeOp::group_done()
+{
+  if (pending_groups_.fetch_sub(1) == 1) {
+    complete(0);
+  }
+}
+
+void ReadGroupOp::execute()
+{
+  positions_.reserve(entries_.size());
+  for (auto index : entries_) {
+    positions_.push_back(range_->entries_[index].position);
+  }
+  data_.resize(entries_.size());
+  results_.assign(entries_.size(), 0);
+
+  log_->backend->ReadBatchAsync(oid_, epoch_, positions_.data(),
+      positions_.size(), data_.data(), results_.data(),
+      [this] { reads_done(); });
+}
+
+void ReadGroupOp::reads_done()
+{
+  const auto count = entries_.size();
+
+  std::vector<bool> verified;
+  if (log_->options.entry_checksums) {
+    log_->verify_entries(data_.data(), results_.data(), count, &verified);
+  }
+
+  // positions that the group couldn't read are left to ReadOp, which handles
+  // uninitialized objects, stale views, and refetching corrupt entries.
+  std::vector<size_t> retry;
+  for (size_t i = 0; i < count; i++) {
+    auto ret = results_[i];
+    if (ret == -ENOENT || ret == -ESPIPE) {
+      retry.push_back(i);
+      continue;
+    }
+
+    if (ret == -ERANGE) {
+      ret = -ENOENT;
+    } else if (ret == -ENODATA) {
+      log_->invalid_ranges.add(range_->entries_[entries_[i]].position);
+    } else if (!ret && log_->encode_entries()) {
+      const bool ok = !log_->options.entry_checksums || verified[i];
+      if (!ok && log_->options.checksum_policy == Options::CHECKSUM_REFETCH) {
+        log_->read_checksum_refetches++;
+        RecordTick(log_->options.statistics, CHECKSUM_REFETCHES);
+        retry.push_back(i);
+        continue;
       }
+      ret = log_->decode_entry(&data_[i], ok);
+    }
 
-      if (restart)
-        break;
+    auto& entry = range_->entries_[entries_[i]];
+    entry.ret = ret;
+    if (!ret) {
+      entry.data.swap(data_[i]);
     }
+  }
 
-    if (restart)
-      continue;
+  if (retry.empty()) {
+    complete(0);
+    return;
+  }
 
-    break;
+  pending_ = retry.size() + 1;
+
+  for (auto i : retry) {
+    auto entry = &range_->entries_[entries_[i]];
+    auto op = new ReadOp(log_, entry->position,
+        [entry](int ret, std::string& data) {
+          entry->ret = ret;
+          if (!ret) {
+            entry->data.swap(data);
+          }
+        });
+
+    op->start([](LogOp *op, int ret, void *arg) {
+      auto group = static_cast<ReadGroupOp*>(arg);
+      op->callback(ret);
+      delete op;
+      if (group->put_pending()) {
+        group->complete(0);
+      }
+    }, this);
   }
 
-  return 0;
+  if (put_pending()) {
+    complete(0);
+  }
 }
 
-int LogImpl::trimTo(const uint64_t position)
+int LogImpl::ReadRange(const uint64_t start, const uint64_t end,
+    std::vector<LogEntry> *entries)
 {
   struct {
     int ret;
     bool done = false;
+    std::vector<LogEntry> *entries;
     std::mutex lock;
     std::condition_variable cond;
   } ctx;
 
-  int ret = trimToAsync(position, [&](int ret) {
+  ctx.entries = entries;
+
+  int ret = readRangeAsync(start, end,
+      [&ctx](int ret, std::vector<LogEntry>& entries) {
     {
       std::lock_guard<std::mutex> lk(ctx.lock);
       ctx.ret = ret;
       ctx.done = true;
+      if (!ctx.ret && ctx.entries) {
+        ctx.entries->swap(entries);
+      }
       ctx.cond.notify_one();
     }
   });
@@ -588,74 +1337,1047 @@ int LogImpl::trimTo(const uint64_t position)
   return ctx.ret;
 }
 
-int LogImpl::trimToAsync(uint64_t position, std::function<void(int)> cb)
+int LogImpl::readRangeAsync(const uint64_t start, const uint64_t end,
+    std::function<void(int, std::vector<LogEntry>&)> cb)
 {
-  auto op = std::unique_ptr<LogOp>(new TrimToOp(this, position, cb));
+  if (end < start) {
+    return -EINVAL;
+  }
+
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) ReadRangeOp(this, start, end, std::move(cb)));
   queue_op(std::move(op));
   return 0;
 }
 
-void LogImpl::queue_op(std::unique_ptr<LogOp> op)
+int LogImpl::AppendBatch(std::vector<std::string>&& entries,
+    std::vector<uint64_t> *positions)
 {
-  std::unique_lock<std::mutex> lk(lock);
-
-  if (num_inflight_ops_ >= options.max_inflight_ops) {
-    std::condition_variable cond;
-    queue_op_waiters_.emplace_front(false, &cond);
-    auto it = queue_op_waiters_.begin();
-    cond.wait(lk, [&] {
-      assert(it->second == &cond);
-      return it->first;
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    AppendBatchOp op(this, std::move(entries),
+        [&](int r, std::vector<uint64_t>& p) {
+      ret = r;
+      if (positions) {
+        positions->swap(p);
+      }
     });
-    queue_op_waiters_.erase(it);
+    run_inline(op);
+    return ret;
   }
 
-  num_inflight_ops_++;
+  struct {
+    int ret;
+    bool done = false;
+    std::vector<uint64_t> *positions;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
 
-  pending_ops_.emplace_back(std::move(op));
-  finishers_cond_.notify_all();
-}
+  ctx.positions = positions;
 
-void LogImpl::finisher_entry_()
-{
-  while (true) {
-    bool do_shutdown = false;
-    std::unique_ptr<LogOp> op;
+  int ret = appendBatchAsync(std::move(entries),
+      [&ctx](int ret, std::vector<uint64_t>& positions) {
     {
-      std::unique_lock<std::mutex> lk(lock);
-      finishers_cond_.wait(lk, [&] {
-        return !pending_ops_.empty() || shutdown;
-      });
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      ctx.ret = ret;
+      ctx.done = true;
+      if (ctx.positions) {
+        ctx.positions->swap(positions);
+      }
+      ctx.cond.notify_one();
+    }
+  });
+
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  return ctx.ret;
+}
+
+int LogImpl::appendBatchAsync(std::vector<std::string>&& entries,
+    std::function<void(int, std::vector<uint64_t>&)> cb)
+{
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) AppendBatchOp(this, std::move(entries), std::move(cb)));
+  queue_op(std::move(op));
+  return 0;
+}
+
+void FillOp::issue(const std::string& oid, const uint64_t epoch,
+    std::function<void(int)> cb)
+{
+  log_->backend->FillAsync(oid, epoch, position_, std::move(cb));
+}
+
+int FillOp::result(const int ret)
+{
+  if (!ret) {
+    log_->invalid_ranges.add(position_);
+    log_->position_watcher.notify(position_);
+  }
+  return ret;
+}
+
+int LogImpl::Fill(const uint64_t position)
+{
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    FillOp op(this, position, [&](int r) {
+      ret = r;
+    });
+    run_inline(op);
+    return ret;
+  }
+
+  struct {
+    int ret;
+    bool done = false;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  int ret = fillAsync(position, [&](int ret) {
+    {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      ctx.ret = ret;
+      ctx.done = true;
+      ctx.cond.notify_one();
+    }
+  });
+
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  return ctx.ret;
+}
 
-      if (shutdown) {
-        if (pending_ops_.empty()) {
+int LogImpl::fillAsync(uint64_t position, std::function<void(int)> cb)
+{
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) FillOp(this, position, std::move(cb)));
+  queue_op(std::move(op));
+  return 0;
+}
+
+void TrimOp::issue(const std::string& oid, const uint64_t epoch,
+    std::function<void(int)> cb)
+{
+  log_->backend->TrimAsync(oid, epoch, position_, false, false,
+      std::move(cb));
+}
+
+int TrimOp::result(const int ret)
+{
+  if (!ret) {
+    if (log_->cache) {
+      uint64_t position = position_;
+      log_->cache->remove(&position);
+    }
+    log_->invalid_ranges.add(position_);
+    log_->position_watcher.notify(position_);
+  }
+  return ret;
+}
+
+int LogImpl::Trim(const uint64_t position)
+{
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    TrimOp op(this, position, [&](int r) {
+      ret = r;
+    });
+    run_inline(op);
+    return ret;
+  }
+
+  struct {
+    int ret;
+    bool done = false;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  int ret = trimAsync(position, [&](int ret) {
+    {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      ctx.ret = ret;
+      ctx.done = true;
+      ctx.cond.notify_one();
+    }
+  });
+
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  return ctx.ret;
+}
+
+int LogImpl::trimAsync(uint64_t position, std::function<void(int)> cb)
+{
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) TrimOp(this, position, std::move(cb)));
+  queue_op(std::move(op));
+  return 0;
+}
+
+int TrimToOp::run()
+{
+  while (true) {
+    const auto view = log_->striper->view();
+    // note that we are invalidating the range [0, position_], inclusive. this
+    // results in a _valid_ range of [_position+1, ...) which is why we _advance
+    // the valid position_ to position_ + 1.
+    if (position_ >= view->object_map().min_valid_position()) {
+      int ret = log_->striper->advance_min_valid_position(position_ + 1);
+      if (ret) {
+        return ret;
+      }
+      continue;
+    }
+
+    uint64_t stripe_id = 0;
+    bool done = false;
+    bool restart = false;
+
+    // drives the iterator over the map_to range
+    while (true) {
+      // get all objects that map positions in the trim range
+      // TODO: would be good to skip objects already processed
+      const auto objects = log_->striper->map_to(view, position_, stripe_id, done);
+      if (done) {
+        break;
+      }
+
+      if (!objects) {
+        // expand view may also attempt to initialize new stripes. this is
+        // correct, but inefficient. however, trimming/space reclaiming right now
+        // has a lot of ineffiencies and this can be address in a later revision
+        // that will address the problem of trimming/space reclaiming/object
+        // deletion/view trimming more completely.
+        int ret = log_->striper->try_expand_view(position_);
+        if (ret) {
+          return ret;
+        }
+        restart = true;
+        break;
+      }
+
+      for (auto obj : *objects) {
+        const auto oid = obj.first;
+        const auto trim_full = obj.second;
+
+        // handles setting up range trim and omap/bytestream space reclaim etc..
+        int ret = log_->backend->Trim(oid, view->epoch(), position_,
+            true, trim_full);
+
+        if (ret == -ESPIPE) {
+          log_->striper->update_current_view(view->epoch());
+          // restart after view update. wildly inefficient :(
+          restart = true;
+          break;
+        }
+
+        if (ret == -ENOENT) {
+          int ret = log_->backend->Seal(oid, view->epoch());
+          if (ret && ret != -ESPIPE) {
+            return ret;
+          }
+
+          // part of trimming here means we may create objects that are
+          // immediately trimmed (holes, past eol). i suspect that there are an
+          // optimization here, but for now when we create a new object we'll
+          // restart the trim process and treat it like any other object. this is
+          // clearly, wildly, inefficient.
+          restart = true;
           break;
         }
-        do_shutdown = true;
+
+        if (ret != 0) {
+          return ret;
+        }
       }
 
-      assert(!pending_ops_.empty());
-      op = std::move(pending_ops_.front());
-      pending_ops_.pop_front();
+      if (restart)
+        break;
+    }
+
+    if (restart)
+      continue;
+
+    break;
+  }
+
+  if (log_->cache) {
+    log_->cache->remove_below(position_ + 1);
+  }
+  log_->invalid_ranges.add_below(position_ + 1);
+  log_->position_watcher.notify(0, position_);
+
+  return 0;
+}
+
+int LogImpl::trimTo(const uint64_t position)
+{
+  if (options.inline_sync_ops && try_reserve_op()) {
+    int ret;
+    TrimToOp op(this, position, [&](int r) {
+      ret = r;
+    });
+    run_inline(op);
+    return ret;
+  }
+
+  struct {
+    int ret;
+    bool done = false;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  int ret = trimToAsync(position, [&](int ret) {
+    {
+      std::lock_guard<std::mutex> lk(ctx.lock);
+      ctx.ret = ret;
+      ctx.done = true;
+      ctx.cond.notify_one();
+    }
+  });
+
+  if (ret) {
+    return ret;
+  }
+
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+
+  return ctx.ret;
+}
+
+int LogImpl::trimToAsync(uint64_t position, std::function<void(int)> cb)
+{
+  auto op = std::unique_ptr<LogOp>(
+      new (op_pool_) TrimToOp(this, position, std::move(cb)));
+  queue_op(std::move(op));
+  return 0;
+}
+
+int LogImpl::Submit(CompletionQueue *cq, std::vector<LogRequest>& requests)
+{
+  if (!cq) {
+    return -EINVAL;
+  }
+
+  for (const auto& req : requests) {
+    switch (req.type) {
+      case LogRequest::APPEND:
+      case LogRequest::READ:
+      case LogRequest::FILL:
+      case LogRequest::TRIM:
+        break;
+      default:
+        return -EINVAL;
+    }
+  }
+
+  auto cq_impl = static_cast_with_check<CompletionQueueImpl>(cq);
+  cq_impl->add_pending(requests.size());
+
+  for (auto& req : requests) {
+    std::unique_ptr<LogOp> op;
+    switch (req.type) {
+      case LogRequest::APPEND:
+        op.reset(new (op_pool_) CQAppendOp(this, std::move(req.data), cq_impl,
+              req.cookie));
+        break;
+      case LogRequest::READ:
+        {
+          std::string data;
+          int ret;
+          if (local_read(req.position, &data, &ret)) {
+            cq_impl->complete(LogRequest::READ, req.cookie, ret, req.position,
+                ret ? nullptr : &data);
+            continue;
+          }
+        }
+        op.reset(new (op_pool_) CQReadOp(this, req.position, cq_impl,
+              req.cookie));
+        break;
+      case LogRequest::FILL:
+        op.reset(new (op_pool_) CQFillOp(this, req.position, cq_impl,
+              req.cookie));
+        break;
+      case LogRequest::TRIM:
+        op.reset(new (op_pool_) CQTrimOp(this, req.position, cq_impl,
+              req.cookie));
+        break;
+    }
+    queue_op(std::move(op));
+  }
+
+  return 0;
+}
+
+bool LogImpl::try_reserve_op()
+{
+  auto inflight = num_inflight_ops_.load();
+  while (inflight < options.max_inflight_ops) {
+    if (num_inflight_ops_.compare_exchange_weak(inflight, inflight + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LogImpl::reserve_op()
+{
+  while (!try_reserve_op()) {
+    std::unique_lock<std::mutex> lk(lock);
+
+    std::condition_variable cond;
+    queue_op_waiters_.emplace_front(false, &cond);
+    num_queue_op_waiters_++;
+    auto it = queue_op_waiters_.begin();
+
+    // an op may have completed after the limit was observed but before this
+    // waiter was visible to finish_op, in which case nobody will wake us.
+    if (num_inflight_ops_.load() >= options.max_inflight_ops) {
+      cond.wait(lk, [&] {
+        assert(it->second == &cond);
+        return it->first;
+      });
+    }
+
+    queue_op_waiters_.erase(it);
+    num_queue_op_waiters_--;
+  }
+}
+
+void LogImpl::queue_op(std::unique_ptr<LogOp> op)
+{
+  reserve_op();
+  op_queue_.push(std::move(op));
+}
+
+void LogImpl::queue_child_op(std::unique_ptr<LogOp> op)
+{
+  num_inflight_ops_++;
+  op_queue_.push(std::move(op));
+}
+
+void LogImpl::run_inline(LogOp& op)
+{
+  struct inline_ctx {
+    bool done = false;
+    std::mutex lock;
+    std::condition_variable cond;
+  } ctx;
+
+  op.start([](LogOp *op, int ret, void *arg) {
+    auto ctx = static_cast<inline_ctx*>(arg);
+    op->callback(ret);
+    std::lock_guard<std::mutex> lk(ctx->lock);
+    ctx->done = true;
+    ctx->cond.notify_one();
+  }, &ctx);
+
+  // with a synchronous backend the op has already completed
+  std::unique_lock<std::mutex> lk(ctx.lock);
+  ctx.cond.wait(lk, [&] { return ctx.done; });
+  lk.unlock();
+
+  finish_op();
+}
+
+void LogImpl::finish_queued_op(LogOp *op, int ret, void *arg)
+{
+  auto log = static_cast<LogImpl*>(arg);
+  const auto lane = op->lane();
+  op->callback(ret);
+  delete op;
+  log->op_queue_.finished(lane);
+  log->finish_op();
+}
+
+void LogImpl::complete_ordered_append(const ReorderWindow::Ticket ticket,
+    const int ret, std::function<void(int, uint64_t)> cb)
+{
+  // the op is finished when this returns. the window finishes it again when
+  // the callback is delivered.
+  num_inflight_ops_++;
+  append_window->complete(ticket, ret, std::move(cb));
+}
+
+bool LogImpl::retry_sequencer(const VersionedView& view, const int ret)
+{
+  // the log has a newer sequencer
+  if (ret == -ESPIPE) {
+    striper->update_current_view(view.epoch(), true);
+    return true;
+  }
+
+  // a zlog-seqr server that can't be reached may have been replaced. the
+  // latest view is read once, and the error is returned if there is no newer
+  // view.
+  if (view.seq->remote()) {
+    striper->refresh_view();
+    return striper->view()->epoch() != view.epoch();
+  }
+
+  return false;
+}
+
+void LogImpl::finish_op()
+{
+  const auto inflight = num_inflight_ops_.fetch_sub(1);
+  assert((inflight & ~kDrainingOps) > 0);
+
+  // the last op to finish while the log is being destroyed. the destructor
+  // can't return until the lock is released.
+  if (inflight == (kDrainingOps | 1)) {
+    std::lock_guard<std::mutex> lk(drain_lock_);
+    drained_ = true;
+    drain_cond_.notify_one();
+    return;
+  }
+
+  if (num_queue_op_waiters_.load() == 0) {
+    return;
+  }
+
+  // wake the oldest waiter that hasn't already been signaled
+  std::lock_guard<std::mutex> lk(lock);
+  for (auto it = queue_op_waiters_.rbegin();
+       it != queue_op_waiters_.rend(); it++) {
+    if (!it->first) {
+      it->first = true;
+      it->second->notify_one();
+      break;
+    }
+  }
+}
+
+void LogImpl::start_finisher(const size_t home)
+{
+  auto& finisher = *finishers_[home];
+  if (finisher.thread.joinable()) {
+    finisher.thread.join();
+  }
+  finisher.retire = false;
+  finisher.thread = std::thread(&LogImpl::finisher_entry_, this,
+      &finisher, home);
+}
+
+void LogImpl::set_background_limit(const int threads)
+{
+  // background ops get their share of the finishers by weight, and at least
+  // one. the weights alone only order the queue, and background ops such as
+  // trimTo may hold a finisher for a long time.
+  const uint64_t fg = std::max(options.foreground_weight, 1u);
+  const uint64_t bg = std::max(options.background_weight, 1u);
+  op_queue_.set_background_limit(std::max<uint64_t>(1,
+        threads * bg / (fg + bg)));
+}
+
+void LogImpl::finisher_entry_(Finisher *finisher, const size_t home)
+{
+  while (true) {
+    bool do_shutdown = false;
+    auto op = op_queue_.pop(home, &do_shutdown, &finisher->retire);
+    if (!op) {
+      break;
     }
 
     if (do_shutdown) {
+      const auto lane = op->lane();
       op->callback(-ESHUTDOWN);
+      op.reset();
+      op_queue_.finished(lane);
+      finish_op();
+      continue;
+    }
+
+    // the op completes through finish_queued_op, either before start returns
+    // or later from a backend completion. this thread doesn't wait for it.
+    if (adaptive_finishers_) {
+      const auto start_us = now_us();
+      op.release()->start(finish_queued_op, this);
+      finisher_busy_us_ += now_us() - start_us;
     } else {
-      int ret = op->run();
-      op->callback(ret);
+      op.release()->start(finish_queued_op, this);
+    }
+  }
+}
+
+void LogImpl::finisher_adapt_entry_()
+{
+  const auto interval = std::chrono::milliseconds(
+      std::max(options.finisher_adapt_interval_ms, 1));
+
+  std::unique_lock<std::mutex> lk(finisher_adapt_lock_);
+  auto last_us = now_us();
+  while (true) {
+    finisher_adapt_cond_.wait_for(lk, interval,
+        [&] { return finisher_adapt_stop_; });
+    if (finisher_adapt_stop_) {
+      break;
+    }
+
+    const auto cur_us = now_us();
+    const auto interval_us = cur_us - last_us;
+    last_us = cur_us;
+
+    lk.unlock();
+    adapt_finishers(interval_us);
+    lk.lock();
+  }
+}
+
+void LogImpl::adapt_finishers(const uint64_t interval_us)
+{
+  uint64_t queue_ops = 0;
+  uint64_t queue_wait_us = 0;
+  size_t depth = 0;
+  for (size_t i = 0; i < NUM_OP_LANES; i++) {
+    const auto stats = op_queue_.lane_stats(static_cast<OpLane>(i));
+    queue_ops += stats.ops;
+    queue_wait_us += stats.wait_us;
+    depth += stats.depth;
+  }
+  const auto busy_us = finisher_busy_us_.load();
+
+  FinisherSample sample;
+  sample.interval_us = interval_us;
+  sample.ops = queue_ops - last_queue_ops_;
+  sample.wait_us = queue_wait_us - last_queue_wait_us_;
+  sample.busy_us = busy_us - last_busy_us_;
+  sample.depth = depth;
+
+  last_queue_ops_ = queue_ops;
+  last_queue_wait_us_ = queue_wait_us;
+  last_busy_us_ = busy_us;
+
+  const int threads = num_finishers_.load();
+  const int target = adapt_finisher_threads(sample, threads,
+      min_finishers_, max_finishers_);
+
+  if (target > threads) {
+    for (int i = threads; i < target; i++) {
+      start_finisher(i);
+    }
+    finisher_grows_++;
+    RecordTick(options.statistics, FINISHER_POOL_GROWS);
+  } else if (target < threads) {
+    // retired threads exit after finishing the op they are running, if any.
+    // they are joined when the pool grows again or the log is closed.
+    for (int i = target; i < threads; i++) {
+      finishers_[i]->retire = true;
+    }
+    op_queue_.wake_all();
+    finisher_shrinks_++;
+    RecordTick(options.statistics, FINISHER_POOL_SHRINKS);
+  } else {
+    return;
+  }
+
+  set_background_limit(target);
+  num_finishers_ = target;
+  SetTickerCount(options.statistics, FINISHER_THREADS, target);
+}
+
+static inline void put_checksum(std::string *entry, const uint32_t crc)
+{
+  char buf[4];
+  buf[0] = crc & 0xff;
+  buf[1] = (crc >> 8) & 0xff;
+  buf[2] = (crc >> 16) & 0xff;
+  buf[3] = (crc >> 24) & 0xff;
+  entry->append(buf, sizeof(buf));
+}
+
+static inline uint32_t get_checksum(const std::string& entry)
+{
+  const auto p = reinterpret_cast<const unsigned char*>(
+      entry.data() + entry.size() - 4);
+  return uint32_t(p[0]) |
+    (uint32_t(p[1]) << 8) |
+    (uint32_t(p[2]) << 16) |
+    (uint32_t(p[3]) << 24);
+}
+
+void LogImpl::encode_entry(const Slice *data, const size_t count,
+    std::string *entry)
+{
+  if (entry_codec) {
+    entry_codec->Encode(data, count, entry);
+  } else {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+      size += data[i].size;
+    }
+    entry->clear();
+    entry->reserve(size + 4);
+    for (size_t i = 0; i < count; i++) {
+      entry->append(data[i].data, data[i].size);
+    }
+  }
+
+  if (options.entry_checksums) {
+    put_checksum(entry, crc32c::Value(entry->data(), entry->size()));
+  }
+}
+
+void LogImpl::encode_entry(std::string *entry)
+{
+  if (entry_codec) {
+    const Slice slice(*entry);
+    std::string encoded;
+    entry_codec->Encode(&slice, 1, &encoded);
+    entry->swap(encoded);
+  }
+
+  if (options.entry_checksums) {
+    put_checksum(entry, crc32c::Value(entry->data(), entry->size()));
+  }
+}
+
+void LogImpl::encode_entries(std::vector<std::string>& entries)
+{
+  if (entry_codec) {
+    std::string encoded;
+    for (auto& entry : entries) {
+      const Slice slice(entry);
+      entry_codec->Encode(&slice, 1, &encoded);
+      entry.swap(encoded);
     }
+  }
 
-    std::lock_guard<std::mutex> lk(lock);
-    assert(num_inflight_ops_ > 0);
-    num_inflight_ops_--;
-    if (!queue_op_waiters_.empty()) {
-      queue_op_waiters_.back().first = true;
-      queue_op_waiters_.back().second->notify_one();
+  if (options.entry_checksums) {
+    std::vector<Slice> slices(entries.begin(), entries.end());
+    std::vector<uint32_t> crcs(entries.size());
+    crc32c::ValueBatch(slices.data(), slices.size(), crcs.data());
+    for (size_t i = 0; i < entries.size(); i++) {
+      put_checksum(&entries[i], crcs[i]);
     }
   }
 }
 
+bool LogImpl::verify_entry(const std::string& entry) const
+{
+  if (entry.size() < 4) {
+    return false;
+  }
+  return crc32c::Value(entry.data(), entry.size() - 4) == get_checksum(entry);
+}
+
+void LogImpl::verify_entries(const std::string *entries, const int *results,
+    const size_t count, std::vector<bool> *verified) const
+{
+  std::vector<size_t> index;
+  std::vector<Slice> slices;
+  index.reserve(count);
+  slices.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (!results[i] && entries[i].size() >= 4) {
+      index.push_back(i);
+      slices.emplace_back(entries[i].data(), entries[i].size() - 4);
+    }
+  }
+
+  std::vector<uint32_t> crcs(slices.size());
+  crc32c::ValueBatch(slices.data(), slices.size(), crcs.data());
+
+  verified->assign(count, false);
+  for (size_t i = 0; i < index.size(); i++) {
+    (*verified)[index[i]] = crcs[i] == get_checksum(entries[index[i]]);
+  }
+}
+
+int LogImpl::decode_entry(std::string *entry, const bool verified)
+{
+  if (options.entry_checksums) {
+    if (entry->size() < 4) {
+      read_checksum_failures++;
+      RecordTick(options.statistics, CHECKSUM_FAILURES);
+      return -EIO;
+    }
+
+    if (!verified && !verify_entry(*entry)) {
+      read_checksum_failures++;
+      RecordTick(options.statistics, CHECKSUM_FAILURES);
+      if (options.checksum_policy != Options::CHECKSUM_LOG) {
+        return -EIO;
+      }
+      std::cerr << "zlog: log " << name << ": entry checksum mismatch"
+        << std::endl;
+    }
+
+    entry->resize(entry->size() - 4);
+  }
+
+  if (entry_codec) {
+    return entry_codec->Decode(entry);
+  }
+
+  return 0;
+}
+
+bool LogImpl::start_watch()
+{
+  std::lock_guard<std::mutex> lk(watch_lock_);
+  if (!watch_started_) {
+    watch_started_ = true;
+    int ret = backend->Watch([this](uint64_t first, uint64_t last) {
+      position_watcher.notify(first, last);
+    }, &watch_cookie_);
+    backend_watch_ = ret == 0;
+  }
+  return backend_watch_;
+}
+
+int LogImpl::wait_and_read(PositionWatcher::Waiter& waiter,
+    const uint64_t position,
+    const std::chrono::steady_clock::time_point *deadline,
+    std::string *data)
+{
+  const bool watched = start_watch();
+  auto delay = std::chrono::microseconds(100);
+
+  while (true) {
+    if (waiter.cancelled()) {
+      return -ECANCELED;
+    }
+
+    // a notification only means that the position may have changed, so it
+    // is always read again.
+    int ret = Read(position, data);
+    if (ret != -ENOENT) {
+      return ret;
+    }
+
+    // without a backend watch, changes made by other clients are noticed by
+    // reading the position again after a delay.
+    auto until = std::chrono::steady_clock::time_point::max();
+    if (!watched) {
+      until = std::chrono::steady_clock::now() + delay;
+      delay = std::min(delay * 2, decltype(delay)(10000));
+    }
+    if (deadline) {
+      until = std::min(until, *deadline);
+    }
+
+    if (until == std::chrono::steady_clock::time_point::max()) {
+      ret = waiter.wait();
+    } else {
+      ret = waiter.wait_until(until);
+    }
+
+    if (ret == -ECANCELED) {
+      return ret;
+    }
+
+    if (ret == -ETIMEDOUT && deadline &&
+        std::chrono::steady_clock::now() >= *deadline) {
+      return -ETIMEDOUT;
+    }
+  }
+}
+
+int LogImpl::WaitForPosition(const uint64_t position, const int timeout_ms)
+{
+  PositionWatcher::Waiter waiter(&position_watcher, position);
+
+  std::string data;
+  int ret;
+  if (timeout_ms < 0) {
+    ret = wait_and_read(waiter, position, nullptr, &data);
+  } else {
+    const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(timeout_ms);
+    ret = wait_and_read(waiter, position, &deadline, &data);
+  }
+
+  // filled and trimmed positions have been written
+  return ret == -ENODATA ? 0 : ret;
+}
+
+int LogImpl::Subscribe(const uint64_t position,
+    std::function<void(LogEntry&)> cb, uint64_t *subscription)
+{
+  if (!cb || !subscription) {
+    return -EINVAL;
+  }
+
+  std::shared_ptr<Subscription> sub(new Subscription);
+  sub->position = position;
+  sub->cb = std::move(cb);
+  sub->waiter.reset(new PositionWatcher::Waiter(&position_watcher, position,
+        [this] { wake_subscriptions_(); }));
+  sub->next_read = std::chrono::steady_clock::time_point::min();
+  sub->poll_delay = std::chrono::microseconds(100);
+  sub->cancelled = false;
+
+  {
+    std::lock_guard<std::mutex> lk(subscriptions_lock_);
+    *subscription = next_subscription_++;
+    subscriptions_.emplace(*subscription, sub);
+    if (!subscription_thread_.joinable()) {
+      subscription_thread_ = std::thread(&LogImpl::subscription_entry_, this);
+    }
+  }
+
+  wake_subscriptions_();
+
+  return 0;
+}
+
+int LogImpl::Unsubscribe(const uint64_t subscription)
+{
+  std::unique_lock<std::mutex> lk(subscriptions_lock_);
+  auto it = subscriptions_.find(subscription);
+  if (it == subscriptions_.end()) {
+    return -ENOENT;
+  }
+
+  auto sub = it->second;
+  if (running_subscription_ == sub.get() &&
+      subscription_thread_.get_id() == std::this_thread::get_id()) {
+    return -EDEADLK;
+  }
+
+  // the subscription thread may hold a reference until the end of its
+  // current pass, but won't start another callback.
+  sub->cancelled = true;
+  subscriptions_.erase(it);
+  subscriptions_cond_.wait(lk, [&] {
+    return running_subscription_ != sub.get();
+  });
+
+  return 0;
+}
+
+void LogImpl::wake_subscriptions_()
+{
+  std::lock_guard<std::mutex> lk(subscription_wake_lock_);
+  subscription_wake_ = true;
+  subscription_wake_cond_.notify_one();
+}
+
+void LogImpl::subscription_entry_()
+{
+  const bool watched = start_watch();
+  std::vector<std::shared_ptr<Subscription>> subs;
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lk(subscriptions_lock_);
+      if (subscriptions_stop_) {
+        return;
+      }
+      for (auto& it : subscriptions_) {
+        subs.push_back(it.second);
+      }
+    }
+
+    // one entry per subscription per pass, so that a subscription that is
+    // behind doesn't hold up the others
+    bool delivered = false;
+    auto next_read = std::chrono::steady_clock::time_point::max();
+    for (auto& sub : subs) {
+      if (deliver_subscription_(*sub, watched)) {
+        delivered = true;
+      } else {
+        next_read = std::min(next_read, sub->next_read);
+      }
+    }
+    subs.clear();
+
+    std::unique_lock<std::mutex> lk(subscription_wake_lock_);
+    if (!delivered) {
+      auto woken = [this] { return subscription_wake_; };
+      if (next_read == std::chrono::steady_clock::time_point::max()) {
+        subscription_wake_cond_.wait(lk, woken);
+      } else {
+        subscription_wake_cond_.wait_until(lk, next_read, woken);
+      }
+    }
+    subscription_wake_ = false;
+  }
+}
+
+bool LogImpl::deliver_subscription_(Subscription& sub, const bool watched)
+{
+  // a notification only means that the position may have changed. it is
+  // consumed before the read, so one that arrives during the read isn't lost.
+  const auto now = std::chrono::steady_clock::now();
+  if (!sub.waiter->poll() && now < sub.next_read) {
+    return false;
+  }
+
+  LogEntry entry;
+  entry.position = sub.position;
+  entry.ret = Read(sub.position, &entry.data);
+
+  // without a backend watch, changes made by other clients are noticed by
+  // reading the position again after a delay.
+  if (entry.ret == -ENOENT) {
+    if (watched) {
+      sub.next_read = std::chrono::steady_clock::time_point::max();
+    } else {
+      sub.next_read = now + sub.poll_delay;
+      sub.poll_delay = std::min(sub.poll_delay * 2,
+          decltype(sub.poll_delay)(10000));
+    }
+    return false;
+  }
+
+  // the position can't be read right now (e.g. a backend error), and is
+  // read again after a pause.
+  if (entry.ret && entry.ret != -ENODATA) {
+    sub.next_read = now + std::chrono::milliseconds(10);
+    return false;
+  }
+
+  if (entry.ret) {
+    entry.data.clear();
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(subscriptions_lock_);
+    if (sub.cancelled) {
+      return false;
+    }
+    running_subscription_ = &sub;
+  }
+
+  sub.cb(entry);
+
+  {
+    std::lock_guard<std::mutex> lk(subscriptions_lock_);
+    running_subscription_ = nullptr;
+    subscriptions_cond_.notify_all();
+  }
+
+  sub.position++;
+  sub.waiter->reset(sub.position);
+  sub.next_read = now;
+  sub.poll_delay = std::chrono::microseconds(100);
+
+  return true;
+}
+
 void LogImpl::PrintStats()
 {
   std::cout << "==== stats ===========================" << std::endl;
@@ -664,6 +2386,55 @@ void LogImpl::PrintStats()
   std::cout << "append_seal = " << append_seal << std::endl;
   std::cout << "append_stale_view = " << append_stale_view << std::endl;
   std::cout << "append_read_only = " << append_read_only << std::endl;
+  if (options.sequencer_lease_size > 0) {
+    std::cout << "sequencer_lease_fills = " << lease_fills << std::endl;
+  }
+  if (const auto coalescer = backend->coalescer()) {
+    std::cout << "coalesced_writes = " << coalescer->num_writes() << std::endl;
+    std::cout << "coalesced_batches = " << coalescer->num_batches() << std::endl;
+  }
+  if (entry_codec) {
+    const auto stats = entry_codec->stats();
+    std::cout << "codec = " << entry_codec->codec().Name() << std::endl;
+    std::cout << "compress_bytes_in = " << stats.compress_bytes_in << std::endl;
+    std::cout << "compress_bytes_out = " << stats.compress_bytes_out << std::endl;
+    std::cout << "compress_ratio = " << (stats.compress_bytes_out ?
+        (double)stats.compress_bytes_in / stats.compress_bytes_out : 0.0) << std::endl;
+    std::cout << "compress_skipped = " << stats.compress_skipped << std::endl;
+    std::cout << "decompress_bytes_in = " << stats.decompress_bytes_in << std::endl;
+    std::cout << "decompress_bytes_out = " << stats.decompress_bytes_out << std::endl;
+    if (stats.compress_cpu_nanos || stats.decompress_cpu_nanos) {
+      std::cout << "compress_cpu_nanos = " << stats.compress_cpu_nanos << std::endl;
+      std::cout << "decompress_cpu_nanos = " << stats.decompress_cpu_nanos << std::endl;
+    }
+  }
+  if (options.entry_checksums) {
+    std::cout << "read_checksum_failures = " << read_checksum_failures << std::endl;
+    std::cout << "read_checksum_refetches = " << read_checksum_refetches << std::endl;
+  }
+  if (append_window) {
+    const auto stats = append_window->stats();
+    std::cout << "append_window_size = " << stats.size << std::endl;
+    std::cout << "append_window_max_size = " << stats.max_size << std::endl;
+    std::cout << "append_window_held = " << stats.held << std::endl;
+    std::cout << "append_window_held_avg_us = "
+      << (stats.held ? stats.held_us / stats.held : 0) << std::endl;
+  }
+  std::cout << "invalid_range_hits = " << invalid_range_hits << std::endl;
+  std::cout << "invalid_ranges = " << invalid_ranges.size() << std::endl;
+  std::cout << "finisher_threads = " << num_finishers_ << std::endl;
+  if (adaptive_finishers_) {
+    std::cout << "finisher_pool_grows = " << finisher_grows_ << std::endl;
+    std::cout << "finisher_pool_shrinks = " << finisher_shrinks_ << std::endl;
+  }
+  const char *lane_names[NUM_OP_LANES] = {"foreground", "background"};
+  for (size_t i = 0; i < NUM_OP_LANES; i++) {
+    const auto stats = op_queue_.lane_stats(static_cast<OpLane>(i));
+    std::cout << lane_names[i] << "_queue_depth = " << stats.depth << std::endl;
+    std::cout << lane_names[i] << "_queue_ops = " << stats.ops << std::endl;
+    std::cout << lane_names[i] << "_queue_wait_avg_us = "
+      << (stats.ops ? stats.wait_us / stats.ops : 0) << std::endl;
+  }
   std::cout << "======================================" << std::endl;
 }
 
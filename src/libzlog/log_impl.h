@@ -1,15 +1,24 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
 #include <list>
+#include <map>
 #include <mutex>
 #include <thread>
 
 #include "include/zlog/log.h"
 #include "include/zlog/statistics.h"
-#include "libseq/libseqr.h"
 #include "include/zlog/backend.h"
+#include "include/zlog/cache.h"
 #include "striper.h"
 #include "log_backend.h"
+#include "op_pool.h"
+#include "op_queue.h"
+#include "completion_queue.h"
+#include "entry_codec.h"
+#include "reorder_window.h"
+#include "position_watcher.h"
+#include "invalid_ranges.h"
 
 #define DEFAULT_STRIPE_SIZE 100
 
@@ -18,18 +27,172 @@ namespace zlog {
 typedef Backend *(*backend_allocate_t)(void);
 typedef void (*backend_release_t)(Backend*);
 
+// LogOp is the base of all log operations.
+//
+// An op is started with start() and finishes by calling complete() exactly
+// once, which hands the result to the function passed to start(). Ops that
+// only use synchronous interfaces override run() and complete when it
+// returns. Ops that issue asynchronous backend requests override execute()
+// and are structured as state machines: no thread is held while a request is
+// outstanding, and the op is resumed through io_resume() when it completes.
 class LogOp {
  public:
+  typedef void (*done_fn)(LogOp *op, int ret, void *arg);
+
   LogOp(LogImpl *log) :
-    log_(log)
+    log_(log),
+    done_(nullptr),
+    done_arg_(nullptr),
+    io_state_(IO_NONE),
+    io_ret_(0),
+    next_(nullptr),
+    queued_us_(0)
   {}
 
   virtual ~LogOp() {}
-  virtual int run() = 0;
+
+  // begin executing the op. done is invoked with the result when the op
+  // completes, which may happen before start returns or later on another
+  // thread. the op must not be accessed by the caller after done is invoked,
+  // except by done itself.
+  void start(done_fn done, void *arg) {
+    done_ = done;
+    done_arg_ = arg;
+    execute();
+  }
+
   virtual void callback(int ret) = 0;
 
+  // the queue an op waits in for a finisher thread
+  virtual OpLane lane() const {
+    return OP_LANE_FOREGROUND;
+  }
+
+  // ops created with `new (pool) Op(...)` are recycled through the log's op
+  // pool when deleted. a plain `new` uses the global allocator.
+  static void *operator new(size_t size) {
+    return OpPool::allocate_unpooled(size);
+  }
+
+  static void *operator new(size_t size, OpPool& pool) {
+    return pool.allocate(size);
+  }
+
+  static void operator delete(void *p) {
+    OpPool::release(p);
+  }
+
+  static void operator delete(void *p, OpPool& pool) {
+    OpPool::release(p);
+  }
+
  protected:
+  virtual void execute() {
+    complete(run());
+  }
+
+  virtual int run() {
+    assert(0);
+    return -EOPNOTSUPP;
+  }
+
+  // finish the op. this may destroy the op, so it must be the last access to
+  // the op by the caller.
+  void complete(int ret) {
+    done_(this, ret, done_arg_);
+  }
+
+  // issuing an asynchronous backend request follows the pattern:
+  //
+  //   io_begin();
+  //   backend->XAsync(..., [this](int r) { io_complete(r); });
+  //   if (!io_end(&ret)) return; // resumed later in io_resume(ret)
+  //   ... handle ret ...
+  //
+  // a request that completes before the issuing call returns is handled by
+  // the issuer in a loop, rather than recursively from the completion. this
+  // keeps the stack bounded when a backend completes requests synchronously.
+  void io_begin() {
+    io_state_.store(IO_ISSUING);
+  }
+
+  bool io_end(int *pret) {
+    if (io_state_.exchange(IO_RETURNED) == IO_COMPLETED) {
+      *pret = io_ret_;
+      return true;
+    }
+    return false;
+  }
+
+  void io_complete(int ret) {
+    io_ret_ = ret;
+    if (io_state_.exchange(IO_COMPLETED) == IO_RETURNED) {
+      io_resume(ret);
+    }
+  }
+
+  // resume the op after an asynchronous request completes
+  virtual void io_resume(int ret) {
+    assert(0);
+  }
+
   LogImpl *log_;
+
+ private:
+  enum {
+    IO_NONE,
+    IO_ISSUING,
+    IO_COMPLETED,
+    IO_RETURNED,
+  };
+
+  done_fn done_;
+  void *done_arg_;
+
+  std::atomic<int> io_state_;
+  int io_ret_;
+
+  friend class OpQueue;
+  LogOp *next_;
+  uint64_t queued_us_;
+};
+
+// base of ops that target the single log position. the position is mapped to
+// an object, and one backend request is issued against that object. stale
+// views and uninitialized objects are handled by retrying the request.
+class PositionOp : public LogOp {
+ public:
+  PositionOp(LogImpl *log, uint64_t position) :
+    LogOp(log),
+    position_(position)
+  {}
+
+ protected:
+  // issue the backend request for the op
+  virtual void issue(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) = 0;
+
+  // translate the result of a completed backend request
+  virtual int result(int ret) {
+    return ret;
+  }
+
+  // return true to issue the backend request again after a completed request
+  virtual bool retry(int ret) {
+    return false;
+  }
+
+  const uint64_t position_;
+
+ private:
+  void execute() override;
+  void io_resume(int ret) override;
+
+  // returns true if the op completed, or false if it should be retried
+  bool handle(int ret);
+
+  std::shared_ptr<const VersionedView> view_;
+  std::string oid_;
 };
 
 class TailOp : public LogOp {
@@ -37,11 +200,9 @@ class TailOp : public LogOp {
   TailOp(LogImpl *log, bool increment, std::function<void(int, uint64_t)> cb) :
     LogOp(log),
     increment_(increment),
-    cb_(cb)
+    cb_(std::move(cb))
   {}
 
-  int run() override;
-
   void callback(int ret) override {
     if (cb_) {
       cb_(ret, position_);
@@ -49,100 +210,348 @@ class TailOp : public LogOp {
   }
 
  private:
+  int run() override;
+
   bool increment_;
   uint64_t position_;
   std::function<void(int, uint64_t)> cb_;
 };
 
-class TrimOp : public LogOp {
+class TrimOp : public PositionOp {
  public:
   TrimOp(LogImpl *log, uint64_t position, std::function<void(int)> cb) :
-    LogOp(log),
-    position_(position),
-    cb_(cb)
+    PositionOp(log, position),
+    cb_(std::move(cb))
   {}
 
-  int run() override;
-
   void callback(int ret) override {
     if (cb_) {
       cb_(ret);
     }
   }
 
- private:
-  uint64_t position_;
+  OpLane lane() const override {
+    return OP_LANE_BACKGROUND;
+  }
+
+ protected:
+  void issue(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) override;
+
+  int result(int ret) override;
+
   std::function<void(int)> cb_;
 };
 
-class FillOp : public LogOp {
+class FillOp : public PositionOp {
  public:
   FillOp(LogImpl *log, uint64_t position, std::function<void(int)> cb) :
-    LogOp(log),
-    position_(position),
-    cb_(cb)
+    PositionOp(log, position),
+    cb_(std::move(cb))
   {}
 
-  int run() override;
-
   void callback(int ret) override {
     if (cb_) {
       cb_(ret);
     }
   }
 
- private:
-  uint64_t position_;
+  OpLane lane() const override {
+    return OP_LANE_BACKGROUND;
+  }
+
+ protected:
+  void issue(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) override;
+
+  int result(int ret) override;
+
   std::function<void(int)> cb_;
 };
 
-class ReadOp : public LogOp {
+class ReadOp : public PositionOp {
  public:
   ReadOp(LogImpl *log, uint64_t position,
       std::function<void(int, std::string&)> cb) :
-    LogOp(log),
-    position_(position),
-    cb_(cb)
+    PositionOp(log, position),
+    cb_(std::move(cb)),
+    refetches_(0),
+    verified_(false)
   {}
 
-  int run() override;
-
   void callback(int ret) override {
     if (cb_) {
       cb_(ret, data_);
     }
   }
 
- private:
-  uint64_t position_;
+ protected:
+  void issue(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) override;
+
+  int result(int ret) override;
+  bool retry(int ret) override;
+
   std::string data_;
   std::function<void(int, std::string&)> cb_;
+
+ private:
+  // number of times the entry was read again after a checksum mismatch
+  int refetches_;
+  bool verified_;
 };
 
-// TODO: move or copy or reference for the data
 class AppendOp : public LogOp {
  public:
-  AppendOp(LogImpl *log, const std::string& data,
+  AppendOp(LogImpl *log, std::string&& data,
       std::function<void(int, uint64_t)> cb) :
     LogOp(log),
-    data_(data.data(), data.size()),
+    data_(std::move(data)),
+    position_(0),
     position_epoch_(boost::none),
-    cb_(cb)
+    cb_(std::move(cb)),
+    encoded_(false),
+    ordered_(false),
+    windowed_(false)
   {}
 
-  int run() override;
+  void callback(int ret) override;
+
+  // use a position that was reserved for the entry by the sequencer with the
+  // given epoch, rather than obtaining a new position.
+  void assign_position(uint64_t position, uint64_t epoch) {
+    position_ = position;
+    position_epoch_ = epoch;
+  }
+
+  // the entry has already been encoded with the log's codec
+  void set_encoded() {
+    encoded_ = true;
+  }
+
+  // deliver the callback through the log's append window
+  void set_ordered() {
+    ordered_ = true;
+  }
+
+ protected:
+  // write the entry to the object at the current position
+  virtual void write(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb);
+
+  // encode the entry (see LogImpl::encode_entry). called once before the
+  // entry is first written, and only if the log encodes entries.
+  virtual void encode();
+
+  // add the appended entry to the log's cache
+  virtual void cache_entry();
+
+  std::string data_;
+  uint64_t position_;
+  boost::optional<uint64_t> position_epoch_;
+  std::function<void(int, uint64_t)> cb_;
+
+  // the entry before it was encoded, kept for the cache
+  boost::optional<std::string> raw_;
+
+ private:
+  void execute() override;
+  void io_resume(int ret) override;
+
+  // returns true if the op completed. otherwise the write is retried, after
+  // remapping the position if view_ has been reset.
+  bool handle(int ret);
+
+  bool encoded_;
+
+  // ordered_ is set for appends whose callbacks go through the append
+  // window. windowed_ is set once the append holds a position in the window.
+  bool ordered_;
+  bool windowed_;
+  ReorderWindow::Ticket ticket_;
+
+  std::shared_ptr<const VersionedView> view_;
+  std::string oid_;
+};
+
+// append an entry gathered from caller-owned buffers. the buffers must remain
+// valid until the callback has been invoked. when the log encodes entries the
+// buffers are encoded into a single entry and the entry is written instead.
+class GatherAppendOp : public AppendOp {
+ public:
+  GatherAppendOp(LogImpl *log, const std::vector<Slice>& data,
+      std::function<void(int, uint64_t)> cb) :
+    AppendOp(log, std::string(), std::move(cb)),
+    slices_(data)
+  {}
+
+ private:
+  void write(const std::string& oid, uint64_t epoch,
+      std::function<void(int)> cb) override;
+
+  void encode() override;
+  void cache_entry() override;
+
+  const std::vector<Slice> slices_;
+};
+
+// append a batch of entries. positions for the whole batch are reserved at
+// once, and the entries are split into groups by the object they map to. each
+// group is written by a BatchGroupOp, and the batch completes when every group
+// has completed.
+class AppendBatchOp : public LogOp {
+ public:
+  AppendBatchOp(LogImpl *log, std::vector<std::string>&& entries,
+      std::function<void(int, std::vector<uint64_t>&)> cb) :
+    LogOp(log),
+    entries_(std::move(entries)),
+    position_epoch_(boost::none),
+    ret_(0),
+    pending_groups_(0),
+    cb_(std::move(cb))
+  {}
 
   void callback(int ret) override {
     if (cb_) {
-      cb_(ret, position_);
+      cb_(ret, positions_);
     }
   }
 
  private:
-  std::string data_;
-  uint64_t position_;
+  friend class BatchGroupOp;
+
+  void execute() override;
+
+  // record the result of a group or entry. the first error is kept.
+  void set_result(int ret);
+  void group_done();
+
+  // add an entry that has been written to the log's cache
+  void cache_entry(size_t index, uint64_t position);
+
+  std::vector<std::string> entries_;
+  // the entries before they were encoded, kept for the cache
+  std::vector<std::string> raw_entries_;
+  std::vector<uint64_t> positions_;
   boost::optional<uint64_t> position_epoch_;
-  std::function<void(int, uint64_t)> cb_;
+  std::atomic<int> ret_;
+  std::atomic<size_t> pending_groups_;
+  std::function<void(int, std::vector<uint64_t>&)> cb_;
+};
+
+// write the entries of an AppendBatchOp that map to the same object. the
+// writes are issued together, and entries that fail are retried individually
+// with an AppendOp.
+class BatchGroupOp : public LogOp {
+ public:
+  BatchGroupOp(LogImpl *log, AppendBatchOp *batch, uint64_t epoch,
+      std::string oid, std::vector<size_t>&& entries) :
+    LogOp(log),
+    batch_(batch),
+    epoch_(epoch),
+    oid_(std::move(oid)),
+    entries_(std::move(entries)),
+    pending_(0)
+  {}
+
+  void callback(int ret) override {
+    batch_->set_result(ret);
+    batch_->group_done();
+  }
+
+ private:
+  void execute() override;
+
+  // called once for each write, and once more by execute after all of the
+  // writes have been issued. returns true on the last call.
+  bool put_pending() {
+    return pending_.fetch_sub(1) == 1;
+  }
+
+  void writes_done();
+
+  AppendBatchOp *batch_;
+  const uint64_t epoch_;
+  const std::string oid_;
+  const std::vector<size_t> entries_;
+  // result of the write of each entry
+  std::vector<int> results_;
+  std::atomic<size_t> pending_;
+};
+
+// read the positions [start, end). the positions are grouped by the object
+// they map to using the geometry of the stripes that map them, and each group
+// is read by a ReadGroupOp. the range completes when every group has
+// completed.
+class ReadRangeOp : public LogOp {
+ public:
+  ReadRangeOp(LogImpl *log, uint64_t start, uint64_t end,
+      std::function<void(int, std::vector<LogEntry>&)> cb) :
+    LogOp(log),
+    start_(start),
+    end_(end),
+    pending_groups_(0),
+    cb_(std::move(cb))
+  {}
+
+  void callback(int ret) override {
+    if (cb_) {
+      cb_(ret, entries_);
+    }
+  }
+
+ private:
+  friend class ReadGroupOp;
+
+  void execute() override;
+
+  void group_done();
+
+  const uint64_t start_;
+  const uint64_t end_;
+  std::vector<LogEntry> entries_;
+  std::atomic<size_t> pending_groups_;
+  std::function<void(int, std::vector<LogEntry>&)> cb_;
+};
+
+// read the positions of a ReadRangeOp that map to the same object with one
+// backend request. positions that can't be read from the group's view (e.g.
+// the object hasn't been initialized, or the view is stale) are retried
+// individually with a ReadOp.
+class ReadGroupOp : public LogOp {
+ public:
+  ReadGroupOp(LogImpl *log, ReadRangeOp *range, uint64_t epoch,
+      std::string oid, std::vector<size_t>&& entries) :
+    LogOp(log),
+    range_(range),
+    epoch_(epoch),
+    oid_(std::move(oid)),
+    entries_(std::move(entries)),
+    pending_(0)
+  {}
+
+  void callback(int ret) override {
+    range_->group_done();
+  }
+
+ private:
+  void execute() override;
+
+  void reads_done();
+
+  bool put_pending() {
+    return pending_.fetch_sub(1) == 1;
+  }
+
+  ReadRangeOp *range_;
+  const uint64_t epoch_;
+  const std::string oid_;
+  // indices into the range's entries
+  const std::vector<size_t> entries_;
+  std::vector<uint64_t> positions_;
+  std::vector<std::string> data_;
+  std::vector<int> results_;
+  std::atomic<size_t> pending_;
 };
 
 class TrimToOp : public LogOp {
@@ -150,22 +559,101 @@ class TrimToOp : public LogOp {
   TrimToOp(LogImpl *log, uint64_t position, std::function<void(int)> cb) :
     LogOp(log),
     position_(position),
-    cb_(cb)
+    cb_(std::move(cb))
   {}
 
-  int run() override;
-
   void callback(int ret) override {
     if (cb_) {
       cb_(ret);
     }
   }
 
+  OpLane lane() const override {
+    return OP_LANE_BACKGROUND;
+  }
+
  private:
+  int run() override;
+
   const uint64_t position_;
   std::function<void(int)> cb_;
 };
 
+// variants of the ops above that deliver their result to a completion queue
+// rather than invoking a callback.
+class CQAppendOp : public AppendOp {
+ public:
+  CQAppendOp(LogImpl *log, std::string&& data, CompletionQueueImpl *cq,
+      uint64_t cookie) :
+    AppendOp(log, std::move(data), nullptr),
+    cq_(cq),
+    cookie_(cookie)
+  {}
+
+  void callback(int ret) override {
+    cq_->complete(LogRequest::APPEND, cookie_, ret, position_, nullptr);
+  }
+
+ private:
+  CompletionQueueImpl *cq_;
+  const uint64_t cookie_;
+};
+
+class CQReadOp : public ReadOp {
+ public:
+  CQReadOp(LogImpl *log, uint64_t position, CompletionQueueImpl *cq,
+      uint64_t cookie) :
+    ReadOp(log, position, nullptr),
+    cq_(cq),
+    cookie_(cookie)
+  {}
+
+  void callback(int ret) override {
+    cq_->complete(LogRequest::READ, cookie_, ret, position_,
+        ret ? nullptr : &data_);
+  }
+
+ private:
+  CompletionQueueImpl *cq_;
+  const uint64_t cookie_;
+};
+
+class CQFillOp : public FillOp {
+ public:
+  CQFillOp(LogImpl *log, uint64_t position, CompletionQueueImpl *cq,
+      uint64_t cookie) :
+    FillOp(log, position, nullptr),
+    cq_(cq),
+    cookie_(cookie)
+  {}
+
+  void callback(int ret) override {
+    cq_->complete(LogRequest::FILL, cookie_, ret, position_, nullptr);
+  }
+
+ private:
+  CompletionQueueImpl *cq_;
+  const uint64_t cookie_;
+};
+
+class CQTrimOp : public TrimOp {
+ public:
+  CQTrimOp(LogImpl *log, uint64_t position, CompletionQueueImpl *cq,
+      uint64_t cookie) :
+    TrimOp(log, position, nullptr),
+    cq_(cq),
+    cookie_(cookie)
+  {}
+
+  void callback(int ret) override {
+    cq_->complete(LogRequest::TRIM, cookie_, ret, position_, nullptr);
+  }
+
+ private:
+  CompletionQueueImpl *cq_;
+  const uint64_t cookie_;
+};
+
 class LogImpl : public Log {
  public:
   LogImpl(const LogImpl&) = delete;
@@ -187,15 +675,68 @@ class LogImpl : public Log {
  public:
   int Read(uint64_t position, std::string *data) override;
   int Append(const std::string& data, uint64_t *pposition) override;
+  int Append(std::string&& data, uint64_t *pposition) override;
+  int Append(const char *data, size_t size, uint64_t *pposition) override;
+  int Append(const std::vector<Slice>& data, uint64_t *pposition) override;
+  int AppendBatch(std::vector<std::string>&& entries,
+      std::vector<uint64_t> *positions) override;
   int Fill(uint64_t position) override;
   int Trim(uint64_t position) override;
 
  public:
-  void finisher_entry_();
-  std::vector<std::thread> finishers_;
-  std::condition_variable finishers_cond_;
-  std::list<std::unique_ptr<LogOp>> pending_ops_;
+  struct Finisher {
+    std::thread thread;
+    // set to ask the thread to exit when the pool shrinks
+    std::atomic<bool> retire;
+
+    Finisher() : retire(false) {}
+  };
+
+  // cap the background ops that may run with the given number of finishers
+  void set_background_limit(int threads);
+
+  void finisher_entry_(Finisher *finisher, size_t home);
+  void start_finisher(size_t home);
+  // the first num_finishers_ entries are running. with an adaptive pool there
+  // is an entry for each thread up to max_finisher_threads.
+  std::vector<std::unique_ptr<Finisher>> finishers_;
+  std::atomic<int> num_finishers_;
+
+  // adaptive finisher pool
+  void finisher_adapt_entry_();
+  void adapt_finishers(uint64_t interval_us);
+  const bool adaptive_finishers_;
+  int min_finishers_;
+  int max_finishers_;
+  std::thread finisher_adapt_thread_;
+  std::mutex finisher_adapt_lock_;
+  std::condition_variable finisher_adapt_cond_;
+  bool finisher_adapt_stop_;
+  std::atomic<uint64_t> finisher_busy_us_;
+  std::atomic<uint64_t> finisher_grows_;
+  std::atomic<uint64_t> finisher_shrinks_;
+  // previous sample of the queue, used for deltas
+  uint64_t last_queue_ops_;
+  uint64_t last_queue_wait_us_;
+  uint64_t last_busy_us_;
+  OpPool op_pool_;
+  OpQueue op_queue_;
   void queue_op(std::unique_ptr<LogOp> op);
+  // queue an op on behalf of an in-flight op. the op is counted as in-flight,
+  // but never waits for the in-flight limit, which the parent op may be
+  // holding up.
+  void queue_child_op(std::unique_ptr<LogOp> op);
+  void reserve_op();
+  bool try_reserve_op();
+  void finish_op();
+
+  // run the op and its callback on the calling thread, waiting for any
+  // asynchronous backend requests. the caller must have reserved an in-flight
+  // slot with try_reserve_op, which is released here.
+  void run_inline(LogOp& op);
+
+  // completion of ops started by a finisher thread
+  static void finish_queued_op(LogOp *op, int ret, void *arg);
 
   int tailAsync(bool increment, std::function<void(int, uint64_t)> cb);
   int tailAsync(std::function<void(int, uint64_t)> cb) override {
@@ -203,13 +744,37 @@ class LogImpl : public Log {
   }
   int appendAsync(const std::string& data,
       std::function<void(int, uint64_t position)> cb) override;
+  int appendAsync(std::string&& data,
+      std::function<void(int, uint64_t position)> cb) override;
+  int appendAsync(const char *data, size_t size,
+      std::function<void(int, uint64_t position)> cb) override;
+  int appendAsync(const std::vector<Slice>& data,
+      std::function<void(int, uint64_t position)> cb) override;
+  int appendBatchAsync(std::vector<std::string>&& entries,
+      std::function<void(int, std::vector<uint64_t>&)> cb) override;
   int readAsync(uint64_t position,
       std::function<void(int, std::string&)> cb) override;
+  int ReadRange(uint64_t start, uint64_t end,
+      std::vector<LogEntry> *entries) override;
+  int readRangeAsync(uint64_t start, uint64_t end,
+      std::function<void(int, std::vector<LogEntry>&)> cb) override;
   int fillAsync(uint64_t position, std::function<void(int)> cb) override;
   int trimAsync(uint64_t position, std::function<void(int)> cb) override;
   int trimTo(uint64_t position) override;
   int trimToAsync(uint64_t position, std::function<void(int)> cb) override;
 
+  int Submit(CompletionQueue *cq, std::vector<LogRequest>& requests) override;
+
+  int WaitForPosition(uint64_t position, int timeout_ms) override;
+  int Subscribe(uint64_t position, std::function<void(LogEntry&)> cb,
+      uint64_t *subscription) override;
+  int Unsubscribe(uint64_t subscription) override;
+
+  // answer a read without a backend request, from the index of invalid
+  // positions or from the cache. returns true if the read was answered, with
+  // its result in ret.
+  bool local_read(uint64_t position, std::string *data, int *ret);
+
  public:
   int StripeWidth() override {
     assert(0);
@@ -224,10 +789,41 @@ class LogImpl : public Log {
   std::atomic<uint64_t> append_stale_view;
   std::atomic<uint64_t> append_read_only;
 
+  std::atomic<uint64_t> read_checksum_failures;
+  std::atomic<uint64_t> read_checksum_refetches;
+  std::atomic<uint64_t> invalid_range_hits;
+
   void PrintStats() override;
 
  public:
-  bool shutdown;
+  // entries are encoded when they are compressed or checksummed. an encoded
+  // entry is the entry compressed by the codec (if any), followed by the
+  // crc32c of the compressed entry (if checksums are enabled).
+  bool encode_entries() const {
+    return entry_codec || options.entry_checksums;
+  }
+
+  void encode_entry(const Slice *data, size_t count, std::string *entry);
+  void encode_entry(std::string *entry);
+
+  // encode a batch of entries in place. checksums for the batch are computed
+  // together, which is faster than computing them one at a time.
+  void encode_entries(std::vector<std::string>& entries);
+
+  // check an entry read from the backend against its checksum
+  bool verify_entry(const std::string& entry) const;
+
+  // check a batch of entries read from the backend. verified[i] is set if
+  // results[i] is zero and entries[i] matches its checksum. the checksums are
+  // computed together.
+  void verify_entries(const std::string *entries, const int *results,
+      size_t count, std::vector<bool> *verified) const;
+
+  // decode an entry read from the backend in place, applying the checksum
+  // policy. verified is true if the checksum has already been checked.
+  int decode_entry(std::string *entry, bool verified);
+
+ public:
   std::mutex lock;
 
   // thread-safe
@@ -241,11 +837,106 @@ class LogImpl : public Log {
   uint64_t exclusive_position;
   bool exclusive_empty;
 
-  uint32_t num_inflight_ops_;
+  // in-flight ops are counted without the log lock. the lock is only taken
+  // when the limit is reached and submitters need to wait.
+  std::atomic<uint32_t> num_inflight_ops_;
+  std::atomic<uint32_t> num_queue_op_waiters_;
   std::list<std::pair<bool,
     std::condition_variable*>> queue_op_waiters_;
 
+  // set in num_inflight_ops_ by the destructor, which then waits for the ops
+  // that are still in flight. no new ops are admitted once it is set.
+  static const uint32_t kDrainingOps = 1u << 31;
+  std::mutex drain_lock_;
+  std::condition_variable drain_cond_;
+  bool drained_;
+
   const Options options;
+
+  // null when entries are not compressed
+  const std::unique_ptr<EntryCodec> entry_codec;
+
+  // null unless append callbacks are ordered
+  const std::unique_ptr<ReorderWindow> append_window;
+
+  // null when the cache is disabled
+  const std::unique_ptr<Cache> cache;
+
+  // positions known to be filled or trimmed, including those below the
+  // min_valid_position of the latest view that has been seen
+  InvalidRanges invalid_ranges;
+
+  // hand the callback of an append in the append window to the window. the
+  // append's in-flight op slot is kept until the callback is delivered.
+  void complete_ordered_append(ReorderWindow::Ticket ticket, int ret,
+      std::function<void(int, uint64_t)> cb);
+
+  // handle an error returned by the sequencer of view. returns true if the
+  // request should be retried with the current view.
+  bool retry_sequencer(const VersionedView& view, int ret);
+
+  // leased positions that are left unused by a sequencer that has been
+  // replaced, or by this instance's sequencer when the log is closed or a
+  // lease is idle, are filled by a background thread. the thread only runs
+  // when leasing is enabled.
+  void fill_leases(std::vector<std::pair<uint64_t, uint64_t>>& ranges);
+  void lease_fill_entry_();
+  std::mutex lease_fill_lock_;
+  std::condition_variable lease_fill_cond_;
+  std::list<std::pair<uint64_t, uint64_t>> lease_fill_queue_;
+  bool lease_fill_stop_;
+  std::thread lease_fill_thread_;
+  std::atomic<uint64_t> lease_fills;
+
+ public:
+  // notified when ops of this log write, fill or trim positions, and by the
+  // backend when other clients change the log
+  PositionWatcher position_watcher;
+
+  // wait for the position to be written and then read it. returns the result
+  // of the read, -ETIMEDOUT at the deadline (if any), or -ECANCELED if the
+  // waiter is cancelled. the waiter must be registered for the position.
+  int wait_and_read(PositionWatcher::Waiter& waiter, uint64_t position,
+      const std::chrono::steady_clock::time_point *deadline,
+      std::string *data);
+
+  // watch the backend for changes by other clients. the watch is started the
+  // first time a position is waited on. returns true if the backend supports
+  // watches.
+  bool start_watch();
+  std::mutex watch_lock_;
+  bool watch_started_;
+  bool backend_watch_;
+  uint64_t watch_cookie_;
+
+  struct Subscription {
+    uint64_t position;
+    std::function<void(LogEntry&)> cb;
+    std::unique_ptr<PositionWatcher::Waiter> waiter;
+    // when the position is read again without a notification
+    std::chrono::steady_clock::time_point next_read;
+    std::chrono::microseconds poll_delay;
+    bool cancelled;
+  };
+
+  // all of the log's subscriptions are delivered by one thread, started by
+  // the first Subscribe. a subscription's position is read again when the
+  // position watcher notifies it, or when a poll or a retry is due.
+  void subscription_entry_();
+  bool deliver_subscription_(Subscription& sub, bool watched);
+  void wake_subscriptions_();
+  std::mutex subscriptions_lock_;
+  std::condition_variable subscriptions_cond_;
+  uint64_t next_subscription_;
+  bool subscriptions_stop_;
+  Subscription *running_subscription_;
+  std::map<uint64_t, std::shared_ptr<Subscription>> subscriptions_;
+  std::thread subscription_thread_;
+
+  // taken by notifications, with the position watcher locked
+  std::mutex subscription_wake_lock_;
+  std::condition_variable subscription_wake_cond_;
+  bool subscription_wake_;
 };
 
 int create_or_open(const Options& options,
@@ -0,0 +1,87 @@
+#include "op_pool.h"
+#include <cassert>
+#include <new>
+
+namespace zlog {
+
+// padded so that the memory following the header is suitably aligned for any
+// object type.
+struct alignas(alignof(std::max_align_t)) OpPool::Header {
+  OpPool *pool;
+};
+
+OpPool::OpPool(const size_t block_size, const size_t max_free) :
+  block_size_(block_size),
+  max_free_(max_free)
+{
+  // releasing a block never allocates
+  free_.reserve(max_free_);
+}
+
+OpPool::~OpPool()
+{
+  for (auto header : free_) {
+    ::operator delete(header);
+  }
+}
+
+void *OpPool::allocate(const size_t size)
+{
+  if (size > block_size_) {
+    return allocate_unpooled(size);
+  }
+
+  Header *header = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (!free_.empty()) {
+      header = free_.back();
+      free_.pop_back();
+    }
+  }
+
+  if (!header) {
+    header = static_cast<Header*>(
+        ::operator new(sizeof(Header) + block_size_));
+  }
+
+  header->pool = this;
+
+  return header + 1;
+}
+
+void *OpPool::allocate_unpooled(const size_t size)
+{
+  auto header = static_cast<Header*>(::operator new(sizeof(Header) + size));
+  header->pool = nullptr;
+  return header + 1;
+}
+
+void OpPool::release(void *p)
+{
+  if (!p) {
+    return;
+  }
+
+  auto header = static_cast<Header*>(p) - 1;
+  if (header->pool) {
+    header->pool->free_block(header);
+  } else {
+    ::operator delete(header);
+  }
+}
+
+void OpPool::free_block(Header *header)
+{
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (free_.size() < max_free_) {
+      free_.push_back(header);
+      return;
+    }
+  }
+
+  ::operator delete(header);
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace zlog {
+
+/**
+ * OpPool recycles the memory backing log operations.
+ *
+ * Every asynchronous operation is a heap object that lives from submission
+ * until its callback has run. Rather than returning that memory to the system
+ * allocator, freed blocks are kept on a free list owned by the log and reused
+ * by the next submission. Blocks are a fixed size, large enough for any of the
+ * log's op types. Larger requests, and requests made without a pool, are
+ * served by the global allocator.
+ *
+ * Each block is prefixed by a small header recording its owning pool, so that
+ * release() can be called without knowing where the memory came from.
+ */
+class OpPool final {
+ public:
+  OpPool(size_t block_size, size_t max_free);
+
+  OpPool(const OpPool& other) = delete;
+  OpPool(OpPool&& other) = delete;
+  OpPool& operator=(const OpPool& other) = delete;
+  OpPool& operator=(OpPool&& other) = delete;
+
+  ~OpPool();
+
+ public:
+  // allocate size bytes, from the pool when possible
+  void *allocate(size_t size);
+
+  // allocate size bytes from the global allocator. the memory may still be
+  // returned with release().
+  static void *allocate_unpooled(size_t size);
+
+  // free memory returned by allocate() or allocate_unpooled()
+  static void release(void *p);
+
+ private:
+  struct Header;
+
+  void free_block(Header *header);
+
+  const size_t block_size_;
+  const size_t max_free_;
+
+  std::mutex lock_;
+  std::vector<Header*> free_;
+};
+
+}
@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include "libzlog/op_pool.h"
+
+TEST(OpPoolTest, ReusesBlocks) {
+  zlog::OpPool pool(64, 2);
+
+  auto a = pool.allocate(64);
+  auto b = pool.allocate(32);
+  ASSERT_NE(a, b);
+
+  zlog::OpPool::release(a);
+  zlog::OpPool::release(b);
+
+  // the free list is lifo
+  ASSERT_EQ(pool.allocate(16), b);
+  ASSERT_EQ(pool.allocate(64), a);
+
+  zlog::OpPool::release(a);
+  zlog::OpPool::release(b);
+}
+
+TEST(OpPoolTest, MaxFree) {
+  zlog::OpPool pool(64, 1);
+
+  auto a = pool.allocate(64);
+  auto b = pool.allocate(64);
+
+  zlog::OpPool::release(a);
+  zlog::OpPool::release(b);
+
+  // only one block is retained
+  ASSERT_EQ(pool.allocate(64), a);
+  auto c = pool.allocate(64);
+
+  zlog::OpPool::release(a);
+  zlog::OpPool::release(c);
+}
+
+TEST(OpPoolTest, Unpooled) {
+  zlog::OpPool pool(64, 1);
+
+  // oversized requests bypass the pool
+  auto a = pool.allocate(65);
+  zlog::OpPool::release(a);
+  auto b = pool.allocate(64);
+  zlog::OpPool::release(b);
+  ASSERT_EQ(pool.allocate(64), b);
+  zlog::OpPool::release(b);
+
+  auto c = zlog::OpPool::allocate_unpooled(8);
+  zlog::OpPool::release(c);
+  ASSERT_EQ(pool.allocate(64), b);
+  zlog::OpPool::release(b);
+
+  zlog::OpPool::release(nullptr);
+}
@@ -0,0 +1,342 @@
+#include "op_queue.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include "log_impl.h"
+#include "monitoring/statistics.h"
+#include "port/port_posix.h"
+#include "util/random.h"
+
+namespace zlog {
+
+static const uint32_t histogram_wait[NUM_OP_LANES] = {
+  FOREGROUND_QUEUE_WAIT_MICROS,
+  BACKGROUND_QUEUE_WAIT_MICROS,
+};
+
+static inline uint64_t now_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+OpQueue::OpQueue(const size_t num_shards, const uint32_t foreground_weight,
+    const uint32_t background_weight, Statistics *statistics) :
+  weights_{std::max(foreground_weight, 1u), std::max(background_weight, 1u)},
+  statistics_(statistics),
+  sleepers_(0),
+  shutdown_(false),
+  running_background_(0),
+  background_limit_(0)
+{
+  assert(num_shards > 0);
+  for (size_t i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new Shard());
+  }
+  for (size_t i = 0; i < NUM_OP_LANES; i++) {
+    lane_ops_[i] = 0;
+    lane_wait_us_[i] = 0;
+  }
+}
+
+OpQueue::~OpQueue()
+{
+  for (auto& shard : shards_) {
+    assert(shard->empty());
+    assert(shard->sleepers == 0);
+    (void)shard;
+  }
+}
+
+size_t OpQueue::producer_shard() const
+{
+  const int cpuid = port::PhysicalCoreID();
+  if (cpuid < 0) {
+    return Random::GetTLSInstance()->Uniform(shards_.size());
+  }
+  return static_cast<size_t>(cpuid) % shards_.size();
+}
+
+void OpQueue::push(std::unique_ptr<LogOp> op)
+{
+  const auto index = producer_shard();
+  auto& shard = *shards_[index];
+
+  {
+    auto raw = op.release();
+    assert(!raw->next_);
+    const auto lane_id = raw->lane();
+    assert(lane_id < NUM_OP_LANES);
+    auto& lane = shard.lanes[lane_id];
+    raw->queued_us_ = now_us();
+    std::lock_guard<std::mutex> lk(shard.lock);
+    if (lane.tail) {
+      lane.tail->next_ = raw;
+    } else {
+      lane.head = raw;
+    }
+    lane.tail = raw;
+    lane.size++;
+    if (shard.sleepers > 0) {
+      shard.cond.notify_one();
+      return;
+    }
+  }
+
+  // no consumer is sleeping on the target shard. if a consumer elsewhere is
+  // idle then hand it the op rather than waiting for the busy home consumers.
+  // this check must come after the op is published in the shard: a consumer
+  // going to sleep advertises itself _before_ its final scan for work.
+  if (sleepers_.load() > 0) {
+    wake_one(index + 1);
+  }
+}
+
+void OpQueue::wake_one(const size_t start)
+{
+  for (size_t i = 0; i < shards_.size(); i++) {
+    auto& shard = *shards_[(start + i) % shards_.size()];
+    std::lock_guard<std::mutex> lk(shard.lock);
+    if (shard.kicks < shard.sleepers) {
+      shard.kicks++;
+      shard.cond.notify_one();
+      return;
+    }
+  }
+}
+
+bool OpQueue::try_pop_lane(const size_t home, const OpLane lane_id,
+    std::unique_ptr<LogOp>& op)
+{
+  for (size_t i = 0; i < shards_.size(); i++) {
+    auto& shard = *shards_[(home + i) % shards_.size()];
+    auto& lane = shard.lanes[lane_id];
+    if (lane.size.load() == 0) {
+      continue;
+    }
+    LogOp *raw;
+    {
+      std::lock_guard<std::mutex> lk(shard.lock);
+      raw = lane.head;
+      if (!raw) {
+        continue;
+      }
+      lane.head = raw->next_;
+      if (!lane.head) {
+        lane.tail = nullptr;
+      }
+      raw->next_ = nullptr;
+      lane.size--;
+    }
+
+    const auto now = now_us();
+    const auto wait_us = now > raw->queued_us_ ? now - raw->queued_us_ : 0;
+    lane_ops_[lane_id]++;
+    lane_wait_us_[lane_id] += wait_us;
+    MeasureTime(statistics_, histogram_wait[lane_id], wait_us);
+
+    op.reset(raw);
+    return true;
+  }
+  return false;
+}
+
+bool OpQueue::reserve_background()
+{
+  // ops are drained after shutdown without being run
+  auto running = running_background_.load();
+  while (true) {
+    const auto limit = background_limit_.load();
+    if (limit && running >= limit && !shutdown_.load()) {
+      return false;
+    }
+    if (running_background_.compare_exchange_weak(running, running + 1)) {
+      return true;
+    }
+  }
+}
+
+bool OpQueue::runnable(const Shard& shard) const
+{
+  if (shard.lanes[OP_LANE_FOREGROUND].head) {
+    return true;
+  }
+  if (!shard.lanes[OP_LANE_BACKGROUND].head) {
+    return false;
+  }
+  const auto limit = background_limit_.load();
+  return !limit || running_background_.load() < limit || shutdown_.load();
+}
+
+void OpQueue::pass_on(const size_t home)
+{
+  if (sleepers_.load() == 0) {
+    return;
+  }
+
+  // the producers of the remaining ops may have woken only this consumer
+  bool waiting = lane_stats(OP_LANE_FOREGROUND).depth > 0;
+  if (!waiting && lane_stats(OP_LANE_BACKGROUND).depth > 0) {
+    const auto limit = background_limit_.load();
+    waiting = !limit || running_background_.load() < limit;
+  }
+
+  if (waiting) {
+    wake_one(home + 1);
+  }
+}
+
+bool OpQueue::try_pop(const size_t home, std::unique_ptr<LogOp>& op)
+{
+  // each round of (foreground + background weight) turns on the home shard
+  // prefers the foreground lane for foreground weight turns. the other lane
+  // is used when the preferred lane is empty.
+  auto& shard = *shards_[home % shards_.size()];
+  const auto turn = shard.turn.fetch_add(1, std::memory_order_relaxed) %
+    (weights_[OP_LANE_FOREGROUND] + weights_[OP_LANE_BACKGROUND]);
+  const auto preferred = turn < weights_[OP_LANE_FOREGROUND] ?
+    OP_LANE_FOREGROUND : OP_LANE_BACKGROUND;
+  const auto other = preferred == OP_LANE_FOREGROUND ?
+    OP_LANE_BACKGROUND : OP_LANE_FOREGROUND;
+
+  // a background op is only taken when it can be run
+  auto pop_lane = [&](const OpLane lane) {
+    if (lane == OP_LANE_FOREGROUND) {
+      return try_pop_lane(home, lane, op);
+    }
+    if (!reserve_background()) {
+      return false;
+    }
+    if (try_pop_lane(home, lane, op)) {
+      return true;
+    }
+    running_background_--;
+    return false;
+  };
+
+  return pop_lane(preferred) || pop_lane(other);
+}
+
+std::unique_ptr<LogOp> OpQueue::pop(const size_t home, bool *pshutdown,
+    const std::atomic<bool> *cancel)
+{
+  auto& shard = *shards_[home % shards_.size()];
+
+  while (true) {
+    if (cancel && cancel->load()) {
+      return nullptr;
+    }
+
+    std::unique_ptr<LogOp> op;
+    if (try_pop(home, op)) {
+      *pshutdown = shutdown_.load();
+      pass_on(home);
+      return op;
+    }
+
+    if (shutdown_) {
+      return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lk(shard.lock);
+    shard.sleepers++;
+    sleepers_++;
+
+    // final scan after advertising as a sleeper. pairs with the check in
+    // push() so that either this scan sees the new op, or the producer sees
+    // this consumer and wakes it up.
+    lk.unlock();
+    const bool found = try_pop(home, op);
+    lk.lock();
+
+    if (!found) {
+      shard.cond.wait(lk, [&] {
+        return runnable(shard) || shard.kicks > 0 || shutdown_ ||
+          (cancel && cancel->load());
+      });
+    }
+
+    bool kicked = false;
+    if (shard.kicks > 0) {
+      shard.kicks--;
+      kicked = true;
+    }
+    shard.sleepers--;
+    sleepers_--;
+
+    if (found) {
+      lk.unlock();
+      *pshutdown = shutdown_.load();
+      pass_on(home);
+      return op;
+    }
+
+    // a cancelled consumer may have taken a wakeup meant for a new op. pass
+    // it on to another sleeper so the op isn't stranded.
+    if (cancel && cancel->load()) {
+      const bool pass_on = kicked || !shard.empty();
+      lk.unlock();
+      if (pass_on && sleepers_.load() > 0) {
+        wake_one(home);
+      }
+      return nullptr;
+    }
+  }
+}
+
+void OpQueue::finished(const OpLane lane)
+{
+  if (lane != OP_LANE_BACKGROUND) {
+    return;
+  }
+
+  assert(running_background_ > 0);
+  running_background_--;
+
+  // a background op may be waiting for the slot. as in push(), this check
+  // comes after the slot is released: a consumer going to sleep advertises
+  // itself before its final scan for work.
+  if (sleepers_.load() > 0 && lane_stats(OP_LANE_BACKGROUND).depth > 0) {
+    wake_one(0);
+  }
+}
+
+void OpQueue::set_background_limit(const size_t limit)
+{
+  background_limit_ = limit;
+  if (sleepers_.load() > 0) {
+    wake_all();
+  }
+}
+
+void OpQueue::wake_all()
+{
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lk(shard->lock);
+    shard->cond.notify_all();
+  }
+}
+
+OpQueue::LaneStats OpQueue::lane_stats(const OpLane lane) const
+{
+  assert(lane < NUM_OP_LANES);
+  LaneStats stats;
+  stats.depth = 0;
+  for (const auto& shard : shards_) {
+    stats.depth += shard->lanes[lane].size.load();
+  }
+  stats.ops = lane_ops_[lane].load();
+  stats.wait_us = lane_wait_us_[lane].load();
+  return stats;
+}
+
+void OpQueue::shutdown()
+{
+  shutdown_ = true;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lk(shard->lock);
+    shard->cond.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace zlog {
+
+class LogOp;
+class Statistics;
+
+// scheduling class of an op. foreground ops are on the latency-sensitive
+// path of clients (append, read, tail). background ops are maintenance
+// requests such as trim and fill that may be issued in large numbers.
+enum OpLane : uint8_t {
+  OP_LANE_FOREGROUND = 0,
+  OP_LANE_BACKGROUND,
+  NUM_OP_LANES,
+};
+
+/**
+ * OpQueue connects the threads submitting log operations to the finisher
+ * threads that run them.
+ *
+ * The queue is split into shards, each with its own lock. Producers push onto
+ * the shard associated with the core they are running on, so concurrent
+ * producers on different cores rarely touch the same lock. Each consumer has a
+ * home shard that it drains first before stealing from the other shards.
+ *
+ * Each shard holds one fifo per lane, an intrusive list threaded through the
+ * ops themselves, so queueing an op never allocates. When both lanes have
+ * waiting ops, consumers pick between them in proportion to the lane weights,
+ * so a burst of background ops (e.g. a trimTo over a large log) delays
+ * foreground ops by a bounded amount. A lane with no waiting ops doesn't
+ * hold back the other lane. The weights only order dequeues, so the number of
+ * background ops that have been dequeued and haven't finished is also capped
+ * (set_background_limit). Otherwise a few background ops that each hold a
+ * consumer for a long time (e.g. a synchronous trimTo walk) could occupy
+ * every consumer.
+ *
+ * Wakeups are targeted: a push wakes at most one sleeping consumer, preferring
+ * a consumer sleeping on the shard that received the op. Consumers advertise
+ * that they are about to sleep before a final scan of all shards, and producers
+ * check for sleepers after publishing an op, so an op can't be stranded while
+ * an idle consumer sleeps. A consumer that takes an op while more runnable ops
+ * are waiting passes a wakeup on to another sleeper, since the op may hold it
+ * for a long time.
+ */
+class OpQueue final {
+ public:
+  // statistics, if not null, receives the per-lane queue wait times.
+  explicit OpQueue(size_t num_shards, uint32_t foreground_weight = 1,
+      uint32_t background_weight = 1, Statistics *statistics = nullptr);
+
+  OpQueue(const OpQueue& other) = delete;
+  OpQueue(OpQueue&& other) = delete;
+  OpQueue& operator=(const OpQueue& other) = delete;
+  OpQueue& operator=(OpQueue&& other) = delete;
+
+  ~OpQueue();
+
+ public:
+  // add an op to the queue.
+  void push(std::unique_ptr<LogOp> op);
+
+  // remove an op from the queue, blocking until one is available. the shard
+  // with index `home` (modulo the number of shards) is checked first. after
+  // shutdown() is called, remaining ops continue to be returned and *pshutdown
+  // is set to true. nullptr is returned once the queue is shutdown and empty.
+  // if cancel is not null, nullptr is also returned once *cancel is set and
+  // the consumer has been woken with wake_all().
+  std::unique_ptr<LogOp> pop(size_t home, bool *pshutdown,
+      const std::atomic<bool> *cancel = nullptr);
+
+  // called when an op returned by pop() has finished. a background op counts
+  // against the background limit until then.
+  void finished(OpLane lane);
+
+  // the maximum number of background ops that may be running. zero means no
+  // limit.
+  void set_background_limit(size_t limit);
+
+  // wake up all sleeping consumers so that they observe cancellation.
+  void wake_all();
+
+  // wake up all consumers and drain the queue.
+  void shutdown();
+
+  size_t num_shards() const {
+    return shards_.size();
+  }
+
+  struct LaneStats {
+    // ops currently waiting in the lane
+    size_t depth;
+    // ops removed from the lane, and the total time they spent waiting
+    uint64_t ops;
+    uint64_t wait_us;
+  };
+
+  LaneStats lane_stats(OpLane lane) const;
+
+ private:
+  struct Lane {
+    // fifo of ops linked through LogOp::next_
+    LogOp *head;
+    LogOp *tail;
+    // peeked without the lock by consumers scanning for work
+    std::atomic<size_t> size;
+
+    Lane() : head(nullptr), tail(nullptr), size(0) {}
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::condition_variable cond;
+    Lane lanes[NUM_OP_LANES];
+    // consumers sleeping on this shard, and pending wakeups directed at them
+    uint32_t sleepers;
+    uint32_t kicks;
+    // advanced by consumers whose home is this shard to choose a lane
+    std::atomic<uint32_t> turn;
+
+    Shard() : sleepers(0), kicks(0), turn(0) {}
+
+    bool empty() const {
+      for (const auto& lane : lanes) {
+        if (lane.head) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  size_t producer_shard() const;
+  bool runnable(const Shard& shard) const;
+  void pass_on(size_t home);
+  bool reserve_background();
+  bool try_pop(size_t home, std::unique_ptr<LogOp>& op);
+  bool try_pop_lane(size_t home, OpLane lane, std::unique_ptr<LogOp>& op);
+  void wake_one(size_t start);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  const uint32_t weights_[NUM_OP_LANES];
+  Statistics * const statistics_;
+  std::atomic<uint64_t> lane_ops_[NUM_OP_LANES];
+  std::atomic<uint64_t> lane_wait_us_[NUM_OP_LANES];
+  std::atomic<uint32_t> sleepers_;
+  std::atomic<bool> shutdown_;
+  std::atomic<size_t> running_background_;
+  std::atomic<size_t> background_limit_;
+};
+
+}
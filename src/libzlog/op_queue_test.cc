@@ -0,0 +1,267 @@
+#include <atomic>
+#include <set>
+#include <thread>
+#include "gtest/gtest.h"
+#include "libzlog/log_impl.h"
+#include "libzlog/op_queue.h"
+
+class CountingOp : public zlog::LogOp {
+ public:
+  explicit CountingOp(uint64_t id,
+      zlog::OpLane lane = zlog::OP_LANE_FOREGROUND) :
+    LogOp(nullptr),
+    id(id),
+    lane_(lane)
+  {}
+
+  int run() override {
+    return 0;
+  }
+
+  void callback(int ret) override {}
+
+  zlog::OpLane lane() const override {
+    return lane_;
+  }
+
+  const uint64_t id;
+
+ private:
+  const zlog::OpLane lane_;
+};
+
+TEST(OpQueueTest, SingleShard) {
+  zlog::OpQueue q(1);
+  ASSERT_EQ(q.num_shards(), 1u);
+
+  for (uint64_t i = 0; i < 10; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(new CountingOp(i)));
+  }
+
+  // a single shard is fifo
+  for (uint64_t i = 0; i < 10; i++) {
+    bool shutdown = true;
+    auto op = q.pop(0, &shutdown);
+    ASSERT_TRUE(op);
+    ASSERT_FALSE(shutdown);
+    ASSERT_EQ(static_cast<CountingOp*>(op.get())->id, i);
+  }
+
+  q.shutdown();
+
+  bool shutdown = false;
+  ASSERT_FALSE(q.pop(0, &shutdown));
+}
+
+TEST(OpQueueTest, ShutdownDrains) {
+  zlog::OpQueue q(4);
+
+  for (uint64_t i = 0; i < 10; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(new CountingOp(i)));
+  }
+
+  q.shutdown();
+
+  // any consumer can drain ops pushed to any shard
+  std::set<uint64_t> ids;
+  while (true) {
+    bool shutdown = false;
+    auto op = q.pop(3, &shutdown);
+    if (!op) {
+      break;
+    }
+    ASSERT_TRUE(shutdown);
+    ids.insert(static_cast<CountingOp*>(op.get())->id);
+  }
+
+  ASSERT_EQ(ids.size(), 10u);
+}
+
+TEST(OpQueueTest, ShutdownWakesConsumers) {
+  zlog::OpQueue q(2);
+
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < 4; i++) {
+    consumers.emplace_back([&q, i] {
+      bool shutdown = false;
+      auto op = q.pop(i, &shutdown);
+      ASSERT_FALSE(op);
+    });
+  }
+
+  q.shutdown();
+
+  for (auto& c : consumers) {
+    c.join();
+  }
+}
+
+TEST(OpQueueTest, MultiProducerMultiConsumer) {
+  const int num_producers = 8;
+  const int num_consumers = 3;
+  const uint64_t ops_per_producer = 10000;
+
+  zlog::OpQueue q(num_consumers);
+
+  std::mutex lock;
+  std::set<uint64_t> ids;
+
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < num_consumers; i++) {
+    consumers.emplace_back([&, i] {
+      std::vector<uint64_t> seen;
+      while (true) {
+        bool shutdown = false;
+        auto op = q.pop(i, &shutdown);
+        if (!op) {
+          break;
+        }
+        seen.push_back(static_cast<CountingOp*>(op.get())->id);
+      }
+      std::lock_guard<std::mutex> lk(lock);
+      ids.insert(seen.begin(), seen.end());
+    });
+  }
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < num_producers; i++) {
+    producers.emplace_back([&, i] {
+      for (uint64_t j = 0; j < ops_per_producer; j++) {
+        q.push(std::unique_ptr<zlog::LogOp>(
+              new CountingOp(i * ops_per_producer + j)));
+      }
+    });
+  }
+
+  for (auto& p : producers) {
+    p.join();
+  }
+
+  q.shutdown();
+
+  for (auto& c : consumers) {
+    c.join();
+  }
+
+  ASSERT_EQ(ids.size(), num_producers * ops_per_producer);
+}
+
+TEST(OpQueueTest, LaneWeights) {
+  zlog::OpQueue q(1, 2, 1);
+
+  for (uint64_t i = 0; i < 6; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(
+          new CountingOp(i, zlog::OP_LANE_BACKGROUND)));
+  }
+  for (uint64_t i = 0; i < 6; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(
+          new CountingOp(i, zlog::OP_LANE_FOREGROUND)));
+  }
+
+  // background ops queued first don't delay foreground ops by more than the
+  // ratio of the weights, and each lane is fifo.
+  uint64_t next[zlog::NUM_OP_LANES] = {0, 0};
+  for (int i = 0; i < 9; i++) {
+    bool shutdown = true;
+    auto op = q.pop(0, &shutdown);
+    ASSERT_TRUE(op);
+    const auto expected = (i % 3) == 2 ?
+      zlog::OP_LANE_BACKGROUND : zlog::OP_LANE_FOREGROUND;
+    ASSERT_EQ(op->lane(), expected);
+    ASSERT_EQ(static_cast<CountingOp*>(op.get())->id, next[expected]++);
+  }
+
+  // foreground is empty, so the remaining background ops don't wait for
+  // their turn.
+  for (int i = 0; i < 3; i++) {
+    bool shutdown = true;
+    auto op = q.pop(0, &shutdown);
+    ASSERT_TRUE(op);
+    ASSERT_EQ(op->lane(), zlog::OP_LANE_BACKGROUND);
+  }
+
+  q.shutdown();
+
+  bool shutdown = false;
+  ASSERT_FALSE(q.pop(0, &shutdown));
+}
+
+TEST(OpQueueTest, LaneStats) {
+  zlog::OpQueue q(4);
+
+  for (uint64_t i = 0; i < 5; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(
+          new CountingOp(i, zlog::OP_LANE_FOREGROUND)));
+  }
+  for (uint64_t i = 0; i < 3; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(
+          new CountingOp(i, zlog::OP_LANE_BACKGROUND)));
+  }
+
+  auto fg = q.lane_stats(zlog::OP_LANE_FOREGROUND);
+  auto bg = q.lane_stats(zlog::OP_LANE_BACKGROUND);
+  ASSERT_EQ(fg.depth, 5u);
+  ASSERT_EQ(fg.ops, 0u);
+  ASSERT_EQ(bg.depth, 3u);
+  ASSERT_EQ(bg.ops, 0u);
+
+  q.shutdown();
+  while (true) {
+    bool shutdown = false;
+    if (!q.pop(0, &shutdown)) {
+      break;
+    }
+  }
+
+  fg = q.lane_stats(zlog::OP_LANE_FOREGROUND);
+  bg = q.lane_stats(zlog::OP_LANE_BACKGROUND);
+  ASSERT_EQ(fg.depth, 0u);
+  ASSERT_EQ(fg.ops, 5u);
+  ASSERT_EQ(bg.depth, 0u);
+  ASSERT_EQ(bg.ops, 3u);
+}
+
+TEST(OpQueueTest, BackgroundLimit) {
+  zlog::OpQueue q(1);
+  q.set_background_limit(2);
+
+  for (uint64_t i = 0; i < 4; i++) {
+    q.push(std::unique_ptr<zlog::LogOp>(
+          new CountingOp(i, zlog::OP_LANE_BACKGROUND)));
+  }
+
+  bool shutdown = false;
+  std::vector<std::unique_ptr<zlog::LogOp>> running;
+  for (int i = 0; i < 2; i++) {
+    running.emplace_back(q.pop(0, &shutdown));
+    ASSERT_EQ(running.back()->lane(), zlog::OP_LANE_BACKGROUND);
+  }
+
+  // with two background ops running, only foreground ops are taken
+  q.push(std::unique_ptr<zlog::LogOp>(new CountingOp(10)));
+  auto op = q.pop(0, &shutdown);
+  ASSERT_EQ(static_cast<CountingOp*>(op.get())->id, 10u);
+
+  // a consumer waits for a background op to finish
+  std::atomic<bool> popped(false);
+  std::thread consumer([&] {
+    bool shutdown = false;
+    auto op = q.pop(0, &shutdown);
+    ASSERT_TRUE(op);
+    ASSERT_EQ(op->lane(), zlog::OP_LANE_BACKGROUND);
+    popped = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(popped);
+  q.finished(zlog::OP_LANE_BACKGROUND);
+  consumer.join();
+  ASSERT_TRUE(popped);
+
+  // the limit doesn't hold back the queue from draining at shutdown
+  q.shutdown();
+  op = q.pop(0, &shutdown);
+  ASSERT_TRUE(op);
+  ASSERT_TRUE(shutdown);
+  ASSERT_FALSE(q.pop(0, &shutdown));
+}
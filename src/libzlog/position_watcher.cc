@@ -0,0 +1,110 @@
+#include "position_watcher.h"
+#include <cerrno>
+
+namespace zlog {
+
+PositionWatcher::Waiter::Waiter(PositionWatcher *watcher,
+    const uint64_t position) :
+  watcher_(watcher),
+  notified_(false),
+  cancelled_(false)
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  it_ = watcher_->waiters_.emplace(position, this);
+  watcher_->num_waiters_++;
+}
+
+PositionWatcher::Waiter::Waiter(PositionWatcher *watcher,
+    const uint64_t position, std::function<void()> notify_cb) :
+  watcher_(watcher),
+  notify_cb_(std::move(notify_cb)),
+  notified_(false),
+  cancelled_(false)
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  it_ = watcher_->waiters_.emplace(position, this);
+  watcher_->num_waiters_++;
+}
+
+PositionWatcher::Waiter::~Waiter()
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  watcher_->waiters_.erase(it_);
+  watcher_->num_waiters_--;
+}
+
+int PositionWatcher::Waiter::wait()
+{
+  std::unique_lock<std::mutex> lk(watcher_->lock_);
+  cond_.wait(lk, [&] { return notified_ || cancelled_; });
+  if (cancelled_) {
+    return -ECANCELED;
+  }
+  notified_ = false;
+  return 0;
+}
+
+int PositionWatcher::Waiter::wait_until(
+    const std::chrono::steady_clock::time_point deadline)
+{
+  std::unique_lock<std::mutex> lk(watcher_->lock_);
+  cond_.wait_until(lk, deadline, [&] { return notified_ || cancelled_; });
+  if (cancelled_) {
+    return -ECANCELED;
+  }
+  if (!notified_) {
+    return -ETIMEDOUT;
+  }
+  notified_ = false;
+  return 0;
+}
+
+bool PositionWatcher::Waiter::poll()
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  const bool notified = notified_;
+  notified_ = false;
+  return notified;
+}
+
+void PositionWatcher::Waiter::reset(const uint64_t position)
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  watcher_->waiters_.erase(it_);
+  it_ = watcher_->waiters_.emplace(position, this);
+  notified_ = false;
+}
+
+void PositionWatcher::Waiter::cancel()
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  cancelled_ = true;
+  cond_.notify_one();
+}
+
+bool PositionWatcher::Waiter::cancelled() const
+{
+  std::lock_guard<std::mutex> lk(watcher_->lock_);
+  return cancelled_;
+}
+
+void PositionWatcher::notify(const uint64_t first, const uint64_t last)
+{
+  if (num_waiters_ == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(lock_);
+  const auto end = waiters_.upper_bound(last);
+  for (auto it = waiters_.lower_bound(first); it != end; it++) {
+    auto waiter = it->second;
+    waiter->notified_ = true;
+    if (waiter->notify_cb_) {
+      waiter->notify_cb_();
+    } else {
+      waiter->cond_.notify_one();
+    }
+  }
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace zlog {
+
+// wakes threads that are waiting for log positions to be written.
+//
+// the log notifies the watcher when its own ops write, fill or trim
+// positions, and the backend notifies it of changes made by other clients
+// when the backend supports watches. a notification means that a position
+// should be checked again, not that it has been written: ranges notified by
+// the backend may include positions that didn't change.
+class PositionWatcher {
+ public:
+  // a thread waiting for a position. the waiter is registered with the
+  // watcher before the position is checked, so that a change made after the
+  // check isn't missed.
+  class Waiter {
+   public:
+    Waiter(PositionWatcher *watcher, uint64_t position);
+
+    // a waiter that isn't waited on. notify_cb is called, with the watcher
+    // locked, when the waiter is notified, and the notification is consumed
+    // with poll(). this lets one thread follow many positions.
+    Waiter(PositionWatcher *watcher, uint64_t position,
+        std::function<void()> notify_cb);
+
+    ~Waiter();
+
+    Waiter(const Waiter&) = delete;
+    Waiter& operator=(const Waiter&) = delete;
+
+    // wait for a notification for the position. returns 0 when notified,
+    // -ETIMEDOUT at the deadline, or -ECANCELED if the waiter was cancelled.
+    // the notification is consumed.
+    int wait();
+    int wait_until(std::chrono::steady_clock::time_point deadline);
+
+    // consume a notification without waiting. returns true if the waiter
+    // was notified.
+    bool poll();
+
+    // wait for another position
+    void reset(uint64_t position);
+
+    // wake the waiter, and make every later wait return -ECANCELED
+    void cancel();
+
+    bool cancelled() const;
+
+   private:
+    friend class PositionWatcher;
+
+    PositionWatcher * const watcher_;
+    const std::function<void()> notify_cb_;
+    std::multimap<uint64_t, Waiter*>::iterator it_;
+    bool notified_;
+    bool cancelled_;
+    std::condition_variable cond_;
+  };
+
+  PositionWatcher() :
+    num_waiters_(0)
+  {}
+
+  // notify waiters for positions in [first, last]. cheap when nothing is
+  // waiting, so it is called for every change made by the log.
+  void notify(uint64_t first, uint64_t last);
+
+  void notify(uint64_t position) {
+    notify(position, position);
+  }
+
+ private:
+  mutable std::mutex lock_;
+  std::multimap<uint64_t, Waiter*> waiters_;
+  std::atomic<size_t> num_waiters_;
+};
+
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <thread>
+#include "gtest/gtest.h"
+#include "libzlog/position_watcher.h"
+
+static std::chrono::steady_clock::time_point after_ms(int ms)
+{
+  return std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+}
+
+TEST(PositionWatcherTest, Notify) {
+  zlog::PositionWatcher watcher;
+  zlog::PositionWatcher::Waiter waiter(&watcher, 10);
+
+  // other positions don't wake the waiter
+  watcher.notify(9);
+  watcher.notify(11, 20);
+  ASSERT_EQ(waiter.wait_until(after_ms(10)), -ETIMEDOUT);
+
+  // a notification before the wait isn't lost, and is consumed by the wait
+  watcher.notify(10);
+  ASSERT_EQ(waiter.wait_until(after_ms(1000)), 0);
+  ASSERT_EQ(waiter.wait_until(after_ms(10)), -ETIMEDOUT);
+
+  watcher.notify(0, 10);
+  ASSERT_EQ(waiter.wait(), 0);
+
+  waiter.reset(20);
+  watcher.notify(10);
+  ASSERT_EQ(waiter.wait_until(after_ms(10)), -ETIMEDOUT);
+  watcher.notify(15, 25);
+  ASSERT_EQ(waiter.wait(), 0);
+}
+
+TEST(PositionWatcherTest, Waiters) {
+  zlog::PositionWatcher watcher;
+  zlog::PositionWatcher::Waiter a(&watcher, 5);
+  zlog::PositionWatcher::Waiter b(&watcher, 5);
+  {
+    zlog::PositionWatcher::Waiter c(&watcher, 6);
+  }
+
+  watcher.notify(5);
+  ASSERT_EQ(a.wait(), 0);
+  ASSERT_EQ(b.wait(), 0);
+}
+
+TEST(PositionWatcherTest, Wakeup) {
+  zlog::PositionWatcher watcher;
+  zlog::PositionWatcher::Waiter waiter(&watcher, 1);
+
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    watcher.notify(1);
+  });
+
+  ASSERT_EQ(waiter.wait(), 0);
+  thread.join();
+}
+
+TEST(PositionWatcherTest, Cancel) {
+  zlog::PositionWatcher watcher;
+  zlog::PositionWatcher::Waiter waiter(&watcher, 1);
+  ASSERT_FALSE(waiter.cancelled());
+
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    waiter.cancel();
+  });
+
+  ASSERT_EQ(waiter.wait(), -ECANCELED);
+  thread.join();
+
+  ASSERT_TRUE(waiter.cancelled());
+  watcher.notify(1);
+  ASSERT_EQ(waiter.wait_until(after_ms(1000)), -ECANCELED);
+}
+
+TEST(PositionWatcherTest, Poll) {
+  zlog::PositionWatcher watcher;
+  int calls = 0;
+  zlog::PositionWatcher::Waiter waiter(&watcher, 10, [&] { calls++; });
+
+  ASSERT_FALSE(waiter.poll());
+  watcher.notify(9);
+  ASSERT_FALSE(waiter.poll());
+  ASSERT_EQ(calls, 0);
+
+  // the notification is consumed by the poll
+  watcher.notify(5, 15);
+  ASSERT_EQ(calls, 1);
+  ASSERT_TRUE(waiter.poll());
+  ASSERT_FALSE(waiter.poll());
+
+  // reset drops a notification that hasn't been consumed
+  watcher.notify(10);
+  waiter.reset(11);
+  ASSERT_FALSE(waiter.poll());
+  watcher.notify(11);
+  ASSERT_EQ(calls, 3);
+  ASSERT_TRUE(waiter.poll());
+}
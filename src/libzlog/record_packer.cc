@@ -0,0 +1,273 @@
+#include "record_packer.h"
+#include <cassert>
+#include <cerrno>
+
+namespace zlog {
+
+static inline void encode_fixed32(std::string *dst, const uint32_t value)
+{
+  char buf[4];
+  buf[0] = value & 0xff;
+  buf[1] = (value >> 8) & 0xff;
+  buf[2] = (value >> 16) & 0xff;
+  buf[3] = (value >> 24) & 0xff;
+  dst->append(buf, sizeof(buf));
+}
+
+static inline uint32_t decode_fixed32(const char *src)
+{
+  const auto p = reinterpret_cast<const unsigned char*>(src);
+  return uint32_t(p[0]) |
+    (uint32_t(p[1]) << 8) |
+    (uint32_t(p[2]) << 16) |
+    (uint32_t(p[3]) << 24);
+}
+
+void EncodeRecordHeader(const Slice *records, const size_t count,
+    std::string *header)
+{
+  header->clear();
+  header->reserve(4 * (count + 2));
+  encode_fixed32(header, kRecordPackMagic);
+  encode_fixed32(header, count);
+  for (size_t i = 0; i < count; i++) {
+    encode_fixed32(header, records[i].size);
+  }
+}
+
+int UnpackRecords(const Slice& entry, std::vector<Slice> *records)
+{
+  if (entry.size < 8 || decode_fixed32(entry.data) != kRecordPackMagic) {
+    return -EINVAL;
+  }
+
+  const uint64_t count = decode_fixed32(entry.data + 4);
+  const uint64_t header_size = 8 + 4 * count;
+  if (entry.size < header_size) {
+    return -EINVAL;
+  }
+
+  uint64_t offset = header_size;
+  for (uint64_t i = 0; i < count; i++) {
+    offset += decode_fixed32(entry.data + 8 + 4 * i);
+  }
+  if (offset != entry.size) {
+    return -EINVAL;
+  }
+
+  records->clear();
+  records->reserve(count);
+  offset = header_size;
+  for (uint64_t i = 0; i < count; i++) {
+    const auto size = decode_fixed32(entry.data + 8 + 4 * i);
+    records->emplace_back(entry.data + offset, size);
+    offset += size;
+  }
+
+  return 0;
+}
+
+int ReadRecords(Log *log, const uint64_t position, std::string *buffer,
+    std::vector<Slice> *records)
+{
+  int ret = log->Read(position, buffer);
+  if (ret) {
+    return ret;
+  }
+  return UnpackRecords(*buffer, records);
+}
+
+RecordPacker::~RecordPacker() {}
+
+int RecordPacker::Create(Log *log, const RecordPackerOptions& options,
+    RecordPacker **packer)
+{
+  if (!log || options.max_records == 0 || options.max_bytes == 0) {
+    return -EINVAL;
+  }
+
+  *packer = new RecordPackerImpl(log, options);
+
+  return 0;
+}
+
+RecordPackerImpl::RecordPackerImpl(Log *log,
+    const RecordPackerOptions& options) :
+  log_(log),
+  options_(options),
+  inflight_(0),
+  shutdown_(false),
+  flusher_(std::thread(&RecordPackerImpl::flush_entry, this))
+{}
+
+RecordPackerImpl::~RecordPackerImpl()
+{
+  Flush();
+
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    shutdown_ = true;
+    cond_.notify_all();
+  }
+
+  flusher_.join();
+
+  assert(!open_);
+  assert(inflight_ == 0);
+}
+
+int RecordPackerImpl::Append(std::string&& record, RecordAddress *paddr)
+{
+  std::mutex lock;
+  std::condition_variable cond;
+  bool done = false;
+  int ret = 0;
+
+  appendAsync(std::move(record), [&](int r, RecordAddress addr) {
+    std::lock_guard<std::mutex> lk(lock);
+    if (!r && paddr) {
+      *paddr = addr;
+    }
+    ret = r;
+    done = true;
+    cond.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lk(lock);
+  cond.wait(lk, [&] { return done; });
+
+  return ret;
+}
+
+int RecordPackerImpl::Append(const Slice& record, RecordAddress *paddr)
+{
+  return Append(std::string(record.data, record.size), paddr);
+}
+
+int RecordPackerImpl::appendAsync(std::string&& record,
+    std::function<void(int, RecordAddress)> cb)
+{
+  // at most two packs become ready: the open pack, when the record doesn't
+  // fit, and the pack that receives the record.
+  std::unique_ptr<Pack> ready[2];
+
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (open_ && open_->bytes + record.size() > options_.max_bytes) {
+      ready[0] = std::move(open_);
+    }
+
+    if (!open_) {
+      open_.reset(new Pack);
+      open_->opened = std::chrono::steady_clock::now();
+      cond_.notify_all();
+    }
+
+    open_->bytes += record.size();
+    open_->records.emplace_back(std::move(record));
+    open_->callbacks.emplace_back(std::move(cb));
+
+    if (open_->records.size() >= options_.max_records ||
+        open_->bytes >= options_.max_bytes) {
+      ready[1] = std::move(open_);
+    }
+  }
+
+  for (auto& pack : ready) {
+    if (pack) {
+      append_pack(std::move(pack));
+    }
+  }
+
+  return 0;
+}
+
+void RecordPackerImpl::Flush()
+{
+  std::unique_ptr<Pack> pack;
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    pack = std::move(open_);
+  }
+
+  if (pack) {
+    append_pack(std::move(pack));
+  }
+
+  std::unique_lock<std::mutex> lk(lock_);
+  cond_.wait(lk, [&] { return inflight_ == 0; });
+}
+
+void RecordPackerImpl::append_pack(std::unique_ptr<Pack> pack)
+{
+  assert(!pack->records.empty());
+
+  pack->slices.reserve(pack->records.size() + 1);
+  pack->slices.emplace_back();
+  for (const auto& record : pack->records) {
+    pack->slices.emplace_back(record);
+  }
+  EncodeRecordHeader(pack->slices.data() + 1, pack->records.size(),
+      &pack->header);
+  pack->slices[0] = Slice(pack->header);
+
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    inflight_++;
+  }
+
+  // owned by the append callback from here on
+  auto p = pack.release();
+  int ret = log_->appendAsync(p->slices, [this, p](int ret, uint64_t pos) {
+    complete_pack(p, ret, pos);
+  });
+
+  if (ret) {
+    complete_pack(p, ret, 0);
+  }
+}
+
+void RecordPackerImpl::complete_pack(Pack *pack, const int ret,
+    const uint64_t position)
+{
+  for (size_t i = 0; i < pack->callbacks.size(); i++) {
+    RecordAddress addr;
+    addr.position = position;
+    addr.index = i;
+    pack->callbacks[i](ret, addr);
+  }
+
+  delete pack;
+
+  std::lock_guard<std::mutex> lk(lock_);
+  assert(inflight_ > 0);
+  inflight_--;
+  cond_.notify_all();
+}
+
+void RecordPackerImpl::flush_entry()
+{
+  std::unique_lock<std::mutex> lk(lock_);
+
+  while (!shutdown_) {
+    if (!open_) {
+      cond_.wait(lk);
+      continue;
+    }
+
+    const auto deadline = open_->opened +
+      std::chrono::microseconds(options_.max_delay_us);
+    if (std::chrono::steady_clock::now() < deadline) {
+      cond_.wait_until(lk, deadline);
+      continue;
+    }
+
+    auto pack = std::move(open_);
+    lk.unlock();
+    append_pack(std::move(pack));
+    lk.lock();
+  }
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "include/zlog/record.h"
+
+namespace zlog {
+
+// a packed entry is a header followed by the concatenated records. the header
+// is a magic number, the record count, and the size of each record, all
+// encoded as little-endian 32-bit integers.
+static const uint32_t kRecordPackMagic = 0x314b505a; // "ZPK1"
+
+void EncodeRecordHeader(const Slice *records, size_t count,
+    std::string *header);
+
+class RecordPackerImpl : public RecordPacker {
+ public:
+  RecordPackerImpl(Log *log, const RecordPackerOptions& options);
+
+  ~RecordPackerImpl();
+
+  int Append(std::string&& record, RecordAddress *paddr) override;
+  int Append(const Slice& record, RecordAddress *paddr) override;
+  int appendAsync(std::string&& record,
+      std::function<void(int, RecordAddress)> cb) override;
+
+  void Flush() override;
+
+ private:
+  struct Pack {
+    std::vector<std::string> records;
+    std::vector<std::function<void(int, RecordAddress)>> callbacks;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point opened;
+
+    // the entry is appended from these slices, which reference the header
+    // and the records, so they are kept alive until the append completes.
+    std::string header;
+    std::vector<Slice> slices;
+  };
+
+  void append_pack(std::unique_ptr<Pack> pack);
+  void complete_pack(Pack *pack, int ret, uint64_t position);
+  void flush_entry();
+
+  Log * const log_;
+  const RecordPackerOptions options_;
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::unique_ptr<Pack> open_;
+  size_t inflight_;
+  bool shutdown_;
+  std::thread flusher_;
+};
+
+}
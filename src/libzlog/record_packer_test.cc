@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include "libzlog/record_packer.h"
+
+static std::string pack(const std::vector<std::string>& records)
+{
+  std::vector<zlog::Slice> slices(records.begin(), records.end());
+  std::string entry;
+  zlog::EncodeRecordHeader(slices.data(), slices.size(), &entry);
+  for (const auto& record : records) {
+    entry.append(record);
+  }
+  return entry;
+}
+
+TEST(RecordPackerTest, Unpack) {
+  const std::vector<std::string> records = {"a", "", "bcd", std::string(1000, 'x')};
+  const auto entry = pack(records);
+
+  std::vector<zlog::Slice> out;
+  ASSERT_EQ(zlog::UnpackRecords(entry, &out), 0);
+  ASSERT_EQ(out.size(), records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(std::string(out[i].data, out[i].size), records[i]);
+  }
+
+  // records reference the entry rather than copies of it
+  ASSERT_EQ(out[3].data, entry.data() + entry.size() - 1000);
+
+  ASSERT_EQ(zlog::UnpackRecords(pack({}), &out), 0);
+  ASSERT_TRUE(out.empty());
+}
+
+TEST(RecordPackerTest, UnpackInvalid) {
+  std::vector<zlog::Slice> out;
+  ASSERT_EQ(zlog::UnpackRecords(zlog::Slice(), &out), -EINVAL);
+  ASSERT_EQ(zlog::UnpackRecords("not a packed entry", &out), -EINVAL);
+
+  const auto entry = pack({"abc", "def"});
+
+  // truncated record data
+  auto bad = entry.substr(0, entry.size() - 1);
+  ASSERT_EQ(zlog::UnpackRecords(bad, &out), -EINVAL);
+
+  // trailing data
+  bad = entry + "x";
+  ASSERT_EQ(zlog::UnpackRecords(bad, &out), -EINVAL);
+
+  // truncated header
+  bad = entry.substr(0, 10);
+  ASSERT_EQ(zlog::UnpackRecords(bad, &out), -EINVAL);
+
+  // bad magic
+  bad = entry;
+  bad[0]++;
+  ASSERT_EQ(zlog::UnpackRecords(bad, &out), -EINVAL);
+}
@@ -0,0 +1,149 @@
+#include "reorder_window.h"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include "monitoring/statistics.h"
+
+namespace zlog {
+
+ReorderWindow::ReorderWindow(Statistics *statistics,
+    std::function<void()> released) :
+  statistics_(statistics),
+  released_(std::move(released)),
+  delivering_(false),
+  end_(0),
+  max_size_(0),
+  held_(0),
+  held_us_(0)
+{}
+
+uint64_t ReorderWindow::assign(Ticket *ticket, const bool replace,
+    const std::function<uint64_t()>& next)
+{
+  uint64_t position;
+  int ret = try_assign(ticket, replace, [&next](uint64_t *position) {
+    *position = next();
+    return 0;
+  }, &position);
+  assert(!ret);
+  (void)ret;
+  return position;
+}
+
+int ReorderWindow::try_assign(Ticket *ticket, const bool replace,
+    const std::function<int(uint64_t*)>& next, uint64_t *position_out)
+{
+  std::unique_lock<std::mutex> lk(lock_);
+  const auto assigning = assigning_.insert(end_);
+  lk.unlock();
+
+  uint64_t position;
+  int ret = next(&position);
+
+  lk.lock();
+  assigning_.erase(assigning);
+
+  if (ret) {
+    // appends held back by this request may now be deliverable
+    deliver(lk);
+    return ret;
+  }
+
+  const auto prev = *ticket;
+  *ticket = entries_.emplace(position, Entry());
+  *position_out = position;
+  end_ = std::max(end_, position + 1);
+
+  if (entries_.size() > max_size_) {
+    max_size_ = entries_.size();
+  }
+  SetTickerCount(statistics_, APPEND_REORDER_WINDOW, entries_.size());
+
+  if (replace) {
+    assert(!prev->second.done);
+    entries_.erase(prev);
+  }
+
+  // appends behind the old position, or held back by this request, may now
+  // be deliverable
+  deliver(lk);
+
+  return 0;
+}
+
+void ReorderWindow::complete(const Ticket ticket, const int ret,
+    std::function<void(int, uint64_t)> cb)
+{
+  std::unique_lock<std::mutex> lk(lock_);
+
+  auto& entry = ticket->second;
+  entry.done = true;
+  entry.ret = ret;
+  entry.cb = std::move(cb);
+
+  if (ticket != entries_.begin() || delivering_ || !deliverable()) {
+    entry.completed = std::chrono::steady_clock::now();
+    held_++;
+  }
+
+  deliver(lk);
+}
+
+void ReorderWindow::deliver(std::unique_lock<std::mutex>& lk)
+{
+  // the thread already delivering will pick up anything made deliverable
+  if (delivering_) {
+    return;
+  }
+  delivering_ = true;
+
+  while (deliverable()) {
+    const auto position = entries_.begin()->first;
+    auto entry = std::move(entries_.begin()->second);
+    entries_.erase(entries_.begin());
+    SetTickerCount(statistics_, APPEND_REORDER_WINDOW, entries_.size());
+    lk.unlock();
+
+    if (entry.completed != std::chrono::steady_clock::time_point()) {
+      const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - entry.completed).count();
+      held_us_ += us;
+      MeasureTime(statistics_, APPEND_REORDER_DELAY_MICROS, us);
+    }
+
+    if (entry.cb) {
+      entry.cb(entry.ret, position);
+    }
+    released_();
+
+    lk.lock();
+  }
+
+  delivering_ = false;
+}
+
+bool ReorderWindow::deliverable() const
+{
+  if (entries_.empty() || !entries_.begin()->second.done) {
+    return false;
+  }
+  // a request to the sequencer that hasn't returned may yet add a position
+  // as low as the value of end_ when it started
+  return assigning_.empty() ||
+    entries_.begin()->first < *assigning_.begin();
+}
+
+ReorderWindow::Stats ReorderWindow::stats() const
+{
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    stats.size = entries_.size();
+  }
+  stats.max_size = max_size_;
+  stats.held = held_;
+  stats.held_us = held_us_;
+  return stats;
+}
+
+}
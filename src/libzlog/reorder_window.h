@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include "include/zlog/statistics.h"
+
+namespace zlog {
+
+/**
+ * ReorderWindow delivers append callbacks in position order.
+ *
+ * An append enters the window when it is assigned a position, and leaves it
+ * when its callback is delivered. A callback is delivered once the append has
+ * completed and every append in the window at a lower position has been
+ * delivered, so a completed append at the head of the window releases the
+ * appends behind it that completed earlier. The backend requests themselves
+ * are not ordered.
+ *
+ * Positions are obtained from the sequencer without holding the window's
+ * lock, since that may be a round trip to a zlog-seqr server. The sequencer
+ * hands out increasing positions, so while a position is being obtained,
+ * appends at or above the highest position added before the request started
+ * are held back, and an append can't be assigned a position lower than one
+ * that has already been delivered. An append that is assigned a new position
+ * (e.g. after the log is sealed) gives up its old position.
+ *
+ * Callbacks are delivered by one thread at a time, on whichever thread
+ * completed the append that allowed them to be delivered. released is invoked
+ * after each callback.
+ */
+class ReorderWindow final {
+ public:
+  ReorderWindow(Statistics *statistics, std::function<void()> released);
+
+  ReorderWindow(const ReorderWindow& other) = delete;
+  ReorderWindow& operator=(const ReorderWindow& other) = delete;
+
+ private:
+  struct Entry {
+    bool done;
+    int ret;
+    std::function<void(int, uint64_t)> cb;
+    std::chrono::steady_clock::time_point completed;
+
+    Entry() : done(false), ret(0) {}
+  };
+
+ public:
+  // identifies an append in the window. a position may briefly be held by
+  // two appends when a new sequencer reissues a position that an append
+  // holding it will fail to write.
+  typedef std::multimap<uint64_t, Entry>::iterator Ticket;
+
+  // add the position returned by next to the window, and return it. when
+  // replace is true the append already holds ticket, which is released. next
+  // is called without the window's lock held.
+  uint64_t assign(Ticket *ticket, bool replace,
+      const std::function<uint64_t()>& next);
+
+  // same as assign for a next that can fail. on failure the error is
+  // returned and the window is unchanged.
+  int try_assign(Ticket *ticket, bool replace,
+      const std::function<int(uint64_t*)>& next, uint64_t *position);
+
+  // record the result of the append holding ticket
+  void complete(Ticket ticket, int ret,
+      std::function<void(int, uint64_t)> cb);
+
+  struct Stats {
+    // appends in the window now, and the most there have been
+    uint64_t size;
+    uint64_t max_size;
+    // callbacks that had to wait for an append at a lower position, and the
+    // total time they waited
+    uint64_t held;
+    uint64_t held_us;
+  };
+
+  Stats stats() const;
+
+ private:
+  // deliver completed entries from the head of the window
+  void deliver(std::unique_lock<std::mutex>& lk);
+  bool deliverable() const;
+
+  Statistics * const statistics_;
+  const std::function<void()> released_;
+
+  mutable std::mutex lock_;
+  std::multimap<uint64_t, Entry> entries_;
+  bool delivering_;
+
+  // one past the highest position added to the window, and the value it had
+  // when each request to the sequencer that hasn't returned was started
+  uint64_t end_;
+  std::multiset<uint64_t> assigning_;
+
+  std::atomic<uint64_t> max_size_;
+  std::atomic<uint64_t> held_;
+  std::atomic<uint64_t> held_us_;
+};
+
+}
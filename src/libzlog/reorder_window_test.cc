@@ -0,0 +1,193 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libzlog/reorder_window.h"
+
+TEST(ReorderWindowTest, InOrder) {
+  size_t released = 0;
+  zlog::ReorderWindow window(nullptr, [&] { released++; });
+
+  uint64_t next = 0;
+  std::vector<uint64_t> delivered;
+  for (int i = 0; i < 10; i++) {
+    zlog::ReorderWindow::Ticket ticket;
+    const auto pos = window.assign(&ticket, false, [&] { return next++; });
+    ASSERT_EQ(pos, (uint64_t)i);
+    window.complete(ticket, 0, [&](int ret, uint64_t pos) {
+      ASSERT_EQ(ret, 0);
+      delivered.push_back(pos);
+    });
+    ASSERT_EQ(delivered.size(), (size_t)i + 1);
+  }
+
+  ASSERT_EQ(released, 10u);
+  const auto stats = window.stats();
+  ASSERT_EQ(stats.size, 0u);
+  ASSERT_EQ(stats.max_size, 1u);
+  ASSERT_EQ(stats.held, 0u);
+}
+
+TEST(ReorderWindowTest, Reverse) {
+  size_t released = 0;
+  zlog::ReorderWindow window(nullptr, [&] { released++; });
+
+  uint64_t next = 100;
+  std::vector<zlog::ReorderWindow::Ticket> tickets(10);
+  for (auto& ticket : tickets) {
+    window.assign(&ticket, false, [&] { return next++; });
+  }
+
+  std::vector<std::pair<int, uint64_t>> delivered;
+  for (int i = 9; i >= 0; i--) {
+    window.complete(tickets[i], -i, [&](int ret, uint64_t pos) {
+      delivered.emplace_back(ret, pos);
+    });
+    if (i > 0) {
+      ASSERT_TRUE(delivered.empty());
+      ASSERT_EQ(released, 0u);
+    }
+  }
+
+  // results are delivered with the callback of the append they belong to
+  ASSERT_EQ(delivered.size(), 10u);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(delivered[i].first, -i);
+    ASSERT_EQ(delivered[i].second, (uint64_t)(100 + i));
+  }
+  ASSERT_EQ(released, 10u);
+
+  const auto stats = window.stats();
+  ASSERT_EQ(stats.size, 0u);
+  ASSERT_EQ(stats.max_size, 10u);
+  ASSERT_EQ(stats.held, 9u);
+}
+
+// an append that is given a new position releases its old one, which may
+// unblock appends that completed behind it.
+TEST(ReorderWindowTest, Reassign) {
+  zlog::ReorderWindow window(nullptr, [] {});
+
+  uint64_t next = 0;
+  zlog::ReorderWindow::Ticket a, b;
+  window.assign(&a, false, [&] { return next++; });
+  window.assign(&b, false, [&] { return next++; });
+
+  std::vector<uint64_t> delivered;
+  window.complete(b, 0, [&](int ret, uint64_t pos) {
+    delivered.push_back(pos);
+  });
+  ASSERT_TRUE(delivered.empty());
+
+  ASSERT_EQ(window.assign(&a, true, [&] { return next++; }), 2u);
+  ASSERT_EQ(delivered, std::vector<uint64_t>({1}));
+
+  window.complete(a, 0, [&](int ret, uint64_t pos) {
+    delivered.push_back(pos);
+  });
+  ASSERT_EQ(delivered, std::vector<uint64_t>({1, 2}));
+}
+
+// a reissued position can be held by two appends at once
+TEST(ReorderWindowTest, DuplicatePosition) {
+  zlog::ReorderWindow window(nullptr, [] {});
+
+  zlog::ReorderWindow::Ticket a, b;
+  window.assign(&a, false, [] { return 5; });
+  window.assign(&b, false, [] { return 5; });
+  ASSERT_EQ(window.stats().size, 2u);
+
+  std::vector<int> delivered;
+  window.complete(b, 2, [&](int ret, uint64_t pos) {
+    delivered.push_back(ret);
+  });
+  ASSERT_TRUE(delivered.empty());
+  window.complete(a, 1, [&](int ret, uint64_t pos) {
+    delivered.push_back(ret);
+  });
+  ASSERT_EQ(delivered, std::vector<int>({1, 2}));
+}
+
+// positions are obtained without the window's lock. an append at a higher
+// position is held until a lower position that is being obtained is added.
+TEST(ReorderWindowTest, Assigning) {
+  zlog::ReorderWindow window(nullptr, [] {});
+
+  std::mutex lock;
+  std::condition_variable cond;
+  bool obtained = false;
+  bool release = false;
+
+  std::atomic<uint64_t> next(0);
+  zlog::ReorderWindow::Ticket a, b;
+  std::thread thread([&] {
+    window.assign(&a, false, [&] {
+      const auto position = next++;
+      std::unique_lock<std::mutex> lk(lock);
+      obtained = true;
+      cond.notify_all();
+      cond.wait(lk, [&] { return release; });
+      return position;
+    });
+  });
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return obtained; });
+  }
+
+  std::vector<uint64_t> delivered;
+  ASSERT_EQ(window.assign(&b, false, [&] { return next++; }), 1u);
+  window.complete(b, 0, [&](int ret, uint64_t pos) {
+    delivered.push_back(pos);
+  });
+  ASSERT_TRUE(delivered.empty());
+
+  {
+    std::lock_guard<std::mutex> lk(lock);
+    release = true;
+    cond.notify_all();
+  }
+  thread.join();
+  ASSERT_TRUE(delivered.empty());
+
+  window.complete(a, 0, [&](int ret, uint64_t pos) {
+    delivered.push_back(pos);
+  });
+  ASSERT_EQ(delivered, std::vector<uint64_t>({0, 1}));
+}
+
+TEST(ReorderWindowTest, Concurrent) {
+  zlog::ReorderWindow window(nullptr, [] {});
+
+  const int count = 2000;
+  uint64_t next = 0;
+  std::vector<zlog::ReorderWindow::Ticket> tickets(count);
+  for (auto& ticket : tickets) {
+    window.assign(&ticket, false, [&] { return next++; });
+  }
+
+  // callbacks are delivered one at a time, so the vector needs no lock
+  std::vector<uint64_t> delivered;
+  std::vector<std::thread> threads;
+  const int num_threads = 4;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = count - 1 - t; i >= 0; i -= num_threads) {
+        window.complete(tickets[i], 0, [&](int ret, uint64_t pos) {
+          delivered.push_back(pos);
+        });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(delivered.size(), (size_t)count);
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(delivered[i], (uint64_t)i);
+  }
+}
@@ -0,0 +1,325 @@
+#include "seqr_client.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "seqr_protocol.h"
+
+namespace zlog {
+
+using boost::asio::ip::tcp;
+
+// how long a request that the server asks to be retried is retried for
+static const int kMaxRetries = 1000;
+static const auto kRetryDelay = std::chrono::milliseconds(1);
+
+static int error(const boost::system::error_code& ec)
+{
+  if (ec.category() == boost::system::system_category() && ec.value() > 0) {
+    return -ec.value();
+  }
+  return -ECONNRESET;
+}
+
+SeqrClient::SeqrClient(const std::string& address,
+    const std::string& prefix, const int timeout_ms) :
+  address_(address),
+  prefix_(prefix),
+  timeout_(timeout_ms),
+  work_(boost::asio::make_work_guard(io_context_)),
+  socket_(io_context_),
+  in_(64 * seqr::kMessageSize),
+  len_(0),
+  shutdown_(false),
+  connecting_(false),
+  connected_(false),
+  writing_(false),
+  conn_(0),
+  handle_(0),
+  next_tag_(0),
+  io_thread_([this] { io_context_.run(); })
+{}
+
+SeqrClient::~SeqrClient()
+{
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    shutdown_ = true;
+    fail(-ESHUTDOWN);
+  }
+
+  // the i/o thread exits once it has closed the connection
+  work_.reset();
+  io_thread_.join();
+}
+
+int SeqrClient::next(const uint64_t epoch, const uint64_t count,
+    uint64_t *position)
+{
+  if (count == 0 || count > seqr::kMaxCount) {
+    return -EINVAL;
+  }
+  return request(seqr::NEXT, epoch, count, position);
+}
+
+int SeqrClient::tail(const uint64_t epoch, uint64_t *position)
+{
+  return request(seqr::TAIL, epoch, 1, position);
+}
+
+int SeqrClient::request(const uint32_t op, const uint64_t epoch,
+    const uint64_t count, uint64_t *position)
+{
+  int ret;
+  for (int i = 0; i < kMaxRetries; i++) {
+    ret = send(op, epoch, count, position);
+    if (ret != -EAGAIN) {
+      break;
+    }
+    std::this_thread::sleep_for(kRetryDelay);
+  }
+  return ret;
+}
+
+int SeqrClient::send(const uint32_t op, const uint64_t epoch,
+    const uint64_t count, uint64_t *position)
+{
+  Pending pending;
+
+  std::unique_lock<std::mutex> lk(lock_);
+
+  if (shutdown_) {
+    return -ESHUTDOWN;
+  }
+
+  const auto tag = next_tag_++;
+  pending_.emplace(tag, &pending);
+  out_.push_back(seqr::Request{op, 0, tag, epoch, count});
+
+  // requests queued while the i/o thread is connecting or writing are
+  // written when it's done
+  const auto conn = conn_;
+  if (!connected_ && !connecting_) {
+    connecting_ = true;
+    boost::asio::post(io_context_, [this, conn] { connect(conn); });
+  } else if (connected_ && !writing_) {
+    writing_ = true;
+    boost::asio::post(io_context_, [this, conn] { write(conn); });
+  }
+
+  // a server that doesn't answer is treated like one that can't be reached.
+  // the connection is remade by the next request.
+  if (!pending.cond.wait_for(lk, timeout_,
+        [&pending] { return pending.done; })) {
+    pending_.erase(tag);
+    fail(-ETIMEDOUT);
+    return -ETIMEDOUT;
+  }
+
+  if (!pending.ret) {
+    *position = pending.position;
+  }
+
+  return pending.ret;
+}
+
+void SeqrClient::connect(const uint64_t conn)
+{
+  const auto sep = address_.rfind(':');
+  if (sep == std::string::npos || sep == 0 || sep + 1 == address_.size()) {
+    failed(conn, -EINVAL);
+    return;
+  }
+  const auto host = address_.substr(0, sep);
+  const auto port = address_.substr(sep + 1);
+
+  boost::system::error_code ec;
+  tcp::resolver resolver(io_context_);
+  const auto endpoints = resolver.resolve(host, port, ec);
+  if (ec) {
+    failed(conn, -EHOSTUNREACH);
+    return;
+  }
+
+  // the socket of a failed connection is reused
+  socket_.close(ec);
+
+  boost::asio::async_connect(socket_, endpoints,
+      [this, conn](const boost::system::error_code& ec,
+          const tcp::endpoint&) {
+        if (ec) {
+          failed(conn, error(ec));
+          return;
+        }
+        {
+          std::lock_guard<std::mutex> lk(lock_);
+          if (conn != conn_) {
+            return;
+          }
+        }
+        boost::system::error_code err;
+        socket_.set_option(tcp::no_delay(true), err);
+        open(conn);
+      });
+}
+
+void SeqrClient::open(const uint64_t conn)
+{
+  // exchange the log prefix for the handle used by requests
+  seqr::encode(seqr::Request{seqr::OPEN, 0, 0, 0, prefix_.size()},
+      open_buf_);
+  std::vector<boost::asio::const_buffer> out{
+    boost::asio::buffer(open_buf_, sizeof(open_buf_)),
+    boost::asio::buffer(prefix_)
+  };
+
+  boost::asio::async_write(socket_, out,
+      [this, conn](const boost::system::error_code& ec, size_t) {
+        if (ec) {
+          failed(conn, error(ec));
+          return;
+        }
+        {
+          std::lock_guard<std::mutex> lk(lock_);
+          if (conn != conn_) {
+            return;
+          }
+        }
+        boost::asio::async_read(socket_,
+            boost::asio::buffer(open_buf_, sizeof(open_buf_)),
+            [this, conn](const boost::system::error_code& ec, size_t) {
+              if (ec) {
+                failed(conn, error(ec));
+                return;
+              }
+
+              seqr::Reply reply;
+              seqr::decode(open_buf_, &reply);
+
+              std::lock_guard<std::mutex> lk(lock_);
+              if (conn != conn_) {
+                return;
+              }
+              if (reply.ret) {
+                fail(reply.ret);
+                return;
+              }
+
+              handle_ = static_cast<uint32_t>(reply.position);
+              connecting_ = false;
+              connected_ = true;
+              len_ = 0;
+              read(conn);
+              if (!out_.empty()) {
+                writing_ = true;
+                boost::asio::post(io_context_, [this, conn] { write(conn); });
+              }
+            });
+      });
+}
+
+void SeqrClient::write(const uint64_t conn)
+{
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (conn != conn_) {
+      return;
+    }
+    if (out_.empty()) {
+      writing_ = false;
+      return;
+    }
+    wbuf_.resize(out_.size() * seqr::kMessageSize);
+    for (size_t i = 0; i < out_.size(); i++) {
+      out_[i].log = handle_;
+      seqr::encode(out_[i], &wbuf_[i * seqr::kMessageSize]);
+    }
+    out_.clear();
+  }
+
+  // keep writing until no more requests are queued
+  boost::asio::async_write(socket_, boost::asio::buffer(wbuf_),
+      [this, conn](const boost::system::error_code& ec, size_t) {
+        if (ec) {
+          failed(conn, error(ec));
+          return;
+        }
+        write(conn);
+      });
+}
+
+void SeqrClient::read(const uint64_t conn)
+{
+  socket_.async_read_some(
+      boost::asio::buffer(in_.data() + len_, in_.size() - len_),
+      [this, conn](const boost::system::error_code& ec, size_t size) {
+        if (ec) {
+          failed(conn, error(ec));
+          return;
+        }
+
+        std::lock_guard<std::mutex> lk(lock_);
+        if (conn != conn_) {
+          return;
+        }
+
+        len_ += size;
+        size_t offset = 0;
+        for (; len_ - offset >= seqr::kMessageSize;
+             offset += seqr::kMessageSize) {
+          seqr::Reply reply;
+          seqr::decode(in_.data() + offset, &reply);
+          auto it = pending_.find(reply.tag);
+          if (it == pending_.end()) {
+            continue;
+          }
+          it->second->done = true;
+          it->second->ret = reply.ret;
+          it->second->position = reply.position;
+          it->second->cond.notify_one();
+          pending_.erase(it);
+        }
+
+        len_ -= offset;
+        std::memmove(in_.data(), in_.data() + offset, len_);
+
+        read(conn);
+      });
+}
+
+void SeqrClient::failed(const uint64_t conn, const int ret)
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  if (conn == conn_) {
+    fail(ret);
+  }
+}
+
+void SeqrClient::fail(const int ret)
+{
+  for (auto& it : pending_) {
+    it.second->done = true;
+    it.second->ret = ret;
+    it.second->cond.notify_one();
+  }
+  pending_.clear();
+  out_.clear();
+
+  if (!connecting_ && !connected_) {
+    return;
+  }
+
+  connecting_ = false;
+  connected_ = false;
+  writing_ = false;
+
+  // only the i/o thread touches the socket. handlers for the failed
+  // connection see that it is no longer current once they run, and stop.
+  conn_++;
+  boost::asio::post(io_context_, [this] {
+    boost::system::error_code ec;
+    socket_.close(ec);
+  });
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "seqr_protocol.h"
+
+namespace zlog {
+
+// SeqrClient is a connection to the zlog-seqr server that sequences a log.
+//
+// requests from concurrent threads are pipelined over a single connection.
+// the connection is owned by an i/o thread: requests are queued by the
+// calling threads and written by the i/o thread along with any others that
+// are queued while it is writing, and it matches replies to waiting requests.
+// the connection is made by the first request, and is remade by the first
+// request after it fails. requests that are outstanding when the connection
+// fails return an error. a request that isn't answered within timeout_ms
+// returns -ETIMEDOUT, and fails the connection.
+class SeqrClient {
+ public:
+  // address is host:port, and prefix identifies the log on the server
+  SeqrClient(const std::string& address, const std::string& prefix,
+      int timeout_ms = 10000);
+
+  SeqrClient(const SeqrClient&) = delete;
+  SeqrClient& operator=(const SeqrClient&) = delete;
+
+  ~SeqrClient();
+
+  // reserve count consecutive positions from the sequencer configuration
+  // with the given epoch, and return the first.
+  int next(uint64_t epoch, uint64_t count, uint64_t *position);
+
+  // return the next position without reserving it
+  int tail(uint64_t epoch, uint64_t *position);
+
+  const std::string& address() const {
+    return address_;
+  }
+
+ private:
+  struct Pending {
+    bool done = false;
+    int ret = 0;
+    uint64_t position = 0;
+    std::condition_variable cond;
+  };
+
+  int request(uint32_t op, uint64_t epoch, uint64_t count,
+      uint64_t *position);
+  int send(uint32_t op, uint64_t epoch, uint64_t count, uint64_t *position);
+
+  // run on the i/o thread. each is passed the connection that it works on,
+  // and does nothing once that connection has failed.
+  void connect(uint64_t conn);
+  void open(uint64_t conn);
+  void write(uint64_t conn);
+  void read(uint64_t conn);
+
+  // fail the connection, unless it has already failed
+  void failed(uint64_t conn, int ret);
+
+  // complete outstanding requests with ret, and have the i/o thread close
+  // the connection. the lock is held.
+  void fail(int ret);
+
+  const std::string address_;
+  const std::string prefix_;
+  const std::chrono::milliseconds timeout_;
+
+  // only used by the i/o thread
+  boost::asio::io_context io_context_;
+  boost::asio::executor_work_guard<
+    boost::asio::io_context::executor_type> work_;
+  boost::asio::ip::tcp::socket socket_;
+  char open_buf_[seqr::kMessageSize];
+  std::string wbuf_;
+  std::vector<char> in_;
+  size_t len_;
+
+  std::mutex lock_;
+  bool shutdown_;
+  bool connecting_;
+  bool connected_;
+  bool writing_;
+  uint64_t conn_;
+  uint32_t handle_;
+  uint64_t next_tag_;
+  std::vector<seqr::Request> out_;
+  std::map<uint64_t, Pending*> pending_;
+
+  std::thread io_thread_;
+};
+
+}
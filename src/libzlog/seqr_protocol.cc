@@ -0,0 +1,75 @@
+#include "seqr_protocol.h"
+
+namespace zlog {
+namespace seqr {
+
+static void put32(char *buf, const uint32_t val)
+{
+  for (int i = 0; i < 4; i++) {
+    buf[i] = static_cast<char>(val >> (8 * i));
+  }
+}
+
+static void put64(char *buf, const uint64_t val)
+{
+  for (int i = 0; i < 8; i++) {
+    buf[i] = static_cast<char>(val >> (8 * i));
+  }
+}
+
+static uint32_t get32(const char *buf)
+{
+  uint32_t val = 0;
+  for (int i = 0; i < 4; i++) {
+    val |= static_cast<uint32_t>(static_cast<unsigned char>(buf[i])) << (8 * i);
+  }
+  return val;
+}
+
+static uint64_t get64(const char *buf)
+{
+  uint64_t val = 0;
+  for (int i = 0; i < 8; i++) {
+    val |= static_cast<uint64_t>(static_cast<unsigned char>(buf[i])) << (8 * i);
+  }
+  return val;
+}
+
+void encode(const Request& req, char *buf)
+{
+  put32(buf, req.op);
+  put32(buf + 4, req.log);
+  put64(buf + 8, req.tag);
+  put64(buf + 16, req.epoch);
+  put64(buf + 24, req.count);
+}
+
+void decode(const char *buf, Request *req)
+{
+  req->op = get32(buf);
+  req->log = get32(buf + 4);
+  req->tag = get64(buf + 8);
+  req->epoch = get64(buf + 16);
+  req->count = get64(buf + 24);
+}
+
+void encode(const Reply& reply, char *buf)
+{
+  put32(buf, static_cast<uint32_t>(reply.ret));
+  put32(buf + 4, reply.log);
+  put64(buf + 8, reply.tag);
+  put64(buf + 16, reply.epoch);
+  put64(buf + 24, reply.position);
+}
+
+void decode(const char *buf, Reply *reply)
+{
+  reply->ret = static_cast<int32_t>(get32(buf));
+  reply->log = get32(buf + 4);
+  reply->tag = get64(buf + 8);
+  reply->epoch = get64(buf + 16);
+  reply->position = get64(buf + 24);
+}
+
+}
+}
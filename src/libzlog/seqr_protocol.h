@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace zlog {
+namespace seqr {
+
+// the zlog-seqr protocol exchanges fixed size messages over a tcp connection,
+// with every field encoded little-endian. a client may send any number of
+// requests without waiting for replies, and the server replies to them in
+// order. the tag of a request is returned in its reply.
+//
+// OPEN is followed by count bytes holding the prefix of a log, and is replied
+// to with a handle (position) that identifies the log in other requests on
+// the connection. NEXT reserves count consecutive positions and is replied to
+// with the first one. TAIL is replied to with the next position without
+// reserving it.
+//
+// NEXT and TAIL carry the epoch of the sequencer configuration that names the
+// server in the client's view. a reply with ret set to -ESPIPE means that the
+// server's sequencer configuration is newer (reply epoch), or that the server
+// is no longer the log's sequencer. -EAGAIN means that the server hasn't yet
+// seen the client's configuration, and the request may be retried.
+
+static const size_t kMessageSize = 32;
+static const size_t kMaxPrefixSize = 1024;
+static const uint64_t kMaxCount = 1ULL << 20;
+
+enum Op : uint32_t {
+  OPEN = 1,
+  NEXT = 2,
+  TAIL = 3,
+};
+
+struct Request {
+  uint32_t op;
+  uint32_t log;
+  uint64_t tag;
+  uint64_t epoch;
+  uint64_t count;
+};
+
+struct Reply {
+  int32_t ret;
+  uint32_t log;
+  uint64_t tag;
+  uint64_t epoch;
+  uint64_t position;
+};
+
+// encode into / decode from kMessageSize bytes
+void encode(const Request& req, char *buf);
+void decode(const char *buf, Request *req);
+void encode(const Reply& reply, char *buf);
+void decode(const char *buf, Reply *reply);
+
+}
+}
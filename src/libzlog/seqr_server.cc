@@ -0,0 +1,361 @@
+#include "seqr_server.h"
+#include <cerrno>
+#include <cstring>
+#include "log_impl.h"
+
+namespace zlog {
+
+using boost::asio::ip::tcp;
+
+// a connection stops reading requests while this many bytes of replies are
+// waiting to be written
+static const size_t kMaxPendingReplies = 1 << 20;
+
+class SeqrServer::Session :
+  public std::enable_shared_from_this<SeqrServer::Session> {
+ public:
+  Session(SeqrServer *server, tcp::socket socket) :
+    server_(server),
+    socket_(std::move(socket)),
+    in_(64 * 1024),
+    len_(0),
+    writing_(false),
+    paused_(false)
+  {}
+
+  void start() {
+    boost::system::error_code ec;
+    socket_.set_option(tcp::no_delay(true), ec);
+    read();
+  }
+
+ private:
+  void read() {
+    auto self(shared_from_this());
+    socket_.async_read_some(
+        boost::asio::buffer(in_.data() + len_, in_.size() - len_),
+        [this, self](const boost::system::error_code& ec, size_t size) {
+          if (ec) {
+            return;
+          }
+          len_ += size;
+          if (!process()) {
+            boost::system::error_code err;
+            socket_.close(err);
+            return;
+          }
+          if (out_.size() < kMaxPendingReplies) {
+            read();
+          } else {
+            paused_ = true;
+          }
+        });
+  }
+
+  void write() {
+    auto self(shared_from_this());
+    writing_ = true;
+    wbuf_.swap(out_);
+    boost::asio::async_write(socket_, boost::asio::buffer(wbuf_),
+        [this, self](const boost::system::error_code& ec, size_t size) {
+          writing_ = false;
+          wbuf_.clear();
+          if (ec) {
+            return;
+          }
+          if (!out_.empty()) {
+            write();
+          }
+          if (paused_) {
+            paused_ = false;
+            read();
+          }
+        });
+  }
+
+  // handle the complete requests that have been read. returns false if the
+  // connection should be closed.
+  bool process() {
+    size_t offset = 0;
+    while (len_ - offset >= seqr::kMessageSize) {
+      seqr::Request req;
+      seqr::decode(in_.data() + offset, &req);
+
+      seqr::Reply reply{0, req.log, req.tag, 0, 0};
+
+      if (req.op == seqr::OPEN) {
+        if (req.count > seqr::kMaxPrefixSize) {
+          return false;
+        }
+        if (len_ - offset < seqr::kMessageSize + req.count) {
+          break;
+        }
+        const std::string prefix(in_.data() + offset + seqr::kMessageSize,
+            req.count);
+        offset += req.count;
+        auto state = server_->find_log(prefix);
+        if (state) {
+          reply.position = logs_.size();
+          logs_.push_back(state);
+        } else {
+          reply.ret = -ENOENT;
+        }
+      } else if (req.log < logs_.size()) {
+        reply = server_->handle(logs_[req.log], req);
+      } else {
+        reply.ret = -EBADF;
+      }
+
+      offset += seqr::kMessageSize;
+
+      const auto out_offset = out_.size();
+      out_.resize(out_offset + seqr::kMessageSize);
+      seqr::encode(reply, &out_[out_offset]);
+    }
+
+    len_ -= offset;
+    std::memmove(in_.data(), in_.data() + offset, len_);
+
+    if (!writing_ && !out_.empty()) {
+      write();
+    }
+
+    return true;
+  }
+
+  SeqrServer * const server_;
+  tcp::socket socket_;
+
+  std::vector<char> in_;
+  size_t len_;
+
+  // replies are added to out_ while wbuf_ is being written
+  std::string out_;
+  std::string wbuf_;
+  bool writing_;
+  bool paused_;
+
+  // logs opened on the connection, indexed by handle
+  std::vector<LogState*> logs_;
+};
+
+SeqrServer::SeqrServer(const std::string& host) :
+  host_(host),
+  acceptor_(io_context_),
+  shutdown_(false),
+  connections_(0),
+  requests_(0),
+  positions_(0),
+  stale_(0)
+{}
+
+int SeqrServer::Start(const std::string& host, const uint16_t port,
+    const int threads, SeqrServer **server_out)
+{
+  if (threads <= 0) {
+    return -EINVAL;
+  }
+
+  std::unique_ptr<SeqrServer> server(new SeqrServer(host));
+
+  boost::system::error_code ec;
+  const auto addr = boost::asio::ip::make_address(host, ec);
+  if (ec) {
+    return -EINVAL;
+  }
+
+  const tcp::endpoint endpoint(addr, port);
+  server->acceptor_.open(endpoint.protocol(), ec);
+  if (!ec) {
+    server->acceptor_.set_option(tcp::acceptor::reuse_address(true), ec);
+  }
+  if (!ec) {
+    server->acceptor_.bind(endpoint, ec);
+  }
+  if (!ec) {
+    server->acceptor_.listen(boost::asio::socket_base::max_listen_connections,
+        ec);
+  }
+  if (ec) {
+    return ec.category() == boost::system::system_category() ?
+      -ec.value() : -EINVAL;
+  }
+
+  server->accept();
+
+  server->refresh_thread_ = std::thread(&SeqrServer::refresh_entry_,
+      server.get());
+  for (int i = 0; i < threads; i++) {
+    auto s = server.get();
+    server->threads_.emplace_back([s] { s->io_context_.run(); });
+  }
+
+  *server_out = server.release();
+
+  return 0;
+}
+
+SeqrServer::~SeqrServer()
+{
+  io_context_.stop();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(lock_);
+    shutdown_ = true;
+  }
+  refresh_cond_.notify_one();
+  if (refresh_thread_.joinable()) {
+    refresh_thread_.join();
+  }
+}
+
+std::string SeqrServer::address() const
+{
+  return host_ + ":" + std::to_string(acceptor_.local_endpoint().port());
+}
+
+void SeqrServer::accept()
+{
+  acceptor_.async_accept(boost::asio::make_strand(io_context_),
+      [this](const boost::system::error_code& ec, tcp::socket socket) {
+        if (!ec) {
+          connections_++;
+          std::make_shared<Session>(this, std::move(socket))->start();
+        }
+        accept();
+      });
+}
+
+int SeqrServer::add_log(LogImpl *log)
+{
+  const auto address = this->address();
+
+  while (true) {
+    const auto view = log->striper->view();
+    if (view->seq && !view->seq->remote() &&
+        view->seq_config()->address() == address) {
+      break;
+    }
+    int ret = log->striper->propose_sequencer(address);
+    if (ret) {
+      return ret;
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(lock_);
+  const auto prefix = log->backend->prefix();
+  if (logs_.count(prefix)) {
+    return -EEXIST;
+  }
+  logs_.emplace(prefix, std::unique_ptr<LogState>(new LogState(log)));
+
+  return 0;
+}
+
+SeqrServer::LogState *SeqrServer::find_log(const std::string& prefix)
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  auto it = logs_.find(prefix);
+  if (it == logs_.end()) {
+    return nullptr;
+  }
+  return it->second.get();
+}
+
+seqr::Reply SeqrServer::handle(LogState *state, const seqr::Request& req)
+{
+  seqr::Reply reply{0, req.log, req.tag, 0, 0};
+
+  requests_++;
+
+  // once another sequencer has been proposed, the log instance's view either
+  // has no sequencer or a connection to another server. in both cases the
+  // new configuration is newer than the one that names this server.
+  const auto view = state->log->striper->view();
+  if (!view->seq || view->seq->remote()) {
+    stale_++;
+    reply.ret = -ESPIPE;
+    reply.epoch = view->seq_config() ? view->seq_config()->epoch() : 0;
+    return reply;
+  }
+
+  reply.epoch = view->seq_config()->epoch();
+  if (req.epoch < reply.epoch) {
+    stale_++;
+    reply.ret = -ESPIPE;
+    return reply;
+  } else if (req.epoch > reply.epoch) {
+    // the client has seen a newer view than the server
+    stale_++;
+    refresh(state, view->epoch());
+    reply.ret = -EAGAIN;
+    return reply;
+  }
+
+  switch (req.op) {
+    case seqr::NEXT:
+      if (req.count == 0 || req.count > seqr::kMaxCount) {
+        reply.ret = -EINVAL;
+        break;
+      }
+      reply.ret = view->seq->reserve(req.count, &reply.position);
+      positions_ += req.count;
+      break;
+
+    case seqr::TAIL:
+      reply.ret = view->seq->check_tail(false, &reply.position);
+      break;
+
+    default:
+      reply.ret = -EINVAL;
+  }
+
+  return reply;
+}
+
+void SeqrServer::refresh(LogState *state, const uint64_t epoch)
+{
+  if (state->refreshing.exchange(true)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(lock_);
+  refresh_queue_.emplace_back(state, epoch);
+  refresh_cond_.notify_one();
+}
+
+void SeqrServer::refresh_entry_()
+{
+  while (true) {
+    std::pair<LogState*, uint64_t> req;
+    {
+      std::unique_lock<std::mutex> lk(lock_);
+      refresh_cond_.wait(lk, [this] {
+        return shutdown_ || !refresh_queue_.empty();
+      });
+      if (shutdown_) {
+        return;
+      }
+      req = refresh_queue_.front();
+      refresh_queue_.pop_front();
+    }
+
+    req.first->log->striper->update_current_view(req.second, true);
+    req.first->refreshing = false;
+  }
+}
+
+SeqrServer::Stats SeqrServer::stats() const
+{
+  Stats stats;
+  stats.connections = connections_;
+  stats.requests = requests_;
+  stats.positions = positions_;
+  stats.stale = stale_;
+  return stats;
+}
+
+}
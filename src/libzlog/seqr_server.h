@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "seqr_protocol.h"
+
+namespace zlog {
+
+class LogImpl;
+
+// SeqrServer hands out positions for the logs that it sequences (zlog-seqr).
+//
+// a log is added by proposing a view in which the server's log instance is
+// the sequencer, and the sequencer address is the server's address. clients
+// that read the view reserve positions from the server instead of proposing
+// themselves as the sequencer, so any number of writers share one sequence
+// without changing the view. the sequence itself is the server's log
+// instance's sequencer, and the server stops handing out positions for a log
+// once another sequencer has been proposed.
+//
+// connections are served by an asio event loop that is run by a pool of
+// threads, and the requests of a connection are handled one at a time.
+// requests that arrive together are answered with a single write.
+class SeqrServer {
+ public:
+  // listen on host:port, where a port of 0 picks an unused port. host must be
+  // an address that the logs' clients can connect to.
+  static int Start(const std::string& host, uint16_t port, int threads,
+      SeqrServer **server);
+
+  SeqrServer(const SeqrServer&) = delete;
+  SeqrServer& operator=(const SeqrServer&) = delete;
+
+  ~SeqrServer();
+
+  // host:port of the server
+  std::string address() const;
+
+  // become the sequencer of the log and start serving it. the log must
+  // outlive the server.
+  int add_log(LogImpl *log);
+
+  struct Stats {
+    uint64_t connections;
+    uint64_t requests;
+    uint64_t positions;
+    // requests rejected because of a sequencer change
+    uint64_t stale;
+  };
+
+  Stats stats() const;
+
+ private:
+  class Session;
+
+  struct LogState {
+    explicit LogState(LogImpl *log) :
+      log(log),
+      refreshing(false)
+    {}
+
+    LogImpl * const log;
+    std::atomic<bool> refreshing;
+  };
+
+  explicit SeqrServer(const std::string& host);
+
+  void accept();
+
+  LogState *find_log(const std::string& prefix);
+
+  seqr::Reply handle(LogState *state, const seqr::Request& req);
+
+  // wait for a view newer than epoch in the background
+  void refresh(LogState *state, uint64_t epoch);
+  void refresh_entry_();
+
+  const std::string host_;
+
+  boost::asio::io_context io_context_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  std::vector<std::thread> threads_;
+
+  mutable std::mutex lock_;
+  std::map<std::string, std::unique_ptr<LogState>> logs_;
+
+  bool shutdown_;
+  std::list<std::pair<LogState*, uint64_t>> refresh_queue_;
+  std::condition_variable refresh_cond_;
+  std::thread refresh_thread_;
+
+  std::atomic<uint64_t> connections_;
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> positions_;
+  std::atomic<uint64_t> stale_;
+};
+
+}
@@ -0,0 +1,87 @@
+#include <cerrno>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libzlog/seqr_client.h"
+#include "libzlog/seqr_protocol.h"
+#include "libzlog/seqr_server.h"
+
+TEST(SeqrTest, Protocol) {
+  char buf[zlog::seqr::kMessageSize];
+
+  zlog::seqr::Request req{zlog::seqr::NEXT, 7, 1ULL << 40, 33, 1ULL << 20};
+  zlog::seqr::encode(req, buf);
+  zlog::seqr::Request req2;
+  zlog::seqr::decode(buf, &req2);
+  ASSERT_EQ(req2.op, req.op);
+  ASSERT_EQ(req2.log, req.log);
+  ASSERT_EQ(req2.tag, req.tag);
+  ASSERT_EQ(req2.epoch, req.epoch);
+  ASSERT_EQ(req2.count, req.count);
+
+  // fields are little-endian
+  ASSERT_EQ(buf[0], 2);
+  ASSERT_EQ(buf[1], 0);
+
+  zlog::seqr::Reply reply{-ESPIPE, 3, 9, 44, UINT64_MAX};
+  zlog::seqr::encode(reply, buf);
+  zlog::seqr::Reply reply2;
+  zlog::seqr::decode(buf, &reply2);
+  ASSERT_EQ(reply2.ret, -ESPIPE);
+  ASSERT_EQ(reply2.log, reply.log);
+  ASSERT_EQ(reply2.tag, reply.tag);
+  ASSERT_EQ(reply2.epoch, reply.epoch);
+  ASSERT_EQ(reply2.position, reply.position);
+}
+
+TEST(SeqrTest, ClientErrors) {
+  uint64_t pos;
+
+  zlog::SeqrClient bad_address("localhost", "log");
+  ASSERT_EQ(bad_address.next(1, 1, &pos), -EINVAL);
+
+  zlog::SeqrClient client("127.0.0.1:1", "log");
+  ASSERT_EQ(client.next(1, 0, &pos), -EINVAL);
+  ASSERT_LT(client.next(1, 1, &pos), 0);
+  ASSERT_LT(client.tail(1, &pos), 0);
+}
+
+// a server that accepts connections and never replies
+TEST(SeqrTest, ClientTimeout) {
+  using boost::asio::ip::tcp;
+  boost::asio::io_context io_context;
+  tcp::acceptor acceptor(io_context,
+      tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+  const auto address = "127.0.0.1:" +
+    std::to_string(acceptor.local_endpoint().port());
+
+  std::vector<tcp::socket> sockets;
+  std::thread server([&] {
+    for (int i = 0; i < 2; i++) {
+      sockets.emplace_back(acceptor.accept());
+    }
+  });
+
+  zlog::SeqrClient client(address, "log", 100);
+  uint64_t pos;
+  ASSERT_EQ(client.next(1, 1, &pos), -ETIMEDOUT);
+
+  // the connection is remade by the next request
+  ASSERT_EQ(client.tail(1, &pos), -ETIMEDOUT);
+  server.join();
+}
+
+TEST(SeqrTest, UnknownLog) {
+  zlog::SeqrServer *server;
+  ASSERT_EQ(zlog::SeqrServer::Start("127.0.0.1", 0, 1, &server), 0);
+  std::unique_ptr<zlog::SeqrServer> server_ptr(server);
+
+  zlog::SeqrClient client(server->address(), "log");
+  uint64_t pos;
+  ASSERT_EQ(client.next(1, 1, &pos), -ENOENT);
+  ASSERT_EQ(server->stats().connections, 1u);
+  ASSERT_EQ(server->stats().requests, 0u);
+
+  ASSERT_EQ(zlog::SeqrServer::Start("bad host", 0, 1, &server), -EINVAL);
+}
@@ -1,8 +1,80 @@
 #include "sequencer.h"
 #include <boost/optional.hpp>
+#include "seqr_client.h"
 
 namespace zlog {
 
+int Sequencer::remote_check_tail(const bool next, uint64_t *position)
+{
+  if (next) {
+    return client_->next(config_epoch_, 1, position);
+  }
+  return client_->tail(config_epoch_, position);
+}
+
+int Sequencer::remote_reserve(const uint64_t count, uint64_t *first)
+{
+  return client_->next(config_epoch_, count, first);
+}
+
+int Sequencer::lease_next(uint64_t *position)
+{
+  auto lease = leases_->Access();
+  std::lock_guard<std::mutex> lk(lease->lock);
+  if (lease->next == lease->end) {
+    // drain_leases() closes the leases before it visits each one under its
+    // lock, so a lease taken here is either returned by a concurrent drain or
+    // not taken at all.
+    if (leases_closed_.load()) {
+      *position = position_.fetch_add(1);
+      return 0;
+    }
+    lease->next = position_.fetch_add(lease_size_);
+    lease->end = lease->next + lease_size_;
+  }
+  *position = lease->next++;
+  lease->used = true;
+  return 0;
+}
+
+void Sequencer::drain_leases(
+    std::vector<std::pair<uint64_t, uint64_t>> *unused)
+{
+  if (!leases_) {
+    return;
+  }
+
+  leases_closed_ = true;
+
+  for (size_t i = 0; i < leases_->Size(); i++) {
+    auto lease = leases_->AccessAtCore(i);
+    std::lock_guard<std::mutex> lk(lease->lock);
+    if (lease->next < lease->end) {
+      unused->emplace_back(lease->next, lease->end);
+      lease->next = lease->end;
+    }
+  }
+}
+
+void Sequencer::expire_leases(
+    std::vector<std::pair<uint64_t, uint64_t>> *unused)
+{
+  if (!leases_) {
+    return;
+  }
+
+  for (size_t i = 0; i < leases_->Size(); i++) {
+    auto lease = leases_->AccessAtCore(i);
+    std::lock_guard<std::mutex> lk(lease->lock);
+    if (lease->used) {
+      lease->used = false;
+    } else if (lease->next < lease->end) {
+      unused->emplace_back(lease->next, lease->end);
+      lease->next = lease->end;
+    }
+  }
+}
+
 boost::optional<SequencerConfig> SequencerConfig::decode(
       const zlog::fbs::Sequencer *seq)
 {
@@ -14,7 +86,8 @@ boost::optional<SequencerConfig> SequencerConfig::decode(
     SequencerConfig conf(
         seq->epoch(),
         token,
-        seq->position());
+        seq->position(),
+        flatbuffers::GetString(seq->address()));
 
     return conf;
   }
@@ -29,7 +102,8 @@ flatbuffers::Offset<zlog::fbs::Sequencer> SequencerConfig::encode(
   return zlog::fbs::CreateSequencerDirect(fbb,
       epoch_,
       token_.c_str(),
-      position_);
+      position_,
+      address_.empty() ? nullptr : address_.c_str());
 }
 
 nlohmann::json SequencerConfig::dump() const
@@ -38,6 +112,7 @@ nlohmann::json SequencerConfig::dump() const
   j["epoch"] = epoch_;
   j["token"] = token_;
   j["position"] = position_;
+  j["address"] = address_;
   return j;
 }
 
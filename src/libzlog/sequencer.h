@@ -1,24 +1,99 @@
 #pragma once
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include <boost/optional.hpp>
 #include "libzlog/zlog_generated.h"
+#include "port/port_posix.h"
+#include "util/core_local.h"
 #include <nlohmann/json.hpp>
 
 namespace zlog {
 
+class SeqrClient;
+
 class Sequencer {
  public:
-  explicit Sequencer(uint64_t epoch, uint64_t position) :
+  // when lease_size is non-zero, positions returned by next() are taken from
+  // ranges of lease_size positions that are leased by each core.
+  Sequencer(uint64_t epoch, uint64_t position, uint32_t lease_size = 0) :
+    epoch_(epoch),
+    position_(position),
+    config_epoch_(0),
+    lease_size_(lease_size),
+    leases_(lease_size ? new CoreLocalArray<Lease>() : nullptr),
+    leases_closed_(false)
+  {}
+
+  // a sequencer whose positions are handed out by a zlog-seqr server. the
+  // config epoch identifies the server's sequencer configuration.
+  Sequencer(uint64_t epoch, uint64_t config_epoch,
+      std::shared_ptr<SeqrClient> client) :
     epoch_(epoch),
-    position_(position)
+    position_(0),
+    config_epoch_(config_epoch),
+    client_(client),
+    lease_size_(0),
+    leases_closed_(false)
   {}
 
-  uint64_t check_tail(bool next) {
+  // return the next position, reserving it if next is true. a remote
+  // sequencer returns -ESPIPE when the log has a newer sequencer, and the
+  // errors of the connection to the server.
+  int check_tail(bool next, uint64_t *position) {
+    if (client_) {
+      return remote_check_tail(next, position);
+    }
     if (next) {
-      return position_.fetch_add(1);
+      *position = position_.fetch_add(1);
     } else {
-      return position_.load();
+      *position = position_.load();
+    }
+    return 0;
+  }
+
+  // reserve a position for an append whose position doesn't need to follow
+  // the positions of the appends made before it. with leasing enabled the
+  // position comes from the calling core's lease, so positions are not handed
+  // out in order, and the positions that a lease still holds are neither
+  // written nor filled until they are used or the leases are drained.
+  int next(uint64_t *position) {
+    if (leases_) {
+      return lease_next(position);
+    }
+    return check_tail(true, position);
+  }
+
+  // return the unused ranges [first, end) of all leases, and stop leasing.
+  // next() reserves positions one at a time once the leases are drained.
+  void drain_leases(std::vector<std::pair<uint64_t, uint64_t>> *unused);
+
+  // return the unused ranges of the leases that haven't been used since the
+  // previous call. a core whose lease is returned takes a new lease on its
+  // next append.
+  void expire_leases(std::vector<std::pair<uint64_t, uint64_t>> *unused);
+
+  bool leasing() const {
+    return leases_ != nullptr;
+  }
+
+  // reserve count consecutive positions and return the first
+  int reserve(uint64_t count, uint64_t *first) {
+    if (client_) {
+      return remote_reserve(count, first);
     }
+    *first = position_.fetch_add(count);
+    return 0;
+  }
+
+  bool remote() const {
+    return client_ != nullptr;
+  }
+
+  const std::shared_ptr<SeqrClient>& client() const {
+    return client_;
   }
 
   // TODO: why?
@@ -27,17 +102,42 @@ class Sequencer {
   }
 
  private:
+  int remote_check_tail(bool next, uint64_t *position);
+  int remote_reserve(uint64_t count, uint64_t *first);
+  int lease_next(uint64_t *position);
+
+  // a core's lease holds the positions [next, end). used is set by each
+  // append and cleared by expire_leases().
+  struct Lease {
+    std::mutex lock;
+    uint64_t next = 0;
+    uint64_t end = 0;
+    bool used = false;
+    char padding[(CACHE_LINE_SIZE -
+        (sizeof(std::mutex) + 2 * sizeof(uint64_t) + sizeof(bool)) %
+        CACHE_LINE_SIZE)];
+  };
+
   const uint64_t epoch_;
   std::atomic<uint64_t> position_;
+  const uint64_t config_epoch_;
+  const std::shared_ptr<SeqrClient> client_;
+
+  const uint32_t lease_size_;
+  const std::unique_ptr<CoreLocalArray<Lease>> leases_;
+  std::atomic<bool> leases_closed_;
 };
 
 class SequencerConfig {
  public:
+  // address is host:port of the zlog-seqr server that hands out positions,
+  // or empty when positions are handed out by the log client holding token.
   SequencerConfig(uint64_t epoch, const std::string& token,
-      uint64_t position) :
+      uint64_t position, const std::string& address = "") :
     epoch_(epoch),
     token_(token),
-    position_(position)
+    position_(position),
+    address_(address)
   {}
 
  public:
@@ -62,17 +162,23 @@ class SequencerConfig {
     return position_;
   }
 
+  std::string address() const {
+    return address_;
+  }
+
   bool operator==(const SequencerConfig& other) const {
     return
       epoch_ == other.epoch_ &&
       token_ == other.token_ &&
-      position_ == other.position_;
+      position_ == other.position_ &&
+      address_ == other.address_;
   }
 
  private:
   uint64_t epoch_;
   std::string token_;
   uint64_t position_;
+  std::string address_;
 };
 
 }
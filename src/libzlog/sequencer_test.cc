@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libzlog/sequencer.h"
+
+TEST(SequencerTest, Next) {
+  zlog::Sequencer seq(1, 10);
+  ASSERT_FALSE(seq.leasing());
+
+  uint64_t pos;
+  ASSERT_EQ(seq.next(&pos), 0);
+  ASSERT_EQ(pos, 10u);
+  ASSERT_EQ(seq.next(&pos), 0);
+  ASSERT_EQ(pos, 11u);
+
+  std::vector<std::pair<uint64_t, uint64_t>> unused;
+  seq.drain_leases(&unused);
+  ASSERT_TRUE(unused.empty());
+}
+
+TEST(SequencerTest, Lease) {
+  zlog::Sequencer seq(1, 10, 8);
+  ASSERT_TRUE(seq.leasing());
+
+  // the first position takes a lease
+  uint64_t pos;
+  ASSERT_EQ(seq.next(&pos), 0);
+  ASSERT_EQ(pos, 10u);
+  ASSERT_EQ(seq.check_tail(false, &pos), 0);
+  ASSERT_EQ(pos, 18u);
+
+  // reservations aren't leased
+  ASSERT_EQ(seq.reserve(3, &pos), 0);
+  ASSERT_EQ(pos, 18u);
+  ASSERT_EQ(seq.check_tail(true, &pos), 0);
+  ASSERT_EQ(pos, 21u);
+
+  std::vector<std::pair<uint64_t, uint64_t>> unused;
+  seq.drain_leases(&unused);
+  ASSERT_EQ(unused.size(), 1u);
+  ASSERT_EQ(unused[0].first, 11u);
+  ASSERT_EQ(unused[0].second, 18u);
+
+  // positions are handed out one at a time after a drain
+  ASSERT_EQ(seq.next(&pos), 0);
+  ASSERT_EQ(pos, 22u);
+  ASSERT_EQ(seq.next(&pos), 0);
+  ASSERT_EQ(pos, 23u);
+
+  unused.clear();
+  seq.drain_leases(&unused);
+  ASSERT_TRUE(unused.empty());
+}
+
+TEST(SequencerTest, LeaseConcurrent) {
+  zlog::Sequencer seq(1, 0, 4);
+
+  const int num_threads = 8;
+  const int per_thread = 1000;
+  std::vector<std::vector<uint64_t>> positions(num_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < per_thread; i++) {
+        uint64_t pos;
+        ASSERT_EQ(seq.next(&pos), 0);
+        positions[t].push_back(pos);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> unused;
+  seq.drain_leases(&unused);
+
+  // every position below the tail is either handed out or unused, once
+  std::set<uint64_t> seen;
+  for (const auto& p : positions) {
+    for (const auto pos : p) {
+      ASSERT_TRUE(seen.insert(pos).second);
+    }
+  }
+  for (const auto& range : unused) {
+    ASSERT_LT(range.first, range.second);
+    for (auto pos = range.first; pos < range.second; pos++) {
+      ASSERT_TRUE(seen.insert(pos).second);
+    }
+  }
+
+  uint64_t tail;
+  ASSERT_EQ(seq.check_tail(false, &tail), 0);
+  ASSERT_EQ(seen.size(), tail);
+  ASSERT_EQ(*seen.rbegin(), tail - 1);
+}
@@ -1,7 +1,8 @@
 #include "striper.h"
 #include "log_impl.h"
+#include <algorithm>
+#include <atomic>
 #include <iterator>
-#include <numeric>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -161,47 +162,96 @@ int Striper::try_expand_view(const uint64_t position)
   return ret;
 }
 
-int Striper::seal_stripe(const Stripe& stripe, uint64_t epoch,
-    uint64_t *pposition, bool *pempty) const
+int Striper::parallel_for(const size_t count,
+    const std::function<int(size_t)>& fn) const
 {
-  auto& oids = stripe.oids();
-  assert(!oids.empty());
+  std::atomic<size_t> next(0);
+  std::atomic<int> error(0);
 
-  for (auto& oid : oids) {
-    int ret = backend_->Seal(oid, epoch);
-    if (ret < 0) {
-      return ret;
+  auto worker = [&] {
+    while (!error.load()) {
+      const auto i = next++;
+      if (i >= count) {
+        break;
+      }
+      int ret = fn(i);
+      if (ret) {
+        int expected = 0;
+        error.compare_exchange_strong(expected, ret);
+      }
     }
-  }
+  };
 
-  bool stripe_empty = true;
-  // max pos only defined for non-empty stripe
-  uint64_t stripe_max_pos = 0;
+  const auto num_threads = std::min<size_t>(count,
+      std::max<uint32_t>(options_.sequencer_takeover_threads, 1));
 
-  for (auto& oid : oids) {
-    bool empty;
-    uint64_t max_pos;
-    int ret = backend_->MaxPos(oid, epoch, &max_pos, &empty);
-    if (ret < 0) {
-      return ret;
-    }
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
 
-    if (empty) {
-      continue;
-    }
+  return error;
+}
 
-    stripe_empty = false;
-    stripe_max_pos = std::max(stripe_max_pos, max_pos);
+static std::vector<std::string> stripe_oids(const ObjectMap& object_map,
+    const uint64_t first, const uint64_t end)
+{
+  std::vector<std::string> oids;
+  for (auto stripe_id = first; stripe_id < end; stripe_id++) {
+    const auto stripe = object_map.stripe_by_id(stripe_id);
+    assert(!stripe.oids().empty());
+    oids.insert(oids.end(), stripe.oids().begin(), stripe.oids().end());
   }
+  return oids;
+}
+
+int Striper::seal_stripes(const ObjectMap& object_map, const uint64_t first,
+    const uint64_t end, const uint64_t epoch) const
+{
+  const auto oids = stripe_oids(object_map, first, end);
+  return parallel_for(oids.size(), [&](size_t i) {
+    int ret = backend_->Seal(oids[i], epoch);
+    return ret < 0 ? ret : 0;
+  });
+}
 
-  if (pempty) {
-    *pempty = stripe_empty;
+int Striper::max_position(const ObjectMap& object_map, const uint64_t first,
+    const uint64_t end, const uint64_t epoch, uint64_t *pposition,
+    bool *pempty) const
+{
+  const auto oids = stripe_oids(object_map, first, end);
+
+  std::vector<uint64_t> max_pos(oids.size());
+  // vector<bool> elements can't be set concurrently
+  std::unique_ptr<bool[]> empty(new bool[oids.size()]);
+
+  int ret = parallel_for(oids.size(), [&](size_t i) {
+    int ret = backend_->MaxPos(oids[i], epoch, &max_pos[i], &empty[i]);
+    return ret < 0 ? ret : 0;
+  });
+  if (ret) {
+    return ret;
   }
 
-  if (pposition) {
-    if (!stripe_empty) {
-      *pposition = stripe_max_pos;
+  bool stripes_empty = true;
+  // max pos only defined for non-empty stripes
+  uint64_t stripes_max_pos = 0;
+
+  for (size_t i = 0; i < oids.size(); i++) {
+    if (empty[i]) {
+      continue;
     }
+    stripes_empty = false;
+    stripes_max_pos = std::max(stripes_max_pos, max_pos[i]);
+  }
+
+  *pempty = stripes_empty;
+  if (!stripes_empty) {
+    *pposition = stripes_max_pos;
   }
 
   return 0;
@@ -230,7 +280,7 @@ int Striper::advance_min_valid_position(const uint64_t position)
   return ret;
 }
 
-int Striper::propose_sequencer()
+int Striper::propose_sequencer(const std::string& address)
 {
   // read: the current view
   auto curr_view = view();
@@ -240,41 +290,32 @@ int Striper::propose_sequencer()
   // max pos only defined for non-empty log
   uint64_t max_pos;
 
-  // find the maximum position written. the maximum position written is
-  // contained in the first non-empty stripe scanning in reverse, beginning with
-  // the stripe that maps the maximum possible position for the current view.
-
-  std::vector<uint64_t> stripe_ids(curr_view->object_map().num_stripes());
-  std::iota(std::begin(stripe_ids), std::end(stripe_ids), 0);
-
-  auto it = stripe_ids.crbegin();
-  for (; it != stripe_ids.crend(); it++) {
-    const auto stripe = curr_view->object_map().stripe_by_id(*it);
-    int ret = seal_stripe(stripe, next_epoch, &max_pos, &empty);
-    if (ret < 0) {
-      if (ret == -ESPIPE) {
-        update_current_view(curr_view->epoch(), true);
-        return 0;
-      }
-      return ret;
+  // seal every stripe. besides making the maximum position stable, this
+  // signals to clients connected / using other sequencers that they should
+  // grab a new view to see the new sequencer.
+  const auto& object_map = curr_view->object_map();
+  const auto num_stripes = object_map.num_stripes();
+  int ret = seal_stripes(object_map, 0, num_stripes, next_epoch);
+  if (ret < 0) {
+    if (ret == -ESPIPE) {
+      update_current_view(curr_view->epoch(), true);
+      return 0;
     }
-
-    if (empty) {
-      continue;
-    }
-
-    it++;
-    break;
+    return ret;
   }
 
-  assert(!empty || it == stripe_ids.crend());
-
-  // seal all other stripes. this is not to guarantee that the max is valid, but
-  // rather to signal to clients connected / using other sequencers that they
-  // should grab a new view to see the new sequencer.
-  for (; it != stripe_ids.crend(); it++) {
-    const auto stripe = curr_view->object_map().stripe_by_id(*it);
-    int ret = seal_stripe(stripe, next_epoch, nullptr, nullptr);
+  // find the maximum position written. it is contained in the first non-empty
+  // stripe scanning in reverse from the stripe that maps the maximum possible
+  // position for the current view, which is usually one of the last few
+  // stripes. the scan gallops, reading the maximum of windows of stripes that
+  // double in size. every stripe of a window is read: stripes below the
+  // maximum may be empty when their positions were never written, so the
+  // search can't bisect on emptiness.
+  uint64_t end = num_stripes;
+  uint64_t window = 2;
+  while (empty && end > 0) {
+    const auto first = end > window ? end - window : 0;
+    ret = max_position(object_map, first, end, next_epoch, &max_pos, &empty);
     if (ret < 0) {
       if (ret == -ESPIPE) {
         update_current_view(curr_view->epoch(), true);
@@ -282,6 +323,8 @@ int Striper::propose_sequencer()
       }
       return ret;
     }
+    end = first;
+    window *= 2;
   }
 
   // new sequencer configuration.  the epoch used here is the epoch at which the
@@ -293,14 +336,15 @@ int Striper::propose_sequencer()
   SequencerConfig seq_config(
       next_epoch,
       backend_->token(),
-      empty ? 0 : (max_pos + 1));
+      empty ? 0 : (max_pos + 1),
+      address);
 
   // modify: the view by setting a new sequencer configuration
   auto new_view = curr_view->set_sequencer_config(seq_config);
 
   // write: the proposed new view
   auto data = new_view.encode();
-  int ret = backend_->ProposeView(next_epoch, data);
+  ret = backend_->ProposeView(next_epoch, data);
   if (!ret || ret == -ESPIPE) {
     update_current_view(curr_view->epoch(), true);
     return 0;
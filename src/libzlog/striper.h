@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <list>
@@ -62,6 +63,15 @@ class Striper final {
     return view_reader_->wait_for_newer_view(epoch, wakeup);
   }
 
+  // read the latest view without waiting for a newer one
+  void refresh_view() {
+    view_reader_->refresh_view();
+  }
+
+  void set_retired_leases_handler(ViewReader::RetiredLeasesHandler handler) {
+    view_reader_->set_retired_leases_handler(std::move(handler));
+  }
+
  public:
   // versioned view?
   boost::optional<std::string> map(const std::shared_ptr<const View>& view,
@@ -85,8 +95,10 @@ class Striper final {
   // proposes a new view with this log instance configured as the active
   // sequencer. this method waits until the propsoed view (or a newer view) is
   // made active. on success, caller should check the sequencer of the current
-  // view and propose again if necessary.
-  int propose_sequencer();
+  // view and propose again if necessary. when address is set, the sequencer
+  // hands out positions to the log's other clients as a zlog-seqr server
+  // listening on address.
+  int propose_sequencer(const std::string& address = "");
 
   // updates the current view's minimum valid position to be _at least_
   // position. note that this also may expand the range of invalid entries. this
@@ -104,12 +116,21 @@ class Striper final {
   const std::unique_ptr<ViewReader> view_reader_;
 
  private:
-  // seals the given stripe with the given epoch. on success, *pempty will be
-  // set to true if the stripe is empty (no positions have been written, filled,
-  // etc...), and if the stripe is non-empty, *pposition will be set to the
-  // maximum position written. otherwise it is left unmodified.
-  int seal_stripe(const Stripe& stripe, uint64_t epoch,
-      uint64_t *pposition, bool *pempty) const;
+  // run fn(0) .. fn(count - 1) on the calling thread and up to
+  // sequencer_takeover_threads - 1 helper threads. once fn returns an error no
+  // more calls are started, and the first error is returned.
+  int parallel_for(size_t count, const std::function<int(size_t)>& fn) const;
+
+  // seals the objects of stripes [first, end) with the given epoch
+  int seal_stripes(const ObjectMap& object_map, uint64_t first, uint64_t end,
+      uint64_t epoch) const;
+
+  // on success, *pempty will be set to true if the (sealed) stripes [first,
+  // end) are empty (no positions have been written, filled, etc...), and if
+  // they are non-empty, *pposition will be set to the maximum position
+  // written. otherwise it is left unmodified.
+  int max_position(const ObjectMap& object_map, uint64_t first, uint64_t end,
+      uint64_t epoch, uint64_t *pposition, bool *pempty) const;
 
  private:
   // async view expansion
@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
 #include <numeric>
 #include <deque>
+#include <future>
+#include <set>
+#include <thread>
+#include "libzlog/log_cursor.h"
 #include "libzlog/log_impl.h"
+#include "libzlog/seqr_server.h"
+#include "zlog/codec.h"
+#include "zlog/record.h"
 #include "test_libzlog.h"
 
 // TODO
@@ -253,6 +263,1960 @@ TEST_P(LibZLogTest, Trim) {
   ASSERT_EQ(ret, 0);
 }
 
+TEST_P(LibZLogTest, SubmitCompletionQueue) {
+  std::unique_ptr<zlog::CompletionQueue> cq(zlog::CompletionQueue::Create());
+
+  std::vector<zlog::LogRequest> reqs;
+  ASSERT_EQ(log->Submit(nullptr, reqs), -EINVAL);
+
+  // empty batch
+  ASSERT_EQ(log->Submit(cq.get(), reqs), 0);
+  ASSERT_EQ(cq->Pending(), 0u);
+
+  for (uint64_t i = 0; i < 10; i++) {
+    reqs.emplace_back(zlog::LogRequest::Append(i, std::to_string(i)));
+  }
+  ASSERT_EQ(log->Submit(cq.get(), reqs), 0);
+
+  std::vector<zlog::LogCompletion> comps;
+  while (comps.size() < 10) {
+    cq->Wait(&comps, 1, 10);
+  }
+  ASSERT_EQ(cq->Pending(), 0u);
+  ASSERT_EQ(cq->Reap(&comps, 10), 0u);
+
+  std::map<uint64_t, uint64_t> positions;
+  for (const auto& c : comps) {
+    ASSERT_EQ(c.type, zlog::LogRequest::APPEND);
+    ASSERT_EQ(c.ret, 0);
+    positions.emplace(c.cookie, c.position);
+  }
+  ASSERT_EQ(positions.size(), 10u);
+
+  // read back each position, tagged with the original append cookie
+  reqs.clear();
+  for (const auto& p : positions) {
+    reqs.emplace_back(zlog::LogRequest::Read(p.first, p.second));
+  }
+  ASSERT_EQ(log->Submit(cq.get(), reqs), 0);
+
+  comps.clear();
+  ASSERT_EQ(cq->Wait(&comps, 10, 10), 10u);
+  for (const auto& c : comps) {
+    ASSERT_EQ(c.type, zlog::LogRequest::READ);
+    ASSERT_EQ(c.ret, 0);
+    ASSERT_EQ(c.position, positions.at(c.cookie));
+    ASSERT_EQ(c.data, std::to_string(c.cookie));
+  }
+
+  // fill, trim, and reads of invalid / unwritten positions
+  uint64_t tail;
+  ASSERT_EQ(log->CheckTail(&tail), 0);
+
+  reqs.clear();
+  reqs.emplace_back(zlog::LogRequest::Fill(1, tail + 1));
+  reqs.emplace_back(zlog::LogRequest::Trim(2, positions.at(0)));
+  reqs.emplace_back(zlog::LogRequest::Fill(3, positions.at(1)));
+  ASSERT_EQ(log->Submit(cq.get(), reqs), 0);
+
+  comps.clear();
+  ASSERT_EQ(cq->Wait(&comps, 3, 3), 3u);
+  for (const auto& c : comps) {
+    switch (c.cookie) {
+      case 1:
+        ASSERT_EQ(c.type, zlog::LogRequest::FILL);
+        ASSERT_EQ(c.ret, 0);
+        break;
+      case 2:
+        ASSERT_EQ(c.type, zlog::LogRequest::TRIM);
+        ASSERT_EQ(c.ret, 0);
+        break;
+      case 3:
+        ASSERT_EQ(c.type, zlog::LogRequest::FILL);
+        ASSERT_EQ(c.ret, -EROFS);
+        break;
+      default:
+        FAIL();
+    }
+  }
+
+  reqs.clear();
+  reqs.emplace_back(zlog::LogRequest::Read(1, tail + 1));
+  reqs.emplace_back(zlog::LogRequest::Read(2, positions.at(0)));
+  reqs.emplace_back(zlog::LogRequest::Read(3, tail + 2));
+  ASSERT_EQ(log->Submit(cq.get(), reqs), 0);
+
+  comps.clear();
+  ASSERT_EQ(cq->Wait(&comps, 3, 3), 3u);
+  for (const auto& c : comps) {
+    if (c.cookie == 3) {
+      ASSERT_EQ(c.ret, -ENOENT);
+    } else {
+      ASSERT_EQ(c.ret, -ENODATA);
+    }
+    ASSERT_TRUE(c.data.empty());
+  }
+
+  // nothing pending: wait returns immediately
+  comps.clear();
+  ASSERT_EQ(cq->Wait(&comps, 1, 1), 0u);
+}
+
+TEST_P(LibZLogTest, AppendGather) {
+  const std::string header("hdr:");
+  const std::string payload(4096, 'x');
+
+  uint64_t pos;
+  int ret = log->Append({header, payload}, &pos);
+  ASSERT_EQ(ret, 0);
+
+  std::string entry;
+  ret = log->Read(pos, &entry);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(entry, header + payload);
+
+  std::mutex lock;
+  std::condition_variable cond;
+  bool done = false;
+  uint64_t pos2;
+  ret = log->appendAsync({zlog::Slice("a"), zlog::Slice(), payload},
+      [&](int ret, uint64_t position) {
+    ASSERT_EQ(ret, 0);
+    std::lock_guard<std::mutex> lk(lock);
+    pos2 = position;
+    done = true;
+    cond.notify_one();
+  });
+  ASSERT_EQ(ret, 0);
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return done; });
+  }
+
+  ASSERT_GT(pos2, pos);
+  ret = log->Read(pos2, &entry);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(entry, "a" + payload);
+
+  ret = log->Append(std::vector<zlog::Slice>(), &pos);
+  ASSERT_EQ(ret, 0);
+  ret = log->Read(pos, &entry);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(entry, "");
+}
+
+TEST_P(LibZLogTest, AppendBatch) {
+  std::vector<uint64_t> positions;
+  int ret = log->AppendBatch(std::vector<std::string>(), &positions);
+  ASSERT_EQ(ret, 0);
+  ASSERT_TRUE(positions.empty());
+
+  // large enough to span several stripes, and more than one view
+  const size_t count = 1000;
+  std::vector<std::string> entries;
+  for (size_t i = 0; i < count; i++) {
+    entries.push_back("entry." + std::to_string(i));
+  }
+  const auto expected = entries;
+
+  ret = log->AppendBatch(std::move(entries), &positions);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(positions.size(), count);
+  ASSERT_EQ(std::set<uint64_t>(positions.begin(), positions.end()).size(),
+      count);
+
+  for (size_t i = 0; i < count; i++) {
+    std::string entry;
+    ret = log->Read(positions[i], &entry);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(entry, expected[i]);
+  }
+
+  uint64_t tail;
+  ret = log->CheckTail(&tail);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GT(tail, *std::max_element(positions.begin(), positions.end()));
+
+  std::mutex lock;
+  std::condition_variable cond;
+  bool done = false;
+  std::vector<uint64_t> positions2;
+  ret = log->appendBatchAsync({"a", "b", "c"},
+      [&](int ret, std::vector<uint64_t>& positions) {
+    ASSERT_EQ(ret, 0);
+    std::lock_guard<std::mutex> lk(lock);
+    positions2.swap(positions);
+    done = true;
+    cond.notify_one();
+  });
+  ASSERT_EQ(ret, 0);
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return done; });
+  }
+
+  ASSERT_EQ(positions2.size(), 3u);
+  const std::vector<std::string> expected2{"a", "b", "c"};
+  for (size_t i = 0; i < positions2.size(); i++) {
+    ASSERT_GE(positions2[i], tail);
+    std::string entry;
+    ret = log->Read(positions2[i], &entry);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(entry, expected2[i]);
+  }
+}
+
+TEST_P(ZLogTest, AppendBatchRetry) {
+  // writes to new stripes fail with -ENOENT until the objects are initialized
+  // by the retry path.
+  options.init_stripe_on_create = false;
+  options.stripe_width = 3;
+  options.stripe_slots = 2;
+  DoSetUp();
+
+  const size_t count = 100;
+  std::vector<std::string> entries;
+  for (size_t i = 0; i < count; i++) {
+    entries.push_back("entry." + std::to_string(i));
+  }
+  const auto expected = entries;
+
+  std::vector<uint64_t> positions;
+  int ret = log->AppendBatch(std::move(entries), &positions);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(positions.size(), count);
+
+  for (size_t i = 0; i < count; i++) {
+    std::string entry;
+    ret = log->Read(positions[i], &entry);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(entry, expected[i]);
+  }
+}
+
+TEST_P(ZLogTest, CoalesceWrites) {
+  // with one object per stripe and a window, concurrent appends are written
+  // together.
+  options.coalesce_writes = true;
+  options.coalesce_window_us = 2000;
+  options.coalesce_max_entries = 16;
+  options.stripe_width = 1;
+  options.finisher_threads = 4;
+  DoSetUp();
+
+  uint64_t pos;
+  ASSERT_EQ(log->Append("warmup", &pos), 0);
+
+  const int count = 200;
+  std::mutex lock;
+  std::condition_variable cond;
+  int done = 0;
+  std::map<uint64_t, std::string> entries;
+
+  for (int i = 0; i < count; i++) {
+    auto data = "entry-" + std::to_string(i);
+    int ret = log->appendAsync(data, [&, data](int ret, uint64_t pos) {
+      ASSERT_EQ(ret, 0);
+      std::lock_guard<std::mutex> lk(lock);
+      entries.emplace(pos, data);
+      done++;
+      cond.notify_one();
+    });
+    ASSERT_EQ(ret, 0);
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return done == count; });
+  }
+
+  ASSERT_EQ(entries.size(), (size_t)count);
+  for (const auto& entry : entries) {
+    std::string data;
+    ASSERT_EQ(log->Read(entry.first, &data), 0);
+    ASSERT_EQ(data, entry.second);
+  }
+
+  const auto coalescer = ((zlog::LogImpl*)log)->backend->coalescer();
+  ASSERT_TRUE(coalescer);
+  ASSERT_GE(coalescer->num_writes(), (uint64_t)count);
+  ASSERT_LT(coalescer->num_batches(), coalescer->num_writes());
+}
+
+TEST_P(LibZLogTest, RecordPacker) {
+  zlog::RecordPacker *packer;
+  zlog::RecordPackerOptions popts;
+  popts.max_records = 0;
+  ASSERT_EQ(zlog::RecordPacker::Create(log, popts, &packer), -EINVAL);
+
+  // packs are cut by record count
+  popts.max_records = 4;
+  popts.max_bytes = 1 << 20;
+  popts.max_delay_us = 1000000;
+  ASSERT_EQ(zlog::RecordPacker::Create(log, popts, &packer), 0);
+
+  const int count = 10;
+  std::mutex lock;
+  std::map<std::pair<uint64_t, uint32_t>, std::string> records;
+  for (int i = 0; i < count; i++) {
+    auto data = "record-" + std::to_string(i);
+    int ret = packer->appendAsync(std::string(data),
+        [&, data](int ret, zlog::RecordAddress addr) {
+      ASSERT_EQ(ret, 0);
+      std::lock_guard<std::mutex> lk(lock);
+      records.emplace(std::make_pair(addr.position, addr.index), data);
+    });
+    ASSERT_EQ(ret, 0);
+  }
+
+  // the last pack is partial and is only appended by flush
+  packer->Flush();
+  ASSERT_EQ(records.size(), (size_t)count);
+
+  std::set<uint64_t> positions;
+  for (const auto& record : records) {
+    positions.insert(record.first.first);
+  }
+  ASSERT_EQ(positions.size(), 3u);
+
+  for (const auto& record : records) {
+    std::string buffer;
+    std::vector<zlog::Slice> unpacked;
+    ASSERT_EQ(zlog::ReadRecords(log, record.first.first, &buffer,
+          &unpacked), 0);
+    ASSERT_LT(record.first.second, unpacked.size());
+    const auto& slice = unpacked[record.first.second];
+    ASSERT_EQ(std::string(slice.data, slice.size), record.second);
+  }
+
+  delete packer;
+
+  // packs are cut by size and by time
+  popts.max_records = 100;
+  popts.max_bytes = 10;
+  popts.max_delay_us = 1000;
+  ASSERT_EQ(zlog::RecordPacker::Create(log, popts, &packer), 0);
+
+  zlog::RecordAddress addr1, addr2, addr3;
+  ASSERT_EQ(packer->Append(zlog::Slice("abc"), &addr1), 0);
+  ASSERT_EQ(packer->Append(std::string(20, 'x'), &addr2), 0);
+  ASSERT_EQ(addr1.index, 0u);
+  ASSERT_EQ(addr2.index, 0u);
+  ASSERT_NE(addr1.position, addr2.position);
+
+  ASSERT_EQ(packer->Append(std::string("def"), &addr3), 0);
+  std::string buffer;
+  std::vector<zlog::Slice> unpacked;
+  ASSERT_EQ(zlog::ReadRecords(log, addr3.position, &buffer, &unpacked), 0);
+  ASSERT_EQ(unpacked.size(), 1u);
+  ASSERT_EQ(std::string(unpacked[0].data, unpacked[0].size), "def");
+
+  delete packer;
+
+  // a regular entry isn't a packed entry
+  uint64_t pos;
+  ASSERT_EQ(log->Append("plain", &pos), 0);
+  ASSERT_EQ(zlog::ReadRecords(log, pos, &buffer, &unpacked), -EINVAL);
+}
+
+TEST_P(ZLogTest, Codec) {
+  options.codec = zlog::Codec::Builtin("lz");
+  DoSetUp();
+
+  std::string json;
+  for (int i = 0; i < 50; i++) {
+    json += "{\"id\": " + std::to_string(i) + ", \"type\": \"event\"}\n";
+  }
+  const std::string noise = "\x01\x7f\xfe\x00\x42";
+
+  std::map<uint64_t, std::string> entries;
+  uint64_t pos;
+  ASSERT_EQ(log->Append(json, &pos), 0);
+  entries.emplace(pos, json);
+  ASSERT_EQ(log->Append(noise, &pos), 0);
+  entries.emplace(pos, noise);
+  ASSERT_EQ(log->Append(std::string(), &pos), 0);
+  entries.emplace(pos, std::string());
+
+  const std::vector<zlog::Slice> slices = {json, noise, json};
+  ASSERT_EQ(log->Append(slices, &pos), 0);
+  entries.emplace(pos, json + noise + json);
+
+  std::vector<std::string> batch = {json, noise};
+  std::vector<uint64_t> positions;
+  ASSERT_EQ(log->AppendBatch(std::move(batch), &positions), 0);
+  entries.emplace(positions[0], json);
+  entries.emplace(positions[1], noise);
+
+  for (const auto& entry : entries) {
+    std::string data;
+    ASSERT_EQ(log->Read(entry.first, &data), 0);
+    ASSERT_EQ(data, entry.second);
+  }
+
+  const auto stats = ((zlog::LogImpl*)log)->entry_codec->stats();
+  ASSERT_GT(stats.compress_bytes_in, 4 * stats.compress_bytes_out);
+  ASSERT_GT(stats.compress_skipped, 0u);
+
+  // the log can be read with the noop codec. reopening is only supported by
+  // persistent backends.
+  if (backend() != "lmdb") {
+    return;
+  }
+  options.codec = zlog::Codec::Builtin("none");
+  ASSERT_EQ(reopen(), 0);
+  for (const auto& entry : entries) {
+    std::string data;
+    ASSERT_EQ(log->Read(entry.first, &data), 0);
+    ASSERT_EQ(data, entry.second);
+  }
+}
+
+// the entry format is recorded when the log is created
+TEST_P(ZLogTest, EntryFormat) {
+  options.codec = zlog::Codec::Builtin("lz");
+  DoSetUp();
+
+  if (!lowlevel()) {
+    // the other log instances need the same backend instance
+    return;
+  }
+
+  uint64_t pos;
+  ASSERT_EQ(log->Append("entry", &pos), 0);
+
+  zlog::Options options2 = options;
+  options2.create_if_missing = false;
+  options2.error_if_exists = false;
+  options2.statistics = nullptr;
+
+  zlog::Log *log2;
+  options2.codec = nullptr;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &log2), -EINVAL);
+  options2.codec = zlog::Codec::Builtin("lz");
+  options2.entry_checksums = true;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &log2), -EINVAL);
+
+  // entries of a built-in codec can be read with any codec
+  options2.codec = zlog::Codec::Builtin("none");
+  options2.entry_checksums = false;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &log2), 0);
+  std::unique_ptr<zlog::Log> log2_ptr(log2);
+  std::string data;
+  ASSERT_EQ(log2->Read(pos, &data), 0);
+  ASSERT_EQ(data, "entry");
+
+  // the format is kept in new views
+  ASSERT_EQ(log2->Append("entry2", &pos), 0);
+  auto *li = (zlog::LogImpl*)log2;
+  ASSERT_EQ(li->striper->view()->codec(), "lz");
+  ASSERT_FALSE(li->striper->view()->entry_checksums());
+
+  // a log created without a codec can't be opened with one
+  options2.create_if_missing = true;
+  options2.codec = nullptr;
+  zlog::Log *log3;
+  ASSERT_EQ(zlog::Log::Open(options2, "plainlog", &log3), 0);
+  delete log3;
+  options2.codec = zlog::Codec::Builtin("none");
+  ASSERT_EQ(zlog::Log::Open(options2, "plainlog", &log3), -EINVAL);
+}
+
+TEST_P(ZLogTest, InlineSyncOps) {
+  options.inline_sync_ops = true;
+  options.max_inflight_ops = 1;
+  DoSetUp();
+
+  uint64_t tail;
+  int ret = log->CheckTail(&tail);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(tail, 0u);
+
+  uint64_t pos;
+  ret = log->Append("foo", &pos);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(pos, 0u);
+
+  std::string entry;
+  ret = log->Read(pos, &entry);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(entry, "foo");
+
+  ret = log->Read(pos + 1, &entry);
+  ASSERT_EQ(ret, -ENOENT);
+  ASSERT_EQ(entry, "foo");
+
+  ret = log->Fill(pos + 1);
+  ASSERT_EQ(ret, 0);
+  ret = log->Read(pos + 1, &entry);
+  ASSERT_EQ(ret, -ENODATA);
+
+  ret = log->Trim(pos);
+  ASSERT_EQ(ret, 0);
+  ret = log->Read(pos, &entry);
+  ASSERT_EQ(ret, -ENODATA);
+
+  ret = log->trimTo(pos + 5);
+  ASSERT_EQ(ret, 0);
+  ret = log->Read(pos + 3, &entry);
+  ASSERT_EQ(ret, -ENODATA);
+
+  ret = log->CheckTail(&tail);
+  ASSERT_EQ(ret, 0);
+
+  // with concurrent callers the in-flight limit is reached and some of the
+  // calls fall back to the finisher threads.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 50; j++) {
+        uint64_t p;
+        ASSERT_EQ(log->Append("bar", &p), 0);
+        std::string e;
+        ASSERT_EQ(log->Read(p, &e), 0);
+        ASSERT_EQ(e, "bar");
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  uint64_t tail2;
+  ret = log->CheckTail(&tail2);
+  ASSERT_EQ(ret, 0);
+  ASSERT_GE(tail2, tail + 200);
+}
+
+TEST_P(ZLogTest, BackgroundLimit) {
+  // with the default weights one of the four finishers runs background ops
+  options.finisher_threads = 4;
+  DoSetUp();
+
+  uint64_t pos;
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(log->Append("foo", &pos), 0);
+  }
+
+  // trimTo ops that hold their finisher until they are released
+  const int count = 4;
+  std::mutex lock;
+  std::condition_variable cond;
+  bool release = false;
+  int trimmed = 0;
+  for (int i = 0; i < count; i++) {
+    int ret = log->trimToAsync(i * 4, [&](int ret) {
+      ASSERT_EQ(ret, 0);
+      std::unique_lock<std::mutex> lk(lock);
+      cond.wait(lk, [&] { return release; });
+      trimmed++;
+      cond.notify_all();
+    });
+    ASSERT_EQ(ret, 0);
+  }
+
+  // appends make progress while the trims are blocked
+  std::atomic<int> appended(0);
+  for (int i = 0; i < 100; i++) {
+    int ret = log->appendAsync("bar", [&](int ret, uint64_t pos) {
+      ASSERT_EQ(ret, 0);
+      appended++;
+    });
+    ASSERT_EQ(ret, 0);
+  }
+
+  for (int i = 0; i < 1000 && appended < 100; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_EQ(appended, 100);
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    ASSERT_EQ(trimmed, 0);
+    release = true;
+    cond.notify_all();
+    cond.wait(lk, [&] { return trimmed == count; });
+  }
+
+  std::string entry;
+  ASSERT_EQ(log->Read(12, &entry), -ENODATA);
+  ASSERT_EQ(log->Read(13, &entry), 0);
+}
+
+TEST_P(ZLogTest, AdaptiveFinishers) {
+  auto stats = zlog::CreateCacheStatistics();
+  options.statistics = stats.get();
+  options.finisher_threads = 4;
+  options.min_finisher_threads = 1;
+  options.max_finisher_threads = 4;
+  options.finisher_adapt_interval_ms = 5;
+  DoSetUp();
+
+  ASSERT_EQ(stats->getTickerCount(zlog::FINISHER_THREADS), 4u);
+
+  // an idle pool shrinks to the minimum
+  for (int i = 0; i < 400; i++) {
+    if (stats->getTickerCount(zlog::FINISHER_THREADS) == 1u) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_EQ(stats->getTickerCount(zlog::FINISHER_THREADS), 1u);
+  ASSERT_GE(stats->getTickerCount(zlog::FINISHER_POOL_SHRINKS), 1u);
+
+  // ops continue to complete while the pool is resized
+  std::atomic<int> count(0);
+  for (int i = 0; i < 1000; i++) {
+    int ret = log->appendAsync("foo", [&](int ret, uint64_t pos) {
+      ASSERT_EQ(ret, 0);
+      count++;
+    });
+    ASSERT_EQ(ret, 0);
+    if (i % 100 == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+
+  uint64_t pos;
+  int ret = log->Append("bar", &pos);
+  ASSERT_EQ(ret, 0);
+
+  while (count < 1000) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::string entry;
+  ret = log->Read(pos, &entry);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(entry, "bar");
+
+  // the statistics object must outlive the log
+  delete log;
+  log = nullptr;
+}
+
+// forwards to another backend, completing asynchronous entry requests from a
+// background thread. requests are held until a batch has accumulated (or a
+// short timeout), so the number of requests outstanding at once is observable.
+// when reverse is set, the requests in a batch complete in reverse order.
+class AsyncBackend : public zlog::Backend {
+ public:
+  AsyncBackend(std::shared_ptr<zlog::Backend> backend, size_t batch,
+      bool reverse = false) :
+    max_outstanding(0),
+    backend_(backend),
+    batch_(batch),
+    reverse_(reverse),
+    stop_(false),
+    thread_(&AsyncBackend::entry, this)
+  {}
+
+  ~AsyncBackend() {
+    {
+      std::lock_guard<std::mutex> lk(lock_);
+      stop_ = true;
+      cond_.notify_one();
+    }
+    thread_.join();
+  }
+
+  int Initialize(const std::map<std::string, std::string>& opts) override {
+    return backend_->Initialize(opts);
+  }
+
+  std::map<std::string, std::string> meta() override {
+    return backend_->meta();
+  }
+
+  int CreateLog(const std::string& name, const std::string& view,
+      std::string *hoid_out, std::string *prefix_out) override {
+    return backend_->CreateLog(name, view, hoid_out, prefix_out);
+  }
+
+  int OpenLog(const std::string& name, std::string *hoid_out,
+      std::string *prefix_out) override {
+    return backend_->OpenLog(name, hoid_out, prefix_out);
+  }
+
+  int ReadViews(const std::string& hoid, uint64_t epoch, uint32_t max_views,
+      std::map<uint64_t, std::string> *views_out) override {
+    return backend_->ReadViews(hoid, epoch, max_views, views_out);
+  }
+
+  int ProposeView(const std::string& hoid, uint64_t epoch,
+      const std::string& view) override {
+    return backend_->ProposeView(hoid, epoch, view);
+  }
+
+  int uniqueId(const std::string& hoid, uint64_t *id_out) override {
+    return backend_->uniqueId(hoid, id_out);
+  }
+
+  int Read(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::string *data_out) override {
+    return backend_->Read(oid, epoch, position, data_out);
+  }
+
+  int Write(const std::string& oid, const std::string& data, uint64_t epoch,
+      uint64_t position) override {
+    return backend_->Write(oid, data, epoch, position);
+  }
+
+  int Fill(const std::string& oid, uint64_t epoch,
+      uint64_t position) override {
+    return backend_->Fill(oid, epoch, position);
+  }
+
+  int Trim(const std::string& oid, uint64_t epoch, uint64_t position,
+      bool trim_limit, bool trim_full) override {
+    return backend_->Trim(oid, epoch, position, trim_limit, trim_full);
+  }
+
+  int Seal(const std::string& oid, uint64_t epoch) override {
+    return backend_->Seal(oid, epoch);
+  }
+
+  int MaxPos(const std::string& oid, uint64_t epoch, uint64_t *pos_out,
+      bool *empty_out) override {
+    return backend_->MaxPos(oid, epoch, pos_out, empty_out);
+  }
+
+  int Stat(const std::string& oid, size_t *size) override {
+    return backend_->Stat(oid, size);
+  }
+
+  void ReadAsync(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::string *data_out, std::function<void(int)> cb) override {
+    submit([=] { return Read(oid, epoch, position, data_out); }, cb);
+  }
+
+  void WriteAsync(const std::string& oid, const std::string& data,
+      uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) override {
+    const auto datap = &data;
+    submit([=] { return Write(oid, *datap, epoch, position); }, cb);
+  }
+
+  void FillAsync(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::function<void(int)> cb) override {
+    submit([=] { return Fill(oid, epoch, position); }, cb);
+  }
+
+  size_t max_outstanding;
+
+ private:
+  void submit(std::function<int()> req, std::function<void(int)> cb) {
+    std::lock_guard<std::mutex> lk(lock_);
+    reqs_.emplace_back(req, cb);
+    max_outstanding = std::max(max_outstanding, reqs_.size());
+    if (reqs_.size() >= batch_) {
+      cond_.notify_one();
+    }
+  }
+
+  void entry() {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (!stop_) {
+      cond_.wait_for(lk, std::chrono::milliseconds(20), [&] {
+        return stop_ || reqs_.size() >= batch_;
+      });
+      auto reqs = std::move(reqs_);
+      reqs_.clear();
+      if (reverse_) {
+        std::reverse(reqs.begin(), reqs.end());
+      }
+      lk.unlock();
+      for (auto& req : reqs) {
+        req.second(req.first());
+      }
+      lk.lock();
+    }
+  }
+
+  std::shared_ptr<zlog::Backend> backend_;
+  const size_t batch_;
+  const bool reverse_;
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::vector<std::pair<std::function<int()>,
+    std::function<void(int)>>> reqs_;
+  bool stop_;
+  std::thread thread_;
+};
+
+// a single finisher thread keeps many requests in flight against a backend
+// that completes them asynchronously.
+TEST_P(ZLogTest, AsyncBackend) {
+  DoSetUp();
+
+  auto *li = (zlog::LogImpl*)log;
+  auto async_backend = std::make_shared<AsyncBackend>(
+      li->backend->backend(), 16);
+
+  zlog::Options opts;
+  opts.backend = async_backend;
+  opts.finisher_threads = 1;
+  zlog::Log *alog;
+  int ret = zlog::Log::Open(opts, "mylog", &alog);
+  ASSERT_EQ(ret, 0);
+  std::unique_ptr<zlog::Log> alog_ptr(alog);
+
+  const int count = 64;
+  std::mutex lock;
+  std::condition_variable cond;
+  int done = 0;
+  std::set<uint64_t> positions;
+
+  for (int i = 0; i < count; i++) {
+    ret = alog->appendAsync("entry-" + std::to_string(i),
+        [&](int ret, uint64_t pos) {
+      std::lock_guard<std::mutex> lk(lock);
+      if (!ret) {
+        positions.insert(pos);
+      }
+      done++;
+      cond.notify_one();
+    });
+    ASSERT_EQ(ret, 0);
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return done == count; });
+  }
+
+  ASSERT_EQ(positions.size(), (size_t)count);
+  ASSERT_GT(async_backend->max_outstanding, 1u);
+
+  // read back through the async path, including an unwritten position
+  for (auto pos : positions) {
+    std::string entry;
+    ASSERT_EQ(alog->Read(pos, &entry), 0);
+    ASSERT_EQ(entry.compare(0, 6, "entry-"), 0);
+  }
+
+  std::string entry;
+  ASSERT_EQ(alog->Read(*positions.rbegin() + 1, &entry), -ENOENT);
+  ASSERT_EQ(alog->Fill(*positions.rbegin() + 1), 0);
+  ASSERT_EQ(alog->Read(*positions.rbegin() + 1, &entry), -ENODATA);
+
+  // batch writes complete on the backend's thread
+  std::vector<std::string> entries;
+  for (int i = 0; i < count; i++) {
+    entries.push_back("batch-" + std::to_string(i));
+  }
+  std::vector<uint64_t> batch_positions;
+  ASSERT_EQ(alog->AppendBatch(std::move(entries), &batch_positions), 0);
+  ASSERT_EQ(batch_positions.size(), (size_t)count);
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(alog->Read(batch_positions[i], &entry), 0);
+    ASSERT_EQ(entry, "batch-" + std::to_string(i));
+  }
+}
+
+TEST_P(ZLogTest, ReadRange) {
+  options.stripe_width = 5;
+  options.stripe_slots = 4;
+  DoSetUp();
+
+  // a mix of written, filled, trimmed, and unwritten positions spanning
+  // several stripes
+  uint64_t pos;
+  for (int i = 0; i < 50; i++) {
+    ASSERT_EQ(log->Append("entry-" + std::to_string(i), &pos), 0);
+  }
+  ASSERT_EQ(log->Trim(3), 0);
+  ASSERT_EQ(log->Trim(17), 0);
+  ASSERT_EQ(log->Fill(55), 0);
+
+  std::vector<zlog::LogEntry> entries;
+  ASSERT_EQ(log->ReadRange(0, 60, &entries), 0);
+  ASSERT_EQ(entries.size(), 60u);
+  for (uint64_t i = 0; i < 60; i++) {
+    std::string data;
+    const int ret = log->Read(i, &data);
+    ASSERT_EQ(entries[i].position, i);
+    ASSERT_EQ(entries[i].ret, ret);
+    if (!ret) {
+      ASSERT_EQ(entries[i].data, data);
+    }
+  }
+  ASSERT_EQ(entries[0].data, "entry-0");
+  ASSERT_EQ(entries[3].ret, -ENODATA);
+  ASSERT_EQ(entries[17].ret, -ENODATA);
+  ASSERT_EQ(entries[49].data, "entry-49");
+  ASSERT_EQ(entries[50].ret, -ENOENT);
+  ASSERT_EQ(entries[55].ret, -ENODATA);
+
+  // a range that doesn't start on a stripe boundary
+  ASSERT_EQ(log->ReadRange(13, 27, &entries), 0);
+  ASSERT_EQ(entries.size(), 14u);
+  for (uint64_t i = 0; i < 14; i++) {
+    ASSERT_EQ(entries[i].position, 13 + i);
+  }
+  ASSERT_EQ(entries[0].data, "entry-13");
+  ASSERT_EQ(entries[13].data, "entry-26");
+
+  // past the end of the mapped range
+  ASSERT_EQ(log->ReadRange(200, 203, &entries), 0);
+  ASSERT_EQ(entries.size(), 3u);
+  for (const auto& entry : entries) {
+    ASSERT_EQ(entry.ret, -ENOENT);
+  }
+
+  ASSERT_EQ(log->ReadRange(5, 5, &entries), 0);
+  ASSERT_TRUE(entries.empty());
+  ASSERT_EQ(log->ReadRange(5, 4, &entries), -EINVAL);
+
+  // async, with the default per-position backend reads
+  auto *li = (zlog::LogImpl*)log;
+  auto async_backend = std::make_shared<AsyncBackend>(
+      li->backend->backend(), 4);
+  zlog::Options opts;
+  opts.backend = async_backend;
+  zlog::Log *alog;
+  ASSERT_EQ(zlog::Log::Open(opts, "mylog", &alog), 0);
+  std::unique_ptr<zlog::Log> alog_ptr(alog);
+
+  std::mutex lock;
+  std::condition_variable cond;
+  bool done = false;
+  ASSERT_EQ(alog->readRangeAsync(0, 50,
+        [&](int ret, std::vector<zlog::LogEntry>& result) {
+    ASSERT_EQ(ret, 0);
+    std::lock_guard<std::mutex> lk(lock);
+    entries.swap(result);
+    done = true;
+    cond.notify_one();
+  }), 0);
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return done; });
+  }
+  ASSERT_EQ(entries.size(), 50u);
+  ASSERT_EQ(entries[0].data, "entry-0");
+  ASSERT_EQ(entries[3].ret, -ENODATA);
+  ASSERT_EQ(entries[49].data, "entry-49");
+}
+
+TEST_P(ZLogTest, LogCursor) {
+  options.stripe_width = 5;
+  options.stripe_slots = 4;
+  DoSetUp();
+
+  uint64_t pos;
+  for (int i = 0; i < 200; i++) {
+    ASSERT_EQ(log->Append("entry-" + std::to_string(i), &pos), 0);
+  }
+  ASSERT_EQ(log->Trim(7), 0);
+
+  zlog::LogCursor *cursor;
+  zlog::LogCursorOptions copts;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 5, 4, copts, &cursor), -EINVAL);
+  copts.min_readahead = 0;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 0, 10, copts, &cursor), -EINVAL);
+  copts.min_readahead = 4;
+  copts.max_readahead = 2;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 0, 10, copts, &cursor), -EINVAL);
+
+  // forward, past the tail. the readahead window grows while the consumer
+  // keeps up with it.
+  copts.min_readahead = 2;
+  copts.max_readahead = 64;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 0, 205, copts, &cursor), 0);
+  zlog::LogEntry entry;
+  for (uint64_t i = 0; i < 205; i++) {
+    ASSERT_EQ(cursor->Next(&entry), 0);
+    ASSERT_EQ(entry.position, i);
+    if (i == 7) {
+      ASSERT_EQ(entry.ret, -ENODATA);
+    } else if (i >= 200) {
+      ASSERT_EQ(entry.ret, -ENOENT);
+    } else {
+      ASSERT_EQ(entry.ret, 0);
+      ASSERT_EQ(entry.data, "entry-" + std::to_string(i));
+    }
+  }
+  ASSERT_EQ(cursor->Next(&entry), -ERANGE);
+  ASSERT_EQ(cursor->Next(&entry), -ERANGE);
+
+  auto stats = ((zlog::LogCursorImpl*)cursor)->stats();
+  ASSERT_GT(stats.stalls, 0u);
+  ASSERT_GT(stats.readahead, 2u);
+  ASSERT_LE(stats.readahead, 64u);
+  ASSERT_LT(stats.reads, 205u);
+  ASSERT_EQ(stats.hole_waits, 0u);
+  delete cursor;
+
+  // backward
+  copts.reverse = true;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 13, 150, copts, &cursor), 0);
+  for (uint64_t i = 150; i > 13; i--) {
+    ASSERT_EQ(cursor->Next(&entry), 0);
+    ASSERT_EQ(entry.position, i - 1);
+    ASSERT_EQ(entry.data, "entry-" + std::to_string(i - 1));
+  }
+  ASSERT_EQ(cursor->Next(&entry), -ERANGE);
+  delete cursor;
+
+  // empty range
+  ASSERT_EQ(zlog::LogCursor::Create(log, 9, 9, copts, &cursor), 0);
+  ASSERT_EQ(cursor->Next(&entry), -ERANGE);
+  delete cursor;
+
+  // a cursor destroyed with reads outstanding
+  copts.reverse = false;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 0, 200, copts, &cursor), 0);
+  ASSERT_EQ(cursor->Next(&entry), 0);
+  delete cursor;
+
+  // holes are waited for until they are written
+  copts.wait_for_holes = true;
+  copts.hole_timeout_ms = 0;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 198, 202, copts, &cursor), 0);
+  std::thread appender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t pos;
+    ASSERT_EQ(log->Append("entry-200", &pos), 0);
+    ASSERT_EQ(pos, 200u);
+    ASSERT_EQ(log->Fill(201), 0);
+  });
+  for (uint64_t i = 198; i < 202; i++) {
+    ASSERT_EQ(cursor->Next(&entry), 0);
+    ASSERT_EQ(entry.position, i);
+    if (i == 201) {
+      ASSERT_EQ(entry.ret, -ENODATA);
+    } else {
+      ASSERT_EQ(entry.ret, 0);
+      ASSERT_EQ(entry.data, "entry-" + std::to_string(i));
+    }
+  }
+  appender.join();
+  stats = ((zlog::LogCursorImpl*)cursor)->stats();
+  ASSERT_GE(stats.hole_waits, 1u);
+  delete cursor;
+
+  // or reported once they have been waited on for long enough
+  copts.hole_timeout_ms = 20;
+  ASSERT_EQ(zlog::LogCursor::Create(log, 202, 203, copts, &cursor), 0);
+  ASSERT_EQ(cursor->Next(&entry), 0);
+  ASSERT_EQ(entry.ret, -ENOENT);
+  delete cursor;
+}
+
+TEST_P(ZLogTest, Cache) {
+  auto stats = zlog::CreateCacheStatistics();
+  options.statistics = stats.get();
+  // room for eight of the small entries below
+  options.cache_size = 8 * (zlog::Cache::kEntryOverhead + 10);
+  // entries are cached as they were appended, not as they were written
+  options.entry_checksums = true;
+  DoSetUp();
+
+  // appended entries are cached
+  uint64_t pos;
+  std::map<uint64_t, std::string> entries;
+  for (int i = 0; i < 3; i++) {
+    const auto entry = "entry-" + std::to_string(i);
+    ASSERT_EQ(log->Append(entry, &pos), 0);
+    entries.emplace(pos, entry);
+  }
+  ASSERT_EQ(log->Append(std::vector<zlog::Slice>{"gather-", "entry"}, &pos),
+      0);
+  entries.emplace(pos, "gather-entry");
+  std::vector<uint64_t> positions;
+  ASSERT_EQ(log->AppendBatch({"batch-0", "batch-1"}, &positions), 0);
+  entries.emplace(positions[0], "batch-0");
+  entries.emplace(positions[1], "batch-1");
+
+  for (const auto& entry : entries) {
+    std::string data;
+    ASSERT_EQ(log->Read(entry.first, &data), 0);
+    ASSERT_EQ(data, entry.second);
+  }
+  ASSERT_EQ(stats->getTickerCount(zlog::CACHE_REQS), 6u);
+  ASSERT_EQ(stats->getTickerCount(zlog::CACHE_MISSES), 0u);
+
+  // a hit is delivered on the calling thread
+  const auto first = entries.begin()->first;
+  const auto caller = std::this_thread::get_id();
+  bool done = false;
+  ASSERT_EQ(log->readAsync(first, [&](int ret, std::string& data) {
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(data, "entry-0");
+    ASSERT_EQ(std::this_thread::get_id(), caller);
+    done = true;
+  }), 0);
+  ASSERT_TRUE(done);
+
+  // trimmed entries are removed. the read of a trimmed position is answered
+  // by the index of invalid positions before the cache is checked.
+  std::string data;
+  ASSERT_EQ(log->Trim(first + 1), 0);
+  ASSERT_EQ(log->Read(first + 1, &data), -ENODATA);
+  ASSERT_EQ(stats->getTickerCount(zlog::CACHE_MISSES), 0u);
+  ASSERT_EQ(stats->getTickerCount(zlog::INVALID_RANGE_HITS), 1u);
+
+  // evicted entries are cached again when they are read
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(log->Append("filler", &pos), 0);
+  }
+  ASSERT_EQ(log->Read(first, &data), 0);
+  ASSERT_EQ(data, "entry-0");
+  ASSERT_EQ(stats->getTickerCount(zlog::CACHE_MISSES), 1u);
+  ASSERT_EQ(log->Read(first, &data), 0);
+  ASSERT_EQ(data, "entry-0");
+  ASSERT_EQ(stats->getTickerCount(zlog::CACHE_MISSES), 1u);
+
+  ASSERT_EQ(log->trimTo(first + 2), 0);
+  ASSERT_EQ(log->Read(first, &data), -ENODATA);
+
+  // the statistics object must outlive the log
+  delete log;
+  log = nullptr;
+}
+
+// reads of filled and trimmed positions are answered without the backend
+TEST_P(ZLogTest, InvalidRanges) {
+  auto stats = zlog::CreateCacheStatistics();
+  options.statistics = stats.get();
+  DoSetUp();
+
+  auto *li = (zlog::LogImpl*)log;
+
+  uint64_t pos;
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(log->Append("entry-" + std::to_string(i), &pos), 0);
+  }
+  ASSERT_EQ(log->trimTo(4), 0);
+  ASSERT_EQ(log->Fill(10), -EROFS);
+  ASSERT_EQ(log->Fill(25), 0);
+  ASSERT_EQ(log->Trim(12), 0);
+  ASSERT_EQ(li->invalid_ranges.min_valid(), 5u);
+  ASSERT_EQ(li->invalid_ranges.size(), 2u);
+
+  std::string data;
+  for (const uint64_t p : {0, 4, 12, 25}) {
+    ASSERT_EQ(log->Read(p, &data), -ENODATA);
+  }
+  ASSERT_EQ(log->Read(10, &data), 0);
+  ASSERT_EQ(li->invalid_range_hits, 4u);
+  ASSERT_EQ(stats->getTickerCount(zlog::INVALID_RANGE_HITS), 4u);
+
+  // delivered on the calling thread
+  const auto caller = std::this_thread::get_id();
+  bool done = false;
+  ASSERT_EQ(log->readAsync(3, [&](int ret, std::string& data) {
+    ASSERT_EQ(ret, -ENODATA);
+    ASSERT_EQ(std::this_thread::get_id(), caller);
+    done = true;
+  }), 0);
+  ASSERT_TRUE(done);
+  ASSERT_EQ(li->invalid_range_hits, 5u);
+
+  // invalid positions of a range aren't read
+  std::vector<zlog::LogEntry> entries;
+  ASSERT_EQ(log->ReadRange(0, 26, &entries), 0);
+  ASSERT_EQ(entries.size(), 26u);
+  for (const auto& entry : entries) {
+    if (entry.position < 5 || entry.position == 12 || entry.position == 25) {
+      ASSERT_EQ(entry.ret, -ENODATA);
+    } else if (entry.position < 20) {
+      ASSERT_EQ(entry.ret, 0);
+      ASSERT_EQ(entry.data, "entry-" + std::to_string(entry.position));
+    } else {
+      ASSERT_EQ(entry.ret, -ENOENT);
+    }
+  }
+  ASSERT_EQ(li->invalid_range_hits, 12u);
+  ASSERT_EQ(log->ReadRange(0, 5, &entries), 0);
+  ASSERT_EQ(entries.size(), 5u);
+  ASSERT_EQ(li->invalid_range_hits, 17u);
+
+  // the index is filled in by reads that find invalid positions, and is
+  // seeded with the min_valid_position of the views that are seen.
+  if (lowlevel()) {
+    zlog::Options options2 = options;
+    options2.create_if_missing = false;
+    options2.error_if_exists = false;
+    options2.statistics = nullptr;
+    zlog::Log *log2;
+    ASSERT_EQ(zlog::Log::Open(options2, "mylog", &log2), 0);
+    auto *li2 = (zlog::LogImpl*)log2;
+
+    ASSERT_EQ(log2->Read(12, &data), -ENODATA);
+    ASSERT_EQ(li2->invalid_range_hits, 0u);
+    ASSERT_EQ(log2->Read(12, &data), -ENODATA);
+    ASSERT_EQ(log2->Read(2, &data), -ENODATA);
+    ASSERT_EQ(li2->invalid_range_hits, 2u);
+
+    delete log2;
+  }
+
+  delete log;
+  log = nullptr;
+}
+
+TEST_P(ZLogTest, WaitForPosition) {
+  DoSetUp();
+
+  ASSERT_EQ(log->WaitForPosition(0, 0), -ETIMEDOUT);
+  ASSERT_EQ(log->WaitForPosition(0, 10), -ETIMEDOUT);
+
+  // woken by an append through the log
+  std::thread appender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t pos;
+    ASSERT_EQ(log->Append("a", &pos), 0);
+    ASSERT_EQ(pos, 0u);
+  });
+  ASSERT_EQ(log->WaitForPosition(0), 0);
+  appender.join();
+
+  // written, filled and trimmed positions don't wait
+  ASSERT_EQ(log->WaitForPosition(0, 0), 0);
+  ASSERT_EQ(log->Fill(1), 0);
+  ASSERT_EQ(log->WaitForPosition(1, 0), 0);
+  ASSERT_EQ(log->Trim(2), 0);
+  ASSERT_EQ(log->WaitForPosition(2, 0), 0);
+
+  // woken by a fill
+  std::thread filler([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(log->Fill(10), 0);
+  });
+  ASSERT_EQ(log->WaitForPosition(10, 10000), 0);
+  filler.join();
+}
+
+TEST_P(ZLogTest, Subscribe) {
+  DoSetUp();
+
+  uint64_t sub;
+  ASSERT_EQ(log->Subscribe(0, nullptr, &sub), -EINVAL);
+  ASSERT_EQ(log->Subscribe(0, [](zlog::LogEntry&) {}, nullptr), -EINVAL);
+  ASSERT_EQ(log->Unsubscribe(100), -ENOENT);
+
+  uint64_t pos;
+  ASSERT_EQ(log->Append("a0", &pos), 0);
+  ASSERT_EQ(log->Append("a1", &pos), 0);
+
+  std::mutex lock;
+  std::condition_variable cond;
+  std::vector<zlog::LogEntry> entries;
+  std::set<std::thread::id> threads;
+  ASSERT_EQ(log->Subscribe(1, [&](zlog::LogEntry& entry) {
+    std::lock_guard<std::mutex> lk(lock);
+    entries.push_back(std::move(entry));
+    threads.insert(std::this_thread::get_id());
+    cond.notify_one();
+  }, &sub), 0);
+
+  auto wait_for = [&](size_t count) {
+    std::unique_lock<std::mutex> lk(lock);
+    return cond.wait_for(lk, std::chrono::seconds(10),
+        [&] { return entries.size() >= count; });
+  };
+
+  // existing entries are delivered, and then entries as they are appended
+  ASSERT_TRUE(wait_for(1));
+  for (int i = 2; i < 10; i++) {
+    ASSERT_EQ(log->Append("a" + std::to_string(i), &pos), 0);
+  }
+  ASSERT_TRUE(wait_for(9));
+
+  // delivery waits at a hole until it is filled. the hole is a position
+  // that is reserved and never written.
+  {
+    std::promise<uint64_t> reserved;
+    ASSERT_EQ(((zlog::LogImpl*)log)->tailAsync(true,
+          [&](int ret, uint64_t pos) {
+      reserved.set_value(ret ? 0 : pos);
+    }), 0);
+    ASSERT_EQ(reserved.get_future().get(), 10u);
+  }
+  ASSERT_EQ(log->Append("a11", &pos), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  {
+    std::lock_guard<std::mutex> lk(lock);
+    ASSERT_EQ(entries.size(), 9u);
+  }
+  ASSERT_EQ(log->Fill(10), 0);
+  ASSERT_TRUE(wait_for(11));
+
+  ASSERT_EQ(log->Unsubscribe(sub), 0);
+  ASSERT_EQ(log->Unsubscribe(sub), -ENOENT);
+
+  std::lock_guard<std::mutex> lk(lock);
+  ASSERT_EQ(entries.size(), 11u);
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto& entry = entries[i];
+    ASSERT_EQ(entry.position, i + 1);
+    if (entry.position == 10) {
+      ASSERT_EQ(entry.ret, -ENODATA);
+      ASSERT_TRUE(entry.data.empty());
+    } else {
+      ASSERT_EQ(entry.ret, 0);
+      ASSERT_EQ(entry.data, "a" + std::to_string(entry.position));
+    }
+  }
+  ASSERT_EQ(threads.size(), 1u);
+  ASSERT_EQ(threads.count(std::this_thread::get_id()), 0u);
+
+  // subscriptions that are still running end with the log
+  ASSERT_EQ(log->Subscribe(100, [](zlog::LogEntry&) {}, &sub), 0);
+}
+
+// subscriptions share one delivery thread
+TEST_P(ZLogTest, SubscribeMany) {
+  DoSetUp();
+
+  const int num_subs = 50;
+  std::mutex lock;
+  std::condition_variable cond;
+  std::vector<int> delivered(num_subs, 0);
+  std::set<std::thread::id> threads;
+  std::vector<uint64_t> subs(num_subs);
+  std::vector<int> unsubscribed;
+
+  for (int i = 0; i < num_subs; i++) {
+    ASSERT_EQ(log->Subscribe(i % 5, [&, i](zlog::LogEntry& entry) {
+      // a callback can unsubscribe other subscriptions, but not its own
+      if (i == 0 && entry.position == 2) {
+        std::lock_guard<std::mutex> lk(lock);
+        unsubscribed.push_back(log->Unsubscribe(subs[0]));
+        unsubscribed.push_back(log->Unsubscribe(subs[1]));
+      }
+      std::lock_guard<std::mutex> lk(lock);
+      delivered[i]++;
+      threads.insert(std::this_thread::get_id());
+      cond.notify_one();
+    }, &subs[i]), 0);
+  }
+
+  uint64_t pos;
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(log->Append("a" + std::to_string(i), &pos), 0);
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    ASSERT_TRUE(cond.wait_for(lk, std::chrono::seconds(10), [&] {
+      for (int i = 2; i < num_subs; i++) {
+        if (delivered[i] < 20 - i % 5) {
+          return false;
+        }
+      }
+      return true;
+    }));
+    ASSERT_EQ(threads.size(), 1u);
+    ASSERT_EQ(unsubscribed, std::vector<int>({-EDEADLK, 0}));
+    ASSERT_LE(delivered[1], 2);
+  }
+
+  ASSERT_EQ(log->Unsubscribe(subs[0]), 0);
+  ASSERT_EQ(log->Unsubscribe(subs[1]), -ENOENT);
+}
+
+// entries appended by another client are delivered through the backend watch
+TEST_P(ZLogTest, SubscribeOtherClient) {
+  DoSetUp();
+
+  if (!lowlevel()) {
+    // the other client needs the same backend instance
+    return;
+  }
+
+  zlog::Options options2 = options;
+  options2.create_if_missing = false;
+  options2.error_if_exists = false;
+  zlog::Log *log2;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &log2), 0);
+
+  std::mutex lock;
+  std::condition_variable cond;
+  std::vector<std::string> entries;
+  uint64_t sub;
+  ASSERT_EQ(log->Subscribe(0, [&](zlog::LogEntry& entry) {
+    std::lock_guard<std::mutex> lk(lock);
+    entries.push_back(entry.data);
+    cond.notify_one();
+  }, &sub), 0);
+
+  std::thread appender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t pos;
+    for (int i = 0; i < 5; i++) {
+      ASSERT_EQ(log2->Append("b" + std::to_string(i), &pos), 0);
+    }
+  });
+
+  ASSERT_EQ(log->WaitForPosition(4, 10000), 0);
+  appender.join();
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    ASSERT_TRUE(cond.wait_for(lk, std::chrono::seconds(10),
+          [&] { return entries.size() == 5; }));
+    for (int i = 0; i < 5; i++) {
+      ASSERT_EQ(entries[i], "b" + std::to_string(i));
+    }
+  }
+
+  ASSERT_EQ(log->Unsubscribe(sub), 0);
+  delete log2;
+}
+
+// writers share the sequence of a zlog-seqr server without proposing
+// themselves as the sequencer
+TEST_P(ZLogTest, SeqrServer) {
+  DoSetUp();
+
+  if (!lowlevel()) {
+    // the server's log instance needs the same backend instance
+    return;
+  }
+
+  zlog::Options options2 = options;
+  options2.create_if_missing = false;
+  options2.error_if_exists = false;
+  options2.statistics = nullptr;
+
+  uint64_t pos;
+  ASSERT_EQ(log->Append("a", &pos), 0);
+  ASSERT_EQ(pos, 0u);
+
+  zlog::Log *slog;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &slog), 0);
+  zlog::SeqrServer *server;
+  ASSERT_EQ(zlog::SeqrServer::Start("127.0.0.1", 0, 2, &server), 0);
+  ASSERT_EQ(server->add_log((zlog::LogImpl*)slog), 0);
+  ASSERT_EQ(server->add_log((zlog::LogImpl*)slog), -EEXIST);
+
+  zlog::Log *log2;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &log2), 0);
+  auto *li = (zlog::LogImpl*)log;
+  auto *li2 = (zlog::LogImpl*)log2;
+
+  // appends from both clients are sequenced by the server
+  std::mutex lock;
+  std::set<uint64_t> positions;
+  std::vector<std::thread> threads;
+  for (auto l : {log, log2}) {
+    threads.emplace_back([&, l] {
+      for (int i = 0; i < 50; i++) {
+        uint64_t p;
+        ASSERT_EQ(l->Append("b", &p), 0);
+        std::lock_guard<std::mutex> lk(lock);
+        ASSERT_TRUE(positions.insert(p).second);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(positions.size(), 100u);
+  ASSERT_GT(*positions.begin(), 0u);
+
+  std::vector<uint64_t> batch;
+  ASSERT_EQ(log2->AppendBatch({"c", "d", "e"}, &batch), 0);
+  ASSERT_EQ(batch.size(), 3u);
+  ASSERT_EQ(batch[1], batch[0] + 1);
+  ASSERT_EQ(batch[2], batch[0] + 2);
+  ASSERT_GT(batch[0], *positions.rbegin());
+
+  ASSERT_EQ(log->CheckTail(&pos), 0);
+  ASSERT_EQ(pos, batch[2] + 1);
+
+  std::string data;
+  ASSERT_EQ(log->Read(batch[1], &data), 0);
+  ASSERT_EQ(data, "d");
+
+  // neither client changed the sequencer
+  ASSERT_EQ(li2->append_propose_sequencer, 0u);
+  ASSERT_EQ(li->striper->view()->seq_config()->address(), server->address());
+  ASSERT_EQ(li2->striper->view()->seq_config()->address(), server->address());
+  ASSERT_TRUE(li2->striper->view()->seq->remote());
+  ASSERT_EQ(server->stats().positions, 103u);
+
+  // appends fail while the server is down
+  const auto epoch = li2->striper->view()->epoch();
+  delete server;
+  ASSERT_LT(log2->Append("f", &pos), 0);
+  ASSERT_EQ(li2->append_propose_sequencer, 0u);
+  ASSERT_EQ(li2->striper->view()->epoch(), epoch);
+
+  // and a new server takes over
+  ASSERT_EQ(zlog::SeqrServer::Start("127.0.0.1", 0, 1, &server), 0);
+  ASSERT_EQ(server->add_log((zlog::LogImpl*)slog), 0);
+  ASSERT_EQ(log2->Append("g", &pos), 0);
+  ASSERT_GT(pos, batch[2]);
+  ASSERT_EQ(li2->striper->view()->seq_config()->address(), server->address());
+
+  delete log2;
+  delete server;
+  delete slog;
+}
+
+// a new sequencer starts after the maximum position written, found among many
+// stripes, including empty stripes below the maximum
+TEST_P(ZLogTest, ProposeSequencerManyStripes) {
+  DoSetUp();
+
+  if (!lowlevel()) {
+    // the other client needs the same backend instance
+    return;
+  }
+
+  zlog::Options options2 = options;
+  options2.create_if_missing = true;
+  options2.error_if_exists = false;
+  options2.statistics = nullptr;
+  options2.stripe_width = 2;
+  options2.stripe_slots = 1;
+  options2.sequencer_takeover_threads = 4;
+
+  zlog::Log *log2;
+  ASSERT_EQ(zlog::Log::Open(options2, "takeover", &log2), 0);
+  auto *li2 = (zlog::LogImpl*)log2;
+
+  uint64_t pos;
+  for (int i = 0; i < 40; i++) {
+    ASSERT_EQ(log2->Append("a", &pos), 0);
+  }
+  ASSERT_EQ(pos, 39u);
+
+  // stripes 20 to 74 are left empty
+  while (!li2->striper->view()->object_map().map(200).first) {
+    ASSERT_EQ(li2->striper->try_expand_view(200), 0);
+  }
+  ASSERT_GT(li2->striper->view()->object_map().num_stripes(), 100u);
+  ASSERT_EQ(log2->Fill(150), 0);
+
+  zlog::Log *log3;
+  ASSERT_EQ(zlog::Log::Open(options2, "takeover", &log3), 0);
+  ASSERT_EQ(log3->Append("b", &pos), 0);
+  ASSERT_EQ(pos, 151u);
+
+  // the old sequencer's objects are sealed
+  ASSERT_EQ(log2->Append("c", &pos), 0);
+  ASSERT_EQ(pos, 152u);
+
+  delete log3;
+  delete log2;
+}
+
+// leased positions that are left unused are filled when the sequencer is
+// replaced and when the log is closed
+TEST_P(ZLogTest, SequencerLeases) {
+  DoSetUp();
+
+  if (!lowlevel()) {
+    // the other client needs the same backend instance
+    return;
+  }
+
+  zlog::Options options2 = options;
+  options2.create_if_missing = false;
+  options2.error_if_exists = false;
+  options2.statistics = nullptr;
+  options2.sequencer_lease_size = 8;
+  options2.sequencer_lease_idle_ms = 0;
+
+  uint64_t pos;
+  ASSERT_EQ(log->Append("a", &pos), 0);
+  ASSERT_EQ(pos, 0u);
+
+  zlog::Log *llog;
+  ASSERT_EQ(zlog::Log::Open(options2, "mylog", &llog), 0);
+  auto *lli = (zlog::LogImpl*)llog;
+
+  // the first append leases [1, 9), and batches aren't leased
+  ASSERT_EQ(llog->Append("b", &pos), 0);
+  ASSERT_EQ(pos, 1u);
+  ASSERT_TRUE(lli->striper->view()->seq->leasing());
+  std::vector<uint64_t> batch;
+  ASSERT_EQ(llog->AppendBatch({"c", "d"}, &batch), 0);
+  ASSERT_EQ(batch[0], 9u);
+
+  // the other client takes over the sequencer
+  ASSERT_EQ(log->Append("e", &pos), 0);
+  ASSERT_EQ(pos, 11u);
+
+  // the leased positions below the new sequencer's first position are filled
+  // once the leasing client sees the new sequencer
+  lli->striper->refresh_view();
+  const auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::seconds(10);
+  while (lli->lease_fills < 7u &&
+      std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(lli->lease_fills, 7u);
+
+  std::string data;
+  for (uint64_t p = 2; p < 9; p++) {
+    ASSERT_EQ(log->Read(p, &data), -ENODATA);
+  }
+  ASSERT_EQ(log->Read(9, &data), 0);
+  ASSERT_EQ(data, "c");
+
+  // and the rest of a new lease is filled when the log is closed
+  ASSERT_EQ(llog->Append("f", &pos), 0);
+  ASSERT_EQ(pos, 12u);
+  delete llog;
+  for (uint64_t p = 13; p < 20; p++) {
+    ASSERT_EQ(log->Read(p, &data), -ENODATA);
+  }
+  ASSERT_EQ(log->Read(20, &data), -ENOENT);
+}
+
+// the rest of a lease that the appending core stops using is filled, and
+// readers waiting at those positions make progress
+TEST_P(ZLogTest, SequencerLeaseIdle) {
+  options.sequencer_lease_size = 8;
+  options.sequencer_lease_idle_ms = 10;
+  DoSetUp();
+
+  uint64_t pos;
+  ASSERT_EQ(log->Append("a", &pos), 0);
+  auto *li = (zlog::LogImpl*)log;
+  ASSERT_TRUE(li->striper->view()->seq->leasing());
+
+  ASSERT_EQ(log->WaitForPosition(pos + 7, 10000), 0);
+  std::string data;
+  for (uint64_t p = pos + 1; p < pos + 8; p++) {
+    ASSERT_EQ(log->Read(p, &data), -ENODATA);
+  }
+  for (int i = 0; i < 1000 && li->lease_fills < 7u; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(li->lease_fills, 7u);
+
+  // the next append takes a new lease
+  uint64_t pos2;
+  ASSERT_EQ(log->Append("b", &pos2), 0);
+  ASSERT_EQ(pos2, pos + 8);
+}
+
+// appends that complete in reverse order are delivered in position order
+TEST_P(ZLogTest, OrderedAppendCallbacks) {
+  DoSetUp();
+
+  auto *li = (zlog::LogImpl*)log;
+  auto async_backend = std::make_shared<AsyncBackend>(
+      li->backend->backend(), 16, true);
+
+  for (const bool ordered : {false, true}) {
+    zlog::Options opts;
+    opts.backend = async_backend;
+    opts.finisher_threads = 4;
+    opts.ordered_append_callbacks = ordered;
+    zlog::Log *alog;
+    int ret = zlog::Log::Open(opts, "mylog", &alog);
+    ASSERT_EQ(ret, 0);
+    std::unique_ptr<zlog::Log> alog_ptr(alog);
+
+    const int count = 64;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::vector<uint64_t> positions;
+
+    // buffers for gathered appends must outlive the append
+    std::deque<std::string> entries;
+
+    for (int i = 0; i < count; i++) {
+      entries.push_back("entry-" + std::to_string(i));
+      const auto& entry = entries.back();
+      auto cb = [&](int ret, uint64_t pos) {
+        ASSERT_EQ(ret, 0);
+        std::lock_guard<std::mutex> lk(lock);
+        positions.push_back(pos);
+        cond.notify_one();
+      };
+      // the gather path is ordered too
+      ret = (i % 2) ? alog->appendAsync(std::vector<zlog::Slice>{entry}, cb) :
+        alog->appendAsync(entry, cb);
+      ASSERT_EQ(ret, 0);
+    }
+
+    {
+      std::unique_lock<std::mutex> lk(lock);
+      cond.wait(lk, [&] { return positions.size() == (size_t)count; });
+    }
+
+    const bool sorted = std::is_sorted(positions.begin(), positions.end());
+    if (!ordered) {
+      ASSERT_FALSE(sorted);
+      continue;
+    }
+    ASSERT_TRUE(sorted);
+
+
+    const auto stats = ((zlog::LogImpl*)alog)->append_window->stats();
+    ASSERT_EQ(stats.size, 0u);
+    ASSERT_GT(stats.max_size, 1u);
+    ASSERT_GT(stats.held, 0u);
+  }
+
+  // synchronous appends aren't ordered, so a callback can make one. with a
+  // synchronous backend the callback runs on a finisher, and the append runs
+  // inline or on the other finisher.
+  zlog::Options opts;
+  opts.backend = li->backend->backend();
+  opts.finisher_threads = 2;
+  opts.ordered_append_callbacks = true;
+  for (const bool inline_sync_ops : {false, true}) {
+    opts.inline_sync_ops = inline_sync_ops;
+    zlog::Log *olog;
+    ASSERT_EQ(zlog::Log::Open(opts, "mylog", &olog), 0);
+    std::unique_ptr<zlog::Log> olog_ptr(olog);
+
+    std::mutex lock;
+    std::condition_variable cond;
+    bool done = false;
+    uint64_t async_pos = 0, sync_pos = 0;
+    int ret = olog->appendAsync("async", [&](int ret, uint64_t pos) {
+      ASSERT_EQ(ret, 0);
+      uint64_t p;
+      ASSERT_EQ(olog->Append("sync", &p), 0);
+      std::lock_guard<std::mutex> lk(lock);
+      async_pos = pos;
+      sync_pos = p;
+      done = true;
+      cond.notify_one();
+    });
+    ASSERT_EQ(ret, 0);
+
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return done; });
+    ASSERT_GT(sync_pos, async_pos);
+  }
+}
+
+// holds the first write until it is released, and records the thread that
+// makes each write request.
+class GatedBackend : public AsyncBackend {
+ public:
+  explicit GatedBackend(std::shared_ptr<zlog::Backend> backend) :
+    AsyncBackend(backend, 1)
+  {}
+
+  int WriteV(const std::string& oid, const zlog::Slice *data, size_t count,
+      uint64_t epoch, uint64_t position) override {
+    wait();
+    return AsyncBackend::WriteV(oid, data, count, epoch, position);
+  }
+
+  void WriteBatch(const std::string& oid, uint64_t epoch,
+      const uint64_t *positions, const zlog::Slice *data, size_t count,
+      int *results) override {
+    wait();
+    for (size_t i = 0; i < count; i++) {
+      results[i] = AsyncBackend::WriteV(oid, &data[i], 1, epoch,
+          positions[i]);
+    }
+  }
+
+  void wait_for_write() {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return !writers.empty(); });
+  }
+
+  void release() {
+    std::lock_guard<std::mutex> lk(lock);
+    released = true;
+    cond.notify_all();
+  }
+
+  std::mutex lock;
+  std::condition_variable cond;
+  bool released = false;
+  std::vector<std::thread::id> writers;
+
+ private:
+  void wait() {
+    std::unique_lock<std::mutex> lk(lock);
+    writers.push_back(std::this_thread::get_id());
+    cond.notify_all();
+    cond.wait(lk, [&] { return released; });
+  }
+};
+
+// a writer that arrives while the leader is writing takes over the next
+// batch, rather than the leader writing batches for as long as writes arrive
+TEST_P(ZLogTest, CoalesceHandoff) {
+  DoSetUp();
+
+  auto *li = (zlog::LogImpl*)log;
+  auto backend = std::make_shared<GatedBackend>(li->backend->backend());
+  zlog::WriteCoalescer coalescer(backend, 16, 1 << 20, 0);
+
+  std::atomic<int> done(0);
+  const std::string data = "x";
+  auto write = [&](uint64_t position) {
+    coalescer.Write("obj", data, 1, position, [&](int ret) { done++; });
+  };
+
+  std::thread leader(write, 0);
+  backend->wait_for_write();
+
+  std::vector<std::thread> writers;
+  for (uint64_t i = 1; i < 5; i++) {
+    writers.emplace_back(write, i);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  backend->release();
+  leader.join();
+  for (auto& writer : writers) {
+    writer.join();
+  }
+
+  ASSERT_EQ(done, 5);
+  ASSERT_EQ(coalescer.num_writes(), 5u);
+  ASSERT_EQ(backend->writers.size(), 2u);
+  ASSERT_NE(backend->writers[0], backend->writers[1]);
+}
+
+// corrupts the next corrupt_reads entries that are read successfully by
+// flipping the bits of their first byte.
+class CorruptingBackend : public AsyncBackend {
+ public:
+  explicit CorruptingBackend(std::shared_ptr<zlog::Backend> backend) :
+    AsyncBackend(backend, 1),
+    corrupt_reads(0)
+  {}
+
+  int Read(const std::string& oid, uint64_t epoch, uint64_t position,
+      std::string *data_out) override {
+    int ret = AsyncBackend::Read(oid, epoch, position, data_out);
+    if (!ret && !data_out->empty() && corrupt_reads > 0) {
+      corrupt_reads--;
+      (*data_out)[0] = ~(*data_out)[0];
+    }
+    return ret;
+  }
+
+  std::atomic<int> corrupt_reads;
+};
+
+TEST_P(ZLogTest, EntryChecksums) {
+  options.entry_checksums = true;
+  DoSetUp();
+
+  auto *li = (zlog::LogImpl*)log;
+  auto backend = std::make_shared<CorruptingBackend>(li->backend->backend());
+
+  for (const bool compress : {false, true}) {
+    zlog::Options opts;
+    opts.backend = backend;
+    opts.entry_checksums = true;
+    opts.checksum_refetch_attempts = 2;
+    if (compress) {
+      opts.codec = zlog::Codec::Builtin("lz");
+      opts.create_if_missing = true;
+    }
+
+    // the codec is chosen when a log is created
+    zlog::Log *clog;
+    ASSERT_EQ(zlog::Log::Open(opts, compress ? "lzlog" : "mylog", &clog), 0);
+    std::unique_ptr<zlog::Log> clog_ptr(clog);
+
+    // entries written with each append path read back intact
+    const std::string text(200, 'x');
+    std::map<uint64_t, std::string> entries;
+    uint64_t pos;
+    ASSERT_EQ(clog->Append(text, &pos), 0);
+    entries.emplace(pos, text);
+    ASSERT_EQ(clog->Append(std::string(), &pos), 0);
+    entries.emplace(pos, std::string());
+    const std::vector<zlog::Slice> slices = {text, "abc"};
+    ASSERT_EQ(clog->Append(slices, &pos), 0);
+    entries.emplace(pos, text + "abc");
+    std::vector<std::string> batch;
+    for (int i = 0; i < 10; i++) {
+      batch.push_back("batch-" + std::to_string(i));
+    }
+    std::vector<uint64_t> positions;
+    ASSERT_EQ(clog->AppendBatch(std::vector<std::string>(batch),
+          &positions), 0);
+    for (int i = 0; i < 10; i++) {
+      entries.emplace(positions[i], batch[i]);
+    }
+
+    for (const auto& entry : entries) {
+      std::string data;
+      ASSERT_EQ(clog->Read(entry.first, &data), 0);
+      ASSERT_EQ(data, entry.second);
+    }
+
+    // a corrupt entry fails to read
+    pos = entries.begin()->first;
+    std::string data;
+    backend->corrupt_reads = 1;
+    ASSERT_EQ(clog->Read(pos, &data), -EIO);
+    ASSERT_EQ(clog->Read(pos, &data), 0);
+    ASSERT_EQ(data, text);
+
+    auto *cli = (zlog::LogImpl*)clog;
+    ASSERT_EQ(cli->read_checksum_failures, 1u);
+    ASSERT_EQ(cli->read_checksum_refetches, 0u);
+  }
+
+  // an entry that is corrupt when it is read is refetched
+  zlog::Options opts;
+  opts.backend = backend;
+  opts.entry_checksums = true;
+  opts.checksum_policy = zlog::Options::CHECKSUM_REFETCH;
+  opts.checksum_refetch_attempts = 2;
+
+  zlog::Log *clog;
+  ASSERT_EQ(zlog::Log::Open(opts, "mylog", &clog), 0);
+  std::unique_ptr<zlog::Log> clog_ptr(clog);
+  auto *cli = (zlog::LogImpl*)clog;
+
+  uint64_t pos;
+  ASSERT_EQ(clog->Append("entry", &pos), 0);
+
+  std::string data;
+  backend->corrupt_reads = 2;
+  ASSERT_EQ(clog->Read(pos, &data), 0);
+  ASSERT_EQ(data, "entry");
+  ASSERT_EQ(cli->read_checksum_refetches, 2u);
+  ASSERT_EQ(cli->read_checksum_failures, 0u);
+
+  backend->corrupt_reads = 3;
+  ASSERT_EQ(clog->Read(pos, &data), -EIO);
+  ASSERT_EQ(cli->read_checksum_refetches, 4u);
+  ASSERT_EQ(cli->read_checksum_failures, 1u);
+  ASSERT_EQ(backend->corrupt_reads, 0);
+
+  // range reads verify the entries together, and refetch corrupt ones
+  std::vector<zlog::LogEntry> entries;
+  backend->corrupt_reads = 1;
+  ASSERT_EQ(clog->ReadRange(pos, pos + 1, &entries), 0);
+  ASSERT_EQ(entries.size(), 1u);
+  ASSERT_EQ(entries[0].ret, 0);
+  ASSERT_EQ(entries[0].data, "entry");
+  ASSERT_EQ(cli->read_checksum_refetches, 5u);
+
+  // or logged and returned as is
+  opts.checksum_policy = zlog::Options::CHECKSUM_LOG;
+  zlog::Log *llog;
+  ASSERT_EQ(zlog::Log::Open(opts, "mylog", &llog), 0);
+  std::unique_ptr<zlog::Log> llog_ptr(llog);
+
+  backend->corrupt_reads = 1;
+  ASSERT_EQ(llog->Read(pos, &data), 0);
+  ASSERT_NE(data, "entry");
+  ASSERT_EQ(data.size(), strlen("entry"));
+  ASSERT_EQ(((zlog::LogImpl*)llog)->read_checksum_failures, 1u);
+}
+
 // empty log: trim to first pos first stripe
 TEST_P(ZLogTest, TrimTo_EmptyA) {
   options.stripe_width = 5;
@@ -1,5 +1,7 @@
 #include "view.h"
+#include <cerrno>
 #include <iostream>
+#include "include/zlog/codec.h"
 #include "include/zlog/options.h"
 #include "libzlog/zlog_generated.h"
 #include <nlohmann/json.hpp>
@@ -20,7 +22,9 @@ View View::decode(const std::string& view_data)
 
   return View(
       ObjectMap::decode(view->object_map()),
-      SequencerConfig::decode(view->sequencer()));
+      SequencerConfig::decode(view->sequencer()),
+      flatbuffers::GetString(view->codec()),
+      view->entry_checksums());
 }
 
 std::string View::create_initial(const Options& options)
@@ -43,8 +47,13 @@ std::string View::create_initial(const Options& options)
     zlog::fbs::CreateObjectMapDirect(fbb, 0, nullptr, 0) :
     ObjectMap(1, stripes, 0).encode(fbb);
 
+  flatbuffers::Offset<flatbuffers::String> codec =
+    options.codec ? fbb.CreateString(options.codec->Name()) : 0;
+
   auto builder = zlog::fbs::ViewBuilder(fbb);
   builder.add_object_map(object_map);
+  builder.add_codec(codec);
+  builder.add_entry_checksums(options.entry_checksums);
 
   auto view = builder.Finish();
   fbb.Finish(view);
@@ -62,9 +71,14 @@ std::string View::encode() const
   flatbuffers::Offset<zlog::fbs::Sequencer> seq =
     seq_config_ ? seq_config_->encode(fbb) : 0;
 
+  flatbuffers::Offset<flatbuffers::String> codec =
+    codec_.empty() ? 0 : fbb.CreateString(codec_);
+
   auto builder = zlog::fbs::ViewBuilder(fbb);
   builder.add_object_map(encoded_object_map);
   builder.add_sequencer(seq);
+  builder.add_codec(codec);
+  builder.add_entry_checksums(entry_checksums_);
 
   auto view = builder.Finish();
   fbb.Finish(view);
@@ -79,7 +93,7 @@ boost::optional<View> View::expand_mapping(const uint64_t position,
   const auto new_object_map = object_map_.expand_mapping(position,
       options);
   if (new_object_map) {
-    return View(*new_object_map, seq_config_);
+    return View(*new_object_map, seq_config_, codec_, entry_checksums_);
   }
   return boost::none;
 }
@@ -89,14 +103,37 @@ boost::optional<View> View::advance_min_valid_position(uint64_t position) const
 {
   const auto new_object_map = object_map_.advance_min_valid_position(position);
   if (new_object_map) {
-    return View(*new_object_map, seq_config_);
+    return View(*new_object_map, seq_config_, codec_, entry_checksums_);
   }
   return boost::none;
 }
 
 View View::set_sequencer_config(SequencerConfig seq_config) const
 {
-  return View(object_map_, seq_config);
+  return View(object_map_, seq_config, codec_, entry_checksums_);
+}
+
+int View::check_entry_format(const Options& options) const
+{
+  if (options.entry_checksums != entry_checksums_) {
+    return -EINVAL;
+  }
+
+  // entries behind a codec header can be read with any codec when they were
+  // written by a built-in codec, and otherwise only with the same codec.
+  if (codec_.empty()) {
+    return options.codec ? -EINVAL : 0;
+  }
+
+  if (!options.codec) {
+    return -EINVAL;
+  }
+
+  if (codec_ != options.codec->Name() && !Codec::Builtin(codec_)) {
+    return -EINVAL;
+  }
+
+  return 0;
 }
 
 void View::dump(nlohmann::json& out) const
@@ -107,6 +144,8 @@ void View::dump(nlohmann::json& out) const
   } else {
     out["seq_config"] = nullptr;
   }
+  out["codec"] = codec_;
+  out["entry_checksums"] = entry_checksums_;
 }
 
 void VersionedView::dump(nlohmann::json& out) const
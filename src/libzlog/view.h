@@ -18,9 +18,12 @@ struct Options;
 
 class View {
  public:
-  View(ObjectMap object_map, boost::optional<SequencerConfig> seq_config) :
+  View(ObjectMap object_map, boost::optional<SequencerConfig> seq_config,
+      const std::string& codec = "", bool entry_checksums = false) :
     object_map_(object_map),
-    seq_config_(seq_config)
+    seq_config_(seq_config),
+    codec_(codec),
+    entry_checksums_(entry_checksums)
   {}
 
   View(const View& other) = default;
@@ -61,9 +64,26 @@ class View {
     return seq_config_;
   }
 
+  // the name of the codec that entries are written with, or empty when
+  // entries aren't stored behind a codec header. set when the log is created.
+  const std::string& codec() const {
+    return codec_;
+  }
+
+  // entries end with a crc32c checksum. set when the log is created.
+  bool entry_checksums() const {
+    return entry_checksums_;
+  }
+
+  // returns 0 if a log instance with these options reads and writes entries
+  // in the format of this log, and -EINVAL otherwise.
+  int check_entry_format(const Options& options) const;
+
  private:
   ObjectMap object_map_;
   boost::optional<SequencerConfig> seq_config_;
+  std::string codec_;
+  bool entry_checksums_;
 };
 
 class VersionedView : public View {
@@ -1,6 +1,8 @@
 #include "libzlog/view_reader.h"
 #include "include/zlog/backend.h"
 #include "log_backend.h"
+#include "seqr_client.h"
+#include <algorithm>
 #include <iostream>
 
 namespace zlog {
@@ -147,6 +149,12 @@ std::unique_ptr<VersionedView> ViewReader::get_latest_view() const
       new VersionedView(it->first, it->second));
 }
 
+void ViewReader::set_retired_leases_handler(RetiredLeasesHandler handler)
+{
+  std::lock_guard<std::mutex> lk(lock_);
+  retired_leases_handler_ = std::move(handler);
+}
+
 void ViewReader::refresh_view()
 {
   auto latest_view = get_latest_view();
@@ -156,7 +164,10 @@ void ViewReader::refresh_view()
   }
   assert(!latest_view->seq);
 
-  std::lock_guard<std::mutex> lk(lock_);
+  std::vector<std::pair<uint64_t, uint64_t>> retired;
+  RetiredLeasesHandler handler;
+
+  std::unique_lock<std::mutex> lk(lock_);
 
   if (view_) {
     assert(latest_view->epoch() >= view_->epoch());
@@ -207,11 +218,53 @@ void ViewReader::refresh_view()
     } else {
       // create a new instance for this sequencer
       latest_view->seq = std::make_shared<Sequencer>(latest_view->epoch(),
-          latest_view->seq_config()->position());
+          latest_view->seq_config()->position(),
+          options_.sequencer_lease_size);
     }
+  } else if (latest_view->seq_config() &&
+      !latest_view->seq_config()->address().empty()) {
+    // positions are handed out by a zlog-seqr server, which is shared by all
+    // of the log's clients. as above, the server's sequencer state (and our
+    // connection to it) is reused when the sequencer hasn't changed.
+    const auto& seq_config = *latest_view->seq_config();
+    if (view_ &&
+        view_->seq_config() &&
+        view_->seq_config()->address() == seq_config.address() &&
+        view_->seq_config()->epoch() == seq_config.epoch()) {
+      assert(view_->seq);
+      latest_view->seq = view_->seq;
+    } else {
+      latest_view->seq = std::make_shared<Sequencer>(latest_view->epoch(),
+          seq_config.epoch(), std::make_shared<SeqrClient>(
+            seq_config.address(), backend_->prefix()));
+    }
+  }
+
+  // when our sequencer is replaced, the positions that its leases still hold
+  // are drained. those below the new sequencer's first position will never be
+  // handed out, and are given to the handler to be filled. the rest will be
+  // handed out again by the new sequencer.
+  if (view_ && view_->seq && view_->seq->leasing() &&
+      view_->seq != latest_view->seq) {
+    std::vector<std::pair<uint64_t, uint64_t>> unused;
+    view_->seq->drain_leases(&unused);
+    if (latest_view->seq_config()) {
+      const auto start = latest_view->seq_config()->position();
+      for (const auto& range : unused) {
+        if (range.first < start) {
+          retired.emplace_back(range.first, std::min(range.second, start));
+        }
+      }
+    }
+    handler = retired_leases_handler_;
   }
 
   view_ = std::move(latest_view);
+  lk.unlock();
+
+  if (!retired.empty() && handler) {
+    handler(retired);
+  }
 }
 
 }
@@ -1,9 +1,12 @@
 #pragma once
 #include <condition_variable>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 #include "libzlog/view.h"
 #include "include/zlog/options.h"
 
@@ -59,6 +62,13 @@ class ViewReader final {
   // read the latest view from storage
   std::unique_ptr<VersionedView> get_latest_view() const;
 
+  // ranges [first, end) of positions that were leased by this instance's
+  // sequencer, and left unused when it was replaced. the handler is called
+  // without the view lock held.
+  typedef std::function<void(
+      std::vector<std::pair<uint64_t, uint64_t>>&)> RetiredLeasesHandler;
+  void set_retired_leases_handler(RetiredLeasesHandler handler);
+
  private:
   struct RefreshWaiter {
     explicit RefreshWaiter(uint64_t epoch) :
@@ -78,6 +88,7 @@ class ViewReader final {
   const Options options_;
 
   std::shared_ptr<const VersionedView> view_;
+  RetiredLeasesHandler retired_leases_handler_;
 
   void refresh_entry_();
   std::chrono::milliseconds refresh_timeout_;
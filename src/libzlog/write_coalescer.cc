@@ -0,0 +1,144 @@
+#include "write_coalescer.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include "include/zlog/backend.h"
+
+namespace zlog {
+
+static const size_t num_shards = 16;
+
+WriteCoalescer::WriteCoalescer(std::shared_ptr<Backend> backend,
+    const size_t max_entries, const size_t max_bytes,
+    const uint32_t window_us) :
+  backend_(backend),
+  max_entries_(std::max<size_t>(max_entries, 1)),
+  max_bytes_(std::max<size_t>(max_bytes, 1)),
+  window_us_(window_us),
+  num_writes_(0),
+  num_batches_(0)
+{
+  assert(backend_);
+  for (size_t i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+WriteCoalescer::Shard& WriteCoalescer::shard_for(const std::string& oid)
+{
+  return *shards_[std::hash<std::string>()(oid) % shards_.size()];
+}
+
+void WriteCoalescer::Write(std::string&& oid, const std::string& data,
+    const uint64_t epoch, const uint64_t position,
+    std::function<void(int)> cb)
+{
+  auto& shard = shard_for(oid);
+  std::unique_lock<std::mutex> lk(shard.lock);
+
+  // references to map elements remain valid when other elements are added
+  auto& obj = shard.objects[oid];
+  obj.pending.push_back(Request{epoch, position, Slice(data), std::move(cb)});
+  obj.pending_bytes += data.size();
+
+  if (obj.active) {
+    if (full(obj)) {
+      obj.cond.notify_one();
+    }
+
+    // the leader writes this request in its next batch, unless this is the
+    // first writer from another thread to arrive while the leader writes a
+    // batch. that writer waits to take over, and writes the next batch.
+    if (!obj.writing || obj.successor ||
+        obj.leader == std::this_thread::get_id()) {
+      return;
+    }
+    obj.successor = true;
+    obj.handoff.wait(lk, [&] { return !obj.active; });
+    obj.successor = false;
+    obj.active = true;
+  } else {
+    obj.active = true;
+    if (window_us_ > 0 && !full(obj)) {
+      obj.cond.wait_for(lk, std::chrono::microseconds(window_us_),
+          [&] { return full(obj); });
+    }
+  }
+
+  obj.leader = std::this_thread::get_id();
+
+  std::vector<Request> batch;
+  while (!obj.pending.empty() && !obj.successor) {
+    take_batch(obj, batch);
+    obj.writing = true;
+    lk.unlock();
+    write_batch(oid, batch);
+    batch.clear();
+    lk.lock();
+    obj.writing = false;
+  }
+
+  obj.active = false;
+  obj.leader = std::thread::id();
+  if (obj.successor) {
+    obj.handoff.notify_one();
+  } else {
+    shard.objects.erase(oid);
+  }
+}
+
+void WriteCoalescer::take_batch(Object& obj, std::vector<Request>& batch)
+{
+  assert(!obj.pending.empty());
+  const auto epoch = obj.pending.front().epoch;
+
+  size_t count = 0;
+  size_t bytes = 0;
+  for (const auto& req : obj.pending) {
+    if (count > 0 && (req.epoch != epoch || count == max_entries_ ||
+          bytes + req.data.size > max_bytes_)) {
+      break;
+    }
+    count++;
+    bytes += req.data.size;
+  }
+
+  if (count == obj.pending.size()) {
+    batch.swap(obj.pending);
+  } else {
+    batch.assign(std::make_move_iterator(obj.pending.begin()),
+        std::make_move_iterator(obj.pending.begin() + count));
+    obj.pending.erase(obj.pending.begin(), obj.pending.begin() + count);
+  }
+  obj.pending_bytes -= bytes;
+}
+
+void WriteCoalescer::write_batch(const std::string& oid,
+    std::vector<Request>& batch)
+{
+  const auto count = batch.size();
+  std::vector<uint64_t> positions(count);
+  std::vector<Slice> data(count);
+  std::vector<int> results(count);
+  for (size_t i = 0; i < count; i++) {
+    positions[i] = batch[i].position;
+    data[i] = batch[i].data;
+  }
+
+  if (count == 1) {
+    results[0] = backend_->WriteV(oid, &data[0], 1, batch[0].epoch,
+        positions[0]);
+  } else {
+    backend_->WriteBatch(oid, batch[0].epoch, positions.data(), data.data(),
+        count, results.data());
+  }
+
+  num_writes_ += count;
+  num_batches_++;
+
+  for (size_t i = 0; i < count; i++) {
+    batch[i].cb(results[i]);
+  }
+}
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "include/zlog/slice.h"
+
+namespace zlog {
+
+class Backend;
+
+/**
+ * WriteCoalescer combines concurrent writes to the same object into a single
+ * Backend::WriteBatch request.
+ *
+ * The first write to an object becomes the leader for that object and issues
+ * the backend request. Writes to the object that arrive while the leader's
+ * request is in progress are queued and written together in the next batch.
+ * The first of them from another thread waits to become the next leader, and
+ * the leader hands over to it after the batch it is writing, so that under a
+ * steady stream of writes to one object no thread writes batch after batch
+ * on behalf of the others. The others return once their request is queued.
+ * The leader keeps writing only while no other thread is waiting to take
+ * over. The result of each entry is delivered to the callback of the write
+ * that submitted it. No latency is added when there is no concurrency, unless
+ * a window is set, in which case the leader first waits up to the window for
+ * more writes.
+ *
+ * Writes are only combined if they are at the same epoch, and a combined
+ * request is bounded by max_entries and max_bytes.
+ */
+class WriteCoalescer final {
+ public:
+  WriteCoalescer(std::shared_ptr<Backend> backend, size_t max_entries,
+      size_t max_bytes, uint32_t window_us);
+
+  WriteCoalescer(const WriteCoalescer& other) = delete;
+  WriteCoalescer(WriteCoalescer&& other) = delete;
+  WriteCoalescer& operator=(const WriteCoalescer& other) = delete;
+  WriteCoalescer& operator=(WriteCoalescer&& other) = delete;
+
+ public:
+  // same contract as Backend::WriteAsync, except that the callback may be
+  // invoked on a thread that is writing on behalf of other callers.
+  void Write(std::string&& oid, const std::string& data, uint64_t epoch,
+      uint64_t position, std::function<void(int)> cb);
+
+  // number of entries written, and the number of backend requests used
+  uint64_t num_writes() const {
+    return num_writes_;
+  }
+
+  uint64_t num_batches() const {
+    return num_batches_;
+  }
+
+ private:
+  struct Request {
+    uint64_t epoch;
+    uint64_t position;
+    Slice data;
+    std::function<void(int)> cb;
+  };
+
+  struct Object {
+    // a leader is writing the queued requests, and is in the middle of
+    // writing a batch
+    bool active;
+    bool writing;
+    std::thread::id leader;
+    // a writer is waiting to take over from the leader
+    bool successor;
+    std::vector<Request> pending;
+    size_t pending_bytes;
+    // signals a leader waiting out the window that the batch is full
+    std::condition_variable cond;
+    // signals the successor that the leader is done
+    std::condition_variable handoff;
+
+    Object() : active(false), writing(false), successor(false),
+      pending_bytes(0) {}
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<std::string, Object> objects;
+  };
+
+  Shard& shard_for(const std::string& oid);
+
+  bool full(const Object& obj) const {
+    return obj.pending.size() >= max_entries_ ||
+      obj.pending_bytes >= max_bytes_;
+  }
+
+  // remove the next batch from the front of the queue
+  void take_batch(Object& obj, std::vector<Request>& batch);
+
+  void write_batch(const std::string& oid, std::vector<Request>& batch);
+
+  const std::shared_ptr<Backend> backend_;
+  const size_t max_entries_;
+  const size_t max_bytes_;
+  const uint32_t window_us_;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::atomic<uint64_t> num_writes_;
+  std::atomic<uint64_t> num_batches_;
+};
+
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "zlog/log.h"
+#include "zlog/options.h"
+#include "libzlog/log_impl.h"
+#include "libzlog/seqr_client.h"
+#include "libzlog/seqr_server.h"
+
+namespace po = boost::program_options;
+
+// measures the zlog-seqr request path over loopback. a server is started in
+// the process to sequence a log, and each thread reserves positions from it
+// for a fixed time through one of a set of client connections. threads that
+// share a connection have their requests pipelined. request throughput and
+// latency are reported for each number of threads.
+
+struct result {
+  uint64_t ops;
+  double secs;
+  // request latencies in microseconds, sorted
+  std::vector<double> latencies;
+};
+
+static result run(std::vector<std::unique_ptr<zlog::SeqrClient>>& clients,
+    uint64_t epoch, uint64_t count, int threads, double secs)
+{
+  std::atomic<bool> stop(false);
+  std::atomic<int> errors(0);
+  std::vector<std::vector<double>> latencies(threads);
+  std::vector<std::thread> workers;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      auto& client = *clients[t % clients.size()];
+      auto& lat = latencies[t];
+      while (!stop.load(std::memory_order_relaxed)) {
+        const auto op_start = std::chrono::steady_clock::now();
+        uint64_t position;
+        int ret = client.next(epoch, count, &position);
+        if (ret) {
+          errors++;
+          break;
+        }
+        const std::chrono::duration<double, std::micro> elapsed =
+          std::chrono::steady_clock::now() - op_start;
+        lat.push_back(elapsed.count());
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::duration<double>(secs));
+  stop = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  if (errors) {
+    std::cerr << "requests failed" << std::endl;
+    exit(1);
+  }
+
+  result r{0, elapsed.count(), {}};
+  for (auto& lat : latencies) {
+    r.latencies.insert(r.latencies.end(), lat.begin(), lat.end());
+  }
+  r.ops = r.latencies.size();
+  std::sort(r.latencies.begin(), r.latencies.end());
+  return r;
+}
+
+static double percentile(const std::vector<double>& sorted, double pct)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  const auto idx = static_cast<size_t>(pct / 100.0 * (sorted.size() - 1));
+  return sorted[idx];
+}
+
+int main(int argc, char **argv)
+{
+  std::string backend_name;
+  std::vector<std::string> backend_options;
+  std::vector<int> threads;
+  int num_clients;
+  int server_threads;
+  uint64_t count;
+  double secs;
+
+  po::options_description opts("Benchmark options");
+  opts.add_options()
+    ("help", "show help message")
+    ("backend-name", po::value<std::string>(&backend_name)->default_value("ram"), "backend name")
+    ("backend-opt", po::value<std::vector<std::string>>(&backend_options)->multitoken(), "backend options")
+    ("threads", po::value<std::vector<int>>(&threads)->multitoken(), "thread counts (default 1 2 4 8 16 32)")
+    ("clients", po::value<int>(&num_clients)->default_value(1), "client connections shared by the threads")
+    ("server-threads", po::value<int>(&server_threads)->default_value(1), "server event loop threads")
+    ("count", po::value<uint64_t>(&count)->default_value(1), "positions reserved per request")
+    ("secs", po::value<double>(&secs)->default_value(2.0), "seconds per measurement")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, opts), vm);
+
+  if (vm.count("help")) {
+    std::cout << opts << std::endl;
+    return 1;
+  }
+
+  po::notify(vm);
+
+  if (threads.empty()) {
+    threads = {1, 2, 4, 8, 16, 32};
+  }
+  if (num_clients <= 0 || count == 0) {
+    std::cerr << "clients and count must be greater than zero" << std::endl;
+    return 1;
+  }
+
+  zlog::Options options;
+  for (auto option : backend_options) {
+    auto pos = option.find(":");
+    if (pos == std::string::npos) {
+      std::cerr << "invalid option " << option << std::endl;
+      return 1;
+    }
+    options.backend_options[option.substr(0, pos)] = option.substr(pos + 1);
+  }
+  options.backend_name = backend_name;
+  options.create_if_missing = true;
+  options.error_if_exists = false;
+
+  zlog::Log *log;
+  int ret = zlog::Log::Open(options, "seqr_bench", &log);
+  if (ret) {
+    std::cerr << "log::open failed: " << strerror(-ret) << std::endl;
+    return 1;
+  }
+  std::unique_ptr<zlog::Log> log_ptr(log);
+  auto log_impl = static_cast<zlog::LogImpl*>(log);
+
+  zlog::SeqrServer *seqr_server;
+  ret = zlog::SeqrServer::Start("127.0.0.1", 0, server_threads, &seqr_server);
+  if (ret) {
+    std::cerr << "failed to start server: " << strerror(-ret) << std::endl;
+    return 1;
+  }
+  std::unique_ptr<zlog::SeqrServer> server(seqr_server);
+
+  ret = server->add_log(log_impl);
+  if (ret) {
+    std::cerr << "failed to sequence log: " << strerror(-ret) << std::endl;
+    return 1;
+  }
+
+  const auto epoch = log_impl->striper->view()->seq_config()->epoch();
+  const auto prefix = log_impl->backend->prefix();
+
+  std::vector<std::unique_ptr<zlog::SeqrClient>> clients;
+  for (int i = 0; i < num_clients; i++) {
+    clients.emplace_back(new zlog::SeqrClient(server->address(), prefix));
+  }
+
+  std::cout << "hardware threads " << std::thread::hardware_concurrency()
+    << std::endl;
+
+  for (const auto t : threads) {
+    const auto r = run(clients, epoch, count, t, secs);
+    const double ops_per_sec = r.ops / r.secs;
+    const auto stats = server->stats();
+    std::cout << "threads " << t
+      << " clients " << clients.size()
+      << " ops_per_sec " << (uint64_t)ops_per_sec
+      << " positions_per_sec " << (uint64_t)(ops_per_sec * count)
+      << " lat_us_p50 " << percentile(r.latencies, 50)
+      << " lat_us_p99 " << percentile(r.latencies, 99)
+      << " lat_us_max " << percentile(r.latencies, 100)
+      << " server_requests " << stats.requests
+      << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "libzlog/sequencer.h"
+
+namespace po = boost::program_options;
+
+// measures contention on a log instance's sequencer. each thread takes
+// positions from one sequencer for a fixed time, either updating the shared
+// tail for every position, or from the leases of its core. throughput is
+// reported for each number of threads and lease size.
+
+struct result {
+  uint64_t ops;
+  double secs;
+};
+
+static result run(uint32_t lease_size, int threads, double secs)
+{
+  zlog::Sequencer seq(1, 0, lease_size);
+
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> ops(threads);
+  std::vector<std::thread> workers;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      uint64_t count = 0;
+      uint64_t position;
+      while (!stop.load(std::memory_order_relaxed)) {
+        seq.next(&position);
+        count++;
+      }
+      ops[t] = count;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::duration<double>(secs));
+  stop = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  result r{0, elapsed.count()};
+  for (const auto count : ops) {
+    r.ops += count;
+  }
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<int> threads;
+  std::vector<uint32_t> lease_sizes;
+  double secs;
+
+  po::options_description opts("Benchmark options");
+  opts.add_options()
+    ("help", "show help message")
+    ("threads", po::value<std::vector<int>>(&threads)->multitoken(), "thread counts (default 1 2 4 8 16 32 64)")
+    ("lease-size", po::value<std::vector<uint32_t>>(&lease_sizes)->multitoken(), "lease sizes, 0 for no leasing (default 0 8 64)")
+    ("secs", po::value<double>(&secs)->default_value(1.0), "seconds per measurement")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, opts), vm);
+
+  if (vm.count("help")) {
+    std::cout << opts << std::endl;
+    return 1;
+  }
+
+  po::notify(vm);
+
+  if (threads.empty()) {
+    threads = {1, 2, 4, 8, 16, 32, 64};
+  }
+  if (lease_sizes.empty()) {
+    lease_sizes = {0, 8, 64};
+  }
+
+  std::cout << "hardware threads " << std::thread::hardware_concurrency()
+    << std::endl;
+
+  for (const auto lease_size : lease_sizes) {
+    for (const auto t : threads) {
+      const auto r = run(lease_size, t, secs);
+      std::cout << "lease_size " << lease_size
+        << " threads " << t
+        << " ops_per_sec " << (uint64_t)(r.ops / r.secs)
+        << std::endl;
+    }
+  }
+
+  return 0;
+}
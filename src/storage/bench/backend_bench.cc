@@ -1,5 +1,6 @@
 #include <atomic>
 #include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <random>
@@ -8,6 +9,8 @@
 #include <signal.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include <boost/program_options.hpp>
 #include "zlog/backend/ram.h"
 #include "zlog/options.h"
@@ -78,7 +81,7 @@ static void sig_handler(int sig)
 static void io_entry(std::shared_ptr<zlog::Backend> backend,
     const std::vector<std::vector<std::string>>& objects,
     uint64_t width, uint64_t slots, size_t entry_size,
-    uint64_t max_pos, rand_data_gen *gen)
+    uint64_t max_pos, rand_data_gen *gen, std::atomic<bool> *stop)
 {
   assert(!objects.empty());
   assert(objects[0].size() == width);
@@ -86,7 +89,7 @@ static void io_entry(std::shared_ptr<zlog::Backend> backend,
   const auto slots_per_row = width * slots;
 
   while (true) {
-    if (shutdown) {
+    if (shutdown || *stop) {
       break;
     }
 
@@ -138,6 +141,118 @@ static void stats_entry()
   }
 }
 
+static std::vector<std::vector<std::string>> init_objects(
+    std::shared_ptr<zlog::Backend> backend, const std::string& prefix,
+    uint32_t width, uint32_t slots, uint64_t max_pos)
+{
+  const auto slots_per_row = width * slots;
+  const auto num_rows = max_pos / slots_per_row;
+  std::vector<std::vector<std::string>> objects;
+  for (auto row = 0u; row < num_rows; row++) {
+    std::vector<std::string> tmp;
+    for (auto col = 0u; col < width; col++) {
+      std::stringstream ss;
+      ss << prefix << "." << row << "." << col;
+      auto oid = ss.str();
+      int ret = backend->Seal(oid, 1);
+      if (ret) {
+        std::cerr << "seal error: " << strerror(-ret) << std::endl;
+        assert(0);
+      }
+      tmp.push_back(ss.str());
+    }
+    if (shutdown) {
+      break;
+    }
+    objects.push_back(tmp);
+  }
+  return objects;
+}
+
+// run qdepth writer threads against a backend for the given number of
+// seconds and return the average write throughput.
+static double run_writes(std::shared_ptr<zlog::Backend> backend,
+    const std::vector<std::vector<std::string>>& objects,
+    uint32_t width, uint32_t slots, size_t entry_size, int qdepth,
+    int runtime, uint64_t max_pos, rand_data_gen *gen)
+{
+  std::atomic<bool> stop(false);
+
+  seq = 0;
+  const auto start_ops_count = op_count.load();
+  const auto start_us = getus();
+
+  std::vector<std::thread> io_threads;
+  for (int i = 0; i < qdepth; i++) {
+    io_threads.emplace_back(std::thread(io_entry, backend, objects,
+          width, slots, entry_size, max_pos, gen, &stop));
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait_for(lk, std::chrono::seconds(runtime),
+        [&] { return shutdown.load(); });
+  }
+
+  stop = true;
+  for (auto& t : io_threads) {
+    t.join();
+  }
+
+  const auto elapsed_us = getus() - start_us;
+  const auto ops = op_count.load() - start_ops_count;
+
+  return (double)(ops * 1000000ULL) / (double)elapsed_us;
+}
+
+// measure the throughput of the lmdb backend with and without group commit.
+// each run uses a fresh database under db_path.
+static int compare_group_commit(const std::string& db_path,
+    const std::string& prefix, uint32_t width, uint32_t slots,
+    size_t entry_size, int qdepth, int runtime, uint64_t max_pos,
+    size_t max_batch, uint64_t max_delay_us, rand_data_gen *gen)
+{
+  double iops[2];
+  for (int i = 0; i < 2; i++) {
+    const bool group_commit = i == 1;
+    const auto path = db_path + (group_commit ? ".gc" : ".nogc");
+    if (mkdir(path.c_str(), 0755) && errno != EEXIST) {
+      std::cerr << "mkdir " << path << ": " << strerror(errno) << std::endl;
+      return -errno;
+    }
+
+    std::map<std::string, std::string> opts;
+    opts["path"] = path;
+    if (group_commit) {
+      opts["group_commit"] = "true";
+      opts["group_commit_max_batch"] = std::to_string(max_batch);
+      opts["group_commit_max_delay_us"] = std::to_string(max_delay_us);
+    }
+
+    std::shared_ptr<zlog::Backend> backend;
+    int ret = zlog::Backend::Load("lmdb", opts, backend);
+    if (ret) {
+      std::cerr << "backend::load " << ret << std::endl;
+      return ret;
+    }
+
+    const auto objects = init_objects(backend, prefix, width, slots, max_pos);
+    iops[i] = run_writes(backend, objects, width, slots, entry_size, qdepth,
+        runtime, max_pos, gen);
+
+    std::cout << "group_commit " << (group_commit ? "on" : "off")
+      << " iops " << iops[i] << std::endl;
+
+    if (shutdown) {
+      return 0;
+    }
+  }
+
+  std::cout << "speedup " << (iops[1] / iops[0]) << std::endl;
+
+  return 0;
+}
+
 int main(int argc, char **argv)
 {
   std::string prefix;
@@ -151,6 +266,10 @@ int main(int argc, char **argv)
   std::string db_path;
   uint64_t max_pos;
   ssize_t omap_max_size;
+  bool group_commit;
+  size_t group_commit_max_batch;
+  uint64_t group_commit_max_delay_us;
+  bool compare_gc;
 
   po::options_description opts("Benchmark options");
   opts.add_options()
@@ -168,6 +287,10 @@ int main(int argc, char **argv)
     ("pool", po::value<std::string>(&pool)->default_value("zlog"), "pool (ceph)")
     ("db-path", po::value<std::string>(&db_path)->default_value("/tmp/zlog.bench.db"), "db path (lmdb)")
     ("omap-max-size", po::value<ssize_t>(&omap_max_size)->default_value(-1), "omap max size (ceph)")
+    ("group-commit", po::bool_switch(&group_commit), "enable group commit (lmdb)")
+    ("group-commit-max-batch", po::value<size_t>(&group_commit_max_batch)->default_value(64), "max requests per commit (lmdb)")
+    ("group-commit-max-delay-us", po::value<uint64_t>(&group_commit_max_delay_us)->default_value(0), "max wait for a commit batch to fill (lmdb)")
+    ("compare-group-commit", po::bool_switch(&compare_gc), "run the workload with group commit off and on, and report the speedup (lmdb)")
   ;
 
   po::variables_map vm;
@@ -197,6 +320,32 @@ int main(int argc, char **argv)
     }
   } else if (backend_name == "lmdb") {
     options.backend_options["path"] = db_path;
+    if (group_commit) {
+      options.backend_options["group_commit"] = "true";
+      options.backend_options["group_commit_max_batch"] =
+        std::to_string(group_commit_max_batch);
+      options.backend_options["group_commit_max_delay_us"] =
+        std::to_string(group_commit_max_delay_us);
+    }
+  }
+
+  if (compare_gc) {
+    if (backend_name != "lmdb" || runtime == 0) {
+      std::cerr << "group commit comparison requires "
+        "the lmdb backend and a runtime" << std::endl;
+      return -1;
+    }
+
+    signal(SIGINT, sig_handler);
+
+    rand_data_gen dgen(1ULL << 22, entry_size);
+    dgen.generate();
+
+    shutdown = false;
+
+    return compare_group_commit(db_path, prefix, width, slots, entry_size,
+        qdepth, runtime, max_pos, group_commit_max_batch,
+        group_commit_max_delay_us, &dgen);
   }
 
   std::shared_ptr<zlog::Backend> backend;
@@ -216,32 +365,13 @@ int main(int argc, char **argv)
   shutdown = false;
   seq = 0;
 
-  const auto slots_per_row = width * slots;
-  const auto num_rows = max_pos / slots_per_row;
-  std::vector<std::vector<std::string>> objects;
-  for (auto row = 0u; row < num_rows; row++) {
-    std::vector<std::string> tmp;
-    for (auto col = 0u; col < width; col++) {
-      std::stringstream ss;
-      ss << prefix << "." << row << "." << col;
-      auto oid = ss.str();
-      int ret = backend->Seal(oid, 1);
-      if (ret) {
-        std::cerr << "seal error: " << strerror(-ret) << std::endl;
-        assert(0);
-      }
-      tmp.push_back(ss.str());
-    }
-    if (shutdown) {
-      break;
-    }
-    objects.push_back(tmp);
-  }
+  const auto objects = init_objects(backend, prefix, width, slots, max_pos);
 
+  std::atomic<bool> stop(false);
   std::vector<std::thread> io_threads;
   for (int i = 0; i < qdepth; i++) {
     io_threads.emplace_back(std::thread(io_entry, backend, objects,
-          width, slots, entry_size, max_pos, &dgen));
+          width, slots, entry_size, max_pos, &dgen, &stop));
   }
 
   std::thread stats_thread(stats_entry);
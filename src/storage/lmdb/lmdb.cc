@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <vector>
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -54,6 +57,25 @@ int LMDBBackend::Initialize(
 
   Init(it->second);
 
+  // group commit is off unless requested
+  it = opts.find("group_commit");
+  if (it != opts.end() && (it->second == "true" || it->second == "1")) {
+    size_t max_batch = 64;
+    uint64_t max_delay_us = 0;
+
+    it = opts.find("group_commit_max_batch");
+    if (it != opts.end()) {
+      max_batch = std::strtoull(it->second.c_str(), nullptr, 10);
+    }
+
+    it = opts.find("group_commit_max_delay_us");
+    if (it != opts.end()) {
+      max_delay_us = std::strtoull(it->second.c_str(), nullptr, 10);
+    }
+
+    EnableGroupCommit(max_batch, max_delay_us);
+  }
+
   return 0;
 }
 
@@ -418,6 +440,13 @@ int LMDBBackend::ProposeView(const std::string& hoid,
 
 int LMDBBackend::Write(const std::string& oid, const std::string& data,
     uint64_t epoch, uint64_t position)
+{
+  const Slice slice(data);
+  return WriteV(oid, &slice, 1, epoch, position);
+}
+
+int LMDBBackend::WriteV(const std::string& oid, const Slice *data,
+    size_t count, uint64_t epoch, uint64_t position)
 {
   if (oid.empty()) {
     return -EINVAL;
@@ -427,19 +456,44 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
     return -EINVAL;
   }
 
+  if (group_commit) {
+    CommitRequest req;
+    req.type = CommitRequest::WRITE;
+    req.oid = oid;
+    req.epoch = epoch;
+    req.position = position;
+    req.data = data;
+    req.count = count;
+    return SubmitCommitWait(std::move(req));
+  }
+
   auto txn = NewTransaction();
 
-  int ret = CheckEpoch(txn, epoch, oid);
+  int ret = ApplyWrite(txn, oid, data, count, epoch, position);
   if (ret) {
     txn.Abort();
     return ret;
   }
 
+  ret = txn.Commit();
+  if (ret)
+    return ret;
+
+  return 0;
+}
+
+int LMDBBackend::ApplyWrite(Transaction& txn, const std::string& oid,
+    const Slice *data, size_t count, uint64_t epoch, uint64_t position)
+{
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    return ret;
+  }
+
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
@@ -448,7 +502,6 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
     lobj = *((LogObject*)val.mv_data);
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      txn.Abort();
       return -EROFS;
     }
   }
@@ -460,7 +513,6 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
   ret = txn.Get(maxkey, maxval);
   // TODO: enoent here?
   if (ret < 0 && ret != -ENOENT) {
-    txn.Abort();
     return ret;
   } else if (ret == 0) {
     LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
@@ -470,21 +522,28 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
 
   LogEntry entry;
   entry.position = position;
-  const size_t size = sizeof(entry) + data.size();
-  std::vector<unsigned char> blob;
-  blob.reserve(size);
-  blob.insert(blob.end(), (unsigned char *)&entry,
-      ((unsigned char *)&entry) + sizeof(entry));
-  blob.insert(blob.end(), (unsigned char *)data.data(),
-      ((unsigned char *)data.data()) + data.size());
+  size_t size = sizeof(entry);
+  for (size_t i = 0; i < count; i++) {
+    size += data[i].size;
+  }
 
+  // the entry is copied directly into space reserved in the database, rather
+  // than being assembled into a temporary buffer first.
+  void *blob;
   std::string key = LogEntryKey(oid, position);
-  ret = txn.Put(key, blob, true);
+  ret = txn.Reserve(key, size, &blob, true);
   if (ret == -EEXIST) {
-    txn.Abort();
     return -EROFS;
   }
 
+  auto dst = static_cast<char*>(blob);
+  std::memcpy(dst, &entry, sizeof(entry));
+  dst += sizeof(entry);
+  for (size_t i = 0; i < count; i++) {
+    std::memcpy(dst, data[i].data, data[i].size);
+    dst += data[i].size;
+  }
+
   // update max pos
   LogMaxPos new_maxpos;
   new_maxpos.maxpos = std::max(pos, position);
@@ -492,13 +551,105 @@ int LMDBBackend::Write(const std::string& oid, const std::string& data,
   maxval.mv_size = sizeof(new_maxpos);
   txn.Put(maxkey, maxval, false);
 
-  ret = txn.Commit();
-  if (ret)
-    return ret;
-
   return 0;
 }
 
+void LMDBBackend::WriteBatch(const std::string& oid, const uint64_t epoch,
+    const uint64_t *positions, const Slice *data, const size_t count,
+    int *results)
+{
+  if (oid.empty() || epoch == 0) {
+    std::fill(results, results + count, -EINVAL);
+    return;
+  }
+
+  // the batch is applied in a single write transaction, so the epoch check,
+  // object metadata reads, and commit are paid once rather than per entry.
+  auto txn = NewTransaction();
+
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    txn.Abort();
+    std::fill(results, results + count, ret);
+    return;
+  }
+
+  LogObject lobj;
+  {
+    MDB_val val;
+    ret = txn.Get(oid, val);
+    if (ret) {
+      txn.Abort();
+      std::fill(results, results + count, ret);
+      return;
+    }
+    assert(val.mv_size == sizeof(lobj));
+    lobj = *((LogObject*)val.mv_data);
+  }
+
+  uint64_t pos = 0;
+  MDB_val maxval;
+  auto maxkey = MaxPosKey(oid);
+  ret = txn.Get(maxkey, maxval);
+  if (ret < 0 && ret != -ENOENT) {
+    txn.Abort();
+    std::fill(results, results + count, ret);
+    return;
+  } else if (ret == 0) {
+    LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
+    assert(maxval.mv_size == sizeof(*maxpos));
+    pos = maxpos->maxpos;
+  }
+
+  bool written = false;
+  for (size_t i = 0; i < count; i++) {
+    const auto position = positions[i];
+    if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
+      results[i] = -EROFS;
+      continue;
+    }
+
+    LogEntry entry;
+    entry.position = position;
+
+    void *blob;
+    std::string key = LogEntryKey(oid, position);
+    ret = txn.Reserve(key, sizeof(entry) + data[i].size, &blob, true);
+    if (ret == -EEXIST) {
+      results[i] = -EROFS;
+      continue;
+    }
+
+    auto dst = static_cast<char*>(blob);
+    std::memcpy(dst, &entry, sizeof(entry));
+    std::memcpy(dst + sizeof(entry), data[i].data, data[i].size);
+
+    pos = std::max(pos, position);
+    results[i] = 0;
+    written = true;
+  }
+
+  if (!written) {
+    txn.Abort();
+    return;
+  }
+
+  LogMaxPos new_maxpos;
+  new_maxpos.maxpos = pos;
+  maxval.mv_data = &new_maxpos;
+  maxval.mv_size = sizeof(new_maxpos);
+  txn.Put(maxkey, maxval, false);
+
+  ret = txn.Commit();
+  if (ret) {
+    for (size_t i = 0; i < count; i++) {
+      if (!results[i]) {
+        results[i] = ret;
+      }
+    }
+  }
+}
+
 int LMDBBackend::Read(const std::string& oid, uint64_t epoch,
     uint64_t position, std::string *data)
 {
@@ -563,6 +714,70 @@ int LMDBBackend::Read(const std::string& oid, uint64_t epoch,
   return 0;
 }
 
+void LMDBBackend::ReadBatch(const std::string& oid, const uint64_t epoch,
+    const uint64_t *positions, const size_t count, std::string *data_out,
+    int *results)
+{
+  if (oid.empty() || epoch == 0) {
+    std::fill(results, results + count, -EINVAL);
+    return;
+  }
+
+  // all of the positions are read in one read-only transaction
+  auto txn = NewTransaction(true);
+
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    txn.Abort();
+    std::fill(results, results + count, ret);
+    return;
+  }
+
+  LogObject lobj;
+  {
+    MDB_val val;
+    ret = txn.Get(oid, val);
+    if (ret) {
+      txn.Abort();
+      std::fill(results, results + count, ret);
+      return;
+    }
+    assert(val.mv_size == sizeof(lobj));
+    lobj = *((LogObject*)val.mv_data);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const auto position = positions[i];
+    if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
+      results[i] = -ENODATA;
+      continue;
+    }
+
+    MDB_val val;
+    ret = txn.Get(LogEntryKey(oid, position), val);
+    if (ret) {
+      results[i] = ret == -ENOENT ? -ERANGE : ret;
+      continue;
+    }
+
+    LogEntry *entry = (LogEntry*)val.mv_data;
+    assert(entry->position == position);
+    if (entry->trimmed || entry->invalidated) {
+      results[i] = -ENODATA;
+      continue;
+    }
+
+    const char *blob = (const char *)val.mv_data + sizeof(*entry);
+    data_out[i].assign(blob, val.mv_size - sizeof(*entry));
+    results[i] = 0;
+  }
+
+  ret = txn.Commit();
+  if (ret) {
+    std::fill(results, results + count, ret);
+  }
+}
+
 int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     uint64_t position, bool trim_limit, bool trim_full)
 {
@@ -578,19 +793,44 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
+  if (group_commit) {
+    CommitRequest req;
+    req.type = CommitRequest::TRIM;
+    req.oid = oid;
+    req.epoch = epoch;
+    req.position = position;
+    req.trim_limit = trim_limit;
+    req.trim_full = trim_full;
+    return SubmitCommitWait(std::move(req));
+  }
+
   auto txn = NewTransaction();
 
-  int ret = CheckEpoch(txn, epoch, oid);
+  int ret = ApplyTrim(txn, oid, epoch, position, trim_limit, trim_full);
   if (ret) {
     txn.Abort();
     return ret;
   }
 
+  ret = txn.Commit();
+  if (ret)
+    return ret;
+
+  return 0;
+}
+
+int LMDBBackend::ApplyTrim(Transaction& txn, const std::string& oid,
+    uint64_t epoch, uint64_t position, bool trim_limit, bool trim_full)
+{
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    return ret;
+  }
+
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
@@ -605,14 +845,6 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
         lobj.trim_limit = position;
     }
 
-    val.mv_data = &lobj;
-    val.mv_size = sizeof(lobj);
-    ret = txn.Put(oid, val, false);
-    if (ret) {
-      txn.Abort();
-      return ret;
-    }
-
     // TODO: trim full should probably set a max pos that isn't the global trim
     // limit for this operation instance as is the case now, but rather we
     // should add metadata to each object so it can be set correctly and catch
@@ -623,6 +855,10 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
     //
     // only removing data when trim full is set to behave like ceph backend.
     // see note on trim method in ram.cc.
+    //
+    // the keys to delete are collected before anything is modified so that a
+    // failure leaves the transaction untouched.
+    std::vector<std::string> delete_keys;
     if (trim_full) {
       std::stringstream ss;
       ss << oid << ".entry.";
@@ -631,12 +867,9 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
       std::vector<MDB_val> keys;
       int ret = txn.GetAll(prefix, keys);
       if (ret) {
-        txn.Abort();
         return ret;
       }
 
-      std::vector<std::string> delete_keys;
-
       // scan the keys from the cursor first. the docs make it sound like the
       // key pointers won't remain valid if we start mutating things.
       for (auto k : keys) {
@@ -644,7 +877,6 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
         std::string key((char*)k.mv_data, k.mv_size);
         ret = txn.Get(key, val);
         if (ret) {
-          txn.Abort();
           return ret;
         }
 
@@ -652,22 +884,25 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
 
         delete_keys.push_back(key);
       }
+    }
 
+    val.mv_data = &lobj;
+    val.mv_size = sizeof(lobj);
+    ret = txn.Put(oid, val, false);
+    if (ret) {
+      return ret;
+    }
+
+    if (trim_full) {
       for (auto key : delete_keys) {
         ret = txn.Delete(key);
-        if (ret) {
-          txn.Abort();
-          return ret;
-        }
+        // the keys were just read in this transaction
+        ZLOG_LMDB_ASSERT(ret, ret == 0);
       }
-
-      return txn.Commit();
+      return 0;
     }
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      ret = txn.Commit();
-      if (ret)
-        return ret;
       return 0;
     }
   }
@@ -695,7 +930,6 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
   auto maxkey = MaxPosKey(oid);
   ret = txn.Get(maxkey, maxval);
   if (ret < 0 && ret != -ENOENT) {
-    txn.Abort();
     return ret;
   } else if (ret == 0) {
     LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
@@ -716,14 +950,7 @@ int LMDBBackend::Trim(const std::string& oid, uint64_t epoch,
   val.mv_data = &entry;
 
   ret = txn.Put(key, val, false);
-  if (ret) {
-    txn.Abort();
-    return ret;
-  }
-
-  ret = txn.Commit();
-  if (ret)
-    return ret;
+  assert(ret == 0);
 
   return 0;
 }
@@ -739,19 +966,42 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
+  if (group_commit) {
+    CommitRequest req;
+    req.type = CommitRequest::FILL;
+    req.oid = oid;
+    req.epoch = epoch;
+    req.position = position;
+    return SubmitCommitWait(std::move(req));
+  }
+
   auto txn = NewTransaction();
 
-  int ret = CheckEpoch(txn, epoch, oid);
+  int ret = ApplyFill(txn, oid, epoch, position);
   if (ret) {
     txn.Abort();
     return ret;
   }
 
+  ret = txn.Commit();
+  if (ret)
+    return ret;
+
+  return 0;
+}
+
+int LMDBBackend::ApplyFill(Transaction& txn, const std::string& oid,
+    uint64_t epoch, uint64_t position)
+{
+  int ret = CheckEpoch(txn, epoch, oid);
+  if (ret) {
+    return ret;
+  }
+
   {
     MDB_val val;
     ret = txn.Get(oid, val);
     if (ret) {
-      txn.Abort();
       return ret;
     }
 
@@ -760,7 +1010,6 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
     lobj = *((LogObject*)val.mv_data);
 
     if (lobj.trim_limit >= 0 && position <= uint64_t(lobj.trim_limit)) {
-      txn.Abort();
       return 0;
     }
   }
@@ -775,10 +1024,8 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
     entry = *((LogEntry*)val.mv_data);
     assert(entry.position == position);
     if (entry.trimmed || entry.invalidated) {
-      txn.Abort();
       return 0;
     }
-    txn.Abort();
     return -EROFS;
   }
 
@@ -790,7 +1037,6 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
   auto maxkey = MaxPosKey(oid);
   ret = txn.Get(maxkey, maxval);
   if (ret < 0 && ret != -ENOENT) {
-    txn.Abort();
     return ret;
   } else if (ret == 0) {
     LogMaxPos *maxpos = (LogMaxPos*)maxval.mv_data;
@@ -812,16 +1058,243 @@ int LMDBBackend::Fill(const std::string& oid, uint64_t epoch,
   val.mv_data = &entry;
 
   ret = txn.Put(key, val, false);
-  if (ret) {
-    txn.Abort();
-    return ret;
+  assert(ret == 0);
+
+  return 0;
+}
+
+void LMDBBackend::WriteAsync(const std::string& oid, const std::string& data,
+    uint64_t epoch, uint64_t position, std::function<void(int)> cb)
+{
+  if (!group_commit || oid.empty() || epoch == 0) {
+    Backend::WriteAsync(oid, data, epoch, position, cb);
+    return;
+  }
+
+  CommitRequest req;
+  req.type = CommitRequest::WRITE;
+  req.oid = oid;
+  req.epoch = epoch;
+  req.position = position;
+  req.data = nullptr;
+  req.count = 1;
+  req.single = Slice(data);
+  req.cb = std::move(cb);
+  SubmitCommit(std::move(req));
+}
+
+void LMDBBackend::WriteVAsync(const std::string& oid, const Slice *data,
+    size_t count, uint64_t epoch, uint64_t position,
+    std::function<void(int)> cb)
+{
+  if (!group_commit || oid.empty() || epoch == 0) {
+    Backend::WriteVAsync(oid, data, count, epoch, position, cb);
+    return;
+  }
+
+  CommitRequest req;
+  req.type = CommitRequest::WRITE;
+  req.oid = oid;
+  req.epoch = epoch;
+  req.position = position;
+  req.data = data;
+  req.count = count;
+  req.cb = std::move(cb);
+  SubmitCommit(std::move(req));
+}
+
+void LMDBBackend::FillAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, std::function<void(int)> cb)
+{
+  if (!group_commit || oid.empty() || epoch == 0) {
+    Backend::FillAsync(oid, epoch, position, cb);
+    return;
+  }
+
+  CommitRequest req;
+  req.type = CommitRequest::FILL;
+  req.oid = oid;
+  req.epoch = epoch;
+  req.position = position;
+  req.cb = std::move(cb);
+  SubmitCommit(std::move(req));
+}
+
+void LMDBBackend::TrimAsync(const std::string& oid, uint64_t epoch,
+    uint64_t position, bool trim_limit, bool trim_full,
+    std::function<void(int)> cb)
+{
+  if (!group_commit || oid.empty() || epoch == 0 ||
+      (trim_full && !trim_limit)) {
+    Backend::TrimAsync(oid, epoch, position, trim_limit, trim_full, cb);
+    return;
+  }
+
+  CommitRequest req;
+  req.type = CommitRequest::TRIM;
+  req.oid = oid;
+  req.epoch = epoch;
+  req.position = position;
+  req.trim_limit = trim_limit;
+  req.trim_full = trim_full;
+  req.cb = std::move(cb);
+  SubmitCommit(std::move(req));
+}
+
+void LMDBBackend::SubmitCommit(CommitRequest&& req)
+{
+  std::lock_guard<std::mutex> lk(commit_lock);
+  assert(!commit_stop);
+  commit_queue.emplace_back(std::move(req));
+  // the writer only needs a wake up to start a batch, or to cut short its
+  // wait for a batch to fill.
+  if (commit_queue.size() == 1 ||
+      commit_queue.size() == commit_max_batch) {
+    commit_cond.notify_one();
   }
+}
 
-  ret = txn.Commit();
-  if (ret)
-    return ret;
+int LMDBBackend::SubmitCommitWait(CommitRequest&& req)
+{
+  std::mutex lock;
+  std::condition_variable cond;
+  bool done = false;
+  int ret = 0;
 
-  return 0;
+  req.cb = [&](int r) {
+    std::lock_guard<std::mutex> lk(lock);
+    ret = r;
+    done = true;
+    cond.notify_one();
+  };
+
+  SubmitCommit(std::move(req));
+
+  std::unique_lock<std::mutex> lk(lock);
+  cond.wait(lk, [&] { return done; });
+
+  return ret;
+}
+
+int LMDBBackend::ApplyCommit(Transaction& txn, const CommitRequest& req)
+{
+  switch (req.type) {
+    case CommitRequest::WRITE:
+      if (req.data) {
+        return ApplyWrite(txn, req.oid, req.data, req.count, req.epoch,
+            req.position);
+      }
+      return ApplyWrite(txn, req.oid, &req.single, 1, req.epoch,
+          req.position);
+
+    case CommitRequest::FILL:
+      return ApplyFill(txn, req.oid, req.epoch, req.position);
+
+    case CommitRequest::TRIM:
+      return ApplyTrim(txn, req.oid, req.epoch, req.position,
+          req.trim_limit, req.trim_full);
+  }
+
+  assert(0);
+  return -EINVAL;
+}
+
+void LMDBBackend::CommitEntry()
+{
+  std::vector<CommitRequest> batch;
+  std::vector<int> results;
+
+  std::unique_lock<std::mutex> lk(commit_lock);
+
+  while (true) {
+    commit_cond.wait(lk, [&] {
+      return commit_stop || !commit_queue.empty();
+    });
+
+    if (commit_queue.empty()) {
+      assert(commit_stop);
+      break;
+    }
+
+    // trade latency for larger batches
+    if (commit_max_delay_us > 0 && !commit_stop &&
+        commit_queue.size() < commit_max_batch) {
+      commit_cond.wait_for(lk,
+          std::chrono::microseconds(commit_max_delay_us), [&] {
+        return commit_stop || commit_queue.size() >= commit_max_batch;
+      });
+    }
+
+    const auto count = std::min(commit_queue.size(), commit_max_batch);
+    for (size_t i = 0; i < count; i++) {
+      batch.emplace_back(std::move(commit_queue.front()));
+      commit_queue.pop_front();
+    }
+
+    lk.unlock();
+
+    // operations that fail don't modify the transaction, so they don't
+    // affect the other operations in the batch.
+    auto txn = NewTransaction();
+
+    bool modified = false;
+    results.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      results[i] = ApplyCommit(txn, batch[i]);
+      if (!results[i]) {
+        modified = true;
+      }
+    }
+
+    int ret = 0;
+    if (modified) {
+      ret = txn.Commit();
+    } else {
+      txn.Abort();
+    }
+
+    for (size_t i = 0; i < batch.size(); i++) {
+      batch[i].cb(results[i] ? results[i] : ret);
+    }
+
+    batch.clear();
+
+    lk.lock();
+  }
+}
+
+void LMDBBackend::EnableGroupCommit(size_t max_batch, uint64_t max_delay_us)
+{
+  assert(need_close);
+  assert(!group_commit);
+
+  commit_max_batch = std::max(max_batch, size_t(1));
+  commit_max_delay_us = max_delay_us;
+  commit_stop = false;
+  group_commit = true;
+
+  options["group_commit"] = "true";
+  options["group_commit_max_batch"] = std::to_string(commit_max_batch);
+  options["group_commit_max_delay_us"] = std::to_string(commit_max_delay_us);
+
+  commit_thread = std::thread(&LMDBBackend::CommitEntry, this);
+}
+
+void LMDBBackend::StopGroupCommit()
+{
+  if (!group_commit) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(commit_lock);
+    commit_stop = true;
+    commit_cond.notify_one();
+  }
+
+  // pending requests are drained before the writer exits
+  commit_thread.join();
+  group_commit = false;
 }
 
 int LMDBBackend::CheckEpoch(Transaction& txn, uint64_t epoch,
@@ -987,6 +1460,7 @@ void LMDBBackend::Init(const std::string& path)
 
 void LMDBBackend::Close()
 {
+  StopGroupCommit();
   need_close = false;
   mdb_env_sync(env, 1);
   mdb_env_close(env);
@@ -204,6 +204,79 @@ void LibZLogCAPITest::TearDown() {
   }
 }
 
+TEST(LMDBBackendTest, GroupCommit) {
+  DBPathContext context;
+  context.dbpath = strdup("/tmp/zlog.db.XXXXXX");
+  ASSERT_NE(mkdtemp(context.dbpath), nullptr);
+
+  zlog::storage::lmdb::LMDBBackend be;
+  be.Init(context.dbpath);
+  be.EnableGroupCommit(8, 100);
+  ASSERT_EQ(be.meta()["group_commit"], "true");
+
+  ASSERT_EQ(be.Write("", "x", 1, 0), -EINVAL);
+  ASSERT_EQ(be.Write("a", "x", 1, 0), -ENOENT);
+  ASSERT_EQ(be.Seal("a", 2), 0);
+  ASSERT_EQ(be.Write("a", "x", 1, 0), -ESPIPE);
+
+  std::mutex lock;
+  std::condition_variable cond;
+  int pending = 0;
+  int errors = 0;
+
+  // failed entries in a batch don't affect the others
+  std::vector<std::string> entries;
+  for (int i = 0; i < 100; i++) {
+    entries.push_back(std::to_string(i));
+  }
+  for (int i = 0; i < 100; i++) {
+    {
+      std::lock_guard<std::mutex> lk(lock);
+      pending += 2;
+    }
+    auto cb = [&](int ret) {
+      std::lock_guard<std::mutex> lk(lock);
+      if (ret) {
+        errors++;
+      }
+      pending--;
+      cond.notify_one();
+    };
+    be.WriteAsync("a", entries[i], 2, i, cb);
+    be.WriteAsync("a", entries[i], 2, i, cb);
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&] { return pending == 0; });
+  }
+  ASSERT_EQ(errors, 100);
+
+  std::string data;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(be.Read("a", 2, i, &data), 0);
+    ASSERT_EQ(data, entries[i]);
+  }
+
+  ASSERT_EQ(be.Fill("a", 2, 0), -EROFS);
+  ASSERT_EQ(be.Fill("a", 2, 100), 0);
+  ASSERT_EQ(be.Read("a", 2, 100, &data), -ENODATA);
+  ASSERT_EQ(be.Trim("a", 2, 5, false, false), 0);
+  ASSERT_EQ(be.Read("a", 2, 5, &data), -ENODATA);
+  ASSERT_EQ(be.Trim("a", 2, 10, false, true), -EINVAL);
+  ASSERT_EQ(be.Trim("a", 2, 10, true, false), 0);
+  ASSERT_EQ(be.Read("a", 2, 10, &data), -ENODATA);
+  ASSERT_EQ(be.Read("a", 2, 11, &data), 0);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(be.MaxPos("a", 2, &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 100u);
+
+  be.Close();
+}
+
 INSTANTIATE_TEST_CASE_P(Level, ZLogTest,
     ::testing::Values(
       std::make_tuple(true, true),
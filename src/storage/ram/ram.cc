@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include <atomic>
 #include <boost/algorithm/string.hpp>
@@ -277,27 +278,67 @@ int RAMBackend::Read(const std::string& oid, uint64_t epoch,
   }
 
   if (lobj) {
-    if (lobj->trim_limit && position <= *lobj->trim_limit) {
-      return -ENODATA;
-    }
+    return ReadEntry(*lobj, position, data);
+  } else {
+    return -ENOENT;
+  }
+}
 
-    const auto it = lobj->entries.find(position);
-    if (it == lobj->entries.end())
-      return -ERANGE;
+int RAMBackend::ReadEntry(const LogObject& lobj, const uint64_t position,
+    std::string *data)
+{
+  if (lobj.trim_limit && position <= *lobj.trim_limit) {
+    return -ENODATA;
+  }
 
-    const LogEntry& entry = it->second;
-    if (entry.trimmed || entry.invalidated)
-      return -ENODATA;
+  const auto it = lobj.entries.find(position);
+  if (it == lobj.entries.end())
+    return -ERANGE;
 
-    data->assign(entry.data);
-    return 0;
-  } else {
-    return -ENOENT;
+  const LogEntry& entry = it->second;
+  if (entry.trimmed || entry.invalidated)
+    return -ENODATA;
+
+  data->assign(entry.data);
+  return 0;
+}
+
+void RAMBackend::ReadBatch(const std::string& oid, const uint64_t epoch,
+    const uint64_t *positions, const size_t count, std::string *data_out,
+    int *results)
+{
+  if (oid.empty() || epoch == 0) {
+    std::fill(results, results + count, -EINVAL);
+    return;
+  }
+
+  // the whole batch is read under one acquisition of the backend lock
+  std::lock_guard<std::mutex> lk(lock_);
+
+  LogObject *lobj = nullptr;
+  int ret = CheckEpoch(epoch, oid, false, lobj);
+  if (!ret && !lobj) {
+    ret = -ENOENT;
+  }
+  if (ret) {
+    std::fill(results, results + count, ret);
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    results[i] = ReadEntry(*lobj, positions[i], &data_out[i]);
   }
 }
 
 int RAMBackend::Write(const std::string& oid, const std::string& data,
     uint64_t epoch, uint64_t position)
+{
+  const Slice slice(data);
+  return WriteV(oid, &slice, 1, epoch, position);
+}
+
+int RAMBackend::WriteV(const std::string& oid, const Slice *data,
+    size_t count, uint64_t epoch, uint64_t position)
 {
   if (oid.empty()) {
     return -EINVAL;
@@ -307,6 +348,21 @@ int RAMBackend::Write(const std::string& oid, const std::string& data,
     return -EINVAL;
   }
 
+  // gather the entry outside of the backend lock. this is the only copy of
+  // the data, which is then moved into place.
+  LogEntry entry;
+  if (!blackhole_) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+      size += data[i].size;
+    }
+    entry.data.reserve(size);
+    for (size_t i = 0; i < count; i++) {
+      entry.data.append(data[i].data, data[i].size);
+    }
+  }
+
+  Notification notify(this, oid);
   std::lock_guard<std::mutex> lk(lock_);
 
   LogObject *lobj = nullptr;
@@ -327,18 +383,67 @@ int RAMBackend::Write(const std::string& oid, const std::string& data,
 
   auto it = lobj->entries.find(position);
   if (it == lobj->entries.end()) {
-    LogEntry entry;
-    if (!blackhole_) {
-      entry.data = data;
-    }
-    lobj->entries.emplace(position, entry);
+    lobj->entries.emplace(position, std::move(entry));
     lobj->maxpos = std::max(lobj->maxpos, position);
+    notify.add(position, position);
     return 0;
   } else {
     return -EROFS;
   }
 }
 
+void RAMBackend::WriteBatch(const std::string& oid, const uint64_t epoch,
+    const uint64_t *positions, const Slice *data, const size_t count,
+    int *results)
+{
+  if (oid.empty() || epoch == 0) {
+    std::fill(results, results + count, -EINVAL);
+    return;
+  }
+
+  std::vector<LogEntry> entries(count);
+  if (!blackhole_) {
+    for (size_t i = 0; i < count; i++) {
+      entries[i].data.assign(data[i].data, data[i].size);
+    }
+  }
+
+  // the whole batch is applied under one acquisition of the backend lock
+  Notification notify(this, oid);
+  std::lock_guard<std::mutex> lk(lock_);
+
+  LogObject *lobj = nullptr;
+  int ret = CheckEpoch(epoch, oid, false, lobj);
+  if (ret) {
+    std::fill(results, results + count, ret);
+    return;
+  }
+
+  assert(lobj);
+  {
+    auto ret = objects_.emplace(oid, LogObject());
+    lobj = &boost::get<LogObject>(ret.first->second);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const auto position = positions[i];
+    if (lobj->trim_limit && position <= *lobj->trim_limit) {
+      results[i] = -EROFS;
+      continue;
+    }
+
+    auto it = lobj->entries.find(position);
+    if (it == lobj->entries.end()) {
+      lobj->entries.emplace(position, std::move(entries[i]));
+      lobj->maxpos = std::max(lobj->maxpos, position);
+      notify.add(position, position);
+      results[i] = 0;
+    } else {
+      results[i] = -EROFS;
+    }
+  }
+}
+
 int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
     const uint64_t position, bool trim_limit, bool trim_full)
 {
@@ -354,6 +459,7 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
+  Notification notify(this, oid);
   std::lock_guard<std::mutex> lk(lock_);
 
   LogObject *lobj = nullptr;
@@ -368,6 +474,7 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
   }
 
   if (trim_limit) {
+    notify.add(0, position);
     if (lobj->trim_limit)
       lobj->trim_limit = std::max(position, *lobj->trim_limit);
     else
@@ -406,6 +513,7 @@ int RAMBackend::Trim(const std::string& oid, uint64_t epoch,
     entry.data.clear();
     lobj->maxpos = std::max(lobj->maxpos, position);
   }
+  notify.add(position, position);
 
   return 0;
 }
@@ -449,6 +557,7 @@ int RAMBackend::Fill(const std::string& oid, uint64_t epoch,
     return -EINVAL;
   }
 
+  Notification notify(this, oid);
   std::lock_guard<std::mutex> lk(lock_);
 
   LogObject *lobj = nullptr;
@@ -473,6 +582,7 @@ int RAMBackend::Fill(const std::string& oid, uint64_t epoch,
     entry.invalidated = true;
     lobj->entries.emplace(position, entry);
     lobj->maxpos = std::max(lobj->maxpos, position);
+    notify.add(position, position);
     return 0;
   } else {
     auto& entry = it->second;
@@ -551,6 +661,48 @@ int RAMBackend::MaxPos(const std::string& oid, uint64_t epoch,
   return 0;
 }
 
+int RAMBackend::Watch(const std::string& prefix,
+    std::function<void(uint64_t, uint64_t)> cb, uint64_t *cookie)
+{
+  if (!cb || !cookie) {
+    return -EINVAL;
+  }
+
+  std::lock_guard<std::mutex> lk(watch_lock_);
+  *cookie = next_watch_cookie_++;
+  watches_.emplace(*cookie, std::make_pair(prefix, std::move(cb)));
+  num_watches_ = watches_.size();
+
+  return 0;
+}
+
+int RAMBackend::Unwatch(uint64_t cookie)
+{
+  std::lock_guard<std::mutex> lk(watch_lock_);
+  if (watches_.erase(cookie) == 0) {
+    return -ENOENT;
+  }
+  num_watches_ = watches_.size();
+
+  return 0;
+}
+
+void RAMBackend::Notify(const std::string& oid, const uint64_t first,
+    const uint64_t last)
+{
+  if (num_watches_ == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(watch_lock_);
+  for (const auto& watch : watches_) {
+    const auto& prefix = watch.second.first;
+    if (oid.compare(0, prefix.size(), prefix) == 0) {
+      watch.second.second(first, last);
+    }
+  }
+}
+
 int RAMBackend::CheckEpoch(uint64_t epoch, const std::string& oid,
     bool eq, LogObject*& lobj)
 {
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "zlog/log.h"
+#include "include/zlog/backend/ram.h"
+#include "port/stack_trace.h"
+
+// counts heap allocations made by every thread while enabled. this replaces
+// the global operator new, so these tests are built into their own binary.
+static std::atomic<bool> count_allocs(false);
+static std::atomic<uint64_t> num_allocs(0);
+
+void *operator new(size_t size)
+{
+  if (count_allocs.load(std::memory_order_relaxed)) {
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+  }
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+  free(p);
+}
+
+TEST(AllocTest, Append) {
+  // one stripe holds every entry, so the view isn't expanded while
+  // allocations are counted
+  zlog::Options options;
+  options.backend = std::make_shared<zlog::storage::ram::RAMBackend>();
+  options.create_if_missing = true;
+  options.error_if_exists = true;
+  options.stripe_slots = 1000;
+
+  zlog::Log *log;
+  ASSERT_EQ(zlog::Log::Open(options, "mylog", &log), 0);
+  std::unique_ptr<zlog::Log> log_ptr(log);
+
+  // warm up the op pool, and create the initial sequencer and stripes
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(log->Append(std::string(100, 'x'), nullptr), 0);
+  }
+
+  const uint64_t count = 1000;
+  std::vector<std::string> entries(count, std::string(100, 'x'));
+  std::vector<int> rets(count);
+
+  // the appends are synchronous, so nothing is in flight outside of the
+  // window
+  num_allocs = 0;
+  count_allocs = true;
+  for (size_t i = 0; i < count; i++) {
+    rets[i] = log->Append(std::move(entries[i]), nullptr);
+  }
+  count_allocs = false;
+
+  for (auto ret : rets) {
+    ASSERT_EQ(ret, 0);
+  }
+
+  // the payload is moved into the op, the op comes from the pool, and
+  // queueing is intrusive. the log makes one allocation per append, for the
+  // prefixed object name passed to the backend. the ram backend makes four:
+  // the copy of the entry, its map node, and a node and object name that
+  // are built to look up the object and then discarded. the slack covers
+  // the per-object entry tables of the backend growing, a few times each.
+  ASSERT_LE(num_allocs.load(), count * 5 + count / 20);
+}
+
+int main(int argc, char **argv)
+{
+  rocksdb::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
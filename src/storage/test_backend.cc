@@ -354,6 +354,140 @@ TEST_F(BackendTest, Write_MaxPos) {
   ASSERT_EQ(pos, 5000u);
 }
 
+TEST_F(BackendTest, WriteBatch) {
+  std::string data;
+  const uint64_t positions[] = {0, 1, 2, 1};
+  const zlog::Slice entries[] = {"a", "b", zlog::Slice(), "d"};
+  int results[4];
+
+  backend->WriteBatch("", 1, positions, entries, 4, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -EINVAL);
+  }
+
+  backend->WriteBatch("a", 1, positions, entries, 4, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -ENOENT);
+  }
+
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+  backend->WriteBatch("a", 9, positions, entries, 4, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -ESPIPE);
+  }
+
+  // each entry has its own result
+  ASSERT_EQ(backend->Fill("a", 10, 2), 0);
+  backend->WriteBatch("a", 10, positions, entries, 4, results);
+  ASSERT_EQ(results[0], 0);
+  ASSERT_EQ(results[1], 0);
+  ASSERT_EQ(results[2], -EROFS);
+  ASSERT_EQ(results[3], -EROFS);
+
+  ASSERT_EQ(backend->Read("a", 10, 0, &data), 0);
+  ASSERT_EQ(data, "a");
+  ASSERT_EQ(backend->Read("a", 10, 1, &data), 0);
+  ASSERT_EQ(data, "b");
+  ASSERT_EQ(backend->Read("a", 10, 2, &data), -ENODATA);
+
+  const uint64_t positions2[] = {7, 5};
+  backend->WriteBatch("a", 10, positions2, entries, 2, results);
+  ASSERT_EQ(results[0], 0);
+  ASSERT_EQ(results[1], 0);
+  ASSERT_EQ(backend->Read("a", 10, 5, &data), 0);
+  ASSERT_EQ(data, "b");
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(backend->MaxPos("a", 10, &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 7u);
+}
+
+TEST_F(BackendTest, ReadBatch) {
+  const uint64_t positions[] = {0, 1, 2, 3, 0};
+  std::string data[5];
+  int results[5];
+
+  backend->ReadBatch("", 1, positions, 5, data, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -EINVAL);
+  }
+
+  backend->ReadBatch("a", 1, positions, 5, data, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -ENOENT);
+  }
+
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+  backend->ReadBatch("a", 0, positions, 5, data, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -EINVAL);
+  }
+  backend->ReadBatch("a", 9, positions, 5, data, results);
+  for (auto ret : results) {
+    ASSERT_EQ(ret, -ESPIPE);
+  }
+
+  // each position has its own result
+  ASSERT_EQ(backend->Write("a", "x", 10, 0), 0);
+  ASSERT_EQ(backend->Write("a", "yy", 10, 1), 0);
+  ASSERT_EQ(backend->Fill("a", 10, 2), 0);
+  backend->ReadBatch("a", 10, positions, 5, data, results);
+  ASSERT_EQ(results[0], 0);
+  ASSERT_EQ(data[0], "x");
+  ASSERT_EQ(results[1], 0);
+  ASSERT_EQ(data[1], "yy");
+  ASSERT_EQ(results[2], -ENODATA);
+  ASSERT_EQ(results[3], -ERANGE);
+  ASSERT_EQ(results[4], 0);
+  ASSERT_EQ(data[4], "x");
+
+  ASSERT_EQ(backend->Trim("a", 10, 1, true, false), 0);
+  backend->ReadBatch("a", 10, positions, 4, data, results);
+  ASSERT_EQ(results[0], -ENODATA);
+  ASSERT_EQ(results[1], -ENODATA);
+  ASSERT_EQ(results[2], -ENODATA);
+  ASSERT_EQ(results[3], -ERANGE);
+
+  // a batch may be empty
+  backend->ReadBatch("a", 10, positions, 0, data, results);
+}
+
+TEST_F(BackendTest, WriteV) {
+  std::string data;
+  const std::string header("hdr:");
+  const std::string payload(1000, 'x');
+  const zlog::Slice slices[] = {header, payload, zlog::Slice()};
+
+  ASSERT_EQ(backend->WriteV("", slices, 3, 1, 0), -EINVAL);
+  ASSERT_EQ(backend->WriteV("a", slices, 3, 1, 0), -ENOENT);
+  ASSERT_EQ(backend->Seal("a", 10), 0);
+  ASSERT_EQ(backend->WriteV("a", slices, 3, 0, 0), -EINVAL);
+  ASSERT_EQ(backend->WriteV("a", slices, 3, 9, 0), -ESPIPE);
+
+  ASSERT_EQ(backend->WriteV("a", slices, 3, 10, 0), 0);
+  ASSERT_EQ(backend->Read("a", 10, 0, &data), 0);
+  ASSERT_EQ(data, header + payload);
+
+  ASSERT_EQ(backend->WriteV("a", slices, 3, 10, 0), -EROFS);
+  ASSERT_EQ(backend->Write("a", "", 10, 0), -EROFS);
+
+  // no slices is an empty entry
+  ASSERT_EQ(backend->WriteV("a", nullptr, 0, 10, 1), 0);
+  ASSERT_EQ(backend->Read("a", 10, 1, &data), 0);
+  ASSERT_EQ(data, "");
+
+  ASSERT_EQ(backend->Fill("a", 10, 2), 0);
+  ASSERT_EQ(backend->WriteV("a", slices, 1, 10, 2), -EROFS);
+
+  uint64_t pos;
+  bool empty;
+  ASSERT_EQ(backend->MaxPos("a", 10, &pos, &empty), 0);
+  ASSERT_FALSE(empty);
+  ASSERT_EQ(pos, 2u);
+}
+
 TEST_F(BackendTest, Read_Args) {
   std::string data;
   ASSERT_EQ(backend->Read("", 1, 0, &data), -EINVAL);
@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "zlog/backend.h"
+#include "zlog/log.h"
+#include "zlog/options.h"
+#include "libzlog/log_impl.h"
+
+namespace po = boost::program_options;
+
+// measures sequencer takeover time as a function of the number of stripes in
+// a log. for each stripe count a log is created and written up to its last
+// stripe, and then new log instances propose themselves as the sequencer,
+// sealing and reading the log's objects with each number of threads.
+
+static void fill_log(zlog::Log *log, uint64_t positions)
+{
+  const uint64_t batch_size = 1000;
+  while (positions > 0) {
+    const auto count = std::min(positions, batch_size);
+    std::vector<std::string> entries(count, "x");
+    std::vector<uint64_t> out;
+    int ret = log->AppendBatch(std::move(entries), &out);
+    if (ret) {
+      std::cerr << "append failed: " << strerror(-ret) << std::endl;
+      exit(1);
+    }
+    positions -= count;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string backend_name;
+  std::vector<std::string> backend_options;
+  std::vector<uint64_t> stripes;
+  std::vector<uint32_t> threads;
+  uint32_t stripe_width;
+  uint32_t stripe_slots;
+
+  po::options_description opts("Benchmark options");
+  opts.add_options()
+    ("help", "show help message")
+    ("backend-name", po::value<std::string>(&backend_name)->default_value("ram"), "backend name")
+    ("backend-opt", po::value<std::vector<std::string>>(&backend_options)->multitoken(), "backend options")
+    ("stripes", po::value<std::vector<uint64_t>>(&stripes)->multitoken(), "stripe counts (default 10 100 1000 4000)")
+    ("threads", po::value<std::vector<uint32_t>>(&threads)->multitoken(), "takeover thread counts (default 1 16)")
+    ("stripe-width", po::value<uint32_t>(&stripe_width)->default_value(10), "objects per stripe")
+    ("stripe-slots", po::value<uint32_t>(&stripe_slots)->default_value(5), "entries per object per stripe")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, opts), vm);
+
+  if (vm.count("help")) {
+    std::cout << opts << std::endl;
+    return 1;
+  }
+
+  po::notify(vm);
+
+  if (stripes.empty()) {
+    stripes = {10, 100, 1000, 4000};
+  }
+  if (threads.empty()) {
+    threads = {1, 16};
+  }
+
+  std::map<std::string, std::string> backend_opts;
+  for (auto option : backend_options) {
+    auto pos = option.find(":");
+    if (pos == std::string::npos) {
+      std::cerr << "invalid option " << option << std::endl;
+      return 1;
+    }
+    backend_opts[option.substr(0, pos)] = option.substr(pos + 1);
+  }
+
+  // log instances share the backend instance, which holds the log for the
+  // ram backend
+  std::shared_ptr<zlog::Backend> backend;
+  int ret = zlog::Backend::Load(backend_name, backend_opts, backend);
+  if (ret) {
+    std::cerr << "failed to load backend: " << strerror(-ret) << std::endl;
+    return 1;
+  }
+
+  zlog::Options options;
+  options.backend = backend;
+  options.stripe_width = stripe_width;
+  options.stripe_slots = stripe_slots;
+
+  const auto run = std::chrono::system_clock::now().time_since_epoch().count();
+
+  for (const auto num_stripes : stripes) {
+    const auto name = "takeover_bench." + std::to_string(run) + "." +
+      std::to_string(num_stripes);
+
+    options.create_if_missing = true;
+    options.error_if_exists = true;
+    zlog::Log *log;
+    ret = zlog::Log::Open(options, name, &log);
+    if (ret) {
+      std::cerr << "log::open failed: " << strerror(-ret) << std::endl;
+      return 1;
+    }
+    std::unique_ptr<zlog::Log> log_ptr(log);
+    fill_log(log, num_stripes * stripe_width * stripe_slots);
+
+    options.create_if_missing = false;
+    options.error_if_exists = false;
+
+    for (const auto t : threads) {
+      options.sequencer_takeover_threads = t;
+      zlog::Log *log2;
+      ret = zlog::Log::Open(options, name, &log2);
+      if (ret) {
+        std::cerr << "log::open failed: " << strerror(-ret) << std::endl;
+        return 1;
+      }
+      std::unique_ptr<zlog::Log> log2_ptr(log2);
+      auto log_impl = static_cast<zlog::LogImpl*>(log2);
+
+      const auto start = std::chrono::steady_clock::now();
+      ret = log_impl->striper->propose_sequencer();
+      const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+      if (ret) {
+        std::cerr << "propose failed: " << strerror(-ret) << std::endl;
+        return 1;
+      }
+
+      const auto view = log_impl->striper->view();
+      std::cout << "stripes " << view->object_map().num_stripes()
+        << " threads " << t
+        << " takeover_ms " << elapsed.count()
+        << " position " << (view->seq_config() ?
+            view->seq_config()->position() : 0)
+        << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include "util/crc32c.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ZLOG_CRC32C_X86 1
+#include <nmmintrin.h>
+#endif
+
+namespace zlog {
+namespace crc32c {
+
+// reflected crc32c (castagnoli) polynomial
+static const uint32_t kPoly = 0x82f63b78;
+
+// slicing-by-8 tables. table[0] is the classic byte-at-a-time table, and
+// table[k][b] is the crc of byte b followed by k zero bytes.
+struct Tables {
+  uint32_t table[8][256];
+
+  Tables() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? kPoly : 0);
+      }
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+      for (int k = 1; k < 8; k++) {
+        table[k][i] = (table[k - 1][i] >> 8) ^
+          table[0][table[k - 1][i] & 0xff];
+      }
+    }
+  }
+};
+
+static const Tables tables;
+
+static inline uint64_t load64(const char *p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t ExtendPortable(uint32_t init_crc, const char *data, size_t n)
+{
+  const auto& t = tables.table;
+  const auto *p = reinterpret_cast<const unsigned char*>(data);
+  uint32_t crc = init_crc ^ 0xffffffff;
+
+  // the tables assume little-endian loads
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (n >= 8) {
+    const uint64_t v = load64(reinterpret_cast<const char*>(p)) ^ crc;
+    crc = t[7][v & 0xff] ^
+      t[6][(v >> 8) & 0xff] ^
+      t[5][(v >> 16) & 0xff] ^
+      t[4][(v >> 24) & 0xff] ^
+      t[3][(v >> 32) & 0xff] ^
+      t[2][(v >> 40) & 0xff] ^
+      t[1][(v >> 48) & 0xff] ^
+      t[0][v >> 56];
+    p += 8;
+    n -= 8;
+  }
+#endif
+
+  while (n > 0) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    p++;
+    n--;
+  }
+
+  return crc ^ 0xffffffff;
+}
+
+#ifdef ZLOG_CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t ExtendHardware(uint32_t init_crc, const char *data, size_t n)
+{
+  uint64_t crc = init_crc ^ 0xffffffff;
+
+  while (n >= 8) {
+    crc = _mm_crc32_u64(crc, load64(data));
+    data += 8;
+    n -= 8;
+  }
+
+  uint32_t crc32 = static_cast<uint32_t>(crc);
+  while (n > 0) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<unsigned char>(*data));
+    data++;
+    n--;
+  }
+
+  return crc32 ^ 0xffffffff;
+}
+
+// four independent streams. the crc32 instruction has a latency of three
+// cycles and a throughput of one per cycle, so the streams proceed in
+// parallel.
+__attribute__((target("sse4.2")))
+static void ValueBatch4Hardware(const Slice *data, uint32_t *crcs)
+{
+  const char *p[4];
+  size_t n[4];
+  uint64_t crc[4];
+  for (int i = 0; i < 4; i++) {
+    p[i] = data[i].data;
+    n[i] = data[i].size;
+    crc[i] = 0xffffffff;
+  }
+
+  size_t common = n[0];
+  for (int i = 1; i < 4; i++) {
+    if (n[i] < common) {
+      common = n[i];
+    }
+  }
+  common &= ~size_t(7);
+
+  for (size_t off = 0; off < common; off += 8) {
+    crc[0] = _mm_crc32_u64(crc[0], load64(p[0] + off));
+    crc[1] = _mm_crc32_u64(crc[1], load64(p[1] + off));
+    crc[2] = _mm_crc32_u64(crc[2], load64(p[2] + off));
+    crc[3] = _mm_crc32_u64(crc[3], load64(p[3] + off));
+  }
+
+  for (int i = 0; i < 4; i++) {
+    // ExtendHardware expects and returns a finalized crc
+    crcs[i] = ExtendHardware(static_cast<uint32_t>(crc[i]) ^ 0xffffffff,
+        p[i] + common, n[i] - common);
+  }
+}
+
+static bool cpu_has_sse42()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+static const bool fast_crc32 = cpu_has_sse42();
+#else
+static const bool fast_crc32 = false;
+#endif
+
+bool IsFastCrc32Supported()
+{
+  return fast_crc32;
+}
+
+uint32_t Extend(uint32_t init_crc, const char *data, size_t n)
+{
+#ifdef ZLOG_CRC32C_X86
+  if (fast_crc32) {
+    return ExtendHardware(init_crc, data, n);
+  }
+#endif
+  return ExtendPortable(init_crc, data, n);
+}
+
+void ValueBatch(const Slice *data, size_t count, uint32_t *crcs)
+{
+  size_t i = 0;
+#ifdef ZLOG_CRC32C_X86
+  if (fast_crc32) {
+    for (; i + 4 <= count; i += 4) {
+      ValueBatch4Hardware(data + i, crcs + i);
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    crcs[i] = Extend(0, data[i].data, data[i].size);
+  }
+}
+
+}
+}
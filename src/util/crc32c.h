@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "include/zlog/slice.h"
+
+namespace zlog {
+namespace crc32c {
+
+// true if the crc32 instruction from SSE4.2 is used
+bool IsFastCrc32Supported();
+
+// return the crc32c of concat(A, data[0,n-1]) where init_crc is the crc32c
+// of some string A. Extend() is often used to maintain the crc32c of a stream
+// of data.
+uint32_t Extend(uint32_t init_crc, const char *data, size_t n);
+
+// return the crc32c of data[0,n-1]
+inline uint32_t Value(const char *data, size_t n) {
+  return Extend(0, data, n);
+}
+
+// set crcs[i] to the crc32c of data[i]. independent buffers are processed in
+// an interleaved fashion, which hides the latency of the crc32 instruction
+// and is considerably faster than computing each crc separately when the
+// buffers are small.
+void ValueBatch(const Slice *data, size_t count, uint32_t *crcs);
+
+// the portable implementation, used when the hardware doesn't support
+// crc32c. exposed for testing and benchmarking.
+uint32_t ExtendPortable(uint32_t init_crc, const char *data, size_t n);
+
+}
+}
@@ -5,6 +5,7 @@
 #include <string>
 #include <boost/program_options.hpp>
 #include "zlog/backend.h"
+#include "zlog/cursor.h"
 #include "zlog/log.h"
 #include "zlog/options.h"
 #include "libzlog/striper.h"
@@ -291,28 +292,41 @@ int handle_log(std::vector<std::string> command, std::shared_ptr<zlog::Backend>
       std::cerr << "log::CheckTail " << ret << std::endl;
       return ret;
     }
-    std::string data;
-    for (uint64_t i = 0; i < tail; ++i) {
-      int ret = log->Read(i, &data);
-      switch (ret) {
+    zlog::LogCursor *pcursor;
+    ret = zlog::LogCursor::Create(log.get(), 0, tail,
+        zlog::LogCursorOptions(), &pcursor);
+    if (ret != 0) {
+      std::cerr << "logcursor::Create " << ret << std::endl;
+      return ret;
+    }
+    std::unique_ptr<zlog::LogCursor> cursor(pcursor);
+    zlog::LogEntry entry;
+    while ((ret = cursor->Next(&entry)) == 0) {
+      const auto i = entry.position;
+      switch (entry.ret) {
         case 0:
           break;
         case -ENODATA:
           std::cerr << i << ": invalidated" << std::endl;
           continue;
-        case -ERANGE:
+        case -ENOENT:
           std::cerr << i << ": free" << std::endl;
           continue;
         default:
-          std::cerr << "log::Read " << ret << std::endl;
-          return ret;
+          std::cerr << "log::Read " << entry.ret << std::endl;
+          return entry.ret;
       }
       std::cout << i << ": ";
-      for (char c : data.substr(0, 80)) {
-        std::cout << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(c);
+      for (char c : entry.data.substr(0, 80)) {
+        std::cout << std::setfill('0') << std::setw(2) << std::hex
+          << static_cast<int>(static_cast<unsigned char>(c)) << std::dec;
       }
       std::cout << std::endl;
     }
+    if (ret != -ERANGE) {
+      std::cerr << "logcursor::Next " << ret << std::endl;
+      return ret;
+    }
     return 0;
   } else if (command[0] == "read") {
     if (command.size() != 3) { // read <log name> <position>